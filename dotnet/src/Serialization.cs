@@ -23,6 +23,18 @@ namespace Microsoft.Research.SEAL
 
         /// <summary>Use Deflate compression.</summary>
         Deflate = 1,
+
+        /// <summary>Bit-pack ciphertext and key coefficients.</summary>
+        BitPack = 2,
+
+        /// <summary>
+        /// Bit-pack ciphertext and key coefficients and use fast Deflate compression
+        /// on the result.
+        /// </summary>
+        BitPackDeflate = 3,
+
+        /// <summary>Use Zstandard compression.</summary>
+        Zstd = 4,
     }
 
     /// <summary>Class to provide functionality for serialization.</summary>
@@ -702,6 +702,128 @@ void example_ckks_performance_custom()
     ckks_performance_test(SEALContext::Create(parms));
 }
 
+void prng_performance_test(
+    const string &name, shared_ptr<UniformRandomGeneratorFactory> factory)
+{
+    /*
+    We measure the throughput of generating random bytes in blocks of 32 KB,
+    roughly the amount consumed by sampling one uniformly random RNS component
+    with poly_modulus_degree 4096, for a few different randomness buffer sizes.
+    */
+    constexpr size_t block_byte_count = 32768;
+    constexpr size_t total_byte_count = size_t(1) << 27;
+    vector<SEAL_BYTE> block(block_byte_count);
+
+    for (size_t buffer_size : { size_t(4096), size_t(16384), size_t(65536) })
+    {
+        factory->set_buffer_size(buffer_size);
+        auto generator = factory->create();
+
+        auto time_start = chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < total_byte_count / block_byte_count; i++)
+        {
+            generator->generate(block_byte_count, block.data());
+        }
+        auto time_end = chrono::high_resolution_clock::now();
+        auto time_diff = chrono::duration_cast<chrono::microseconds>(time_end - time_start);
+        double megabytes_per_second = static_cast<double>(total_byte_count) /
+            static_cast<double>(time_diff.count());
+
+        cout << setw(10) << name << " (buffer " << setw(5) << buffer_size << " bytes): "
+            << fixed << setprecision(1) << megabytes_per_second << " MB/s" << endl;
+    }
+}
+
+void example_prng_performance()
+{
+    print_example_banner("Random Number Generator Performance Test");
+
+    prng_performance_test("Blake2xb", make_shared<BlakePRNGFactory>());
+    prng_performance_test("AES-CTR", make_shared<AESPRNGFactory>());
+    prng_performance_test("SHAKE-128", make_shared<Shake128PRNGFactory>());
+    cout.flush();
+}
+
+template<typename T>
+void serialization_performance_test(
+    const string &name, const T &object, shared_ptr<SEALContext> context)
+{
+    /*
+    We measure the size of the output and the time to save and load the given
+    object in every compression mode supported by this build. Zstandard can also
+    compress large objects in parallel chunks, here using all hardware threads.
+    */
+    vector<pair<string, CompressionParameters>> compr_modes{
+        { "none", compr_mode_type::none },
+        { "bitpack", compr_mode_type::bitpack },
+#ifdef SEAL_USE_ZLIB
+        { "deflate", compr_mode_type::deflate },
+        { "bitpack_deflate", compr_mode_type::bitpack_deflate },
+#endif
+#ifdef SEAL_USE_ZSTD
+        { "zstd", compr_mode_type::zstd },
+        { "zstd_threads", CompressionParameters(compr_mode_type::zstd,
+            CompressionParameters::zstd_level_default, 0) },
+#endif
+    };
+    constexpr int count = 10;
+
+    for (auto &compr_mode : compr_modes)
+    {
+        stringstream stream;
+        T loaded;
+        streamoff byte_count = 0;
+
+        auto time_start = chrono::high_resolution_clock::now();
+        for (int i = 0; i < count; i++)
+        {
+            stream.str("");
+            byte_count = object.save(stream, compr_mode.second);
+        }
+        auto time_end = chrono::high_resolution_clock::now();
+        auto time_save = chrono::duration_cast<chrono::microseconds>(time_end - time_start);
+
+        string saved = stream.str();
+        time_start = chrono::high_resolution_clock::now();
+        for (int i = 0; i < count; i++)
+        {
+            stringstream load_stream(saved);
+            loaded.load(context, load_stream);
+        }
+        time_end = chrono::high_resolution_clock::now();
+        auto time_load = chrono::duration_cast<chrono::microseconds>(time_end - time_start);
+
+        cout << setw(11) << name << " " << setw(16) << compr_mode.first << ": "
+            << setw(10) << byte_count << " bytes, save "
+            << setw(7) << time_save.count() / count << " us, load "
+            << setw(7) << time_load.count() / count << " us" << endl;
+    }
+}
+
+void example_serialization_performance()
+{
+    print_example_banner("Serialization Performance Test with Degree: 8192");
+
+    EncryptionParameters parms(scheme_type::BFV);
+    size_t poly_modulus_degree = 8192;
+    parms.set_poly_modulus_degree(poly_modulus_degree);
+    parms.set_coeff_modulus(CoeffModulus::BFVDefault(poly_modulus_degree));
+    parms.set_plain_modulus(786433);
+    auto context = SEALContext::Create(parms);
+    print_parameters(context);
+    cout << endl;
+
+    KeyGenerator keygen(context);
+    Encryptor encryptor(context, keygen.public_key());
+    Ciphertext encrypted;
+    encryptor.encrypt(Plaintext("1x^3 + 2x^2 + 3"), encrypted);
+    auto gal_keys = keygen.galois_keys();
+
+    serialization_performance_test("Ciphertext", encrypted, context);
+    serialization_performance_test("GaloisKeys", gal_keys, context);
+    cout.flush();
+}
+
 /*
 Prints a sub-menu to select the performance test.
 */
@@ -717,10 +839,12 @@ void example_performance_test()
         cout << "  2. BFV with a custom degree" << endl;
         cout << "  3. CKKS with default degrees" << endl;
         cout << "  4. CKKS with a custom degree" << endl;
+        cout << "  5. Random number generators" << endl;
+        cout << "  6. Serialization" << endl;
         cout << "  0. Back to main menu" << endl;
 
         int selection = 0;
-        cout << endl << "> Run performance test (1 ~ 4) or go back (0): ";
+        cout << endl << "> Run performance test (1 ~ 6) or go back (0): ";
         if (!(cin >> selection))
         {
             cout << "Invalid option." << endl;
@@ -747,6 +871,14 @@ void example_performance_test()
             example_ckks_performance_custom();
             break;
 
+        case 5:
+            example_prng_performance();
+            break;
+
+        case 6:
+            example_serialization_performance();
+            break;
+
         case 0:
             cout << endl;
             return;
@@ -6,6 +6,7 @@
 #include <cstddef>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <iomanip>
 #include <vector>
 #include <string>
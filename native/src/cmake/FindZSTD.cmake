@@ -0,0 +1,36 @@
+# Copyright (c) Microsoft Corporation. All rights reserved.
+# Licensed under the MIT license.
+
+# Set ZSTD_ROOT to the Zstandard install prefix (or to the build directory of
+# thirdparty/zstd) to direct the search.
+find_path(ZSTD_INCLUDE_DIR
+    NAMES zstd.h
+    HINTS ${ZSTD_ROOT}
+    PATH_SUFFIXES include lib zstd-src/lib)
+
+find_library(ZSTD_LIBRARY
+    NAMES zstd_static zstd
+    HINTS ${ZSTD_ROOT}
+    PATH_SUFFIXES lib lib64 zstd-build/lib)
+
+if(ZSTD_INCLUDE_DIR AND EXISTS "${ZSTD_INCLUDE_DIR}/zstd.h")
+    file(STRINGS "${ZSTD_INCLUDE_DIR}/zstd.h" ZSTD_VERSION_LINES
+        REGEX "^#define ZSTD_VERSION_(MAJOR|MINOR|RELEASE) +[0-9]+")
+    string(REGEX REPLACE ".*MAJOR +([0-9]+).*" "\\1" ZSTD_VERSION_MAJOR "${ZSTD_VERSION_LINES}")
+    string(REGEX REPLACE ".*MINOR +([0-9]+).*" "\\1" ZSTD_VERSION_MINOR "${ZSTD_VERSION_LINES}")
+    string(REGEX REPLACE ".*RELEASE +([0-9]+).*" "\\1" ZSTD_VERSION_RELEASE "${ZSTD_VERSION_LINES}")
+    set(ZSTD_VERSION "${ZSTD_VERSION_MAJOR}.${ZSTD_VERSION_MINOR}.${ZSTD_VERSION_RELEASE}")
+endif()
+
+find_package(PackageHandleStandardArgs)
+find_package_handle_standard_args(ZSTD
+    REQUIRED_VARS ZSTD_LIBRARY ZSTD_INCLUDE_DIR
+    VERSION_VAR ZSTD_VERSION)
+
+if(ZSTD_FOUND AND NOT TARGET ZSTD::ZSTD)
+    # Create imported target for Zstandard
+    add_library(ZSTD::ZSTD UNKNOWN IMPORTED)
+    set_target_properties(ZSTD::ZSTD PROPERTIES
+        IMPORTED_LOCATION ${ZSTD_LIBRARY}
+        INTERFACE_INCLUDE_DIRECTORIES ${ZSTD_INCLUDE_DIR})
+endif()
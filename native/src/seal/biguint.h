@@ -1611,7 +1611,7 @@ namespace seal
         @throws std::runtime_error if I/O operations failed
         */
         inline std::streamoff save(std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
@@ -1653,7 +1653,7 @@ namespace seal
         inline std::streamoff save(
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
@@ -2,6 +2,8 @@
 // Licensed under the MIT license.
 
 #include <algorithm>
+#include <functional>
+#include <numeric>
 #include "seal/ciphertext.h"
 #include "seal/randomgen.h"
 #include "seal/util/defines.h"
@@ -14,6 +16,48 @@ using namespace seal::util;
 
 namespace seal
 {
+    namespace
+    {
+        // Returns the bit count of the largest coefficient in each RNS component
+        // of count coefficients of ciphertext data. All coefficients of an RNS
+        // component are reduced modulo the same prime, so this is at most the
+        // bit count of the prime.
+        vector<uint8_t> rns_bit_counts(const Ciphertext::ct_coeff_type *data,
+            size_t count, size_t poly_modulus_degree, size_t coeff_mod_count)
+        {
+            vector<uint8_t> bit_counts(coeff_mod_count, 0);
+            size_t rns_poly_count = poly_modulus_degree ?
+                count / poly_modulus_degree : 0;
+            for (size_t k = 0; k < rns_poly_count; k++)
+            {
+                uint64_t all_bits = accumulate(data, data + poly_modulus_degree,
+                    uint64_t(0), bit_or<uint64_t>());
+                auto &bit_count = bit_counts[k % coeff_mod_count];
+                bit_count = max(bit_count,
+                    static_cast<uint8_t>(get_significant_bit_count(all_bits)));
+                data += poly_modulus_degree;
+            }
+            return bit_counts;
+        }
+
+        // Returns the number of bytes needed to store count coefficients packed
+        // with given bit counts for the RNS components
+        size_t bitpacked_byte_count(const vector<uint8_t> &bit_counts,
+            size_t count, size_t poly_modulus_degree)
+        {
+            size_t bits_per_rns_poly_set = 0;
+            for (auto bit_count : bit_counts)
+            {
+                bits_per_rns_poly_set += bit_count;
+            }
+            size_t rns_poly_set_size = mul_safe(poly_modulus_degree, bit_counts.size());
+            size_t rns_poly_set_count = rns_poly_set_size ? count / rns_poly_set_size : 0;
+            return divide_round_up(mul_safe(
+                rns_poly_set_count, poly_modulus_degree, bits_per_rns_poly_set),
+                size_t(bits_per_byte));
+        }
+    }
+
     Ciphertext &Ciphertext::operator =(const Ciphertext &assign)
     {
         // Check for self-assignment
@@ -151,7 +195,15 @@ namespace seal
         // different size characteristics and we need the exact size when
         // compr_mode is compr_mode_type::none.
         size_t data_size;
-        if (has_seed_marker())
+        if (Serialization::IsBitPacked(compr_mode))
+        {
+            data_size = bitpacked_data_size(data_.size() / (has_seed_marker() ? 2 : 1));
+            if (has_seed_marker())
+            {
+                data_size = add_safe(data_size, sizeof(random_seed_type)); // seed
+            }
+        }
+        else if (has_seed_marker())
         {
             // Create a temporary aliased IntArray of smaller size
             IntArray<ct_coeff_type> alias_data(
@@ -185,7 +237,7 @@ namespace seal
             members_size));
     }
 
-    void Ciphertext::save_members(ostream &stream) const
+    void Ciphertext::save_members(ostream &stream, bool bit_packed) const
     {
         auto old_except_mask = stream.exceptions();
         try
@@ -211,20 +263,31 @@ namespace seal
 
                 size_t data_size = data_.size();
                 size_t half_size = data_size / 2;
-                // Save_members must be a const method.
-                // Create an alias of data_, must be handled with care.
-                // Alternatively, create and serialize a half copy of data_.
-                IntArray<ct_coeff_type> alias_data(data_.pool_);
-                alias_data.size_ = half_size;
-                alias_data.capacity_ = half_size;
-                auto alias_ptr = util::Pointer<ct_coeff_type>::Aliasing(
-                    const_cast<ct_coeff_type *>(data_.cbegin()));
-                swap(alias_data.data_, alias_ptr);
-                alias_data.save(stream, compr_mode_type::none);
+                if (bit_packed)
+                {
+                    save_bitpacked_data(stream, half_size);
+                }
+                else
+                {
+                    // Save_members must be a const method.
+                    // Create an alias of data_, must be handled with care.
+                    // Alternatively, create and serialize a half copy of data_.
+                    IntArray<ct_coeff_type> alias_data(data_.pool_);
+                    alias_data.size_ = half_size;
+                    alias_data.capacity_ = half_size;
+                    auto alias_ptr = util::Pointer<ct_coeff_type>::Aliasing(
+                        const_cast<ct_coeff_type *>(data_.cbegin()));
+                    swap(alias_data.data_, alias_ptr);
+                    alias_data.save(stream, compr_mode_type::none);
+                }
 
                 // Save the seed
                 stream.write(reinterpret_cast<char*>(&seed), sizeof(random_seed_type));
             }
+            else if (bit_packed)
+            {
+                save_bitpacked_data(stream, data_.size());
+            }
             else
             {
                 // Save the IntArray
@@ -312,7 +375,7 @@ namespace seal
             // size of the loaded IntArray. This is an important security measure to
             // prevent a malformed IntArray from causing arbitrarily large memory
             // allocations.
-            new_data.data_.load(stream, total_uint64_count);
+            new_data.load_data(stream, total_uint64_count);
 
             // Expected buffer size in the seeded case
             auto seeded_uint64_count = poly_modulus_degree64 * coeff_mod_count64;
@@ -349,4 +412,317 @@ namespace seal
 
         swap(*this, new_data);
     }
+
+    size_t Ciphertext::bitpacked_data_size(size_t count) const
+    {
+        auto bit_counts = rns_bit_counts(data_.cbegin(), count,
+            poly_modulus_degree_, coeff_mod_count_);
+        return add_safe(
+            sizeof(Serialization::SEALHeader),
+            sizeof(uint64_t), // count
+            bit_counts.size(), // bit_counts
+            bitpacked_byte_count(bit_counts, count, poly_modulus_degree_));
+    }
+
+    void Ciphertext::save_bitpacked_data(ostream &stream, size_t count) const
+    {
+        // The data is written in the place of the IntArray data_, with its own
+        // SEALHeader indicating that it is bit-packed. Each coefficient is stored
+        // in the bit count of its RNS component, with the bits of consecutive
+        // coefficients packed in 64-bit little-endian words.
+        auto bit_counts = rns_bit_counts(data_.cbegin(), count,
+            poly_modulus_degree_, coeff_mod_count_);
+        size_t byte_count = bitpacked_byte_count(
+            bit_counts, count, poly_modulus_degree_);
+
+        Serialization::SEALHeader header;
+        header.compr_mode = compr_mode_type::bitpack;
+        header.size = safe_cast<uint32_t>(add_safe(
+            sizeof(Serialization::SEALHeader),
+            sizeof(uint64_t),
+            bit_counts.size(),
+            byte_count));
+        Serialization::SaveHeader(header, stream);
+
+        uint64_t count64 = safe_cast<uint64_t>(count);
+        stream.write(reinterpret_cast<const char*>(&count64), sizeof(uint64_t));
+        stream.write(reinterpret_cast<const char*>(bit_counts.data()),
+            safe_cast<streamsize>(bit_counts.size()));
+        if (!byte_count)
+        {
+            return;
+        }
+
+        auto packed(allocate_zero_uint(
+            divide_round_up(byte_count, sizeof(uint64_t)), data_.pool()));
+        uint64_t *packed_ptr = packed.get();
+        uint64_t word = 0;
+        int word_bit_count = 0;
+        const ct_coeff_type *data_ptr = data_.cbegin();
+        size_t rns_poly_count = count / poly_modulus_degree_;
+        for (size_t k = 0; k < rns_poly_count; k++)
+        {
+            int bit_count = bit_counts[k % coeff_mod_count_];
+            if (!bit_count)
+            {
+                data_ptr += poly_modulus_degree_;
+                continue;
+            }
+            for (size_t i = 0; i < poly_modulus_degree_; i++, data_ptr++)
+            {
+                word |= *data_ptr << word_bit_count;
+                word_bit_count += bit_count;
+                if (word_bit_count >= bits_per_uint64)
+                {
+                    *packed_ptr++ = word;
+                    word_bit_count -= bits_per_uint64;
+
+                    // Carry over the bits that did not fit in the word
+                    word = word_bit_count ?
+                        *data_ptr >> (bit_count - word_bit_count) : 0;
+                }
+            }
+        }
+        if (word_bit_count)
+        {
+            *packed_ptr = word;
+        }
+        stream.write(reinterpret_cast<const char*>(packed.get()),
+            safe_cast<streamsize>(byte_count));
+    }
+
+    void Ciphertext::load_data(istream &stream, size_t in_size_bound)
+    {
+        // The data is either an IntArray saved without compression, or data
+        // written by save_bitpacked_data; the SEALHeader tells which
+        auto stream_start_pos = stream.tellg();
+        Serialization::SEALHeader header;
+        Serialization::LoadHeader(stream, header);
+        if (!Serialization::IsValidHeader(header))
+        {
+            throw logic_error("loaded SEALHeader is invalid");
+        }
+
+        if (header.compr_mode == compr_mode_type::none)
+        {
+            data_.load_members(stream, in_size_bound);
+        }
+        else if (header.compr_mode == compr_mode_type::bitpack)
+        {
+            uint64_t count64 = 0;
+            stream.read(reinterpret_cast<char*>(&count64), sizeof(uint64_t));
+            size_t rns_poly_set_size = mul_safe(poly_modulus_degree_, coeff_mod_count_);
+            if (unsigned_gt(count64, in_size_bound) || (rns_poly_set_size ?
+                count64 % rns_poly_set_size : count64))
+            {
+                throw logic_error("unexpected size");
+            }
+            size_t count = safe_cast<size_t>(count64);
+
+            vector<uint8_t> bit_counts(coeff_mod_count_);
+            stream.read(reinterpret_cast<char*>(bit_counts.data()),
+                safe_cast<streamsize>(bit_counts.size()));
+            for (auto bit_count : bit_counts)
+            {
+                if (bit_count > bits_per_uint64)
+                {
+                    throw logic_error("ciphertext data is invalid");
+                }
+            }
+            size_t byte_count = bitpacked_byte_count(
+                bit_counts, count, poly_modulus_degree_);
+
+            data_.resize(count);
+            if (byte_count)
+            {
+                auto packed(allocate_zero_uint(
+                    divide_round_up(byte_count, sizeof(uint64_t)), data_.pool()));
+                stream.read(reinterpret_cast<char*>(packed.get()),
+                    safe_cast<streamsize>(byte_count));
+
+                const uint64_t *packed_ptr = packed.get();
+                int word_offset = 0;
+                ct_coeff_type *data_ptr = data_.begin();
+                size_t rns_poly_count = count / poly_modulus_degree_;
+                for (size_t k = 0; k < rns_poly_count; k++)
+                {
+                    int bit_count = bit_counts[k % coeff_mod_count_];
+                    if (!bit_count)
+                    {
+                        data_ptr = fill_n(data_ptr, poly_modulus_degree_, ct_coeff_type(0));
+                        continue;
+                    }
+                    uint64_t mask = bit_count == bits_per_uint64 ?
+                        ~uint64_t(0) : (uint64_t(1) << bit_count) - 1;
+                    for (size_t i = 0; i < poly_modulus_degree_; i++, data_ptr++)
+                    {
+                        uint64_t value = *packed_ptr >> word_offset;
+                        if (word_offset + bit_count > bits_per_uint64)
+                        {
+                            value |= packed_ptr[1] << (bits_per_uint64 - word_offset);
+                        }
+                        *data_ptr = value & mask;
+                        word_offset += bit_count;
+                        if (word_offset >= bits_per_uint64)
+                        {
+                            word_offset -= bits_per_uint64;
+                            packed_ptr++;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                fill_n(data_.begin(), count, ct_coeff_type(0));
+            }
+        }
+        else
+        {
+            throw logic_error("unsupported compression mode");
+        }
+
+        if (header.size != stream.tellg() - stream_start_pos)
+        {
+            throw logic_error("invalid data size");
+        }
+    }
+
+    size_t Ciphertext::view_members_size() const
+    {
+        return add_safe(
+            view_aligned_size(add_safe(
+                sizeof(parms_id_),
+                sizeof(uint64_t), // is_ntt_form_
+                sizeof(uint64_t), // size_
+                sizeof(uint64_t), // poly_modulus_degree_
+                sizeof(uint64_t), // coeff_mod_count_
+                sizeof(scale_))),
+            view_aligned_size(mul_safe(data_.size(), sizeof(ct_coeff_type))));
+    }
+
+    streamoff Ciphertext::save_aligned_size() const
+    {
+        return safe_cast<streamoff>(add_safe(
+            view_aligned_size(view_header_byte_count), view_members_size()));
+    }
+
+    streamoff Ciphertext::save_aligned(ostream &stream) const
+    {
+        size_t total_size = safe_cast<size_t>(save_aligned_size());
+        auto old_except_mask = stream.exceptions();
+        try
+        {
+            // Throw exceptions on std::ios_base::badbit and std::ios_base::failbit
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+
+            ViewWriter writer(stream);
+            writer.write_header(total_size);
+            save_view_members(writer);
+            if (writer.offset() != total_size)
+            {
+                throw logic_error("invalid data size");
+            }
+        }
+        catch (const ios_base::failure &)
+        {
+            stream.exceptions(old_except_mask);
+            throw runtime_error("I/O error");
+        }
+        catch (...)
+        {
+            stream.exceptions(old_except_mask);
+            throw;
+        }
+        stream.exceptions(old_except_mask);
+        return safe_cast<streamoff>(total_size);
+    }
+
+    void Ciphertext::save_view_members(ViewWriter &writer) const
+    {
+        if (has_seed_marker())
+        {
+            throw logic_error("seeded ciphertext cannot be saved aligned");
+        }
+
+        uint64_t is_ntt_form64 = is_ntt_form_ ? 1 : 0;
+        uint64_t size64 = safe_cast<uint64_t>(size_);
+        uint64_t poly_modulus_degree64 = safe_cast<uint64_t>(poly_modulus_degree_);
+        uint64_t coeff_mod_count64 = safe_cast<uint64_t>(coeff_mod_count_);
+        writer.write(&parms_id_, sizeof(parms_id_type));
+        writer.write(&is_ntt_form64, sizeof(uint64_t));
+        writer.write(&size64, sizeof(uint64_t));
+        writer.write(&poly_modulus_degree64, sizeof(uint64_t));
+        writer.write(&coeff_mod_count64, sizeof(uint64_t));
+        writer.write(&scale_, sizeof(double));
+        writer.align();
+        writer.write(data_.cbegin(), mul_safe(data_.size(), sizeof(ct_coeff_type)));
+        writer.align();
+    }
+
+    streamoff Ciphertext::unsafe_load_view(shared_ptr<SEALContext> context,
+        SEAL_BYTE *in, size_t size)
+    {
+        ViewReader reader(in, size);
+        size_t total_size = reader.read_header();
+        Ciphertext new_data(data_.pool());
+        new_data.load_view_members(move(context), reader);
+        if (reader.offset() != total_size)
+        {
+            throw logic_error("invalid data size");
+        }
+        swap(*this, new_data);
+        return safe_cast<streamoff>(total_size);
+    }
+
+    void Ciphertext::load_view_members(shared_ptr<SEALContext> context,
+        ViewReader &reader)
+    {
+        // Verify parameters
+        if (!context)
+        {
+            throw invalid_argument("invalid context");
+        }
+        if (!context->parameters_set())
+        {
+            throw invalid_argument("encryption parameters are not set correctly");
+        }
+
+        parms_id_type parms_id{};
+        reader.read(&parms_id, sizeof(parms_id_type));
+        uint64_t is_ntt_form64 = 0;
+        reader.read(&is_ntt_form64, sizeof(uint64_t));
+        uint64_t size64 = 0;
+        reader.read(&size64, sizeof(uint64_t));
+        uint64_t poly_modulus_degree64 = 0;
+        reader.read(&poly_modulus_degree64, sizeof(uint64_t));
+        uint64_t coeff_mod_count64 = 0;
+        reader.read(&coeff_mod_count64, sizeof(uint64_t));
+        double scale = 0;
+        reader.read(&scale, sizeof(double));
+
+        Ciphertext new_data(data_.pool());
+        new_data.parms_id_ = parms_id;
+        new_data.is_ntt_form_ = is_ntt_form64 != 0;
+        new_data.size_ = safe_cast<size_t>(size64);
+        new_data.poly_modulus_degree_ = safe_cast<size_t>(poly_modulus_degree64);
+        new_data.coeff_mod_count_ = safe_cast<size_t>(coeff_mod_count64);
+        new_data.scale_ = scale;
+
+        // As in load_members, pure key levels are allowed here
+        if (!is_metadata_valid_for(new_data, context, true))
+        {
+            throw logic_error("ciphertext data is invalid");
+        }
+
+        // Refer to the data in place
+        auto total_uint64_count = mul_safe(
+            new_data.size_,
+            new_data.poly_modulus_degree_,
+            new_data.coeff_mod_count_);
+        ct_coeff_type *data = reader.take_array<ct_coeff_type>(total_uint64_count);
+        new_data.data_ = IntArray<ct_coeff_type>(Pointer<ct_coeff_type>::Aliasing(data),
+            total_uint64_count, false, data_.pool());
+
+        swap(*this, new_data);
+    }
 }
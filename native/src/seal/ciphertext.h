@@ -18,6 +18,7 @@
 #include "seal/valcheck.h"
 #include "seal/util/common.h"
 #include "seal/util/defines.h"
+#include "seal/util/viewlayout.h"
 #include "seal/util/ztools.h"
 
 namespace seal
@@ -54,6 +55,8 @@ namespace seal
     */
     class Ciphertext
     {
+        friend class KSwitchKeys;
+
     public:
         using ct_coeff_type = std::uint64_t;
 
@@ -514,12 +517,13 @@ namespace seal
         */
         inline std::streamoff save(
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
-                std::bind(&Ciphertext::save_members, this, _1),
-                save_size(compr_mode_type::none),
+                std::bind(&Ciphertext::save_members, this, _1,
+                    Serialization::IsBitPacked(compr_mode)),
+                save_size(Serialization::RawComprMode(compr_mode)),
                 stream, compr_mode);
         }
 
@@ -589,12 +593,13 @@ namespace seal
         inline std::streamoff save(
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
-                std::bind(&Ciphertext::save_members, this, _1),
-                save_size(compr_mode_type::none),
+                std::bind(&Ciphertext::save_members, this, _1,
+                    Serialization::IsBitPacked(compr_mode)),
+                save_size(Serialization::RawComprMode(compr_mode)),
                 out, size, compr_mode);
         }
 
@@ -655,6 +660,82 @@ namespace seal
             return in_size;
         }
 
+        /**
+        Returns the number of bytes save_aligned writes.
+
+        @throws std::logic_error if the size does not fit in the return type
+        */
+        SEAL_NODISCARD std::streamoff save_aligned_size() const;
+
+        /**
+        Saves the ciphertext to an output stream in an uncompressed layout in
+        which the ciphertext data is aligned, so that it can be used in place by
+        load_view, e.g., from a memory-mapped file (see MappedFile). The output
+        is in binary format and not human-readable. The output stream must have
+        the "binary" flag set. Data saved with save_aligned cannot be loaded with
+        load and vice versa.
+
+        @param[out] stream The stream to save the ciphertext to
+        @throws std::logic_error if the ciphertext holds a seed instead of its
+        second polynomial
+        @throws std::runtime_error if I/O operations failed
+        */
+        std::streamoff save_aligned(std::ostream &stream) const;
+
+        /**
+        Makes the ciphertext refer to ciphertext data saved with save_aligned
+        at a given memory location, without copying it. The memory must remain
+        valid for as long as the ciphertext refers to it, i.e., until it is
+        destroyed or resized beyond its size. Changes to the ciphertext, also by
+        assignment, are made in the memory. Only the metadata is checked;
+        the data itself is not read, so the memory can be paged in lazily. This
+        function should not be used unless the ciphertext comes from a fully
+        trusted source.
+
+        @param[in] context The SEALContext
+        @param[in] in The memory location holding the ciphertext, aligned to
+        8 bytes
+        @param[in] size The number of bytes available in the given memory location
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if in is null or not aligned
+        @throws std::logic_error if the data is not in the layout written by
+        save_aligned or is invalid
+        */
+        std::streamoff unsafe_load_view(std::shared_ptr<SEALContext> context,
+            SEAL_BYTE *in, std::size_t size);
+
+        /**
+        Makes the ciphertext refer to ciphertext data saved with save_aligned
+        at a given memory location, without copying it. The memory must remain
+        valid for as long as the ciphertext refers to it, i.e., until it is
+        destroyed or resized beyond its size. Changes to the ciphertext, also by
+        assignment, are made in the memory. The ciphertext is verified to
+        be valid for the given SEALContext, which reads all of the data.
+
+        @param[in] context The SEALContext
+        @param[in] in The memory location holding the ciphertext, aligned to
+        8 bytes
+        @param[in] size The number of bytes available in the given memory location
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if in is null or not aligned
+        @throws std::logic_error if the data is not in the layout written by
+        save_aligned or is invalid
+        */
+        inline std::streamoff load_view(std::shared_ptr<SEALContext> context,
+            SEAL_BYTE *in, std::size_t size)
+        {
+            Ciphertext new_data(pool());
+            auto in_size = new_data.unsafe_load_view(context, in, size);
+            if (!is_valid_for(new_data, std::move(context)))
+            {
+                throw std::logic_error("ciphertext data is invalid");
+            }
+            std::swap(*this, new_data);
+            return in_size;
+        }
+
         /**
         Returns whether the ciphertext is in NTT form.
         */
@@ -734,10 +815,23 @@ namespace seal
             std::shared_ptr<SEALContext> context,
             const random_seed_type &seed);
 
-        void save_members(std::ostream &stream) const;
+        void save_members(std::ostream &stream, bool bit_packed) const;
 
         void load_members(std::shared_ptr<SEALContext> context, std::istream &stream);
 
+        SEAL_NODISCARD std::size_t bitpacked_data_size(std::size_t count) const;
+
+        void save_bitpacked_data(std::ostream &stream, std::size_t count) const;
+
+        void load_data(std::istream &stream, std::size_t in_size_bound);
+
+        SEAL_NODISCARD std::size_t view_members_size() const;
+
+        void save_view_members(util::ViewWriter &writer) const;
+
+        void load_view_members(std::shared_ptr<SEALContext> context,
+            util::ViewReader &reader);
+
         inline bool has_seed_marker() const noexcept
         {
             return data_.size() && (size_ == 2) ?
@@ -7,17 +7,357 @@
 #include "seal/util/uintarith.h"
 #include "seal/util/uintarithsmallmod.h"
 #include "seal/util/numth.h"
+#include "seal/util/common.h"
+#include "seal/util/hash.h"
+#include "seal/util/viewlayout.h"
 #include <utility>
 #include <stdexcept>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 using namespace std;
 using namespace seal::util;
 
 namespace seal
 {
-    SEALContext::ContextData SEALContext::validate(EncryptionParameters parms)
+    namespace
     {
-        ContextData context_data(parms, pool_);
+        // Registry for SEALContext::CreateShared; the random generator factory
+        // is part of the key as it is not part of the parms_id
+        using shared_context_key = tuple<
+            parms_id_type, bool, sec_level_type, const UniformRandomGeneratorFactory*>;
+
+        mutex shared_contexts_mutex;
+
+        map<shared_context_key, weak_ptr<SEALContext>> shared_contexts;
+
+        // Expired entries are removed when the registry has doubled in size
+        // since the last sweep
+        size_t shared_contexts_sweep_size = 16;
+
+        // Returns whether plain_modulus is smaller than the product of the given
+        // coefficient moduli
+        bool is_less_than_product(const SmallModulus &plain_modulus,
+            const vector<SmallModulus> &coeff_modulus)
+        {
+            // Every modulus is at least 2, so the product only grows
+            uint64_t product = 1;
+            for (auto &mod : coeff_modulus)
+            {
+                unsigned long long wide_product[2];
+                multiply_uint64(product, mod.value(), wide_product);
+                if (wide_product[1])
+                {
+                    return true;
+                }
+                product = wide_product[0];
+            }
+            return plain_modulus.value() < product;
+        }
+
+        // An output stream buffer that discards what is written to it, but
+        // computes its Blake2b hash
+        class HashBuffer final : public streambuf
+        {
+        public:
+            HashBuffer()
+            {
+                if (blake2b_init(&state_, HashFunction::hash_block_byte_count))
+                {
+                    throw runtime_error("blake2b failed");
+                }
+            }
+
+            void update(const void *data, size_t byte_count)
+            {
+                if (blake2b_update(&state_, data, byte_count))
+                {
+                    throw runtime_error("blake2b failed");
+                }
+            }
+
+            SEAL_NODISCARD HashFunction::hash_block_type digest()
+            {
+                HashFunction::hash_block_type result;
+                if (blake2b_final(&state_, result.data(), HashFunction::hash_block_byte_count))
+                {
+                    throw runtime_error("blake2b failed");
+                }
+                return result;
+            }
+
+        private:
+            streamsize xsputn(const char_type *s, streamsize count) override
+            {
+                update(s, static_cast<size_t>(count));
+                return count;
+            }
+
+            int_type overflow(int_type ch) override
+            {
+                if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                {
+                    char_type c = traits_type::to_char_type(ch);
+                    update(&c, 1);
+                }
+                return traits_type::not_eof(ch);
+            }
+
+            blake2b_state state_;
+        };
+    }
+
+    /**
+    Creates the levels of the modulus switching chain below the first data level
+    when they are first accessed. Levels are created from the top down, so that
+    each level can refer to the one above it, and are owned by this object. Each
+    level is created under its own once_flag, so reading a level that exists
+    takes no lock.
+    */
+    class SEALContext::ModChainBuilder :
+        public enable_shared_from_this<SEALContext::ModChainBuilder>
+    {
+    public:
+        // The parameters of the levels are given by chain index
+        ModChainBuilder(vector<EncryptionParameters> level_parms,
+            weak_ptr<const ContextData> first_context_data, sec_level_type sec_level,
+            MemoryPoolHandle pool, shared_ptr<SmallNTTTablesCache> small_ntt_tables_cache,
+            shared_ptr<GaloisTool> galois_tool) :
+            level_parms_(move(level_parms)), levels_(level_parms_.size()),
+            first_context_data_(move(first_context_data)), sec_level_(sec_level),
+            pool_(move(pool)), small_ntt_tables_cache_(move(small_ntt_tables_cache)),
+            galois_tool_(move(galois_tool))
+        {
+        }
+
+        shared_ptr<const ContextData> get(size_t chain_index)
+        {
+            auto &level = levels_[chain_index];
+            call_once(level.created, [&]() {
+                auto context_data = make_shared<ContextData>(validate(
+                    level_parms_[chain_index], sec_level_, pool_,
+                    small_ntt_tables_cache_, galois_tool_));
+                if (!context_data->qualifiers_.parameters_set)
+                {
+                    throw logic_error("invalid parameters in modulus switching chain");
+                }
+                context_data->chain_index_ = chain_index;
+                context_data->prev_context_data_ = (chain_index + 1 < levels_.size()) ?
+                    weak_ptr<const ContextData>(get(chain_index + 1)) : first_context_data_;
+                if (chain_index)
+                {
+                    context_data->mod_chain_builder_ = weak_from_this();
+                }
+                level.context_data = move(context_data);
+            });
+            return level.context_data;
+        }
+
+        shared_ptr<const ContextData> get(const parms_id_type &parms_id)
+        {
+            for (size_t i = 0; i < level_parms_.size(); i++)
+            {
+                if (level_parms_[i].parms_id() == parms_id)
+                {
+                    return get(i);
+                }
+            }
+            return nullptr;
+        }
+
+    private:
+        struct Level
+        {
+            once_flag created;
+
+            shared_ptr<const ContextData> context_data;
+        };
+
+        vector<EncryptionParameters> level_parms_;
+
+        vector<Level> levels_;
+
+        weak_ptr<const ContextData> first_context_data_;
+
+        sec_level_type sec_level_;
+
+        MemoryPoolHandle pool_;
+
+        shared_ptr<SmallNTTTablesCache> small_ntt_tables_cache_;
+
+        shared_ptr<GaloisTool> galois_tool_;
+    };
+
+    shared_ptr<const SEALContext::ContextData>
+        SEALContext::ContextData::lazy_next_context_data() const noexcept
+    {
+        auto mod_chain_builder = mod_chain_builder_.lock();
+        if (!mod_chain_builder)
+        {
+            return next_context_data_;
+        }
+        try
+        {
+            return mod_chain_builder->get(chain_index_ - 1);
+        }
+        catch (...)
+        {
+            return nullptr;
+        }
+    }
+
+    shared_ptr<const SEALContext::ContextData> SEALContext::lazy_context_data(
+        const parms_id_type &parms_id) const
+    {
+        return mod_chain_builder_ ? mod_chain_builder_->get(parms_id) : nullptr;
+    }
+
+    shared_ptr<SEALContext> SEALContext::CreateShared(
+        const EncryptionParameters &parms,
+        bool expand_mod_chain,
+        sec_level_type sec_level)
+    {
+        shared_context_key key(parms.parms_id(), expand_mod_chain, sec_level,
+            parms.random_generator().get());
+
+        lock_guard<mutex> lock(shared_contexts_mutex);
+        auto &entry = shared_contexts[key];
+        auto context = entry.lock();
+        if (context)
+        {
+            return context;
+        }
+
+        // Hold the lock while creating the context so that it is created once
+        context = shared_ptr<SEALContext>(new SEALContext(parms, expand_mod_chain,
+            sec_level, false, MemoryManager::GetPool(mm_prof_opt::FORCE_GLOBAL),
+            nullptr));
+        entry = context;
+
+        if (shared_contexts.size() >= shared_contexts_sweep_size)
+        {
+            for (auto it = shared_contexts.begin(); it != shared_contexts.end();)
+            {
+                it = it->second.expired() ? shared_contexts.erase(it) : next(it);
+            }
+            shared_contexts_sweep_size = max<size_t>(2 * shared_contexts.size(), 16);
+        }
+        return context;
+    }
+
+    shared_ptr<SEALContext> SEALContext::Create(
+        const EncryptionParameters &parms,
+        SEAL_BYTE *precomputation,
+        size_t size,
+        bool expand_mod_chain,
+        sec_level_type sec_level,
+        bool lazy_mod_chain)
+    {
+        ViewReader reader(precomputation, size);
+        size_t total_size = reader.read_header();
+        parms_id_type parms_id;
+        reader.read(&parms_id, sizeof(parms_id_type));
+        reader.align();
+        if (parms_id != parms.parms_id())
+        {
+            throw invalid_argument("precomputation does not match encryption parameters");
+        }
+
+        // The digest covers the header and parms_id; each of the NTT tables has
+        // a digest of its own that is checked when the table is first used
+        HashBuffer hash_buffer;
+        hash_buffer.update(precomputation, reader.offset());
+        HashFunction::hash_block_type digest;
+        reader.read(&digest, sizeof(digest));
+        reader.align();
+        if (hash_buffer.digest() != digest)
+        {
+            throw logic_error("invalid precomputation");
+        }
+
+        int coeff_count_power = get_power_of_two(parms.poly_modulus_degree());
+        if (coeff_count_power < 0)
+        {
+            throw logic_error("invalid precomputation");
+        }
+        auto pool = MemoryManager::GetPool();
+        auto small_ntt_tables_cache =
+            make_shared<SmallNTTTablesCache>(coeff_count_power, pool);
+        small_ntt_tables_cache->load_view(reader);
+        if (reader.offset() != total_size)
+        {
+            throw logic_error("invalid data size");
+        }
+
+        return shared_ptr<SEALContext>(new SEALContext(parms, expand_mod_chain,
+            sec_level, lazy_mod_chain, move(pool), move(small_ntt_tables_cache)));
+    }
+
+    streamoff SEALContext::save_precomputation_size() const
+    {
+        if (!parameters_set())
+        {
+            throw logic_error("encryption parameters are not set correctly");
+        }
+        size_t size = add_safe(view_aligned_size(view_header_byte_count),
+            view_aligned_size(sizeof(parms_id_type)),
+            view_aligned_size(HashFunction::hash_block_byte_count));
+        return safe_cast<streamoff>(add_safe(size, small_ntt_tables_cache_->view_size()));
+    }
+
+    streamoff SEALContext::save_precomputation(ostream &stream) const
+    {
+        size_t total_size = safe_cast<size_t>(save_precomputation_size());
+        auto old_except_mask = stream.exceptions();
+        try
+        {
+            // Throw exceptions on std::ios_base::badbit and std::ios_base::failbit
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+
+            // Hash the header and parms_id as they are written below
+            HashBuffer hash_buffer;
+            ostream hash_stream(&hash_buffer);
+            hash_stream.exceptions(ios_base::badbit | ios_base::failbit);
+            ViewWriter hash_writer(hash_stream);
+            hash_writer.write_header(total_size);
+            hash_writer.write(&key_parms_id_, sizeof(parms_id_type));
+            hash_writer.align();
+            auto digest = hash_buffer.digest();
+
+            ViewWriter writer(stream);
+            writer.write_header(total_size);
+            writer.write(&key_parms_id_, sizeof(parms_id_type));
+            writer.align();
+            writer.write(&digest, sizeof(digest));
+            writer.align();
+            small_ntt_tables_cache_->save_view(writer);
+            if (writer.offset() != total_size)
+            {
+                throw logic_error("invalid data size");
+            }
+        }
+        catch (const ios_base::failure &)
+        {
+            stream.exceptions(old_except_mask);
+            throw runtime_error("I/O error");
+        }
+        catch (...)
+        {
+            stream.exceptions(old_except_mask);
+            throw;
+        }
+        stream.exceptions(old_except_mask);
+        return safe_cast<streamoff>(total_size);
+    }
+
+    SEALContext::ContextData SEALContext::validate(EncryptionParameters parms,
+        sec_level_type sec_level, MemoryPoolHandle pool,
+        shared_ptr<SmallNTTTablesCache> &small_ntt_tables_cache,
+        shared_ptr<GaloisTool> &galois_tool)
+    {
+        ContextData context_data(parms, pool);
         context_data.qualifiers_.parameters_set = true;
 
         // Is a scheme set?
@@ -62,8 +402,8 @@ namespace seal
         }
 
         // Compute the product of all coeff moduli
-        context_data.total_coeff_modulus_ = allocate_uint(coeff_mod_count, pool_);
-        auto temp(allocate_uint(coeff_mod_count, pool_));
+        context_data.total_coeff_modulus_ = allocate_uint(coeff_mod_count, pool);
+        auto temp(allocate_uint(coeff_mod_count, pool));
         set_uint(1, coeff_mod_count, context_data.total_coeff_modulus_.get());
         for (size_t i = 0; i < coeff_mod_count; i++)
         {
@@ -99,16 +439,16 @@ namespace seal
         context_data.qualifiers_.using_fft = true;
 
         // Assume parameters satisfy desired security level
-        context_data.qualifiers_.sec_level = sec_level_;
+        context_data.qualifiers_.sec_level = sec_level;
 
         // Check if the parameters are secure according to HomomorphicEncryption.org
         // security standard
         if (context_data.total_coeff_modulus_bit_count_ >
-            CoeffModulus::MaxBitCount(poly_modulus_degree, sec_level_))
+            CoeffModulus::MaxBitCount(poly_modulus_degree, sec_level))
         {
             // Not secure according to HomomorphicEncryption.org security standard
             context_data.qualifiers_.sec_level = sec_level_type::none;
-            if (sec_level_ != sec_level_type::none)
+            if (sec_level != sec_level_type::none)
             {
                 // Parameters are not valid
                 context_data.qualifiers_.parameters_set = false;
@@ -116,14 +456,27 @@ namespace seal
             }
         }
 
-        // Can we use NTT with coeff_modulus?
+        // Can we use NTT with coeff_modulus? The NTT tables for each prime are
+        // generated only once and shared by all levels of the modulus chain.
+        if (!small_ntt_tables_cache ||
+            small_ntt_tables_cache->coeff_count_power() != coeff_count_power)
+        {
+            small_ntt_tables_cache =
+                make_shared<SmallNTTTablesCache>(coeff_count_power, pool);
+        }
+        context_data.small_ntt_tables_cache_ = small_ntt_tables_cache;
+        if (!galois_tool || galois_tool->coeff_count_power() != coeff_count_power)
+        {
+            galois_tool = make_shared<GaloisTool>(coeff_count_power, pool);
+        }
+        context_data.galois_tool_ = galois_tool;
         context_data.qualifiers_.using_ntt = true;
         context_data.small_ntt_tables_ =
-            allocate<SmallNTTTables>(coeff_mod_count, pool_, pool_);
+            allocate<SmallNTTTables>(coeff_mod_count, pool, pool);
         for (size_t i = 0; i < coeff_mod_count; i++)
         {
-            if (!context_data.small_ntt_tables_[i].generate(coeff_count_power,
-                coeff_modulus[i]))
+            if (!small_ntt_tables_cache->get(coeff_modulus[i],
+                context_data.small_ntt_tables_[i]))
             {
                 // Parameters are not valid
                 context_data.qualifiers_.using_ntt = false;
@@ -163,8 +516,9 @@ namespace seal
 
             // Can we use batching? (NTT with plain_modulus)
             context_data.qualifiers_.using_batching = false;
-            context_data.plain_ntt_tables_ = allocate<SmallNTTTables>(pool_);
-            if (context_data.plain_ntt_tables_->generate(coeff_count_power, plain_modulus))
+            context_data.plain_ntt_tables_ = allocate<SmallNTTTables>(pool);
+            if (small_ntt_tables_cache->get(plain_modulus,
+                *context_data.plain_ntt_tables_))
             {
                 context_data.qualifiers_.using_batching = true;
             }
@@ -181,21 +535,21 @@ namespace seal
 
             // Calculate coeff_div_plain_modulus (BFV-"Delta") and the remainder
             // upper_half_increment
-            context_data.coeff_div_plain_modulus_ = allocate_uint(coeff_mod_count, pool_);
-            context_data.upper_half_increment_ = allocate_uint(coeff_mod_count, pool_);
+            context_data.coeff_div_plain_modulus_ = allocate_uint(coeff_mod_count, pool);
+            context_data.upper_half_increment_ = allocate_uint(coeff_mod_count, pool);
             auto wide_plain_modulus(duplicate_uint_if_needed(plain_modulus.data(),
-                plain_modulus.uint64_count(), coeff_mod_count, false, pool_));
+                plain_modulus.uint64_count(), coeff_mod_count, false, pool));
             divide_uint_uint(context_data.total_coeff_modulus_.get(),
                 wide_plain_modulus.get(), coeff_mod_count,
                 context_data.coeff_div_plain_modulus_.get(),
-                context_data.upper_half_increment_.get(), pool_);
+                context_data.upper_half_increment_.get(), pool);
             // store the non-RNS form of upper_half_increment for BFV encryption
             context_data.coeff_mod_plain_modulus_ = context_data.upper_half_increment_[0];
             // Decompose coeff_div_plain_modulus into RNS factors
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
                 temp[i] = modulo_uint(context_data.coeff_div_plain_modulus_.get(),
-                    coeff_mod_count, coeff_modulus[i], pool_);
+                    coeff_mod_count, coeff_modulus[i], pool);
             }
             set_uint_uint(temp.get(), coeff_mod_count,
                 context_data.coeff_div_plain_modulus_.get());
@@ -204,7 +558,7 @@ namespace seal
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
                 temp[i] = modulo_uint(context_data.upper_half_increment_.get(),
-                    coeff_mod_count, coeff_modulus[i], pool_);
+                    coeff_mod_count, coeff_modulus[i], pool);
             }
             set_uint_uint(temp.get(), coeff_mod_count,
                 context_data.upper_half_increment_.get());
@@ -214,7 +568,7 @@ namespace seal
 
             // Calculate coeff_modulus - plain_modulus.
             context_data.plain_upper_half_increment_ =
-                allocate_uint(coeff_mod_count, pool_);
+                allocate_uint(coeff_mod_count, pool);
             if (context_data.qualifiers_.using_fast_plain_lift)
             {
                 // Calculate coeff_modulus[i] - plain_modulus if using_fast_plain_lift
@@ -252,7 +606,7 @@ namespace seal
             context_data.plain_upper_half_threshold_ = uint64_t(1) << 63;
 
             // Calculate plain_upper_half_increment = 2^64 mod coeff_modulus for CKKS plaintexts
-            context_data.plain_upper_half_increment_ = allocate_uint(coeff_mod_count, pool_);
+            context_data.plain_upper_half_increment_ = allocate_uint(coeff_mod_count, pool);
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
                 uint64_t tmp = (uint64_t(1) << 63) % coeff_modulus[i].value();
@@ -264,7 +618,7 @@ namespace seal
 
             // Compute the upper_half_threshold for this modulus.
             context_data.upper_half_threshold_ = allocate_uint(
-                coeff_mod_count, pool_);
+                coeff_mod_count, pool);
             increment_uint(context_data.total_coeff_modulus(),
                 coeff_mod_count, context_data.upper_half_threshold_.get());
             right_shift_uint(context_data.upper_half_threshold_.get(), 1,
@@ -277,9 +631,9 @@ namespace seal
         }
 
         // Create BaseConverter
-        context_data.base_converter_ = allocate<BaseConverter>(pool_, pool_);
+        context_data.base_converter_ = allocate<BaseConverter>(pool, pool);
         context_data.base_converter_->generate(coeff_modulus, poly_modulus_degree,
-            plain_modulus);
+            plain_modulus, small_ntt_tables_cache);
         if (!context_data.base_converter_->is_generated())
         {
             // Parameters are not valid
@@ -301,17 +655,18 @@ namespace seal
     }
 
     parms_id_type SEALContext::create_next_context_data(
-        const parms_id_type &prev_parms_id)
+        const parms_id_type &prev_parms_id, size_t drop_count)
     {
-        // Create the next set of parameters by removing last modulus
+        // Create the next set of parameters by removing the last moduli
         auto next_parms = context_data_map_.at(prev_parms_id)->parms_;
         auto next_coeff_modulus = next_parms.coeff_modulus();
-        next_coeff_modulus.pop_back();
+        next_coeff_modulus.resize(next_coeff_modulus.size() - drop_count);
         next_parms.set_coeff_modulus(next_coeff_modulus);
         auto next_parms_id = next_parms.parms_id();
 
         // Validate next parameters and create next context_data
-        auto next_context_data = validate(next_parms);
+        auto next_context_data = validate(next_parms, sec_level_, pool_,
+            small_ntt_tables_cache_, galois_tool_);
 
         // If not valid then return zero parms_id
         if (!next_context_data.qualifiers_.parameters_set)
@@ -337,8 +692,10 @@ namespace seal
     }
 
     SEALContext::SEALContext(EncryptionParameters parms, bool expand_mod_chain,
-        sec_level_type sec_level, MemoryPoolHandle pool)
-        : pool_(move(pool)), sec_level_(sec_level)
+        sec_level_type sec_level, bool lazy_mod_chain, MemoryPoolHandle pool,
+        shared_ptr<SmallNTTTablesCache> small_ntt_tables_cache)
+        : pool_(move(pool)), small_ntt_tables_cache_(move(small_ntt_tables_cache)),
+        sec_level_(sec_level)
     {
         if (!pool_)
         {
@@ -357,21 +714,34 @@ namespace seal
 
         // First create key_parms_id_.
         context_data_map_.emplace(make_pair(parms.parms_id(),
-            make_shared<const ContextData>(validate(parms))));
+            make_shared<const ContextData>(
+                validate(parms, sec_level_, pool_, small_ntt_tables_cache_,
+                    galois_tool_))));
         key_parms_id_ = parms.parms_id();
 
+        // There must be at least one prime besides the special primes to use
+        // keyswitching
+        size_t special_prime_count = parms.special_prime_count();
+        size_t coeff_mod_count = parms.coeff_modulus().size();
+        if (coeff_mod_count > 1 && special_prime_count >= coeff_mod_count)
+        {
+            const_pointer_cast<ContextData>(context_data_map_.at(key_parms_id_))->
+                qualifiers_.parameters_set = false;
+        }
+
         // Then create first_parms_id_ if the parameters are valid and there is
         // more than one modulus in coeff_modulus. This is equivalent to expanding
-        // the chain by one step. Otherwise, we set first_parms_id_ to equal
-        // key_parms_id_.
+        // the chain by removing the special primes. Otherwise, we set
+        // first_parms_id_ to equal key_parms_id_.
         if (!context_data_map_.at(key_parms_id_)->qualifiers_.parameters_set ||
-            parms.coeff_modulus().size() == 1)
+            coeff_mod_count == 1)
         {
             first_parms_id_ = key_parms_id_;
         }
         else
         {
-            auto next_parms_id = create_next_context_data(key_parms_id_);
+            auto next_parms_id = create_next_context_data(
+                key_parms_id_, special_prime_count);
             first_parms_id_ = (next_parms_id == parms_id_zero) ?
                 key_parms_id_ : next_parms_id;
         }
@@ -382,9 +752,54 @@ namespace seal
         // Check if keyswitching is available
         using_keyswitching_ = (first_parms_id_ != key_parms_id_);
 
+        // Group the primes of the first data level into digits of equal size
+        if (using_keyswitching_)
+        {
+            size_t decomp_mod_count = coeff_mod_count - special_prime_count;
+            size_t digit_count = parms.decomposition_count();
+            if (!digit_count || digit_count > decomp_mod_count)
+            {
+                digit_count = decomp_mod_count;
+            }
+            keyswitching_digit_size_ = (decomp_mod_count + digit_count - 1) / digit_count;
+        }
+
         // If modulus switching chain is to be created, compute the remaining
         // parameter sets as long as they are valid to use (parameters_set == true)
-        if (expand_mod_chain &&
+        if (expand_mod_chain && lazy_mod_chain &&
+            context_data_map_.at(first_parms_id_)->qualifiers_.parameters_set)
+        {
+            // Only compute the parameters of the remaining levels. Removing primes
+            // keeps valid parameters valid, except that for BFV plain_modulus must
+            // remain smaller than the coefficient modulus.
+            vector<EncryptionParameters> level_parms;
+            auto next_parms = context_data_map_.at(first_parms_id_)->parms();
+            auto next_coeff_modulus = next_parms.coeff_modulus();
+            while (next_coeff_modulus.size() > 1)
+            {
+                next_coeff_modulus.pop_back();
+                if (parms.scheme() == scheme_type::BFV &&
+                    !is_less_than_product(parms.plain_modulus(), next_coeff_modulus))
+                {
+                    break;
+                }
+                next_parms.set_coeff_modulus(next_coeff_modulus);
+                context_data_map_.emplace(next_parms.parms_id(), nullptr);
+                last_parms_id_ = next_parms.parms_id();
+                level_parms.push_back(next_parms);
+            }
+            reverse(level_parms.begin(), level_parms.end());
+            if (!level_parms.empty())
+            {
+                mod_chain_builder_ = make_shared<ModChainBuilder>(move(level_parms),
+                    context_data_map_.at(first_parms_id_), sec_level_, pool_,
+                    small_ntt_tables_cache_, galois_tool_);
+                const_pointer_cast<ContextData>(
+                    context_data_map_.at(first_parms_id_))->mod_chain_builder_ =
+                        mod_chain_builder_;
+            }
+        }
+        else if (expand_mod_chain &&
             context_data_map_.at(first_parms_id_)->qualifiers_.parameters_set)
         {
             auto prev_parms_id = first_parms_id_;
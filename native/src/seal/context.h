@@ -6,11 +6,13 @@
 #include <unordered_map>
 #include <functional>
 #include <memory>
+#include <ostream>
 #include "seal/encryptionparams.h"
 #include "seal/memorymanager.h"
 #include "seal/modulus.h"
 #include "seal/util/smallntt.h"
 #include "seal/util/baseconverter.h"
+#include "seal/util/galois.h"
 #include "seal/util/pointer.h"
 
 namespace seal
@@ -149,6 +151,8 @@ namespace seal
     */
     class SEALContext
     {
+        class ModChainBuilder;
+
     public:
         /**
         Class to hold pre-computation data for a given set of encryption parameters.
@@ -236,6 +240,16 @@ namespace seal
                 return plain_ntt_tables_;
             }
 
+            /**
+            Returns a const reference to the cache of permutations for Galois
+            automorphisms, which is shared by all levels of the modulus switching
+            chain.
+            */
+            SEAL_NODISCARD inline const util::GaloisTool &galois_tool() const noexcept
+            {
+                return *galois_tool_;
+            }
+
             /**
             Return a pointer to BFV "Delta", i.e. coefficient modulus divided by
             plaintext modulus.
@@ -317,11 +331,15 @@ namespace seal
             /**
             Returns a shared_ptr to the context data corresponding to the next parameters
             in the modulus switching chain. If the current data is the last one in the
-            chain, then the result is nullptr.
+            chain, then the result is nullptr. If the SEALContext was created with
+            lazy_mod_chain set, the next context data is created if needed; this
+            requires the SEALContext to still exist, and otherwise, or if creating
+            it failed, the result is nullptr.
             */
             SEAL_NODISCARD inline auto next_context_data() const noexcept
             {
-                return next_context_data_;
+                return mod_chain_builder_.expired() ?
+                    next_context_data_ : lazy_next_context_data();
             }
 
             /**
@@ -343,12 +361,20 @@ namespace seal
                 }
             }
 
+            std::shared_ptr<const ContextData> lazy_next_context_data() const noexcept;
+
             MemoryPoolHandle pool_;
 
             EncryptionParameters parms_;
 
             EncryptionParameterQualifiers qualifiers_;
 
+            // Owner of the NTT tables shared by all ContextData instances
+            std::shared_ptr<util::SmallNTTTablesCache> small_ntt_tables_cache_;
+
+            // Galois permutations shared by all ContextData instances
+            std::shared_ptr<util::GaloisTool> galois_tool_;
+
             util::Pointer<util::BaseConverter> base_converter_;
 
             util::Pointer<util::SmallNTTTables> small_ntt_tables_;
@@ -375,6 +401,9 @@ namespace seal
 
             std::shared_ptr<const ContextData> next_context_data_{ nullptr };
 
+            // Creates the next context data if it is created on first access
+            std::weak_ptr<ModChainBuilder> mod_chain_builder_;
+
             std::size_t chain_index_ = 0;
         };
 
@@ -389,21 +418,90 @@ namespace seal
         should be created
         @param[in] sec_level Determines whether a specific security level should be
         enforced according to HomomorphicEncryption.org security standard
+        @param[in] lazy_mod_chain Determines whether the levels of the modulus
+        switching chain below the first data level are created only when they are
+        first accessed, through get_context_data, last_context_data, or
+        ContextData::next_context_data; their parms_ids are known up front
         */
         SEAL_NODISCARD static auto Create(
             const EncryptionParameters &parms,
             bool expand_mod_chain = true,
-            sec_level_type sec_level = sec_level_type::tc128)
+            sec_level_type sec_level = sec_level_type::tc128,
+            bool lazy_mod_chain = false)
         {
             return std::shared_ptr<SEALContext>(
                 new SEALContext(
                     parms,
                     expand_mod_chain,
                     sec_level,
-                    MemoryManager::GetPool())
+                    lazy_mod_chain,
+                    MemoryManager::GetPool(),
+                    nullptr)
                 );
         }
 
+        /**
+        Creates an instance of SEALContext using pre-computations saved with
+        save_precomputation at a given memory location, e.g., a memory-mapped
+        file (see MappedFile). The NTT tables are used in place instead of being
+        computed, so the memory must remain valid for as long as the SEALContext
+        and any objects created from it are in use. The saved data must have been
+        created for the same encryption parameters, which is checked by comparing
+        parms_id. The header and parms_id are verified against a Blake2b digest
+        here; each NTT table is verified against its own digest when it is first
+        used, so that creating the SEALContext does not read the tables. The
+        digests detect corrupted or mismatched data but do not authenticate its
+        source.
+
+        @param[in] parms The encryption parameters
+        @param[in] precomputation The memory location holding the pre-computations,
+        aligned to 8 bytes
+        @param[in] size The number of bytes available in the given memory location
+        @param[in] expand_mod_chain Determines whether the modulus switching chain
+        should be created
+        @param[in] sec_level Determines whether a specific security level should be
+        enforced according to HomomorphicEncryption.org security standard
+        @param[in] lazy_mod_chain Determines whether the levels of the modulus
+        switching chain below the first data level are created only when they are
+        first accessed
+        @throws std::invalid_argument if precomputation is null or not aligned
+        @throws std::invalid_argument if the pre-computations were saved for
+        different encryption parameters
+        @throws std::logic_error if the data is not in the layout written by
+        save_precomputation, does not match its digest, or is invalid; an NTT
+        table that does not match its digest instead throws std::logic_error
+        from the first operation that uses it
+        */
+        SEAL_NODISCARD static std::shared_ptr<SEALContext> Create(
+            const EncryptionParameters &parms,
+            SEAL_BYTE *precomputation,
+            std::size_t size,
+            bool expand_mod_chain = true,
+            sec_level_type sec_level = sec_level_type::tc128,
+            bool lazy_mod_chain = false);
+
+        /**
+        Returns a SEALContext for the given encryption parameters that is shared
+        with every other caller of CreateShared with equal parameters. Contexts
+        are looked up in a process-wide registry by parms_id, expand_mod_chain,
+        sec_level, and the random generator factory of the parameters; if none
+        exists, a new context is created as with Create. The registry only holds
+        weak references, so a context is destroyed as usual once the last
+        shared_ptr to it is released, and is created again on the next call.
+        This function is thread-safe. Contexts returned by CreateShared use the
+        global memory pool.
+
+        @param[in] parms The encryption parameters
+        @param[in] expand_mod_chain Determines whether the modulus switching chain
+        should be created
+        @param[in] sec_level Determines whether a specific security level should be
+        enforced according to HomomorphicEncryption.org security standard
+        */
+        SEAL_NODISCARD static std::shared_ptr<SEALContext> CreateShared(
+            const EncryptionParameters &parms,
+            bool expand_mod_chain = true,
+            sec_level_type sec_level = sec_level_type::tc128);
+
         /**
         Returns the ContextData corresponding to encryption parameters with a given
         parms_id. If parameters with the given parms_id are not found then the
@@ -415,8 +513,11 @@ namespace seal
             parms_id_type parms_id) const
         {
             auto data = context_data_map_.find(parms_id);
-            return (data != context_data_map_.end()) ?
-                data->second : std::shared_ptr<ContextData>{ nullptr };
+            if (data == context_data_map_.end())
+            {
+                return std::shared_ptr<const ContextData>{ nullptr };
+            }
+            return data->second ? data->second : lazy_context_data(parms_id);
         }
 
         /**
@@ -447,9 +548,7 @@ namespace seal
         */
         SEAL_NODISCARD inline auto last_context_data() const
         {
-            auto data = context_data_map_.find(last_parms_id_);
-            return (data != context_data_map_.end()) ?
-                data->second : std::shared_ptr<ContextData>{ nullptr };
+            return get_context_data(last_parms_id_);
         }
 
         /**
@@ -500,6 +599,40 @@ namespace seal
             return using_keyswitching_;
         }
 
+        /**
+        Returns the number of primes in each digit of the decomposition used in
+        key switching, as determined by EncryptionParameters::decomposition_count.
+        The primes of the first data level are grouped into digits in order; the
+        last digit may contain fewer primes. Returns zero if keyswitching is not
+        supported.
+        */
+        SEAL_NODISCARD inline std::size_t keyswitching_digit_size() const noexcept
+        {
+            return keyswitching_digit_size_;
+        }
+
+        /**
+        Returns the number of bytes save_precomputation writes.
+
+        @throws std::logic_error if the encryption parameters are not valid
+        @throws std::logic_error if the size does not fit in the return type
+        */
+        SEAL_NODISCARD std::streamoff save_precomputation_size() const;
+
+        /**
+        Saves the pre-computed NTT tables, which make up most of the time spent
+        in creating a SEALContext, to an output stream in an uncompressed layout
+        that can be used in place by Create, e.g., from a memory-mapped file (see
+        MappedFile). A Blake2b digest of the header and parms_id, and one of each
+        table, are saved with them. The output is in binary format and not
+        human-readable. The output stream must have the "binary" flag set.
+
+        @param[out] stream The stream to save the pre-computations to
+        @throws std::logic_error if the encryption parameters are not valid
+        @throws std::runtime_error if I/O operations failed
+        */
+        std::streamoff save_precomputation(std::ostream &stream) const;
+
     private:
         SEALContext(const SEALContext &copy) = delete;
 
@@ -518,21 +651,37 @@ namespace seal
         should be created
         @param[in] sec_level Determines whether a specific security level should be
         enforced according to HomomorphicEncryption.org security standard
+        @param[in] lazy_mod_chain Determines whether the levels of the modulus
+        switching chain below the first data level are created on first access
         @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @param[in] small_ntt_tables_cache Previously computed NTT tables to use,
+        or nullptr
         @throws std::invalid_argument if pool is uninitialized
         */
         SEALContext(EncryptionParameters parms, bool expand_mod_chain,
-            sec_level_type sec_level, MemoryPoolHandle pool);
+            sec_level_type sec_level, bool lazy_mod_chain, MemoryPoolHandle pool,
+            std::shared_ptr<util::SmallNTTTablesCache> small_ntt_tables_cache);
+
+        static ContextData validate(EncryptionParameters parms,
+            sec_level_type sec_level, MemoryPoolHandle pool,
+            std::shared_ptr<util::SmallNTTTablesCache> &small_ntt_tables_cache,
+            std::shared_ptr<util::GaloisTool> &galois_tool);
 
-        ContextData validate(EncryptionParameters parms);
+        /**
+        Returns the ContextData for the given parms_id of a level of the modulus
+        switching chain that is created on first access, creating it if needed.
+        */
+        std::shared_ptr<const ContextData> lazy_context_data(
+            const parms_id_type &parms_id) const;
 
         /**
-        Create the next context_data by dropping the last element from coeff_modulus.
-        If the new encryption parameters are not valid, returns parms_id_zero.
-        Otherwise, returns the parms_id of the next parameter and appends the next
-        context_data to the chain.
+        Create the next context_data by dropping the last drop_count elements from
+        coeff_modulus. If the new encryption parameters are not valid, returns
+        parms_id_zero. Otherwise, returns the parms_id of the next parameter and
+        appends the next context_data to the chain.
         */
-        parms_id_type create_next_context_data(const parms_id_type &prev_parms);
+        parms_id_type create_next_context_data(const parms_id_type &prev_parms,
+            std::size_t drop_count = 1);
 
         MemoryPoolHandle pool_;
 
@@ -542,9 +691,27 @@ namespace seal
 
         parms_id_type last_parms_id_;
 
+        /**
+        Levels of the modulus switching chain that are created on first access
+        are stored in context_data_map_ as nullptr, and are owned by
+        mod_chain_builder_ once created.
+        */
         std::unordered_map<
             parms_id_type, std::shared_ptr<const ContextData>> context_data_map_{};
 
+        std::shared_ptr<ModChainBuilder> mod_chain_builder_;
+
+        /**
+        NTT tables for every prime used on any level of the modulus switching
+        chain, and in Bsk; every ContextData refers to these tables.
+        */
+        std::shared_ptr<util::SmallNTTTablesCache> small_ntt_tables_cache_;
+
+        /**
+        Permutations for Galois automorphisms; every ContextData refers to these.
+        */
+        std::shared_ptr<util::GaloisTool> galois_tool_;
+
         /**
         Is HomomorphicEncryption.org security standard enforced?
         */
@@ -554,5 +721,7 @@ namespace seal
         Is keyswitching supported by the encryption parameters?
         */
         bool using_keyswitching_;
+
+        std::size_t keyswitching_digit_size_ = 0;
     };
 }
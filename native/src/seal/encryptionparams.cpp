@@ -22,6 +22,11 @@ namespace seal
             uint64_t coeff_mod_count64 = static_cast<uint64_t>(coeff_modulus_.size());
             uint8_t scheme = static_cast<uint8_t>(scheme_);
 
+            // The key switching settings are stored in the unused high bits of
+            // coeff_mod_count, so that the default settings keep the format
+            coeff_mod_count64 |= static_cast<uint64_t>(special_prime_count_ - 1) << 32;
+            coeff_mod_count64 |= static_cast<uint64_t>(decomposition_count_) << 48;
+
             stream.write(reinterpret_cast<const char*>(&scheme), sizeof(uint8_t));
             stream.write(reinterpret_cast<const char*>(&poly_modulus_degree64), sizeof(uint64_t));
             stream.write(reinterpret_cast<const char*>(&coeff_mod_count64), sizeof(uint64_t));
@@ -71,9 +76,12 @@ namespace seal
                 throw logic_error("poly_modulus_degree is invalid");
             }
 
-            // Read the coeff_modulus size
+            // Read the coeff_modulus size and the key switching settings
             uint64_t coeff_mod_count64 = 0;
             stream.read(reinterpret_cast<char*>(&coeff_mod_count64), sizeof(uint64_t));
+            uint64_t special_prime_count64 = ((coeff_mod_count64 >> 32) & 0xFFFF) + 1;
+            uint64_t decomposition_count64 = coeff_mod_count64 >> 48;
+            coeff_mod_count64 &= 0xFFFFFFFF;
 
             // Only check for upper bound; lower bound is zero for scheme_type::none
             if (coeff_mod_count64 > SEAL_COEFF_MOD_COUNT_MAX)
@@ -96,6 +104,8 @@ namespace seal
             // Supposedly everything worked so set the values of member variables
             parms.set_poly_modulus_degree(safe_cast<size_t>(poly_modulus_degree64));
             parms.set_coeff_modulus(coeff_modulus);
+            parms.set_special_prime_count(safe_cast<size_t>(special_prime_count64));
+            parms.set_decomposition_count(safe_cast<size_t>(decomposition_count64));
 
             // Only BFV uses plain_modulus; set_plain_modulus checks that for
             // other schemes it is zero
@@ -123,11 +133,17 @@ namespace seal
     {
         size_t coeff_mod_count = coeff_modulus_.size();
 
+        // The key switching settings are hashed only if they differ from the
+        // defaults, so that existing parms_ids remain unchanged
+        bool default_key_switching =
+            special_prime_count_ == 1 && decomposition_count_ == 0;
+
         size_t total_uint64_count = add_safe(
             size_t(1),  // scheme
             size_t(1),  // poly_modulus_degree
             coeff_mod_count,
-            plain_modulus_.uint64_count()
+            plain_modulus_.uint64_count(),
+            default_key_switching ? size_t(0) : size_t(2)
         );
 
         auto param_data(allocate_uint(total_uint64_count, pool_));
@@ -147,6 +163,12 @@ namespace seal
         set_uint_uint(plain_modulus_.data(), plain_modulus_.uint64_count(), param_data_ptr);
         param_data_ptr += plain_modulus_.uint64_count();
 
+        if (!default_key_switching)
+        {
+            *param_data_ptr++ = static_cast<uint64_t>(special_prime_count_);
+            *param_data_ptr++ = static_cast<uint64_t>(decomposition_count_);
+        }
+
         HashFunction::hash(param_data.get(), total_uint64_count, parms_id_);
 
         // Did we somehow manage to get a zero block as result? This is reserved for
@@ -252,6 +252,70 @@ namespace seal
             set_plain_modulus(SmallModulus(plain_modulus));
         }
 
+        /**
+        Sets the number of special primes used in key switching. The special
+        primes are the last special_prime_count primes of the coefficient modulus;
+        they are used only by keys and the key switching operation and are not
+        part of the data levels of the modulus switching chain. By default there
+        is one special prime. Using more special primes lowers the noise added by
+        key switching with a decomposition into few digits (see
+        set_decomposition_count), at the cost of a larger key level. The product
+        of the special primes should be at least the product of the primes in
+        one digit.
+
+        @param[in] special_prime_count The new number of special primes
+        @throws std::logic_error if a valid scheme is not set and
+        special_prime_count is not 1
+        @throws std::invalid_argument if special_prime_count is zero or too large
+        */
+        inline void set_special_prime_count(std::size_t special_prime_count)
+        {
+            if (scheme_ == scheme_type::none && special_prime_count != 1)
+            {
+                throw std::logic_error("special_prime_count is not supported for this scheme");
+            }
+            if (!special_prime_count || special_prime_count >= SEAL_COEFF_MOD_COUNT_MAX)
+            {
+                throw std::invalid_argument("special_prime_count is invalid");
+            }
+
+            special_prime_count_ = special_prime_count;
+
+            // Re-compute the parms_id
+            compute_parms_id();
+        }
+
+        /**
+        Sets the number of digits in the decomposition used in key switching. The
+        primes of the first data level are split into decomposition_count groups
+        of consecutive primes of equal size (except possibly the last one), and
+        keys contain one component for each group. Fewer digits make keys smaller
+        and key switching faster but add more noise unless more special primes
+        are used. The default value zero, like any value larger than the number
+        of primes of the first data level, uses one digit per prime.
+
+        @param[in] decomposition_count The new number of digits
+        @throws std::logic_error if a valid scheme is not set and
+        decomposition_count is non-zero
+        @throws std::invalid_argument if decomposition_count is too large
+        */
+        inline void set_decomposition_count(std::size_t decomposition_count)
+        {
+            if (scheme_ == scheme_type::none && decomposition_count)
+            {
+                throw std::logic_error("decomposition_count is not supported for this scheme");
+            }
+            if (decomposition_count > SEAL_COEFF_MOD_COUNT_MAX)
+            {
+                throw std::invalid_argument("decomposition_count is invalid");
+            }
+
+            decomposition_count_ = decomposition_count;
+
+            // Re-compute the parms_id
+            compute_parms_id();
+        }
+
         /**
         Sets the random number generator factory to use for encryption. By default,
         the random generator is set to UniformRandomGeneratorFactory::default_factory().
@@ -299,6 +363,23 @@ namespace seal
             return plain_modulus_;
         }
 
+        /**
+        Returns the number of special primes used in key switching.
+        */
+        SEAL_NODISCARD inline std::size_t special_prime_count() const noexcept
+        {
+            return special_prime_count_;
+        }
+
+        /**
+        Returns the number of digits in the key switching decomposition, or zero
+        if every prime of the first data level is a digit of its own.
+        */
+        SEAL_NODISCARD inline std::size_t decomposition_count() const noexcept
+        {
+            return decomposition_count_;
+        }
+
         /**
         Returns a pointer to the random number generator factory to use for encryption.
         */
@@ -382,7 +463,7 @@ namespace seal
         @throws std::runtime_error if I/O operations failed
         */
         inline std::streamoff save(std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
@@ -427,7 +508,7 @@ namespace seal
         inline std::streamoff save(
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
@@ -514,6 +595,10 @@ namespace seal
 
         SmallModulus plain_modulus_{};
 
+        std::size_t special_prime_count_ = 1;
+
+        std::size_t decomposition_count_ = 0;
+
         parms_id_type parms_id_ = parms_id_zero;
     };
 }
@@ -3,6 +3,8 @@
 
 #include <algorithm>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 #include "seal/encryptor.h"
 #include "seal/randomgen.h"
 #include "seal/randomtostd.h"
@@ -17,6 +19,8 @@
 #include "seal/util/smallntt.h"
 #include "seal/util/rlwe.h"
 #include "seal/util/scalingvariant.h"
+#include "seal/util/parallel.h"
+#include "seal/util/zeroencryptionpool.h"
 
 using namespace std;
 
@@ -105,11 +109,73 @@ namespace seal
         }
     }
 
+    Encryptor::~Encryptor() = default;
+
+    void Encryptor::set_public_key(const PublicKey &public_key)
+    {
+        if (!is_valid_for(public_key, context_))
+        {
+            throw invalid_argument("public key is not valid for encryption parameters");
+        }
+
+        // Pooled encryptions of zero are only valid under the old key
+        size_t pool_depth = 0;
+        size_t pool_thread_count = 0;
+        if (zero_pool_)
+        {
+            pool_depth = zero_pool_->depth();
+            pool_thread_count = zero_pool_->thread_count();
+            zero_pool_.reset();
+        }
+        public_key_ = public_key;
+        if (pool_depth)
+        {
+            enable_zero_pool(pool_depth, pool_thread_count);
+        }
+    }
+
+    void Encryptor::enable_zero_pool(size_t depth, size_t thread_count)
+    {
+        if (!is_metadata_valid_for(public_key_, context_))
+        {
+            throw logic_error("public key is not set");
+        }
+        if (!depth || !thread_count)
+        {
+            throw invalid_argument("depth and thread_count must be positive");
+        }
+
+        // Stop the current pool before creating the new one
+        zero_pool_.reset();
+
+        // The generator always passes its own random number generator, which
+        // makes encrypt_zero_internal bypass the pool
+        auto generator = [this](const parms_id_type &parms_id,
+            shared_ptr<UniformRandomGenerator> rng, Ciphertext &destination) {
+            encrypt_zero_internal(parms_id, true, false, destination, pool_, move(rng));
+        };
+        zero_pool_ = make_unique<util::ZeroEncryptionPool>(generator,
+            context_->key_context_data()->parms().random_generator(),
+            depth, thread_count);
+
+        // In BFV fresh encryptions are always at the first data level
+        if (context_->key_context_data()->parms().scheme() == scheme_type::BFV)
+        {
+            zero_pool_->reserve(context_->first_parms_id());
+        }
+    }
+
+    void Encryptor::disable_zero_pool()
+    {
+        zero_pool_.reset();
+    }
+
     void Encryptor::encrypt_zero_internal(
         parms_id_type parms_id,
         bool is_asymmetric, bool save_seed,
         Ciphertext &destination,
-        MemoryPoolHandle pool) const
+        MemoryPoolHandle pool,
+        shared_ptr<UniformRandomGenerator> rng) const
     {
         // Verify parameters.
         if (!pool)
@@ -138,6 +204,31 @@ namespace seal
             throw invalid_argument("unsupported scheme");
         }
 
+        // Use a pooled encryption of zero if one is ready; it is copied so
+        // that destination keeps its own memory pool
+        if (is_asymmetric && !rng && zero_pool_)
+        {
+            Ciphertext pooled;
+            if (zero_pool_->try_take(parms_id, pooled))
+            {
+                destination.resize(context_, parms_id, 2);
+                for (size_t j = 0; j < 2; j++)
+                {
+                    util::set_poly_poly(pooled.data(j), coeff_count, coeff_mod_count,
+                        destination.data(j));
+                }
+                destination.is_ntt_form() = pooled.is_ntt_form();
+                destination.scale() = pooled.scale();
+                return;
+            }
+        }
+
+        // Use a fresh generator unless one was given
+        if (!rng)
+        {
+            rng = parms.random_generator()->create();
+        }
+
         // Resize destination and save results
         destination.resize(context_, parms_id, 2);
 
@@ -155,7 +246,7 @@ namespace seal
                 // Zero encryption without modulus switching
                 Ciphertext temp(pool);
                 util::encrypt_zero_asymmetric(public_key_, context_, prev_parms_id,
-                    is_ntt_form, temp);
+                    is_ntt_form, rng, temp);
 
                 // Modulus switching
                 for (size_t j = 0; j < 2; j++)
@@ -187,13 +278,13 @@ namespace seal
             {
                 // Does not require modulus switching
                 util::encrypt_zero_asymmetric(public_key_, context_, parms_id,
-                    is_ntt_form, destination);
+                    is_ntt_form, rng, destination);
             }
         }
         else
         {
             util::encrypt_zero_symmetric(secret_key_, context_, parms_id,
-                is_ntt_form, save_seed, destination);
+                is_ntt_form, save_seed, rng, destination);
             // Does not require modulus switching
         }
     }
@@ -202,7 +293,8 @@ namespace seal
         const Plaintext &plain,
         bool is_asymmetric, bool save_seed,
         Ciphertext &destination,
-        MemoryPoolHandle pool) const
+        MemoryPoolHandle pool,
+        shared_ptr<UniformRandomGenerator> rng) const
     {
         // Minimal verification that the keys are set
         if (is_asymmetric)
@@ -235,7 +327,7 @@ namespace seal
             }
 
             encrypt_zero_internal(context_->first_parms_id(),
-                is_asymmetric, save_seed, destination, pool);
+                is_asymmetric, save_seed, destination, pool, rng);
 
             // Multiply plain by scalar coeff_div_plaintext and reposition if in upper-half.
             // Result gets added into the c_0 term of ciphertext (c_0,c_1).
@@ -255,7 +347,7 @@ namespace seal
                 throw invalid_argument("plain is not valid for encryption parameters");
             }
             encrypt_zero_internal(plain.parms_id(),
-                is_asymmetric, save_seed, destination, pool);
+                is_asymmetric, save_seed, destination, pool, rng);
 
             auto &parms = context_->get_context_data(plain.parms_id())->parms();
             auto &coeff_modulus = parms.coeff_modulus();
@@ -280,4 +372,62 @@ namespace seal
             throw invalid_argument("unsupported scheme");
         }
     }
+
+    void Encryptor::encrypt_many_internal(
+        const Plaintext *plains, size_t count,
+        bool is_asymmetric,
+        Ciphertext *destination,
+        size_t thread_count,
+        MemoryPoolHandle pool) const
+    {
+        if (!pool)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
+        if (count && (!plains || !destination))
+        {
+            throw invalid_argument("plains and destination cannot be null");
+        }
+
+        // Validate everything up front so that worker threads do not normally throw
+        if (is_asymmetric)
+        {
+            if (!is_metadata_valid_for(public_key_, context_))
+            {
+                throw logic_error("public key is not set");
+            }
+        }
+        else
+        {
+            if (!is_metadata_valid_for(secret_key_, context_))
+            {
+                throw logic_error("secret key is not set");
+            }
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!is_metadata_valid_for(plains[i], context_) || !is_buffer_valid(plains[i]))
+            {
+                throw invalid_argument("plains is not valid for encryption parameters");
+            }
+        }
+
+        if (!thread_count)
+        {
+            thread_count = max<size_t>(thread::hardware_concurrency(), 1);
+        }
+        thread_count = min(thread_count, count);
+
+        // Each worker thread owns one random generator for all of its ciphertexts
+        auto random_generator = context_->key_context_data()->parms().random_generator();
+        vector<shared_ptr<UniformRandomGenerator>> rngs(thread_count);
+        util::parallel_for(thread_count, count, [&](size_t thread_index, size_t i) {
+            auto &rng = rngs[thread_index];
+            if (!rng)
+            {
+                rng = random_generator->create();
+            }
+            encrypt_internal(plains[i], is_asymmetric, false, destination[i], pool, rng);
+        });
+    }
 }
@@ -13,10 +13,20 @@
 #include "seal/context.h"
 #include "seal/publickey.h"
 #include "seal/secretkey.h"
+#include "seal/randomgen.h"
 #include "seal/util/smallntt.h"
 
+#ifdef SEAL_USE_MSGSL_SPAN
+#include <gsl/span>
+#endif
+
 namespace seal
 {
+    namespace util
+    {
+        class ZeroEncryptionPool;
+    }
+
     /**
     Encrypts Plaintext objects into Ciphertext objects. Constructing an Encryptor
     requires a SEALContext with valid encryption parameters, the public key and/or
@@ -86,19 +96,18 @@ namespace seal
             const SecretKey &secret_key);
 
         /**
-        Give a new instance of public key.
+        Destroys the Encryptor and stops the encryption-of-zero pool if enabled.
+        */
+        ~Encryptor();
+
+        /**
+        Give a new instance of public key. If the encryption-of-zero pool is
+        enabled, its contents are discarded and it is refilled under the new key.
 
         @param[in] public_key The public key
         @throws std::invalid_argument if public_key is not valid
         */
-        inline void set_public_key(const PublicKey &public_key)
-        {
-            if (!is_valid_for(public_key, context_))
-            {
-                throw std::invalid_argument("public key is not valid for encryption parameters");
-            }
-            public_key_ = public_key;
-        }
+        void set_public_key(const PublicKey &public_key);
 
         /**
         Give a new instance of secret key.
@@ -115,6 +124,42 @@ namespace seal
             secret_key_ = secret_key;
         }
 
+        /**
+        Enables a pool of precomputed encryptions of zero under the public key.
+        Background threads keep up to depth encryptions of zero ready for each
+        parms_id that has been used for public-key encryption, so that encrypt
+        and encrypt_zero only need to add the plaintext when an entry is ready.
+        Each pooled encryption of zero is used at most once. When the pool is
+        empty, encryption falls back to computing a fresh encryption of zero.
+        Calling this function again replaces the current pool.
+
+        Pooled ciphertexts are kept in a memory pool that is cleared when the
+        memory is released, since an encryption of zero must remain secret
+        until it has been combined with a plaintext. A pooled encryption of zero
+        is copied into the destination ciphertext, which keeps its own memory
+        pool.
+
+        @param[in] depth The number of encryptions of zero kept per parms_id
+        @param[in] thread_count The number of background threads refilling the
+        pool
+        @throws std::logic_error if a public key is not set
+        @throws std::invalid_argument if depth or thread_count is zero
+        */
+        void enable_zero_pool(std::size_t depth, std::size_t thread_count = 1);
+
+        /**
+        Stops the background threads and discards the encryption-of-zero pool.
+        */
+        void disable_zero_pool();
+
+        /**
+        Returns whether the encryption-of-zero pool is enabled.
+        */
+        SEAL_NODISCARD inline bool zero_pool_enabled() const noexcept
+        {
+            return static_cast<bool>(zero_pool_);
+        }
+
         /**
         Encrypts a plaintext with the public key and stores the result in
         destination. The encryption parameters for the resulting ciphertext
@@ -140,6 +185,72 @@ namespace seal
             encrypt_internal(plain, true, false, destination, pool);
         }
 
+        /**
+        Encrypts a batch of plaintexts with the public key and stores the results
+        in destination, which is resized to the number of plaintexts. The work is
+        distributed over the given number of threads, each of which reuses a single
+        random number generator for all of its ciphertexts. The encryption
+        parameters for each resulting ciphertext are as in encrypt. Dynamic memory
+        allocations in the process are allocated from the memory pool pointed to by
+        the given MemoryPoolHandle, which must be thread-safe when thread_count is
+        not 1.
+
+        @param[in] plains The plaintexts to encrypt
+        @param[out] destination The ciphertexts to overwrite with the encrypted
+        plaintexts
+        @param[in] thread_count The number of threads to use; zero selects the
+        number of hardware threads
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::logic_error if a public key is not set
+        @throws std::invalid_argument if any of plains is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if any of plains is not in default NTT form
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        inline void encrypt_many(const std::vector<Plaintext> &plains,
+            std::vector<Ciphertext> &destination, std::size_t thread_count = 0,
+            MemoryPoolHandle pool = MemoryManager::GetPool()) const
+        {
+            destination.resize(plains.size());
+            encrypt_many_internal(plains.data(), plains.size(), true,
+                destination.data(), thread_count, std::move(pool));
+        }
+#ifdef SEAL_USE_MSGSL_SPAN
+        /**
+        Encrypts a batch of plaintexts with the public key and stores the results
+        in destination. The work is distributed over the given number of threads,
+        each of which reuses a single random number generator for all of its
+        ciphertexts. The encryption parameters for each resulting ciphertext are
+        as in encrypt. Dynamic memory allocations in the process are allocated from
+        the memory pool pointed to by the given MemoryPoolHandle, which must be
+        thread-safe when thread_count is not 1.
+
+        @param[in] plains The plaintexts to encrypt
+        @param[out] destination The ciphertexts to overwrite with the encrypted
+        plaintexts
+        @param[in] thread_count The number of threads to use; zero selects the
+        number of hardware threads
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if plains and destination have different
+        sizes
+        @throws std::logic_error if a public key is not set
+        @throws std::invalid_argument if any of plains is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if any of plains is not in default NTT form
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        inline void encrypt_many(gsl::span<const Plaintext> plains,
+            gsl::span<Ciphertext> destination, std::size_t thread_count = 0,
+            MemoryPoolHandle pool = MemoryManager::GetPool()) const
+        {
+            if (plains.size() != destination.size())
+            {
+                throw std::invalid_argument("plains and destination sizes do not match");
+            }
+            encrypt_many_internal(plains.data(), static_cast<std::size_t>(plains.size()),
+                true, destination.data(), thread_count, std::move(pool));
+        }
+#endif
         /**
         Encrypts a zero plaintext with the public key and stores the result in
         destination. The encryption parameters for the resulting ciphertext
@@ -206,6 +317,72 @@ namespace seal
             encrypt_internal(plain, false, false, destination, pool);
         }
 
+        /**
+        Encrypts a batch of plaintexts with the secret key and stores the results
+        in destination, which is resized to the number of plaintexts. The work is
+        distributed over the given number of threads, each of which reuses a single
+        random number generator for all of its ciphertexts. The encryption
+        parameters for each resulting ciphertext are as in encrypt_symmetric.
+        Dynamic memory allocations in the process are allocated from the memory
+        pool pointed to by the given MemoryPoolHandle, which must be thread-safe
+        when thread_count is not 1.
+
+        @param[in] plains The plaintexts to encrypt
+        @param[out] destination The ciphertexts to overwrite with the encrypted
+        plaintexts
+        @param[in] thread_count The number of threads to use; zero selects the
+        number of hardware threads
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::logic_error if a secret key is not set
+        @throws std::invalid_argument if any of plains is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if any of plains is not in default NTT form
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        inline void encrypt_symmetric_many(const std::vector<Plaintext> &plains,
+            std::vector<Ciphertext> &destination, std::size_t thread_count = 0,
+            MemoryPoolHandle pool = MemoryManager::GetPool()) const
+        {
+            destination.resize(plains.size());
+            encrypt_many_internal(plains.data(), plains.size(), false,
+                destination.data(), thread_count, std::move(pool));
+        }
+#ifdef SEAL_USE_MSGSL_SPAN
+        /**
+        Encrypts a batch of plaintexts with the secret key and stores the results
+        in destination. The work is distributed over the given number of threads,
+        each of which reuses a single random number generator for all of its
+        ciphertexts. The encryption parameters for each resulting ciphertext are
+        as in encrypt_symmetric. Dynamic memory allocations in the process are
+        allocated from the memory pool pointed to by the given MemoryPoolHandle,
+        which must be thread-safe when thread_count is not 1.
+
+        @param[in] plains The plaintexts to encrypt
+        @param[out] destination The ciphertexts to overwrite with the encrypted
+        plaintexts
+        @param[in] thread_count The number of threads to use; zero selects the
+        number of hardware threads
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if plains and destination have different
+        sizes
+        @throws std::logic_error if a secret key is not set
+        @throws std::invalid_argument if any of plains is not valid for the
+        encryption parameters
+        @throws std::invalid_argument if any of plains is not in default NTT form
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        inline void encrypt_symmetric_many(gsl::span<const Plaintext> plains,
+            gsl::span<Ciphertext> destination, std::size_t thread_count = 0,
+            MemoryPoolHandle pool = MemoryManager::GetPool()) const
+        {
+            if (plains.size() != destination.size())
+            {
+                throw std::invalid_argument("plains and destination sizes do not match");
+            }
+            encrypt_many_internal(plains.data(), static_cast<std::size_t>(plains.size()),
+                false, destination.data(), thread_count, std::move(pool));
+        }
+#endif
         /**
         Encrypts a zero plaintext with the secret key and stores the result in
         destination. The encryption parameters for the resulting ciphertext
@@ -279,7 +456,7 @@ namespace seal
         inline std::streamoff encrypt_symmetric_save(
             const Plaintext &plain,
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default,
+            CompressionParameters compr_mode = Serialization::compr_mode_default,
             MemoryPoolHandle pool = MemoryManager::GetPool()) const
         {
             Ciphertext destination;
@@ -310,7 +487,7 @@ namespace seal
         */
         inline std::streamoff encrypt_zero_symmetric_save(
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default,
+            CompressionParameters compr_mode = Serialization::compr_mode_default,
             MemoryPoolHandle pool = MemoryManager::GetPool()) const
         {
             return encrypt_zero_symmetric_save(
@@ -344,7 +521,7 @@ namespace seal
         inline std::streamoff encrypt_zero_symmetric_save(
             parms_id_type parms_id,
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default,
+            CompressionParameters compr_mode = Serialization::compr_mode_default,
             MemoryPoolHandle pool = MemoryManager::GetPool()) const
         {
             Ciphertext destination;
@@ -385,7 +562,7 @@ namespace seal
             const Plaintext &plain,
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default,
+            CompressionParameters compr_mode = Serialization::compr_mode_default,
             MemoryPoolHandle pool = MemoryManager::GetPool()) const
         {
             Ciphertext destination;
@@ -419,7 +596,7 @@ namespace seal
         inline std::streamoff encrypt_zero_symmetric_save(
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default,
+            CompressionParameters compr_mode = Serialization::compr_mode_default,
             MemoryPoolHandle pool = MemoryManager::GetPool()) const
         {
             return encrypt_zero_symmetric_save(
@@ -455,7 +632,7 @@ namespace seal
             parms_id_type parms_id,
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default,
+            CompressionParameters compr_mode = Serialization::compr_mode_default,
             MemoryPoolHandle pool = MemoryManager::GetPool()) const
         {
             Ciphertext destination;
@@ -483,18 +660,31 @@ namespace seal
             parms_id_type parms_id,
             bool is_asymmetric, bool save_seed,
             Ciphertext &destination,
-            MemoryPoolHandle pool = MemoryManager::GetPool()) const;
+            MemoryPoolHandle pool = MemoryManager::GetPool(),
+            std::shared_ptr<UniformRandomGenerator> rng = nullptr) const;
 
         void encrypt_internal(
             const Plaintext &plain,
             bool is_asymmetric, bool save_seed,
             Ciphertext &destination,
-            MemoryPoolHandle pool = MemoryManager::GetPool()) const;
+            MemoryPoolHandle pool = MemoryManager::GetPool(),
+            std::shared_ptr<UniformRandomGenerator> rng = nullptr) const;
+
+        void encrypt_many_internal(
+            const Plaintext *plains, std::size_t count,
+            bool is_asymmetric,
+            Ciphertext *destination,
+            std::size_t thread_count,
+            MemoryPoolHandle pool) const;
 
         std::shared_ptr<SEALContext> context_{ nullptr };
 
         PublicKey public_key_;
 
         SecretKey secret_key_;
+
+        // Declared last so that the refill threads stop before the keys and
+        // context they use are destroyed
+        std::unique_ptr<util::ZeroEncryptionPool> zero_pool_;
     };
 }
@@ -13,6 +13,7 @@
 #include "seal/util/polyarithsmallmod.h"
 #include "seal/util/scalingvariant.h"
 #include "seal/util/numth.h"
+#include "seal/util/galois.h"
 
 using namespace std;
 using namespace seal::util;
@@ -267,6 +268,8 @@ namespace seal
     void Evaluator::multiply_inplace(Ciphertext &encrypted1,
         const Ciphertext &encrypted2, MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::multiply_inplace");
+
         // Verify parameters.
         if (!is_metadata_valid_for(encrypted1, context_) || !is_buffer_valid(encrypted1))
         {
@@ -617,82 +620,94 @@ namespace seal
             throw logic_error("invalid parameters");
         }
 
-        // Prepare destination
-        encrypted1.resize(context_, context_data.parms_id(), dest_count);
-
         //pointer increment to switch to a next polynomial
         size_t encrypted_ptr_increment = coeff_count * coeff_mod_count;
 
-        //Step 1: naive multiplication modulo the coefficient modulus
-        //First allocate two temp polys :
-        //one for results in base q. This need to be zero
-        //for the arbitrary size multiplication; not for 2x2 though
-        auto tmp_des(allocate_zero_poly(
-            coeff_count * dest_count, coeff_mod_count, pool));
-
-        //Allocate tmp polys for NTT multiplication results in base q
-        auto tmp1_poly(allocate_poly(coeff_count, coeff_mod_count, pool));
-        auto tmp2_poly(allocate_poly(coeff_count, coeff_mod_count, pool));
-
-        // First convert all the inputs into NTT form
-        auto copy_encrypted1_ntt(allocate_poly(
-            coeff_count * encrypted1_size, coeff_mod_count, pool));
-        set_poly_poly(encrypted1.data(), coeff_count * encrypted1_size,
-            coeff_mod_count, copy_encrypted1_ntt.get());
-
-        auto copy_encrypted2_ntt(allocate_poly(
+        // Every output coefficient is a sum of at most SEAL_CIPHERTEXT_SIZE_MAX
+        // products of values less than q, so the sums stay below q * 2^64 as
+        // Montgomery reduction requires
+        static_assert(SEAL_CIPHERTEXT_SIZE_MAX <=
+            (uint64_t(1) << (64 - SEAL_USER_MOD_BIT_COUNT_MAX)),
+            "SEAL_CIPHERTEXT_SIZE_MAX is too large for lazy Montgomery reduction");
+
+        // Bring encrypted2 into Montgomery form x * 2^64 mod q. The products
+        // with encrypted1 are then summed in 128 bits and reduced only once
+        // per output coefficient, directly back to the standard form.
+        auto mont_encrypted2(allocate_poly(
             coeff_count * encrypted2_size, coeff_mod_count, pool));
-        set_poly_poly(encrypted2.data(), coeff_count * encrypted2_size,
-            coeff_mod_count, copy_encrypted2_ntt.get());
+        auto neg_inv(allocate_uint(coeff_mod_count, pool));
+        for (size_t i = 0; i < coeff_mod_count; i++)
+        {
+            neg_inv[i] = montgomery_neg_inv(coeff_modulus[i]);
 
-        // Perform multiplication on arbitrary size ciphertexts
+            // (2^64)^2 mod q, so that Montgomery reduction of x * r2 is x * 2^64
+            uint64_t r[2]{ 0, 1 };
+            r[0] = barrett_reduce_128(r, coeff_modulus[i]);
+            uint64_t r2 = multiply_uint_uint_mod(r[0], r[0], coeff_modulus[i]);
+            for (size_t j = 0; j < encrypted2_size; j++)
+            {
+                const uint64_t *poly = encrypted2.data(j) + (i * coeff_count);
+                uint64_t *result = mont_encrypted2.get() +
+                    (j * encrypted_ptr_increment) + (i * coeff_count);
+                for (size_t k = 0; k < coeff_count; k++)
+                {
+                    unsigned long long z[2];
+                    multiply_uint64(poly[k], r2, z);
+                    result[k] = montgomery_reduce_128(z, coeff_modulus[i], neg_inv[i]);
+                }
+            }
+        }
+
+        // Perform multiplication on arbitrary size ciphertexts. Every output
+        // component is written in full, so the result buffer need not be zero.
+        auto tmp_des(allocate_poly(coeff_count * dest_count, coeff_mod_count, pool));
 
         // Loop over encrypted1 components [i], seeing if a match exists with an encrypted2
         // component [j] such that [i+j]=[secret_power_index]
         // Only need to check encrypted1 components up to and including [secret_power_index],
         // and strictly less than [encrypted_array.size()]
-
-        // Number of encrypted1 components to check
-        size_t current_encrypted1_limit = 0;
-
         for (size_t secret_power_index = 0;
             secret_power_index < dest_count; secret_power_index++)
         {
-            current_encrypted1_limit = min(encrypted1_size, secret_power_index + 1);
+            size_t encrypted1_first = (secret_power_index < encrypted2_size) ?
+                0 : secret_power_index - encrypted2_size + 1;
+            size_t encrypted1_limit = min(encrypted1_size, secret_power_index + 1);
 
-            for (size_t encrypted1_index = 0;
-                encrypted1_index < current_encrypted1_limit; encrypted1_index++)
+            size_t pair_count = encrypted1_limit - encrypted1_first;
+
+            for (size_t i = 0; i < coeff_mod_count; i++)
             {
-                // check if a corresponding component in encrypted2 exists
-                if (encrypted2_size > secret_power_index - encrypted1_index)
+                // Pointers to the RNS components of the pairs to multiply
+                const uint64_t *operand1[SEAL_CIPHERTEXT_SIZE_MAX];
+                const uint64_t *operand2[SEAL_CIPHERTEXT_SIZE_MAX];
+                for (size_t pair = 0; pair < pair_count; pair++)
                 {
+                    size_t encrypted1_index = encrypted1_first + pair;
                     size_t encrypted2_index = secret_power_index - encrypted1_index;
+                    operand1[pair] = encrypted1.data(encrypted1_index) + (i * coeff_count);
+                    operand2[pair] = mont_encrypted2.get() +
+                        (encrypted2_index * encrypted_ptr_increment) + (i * coeff_count);
+                }
 
-                    // NTT Multiplication and addition for results in q
-                    for (size_t i = 0; i < coeff_mod_count; i++)
+                uint64_t *result = tmp_des.get() +
+                    (secret_power_index * encrypted_ptr_increment) + (i * coeff_count);
+                for (size_t k = 0; k < coeff_count; k++)
+                {
+                    unsigned long long sum[2]{ 0, 0 };
+                    for (size_t pair = 0; pair < pair_count; pair++)
                     {
-                        // ci * dj
-                        dyadic_product_coeffmod(
-                            copy_encrypted1_ntt.get() + (i * coeff_count) +
-                            (encrypted_ptr_increment * encrypted1_index),
-                            copy_encrypted2_ntt.get() + (i * coeff_count) +
-                            (encrypted_ptr_increment * encrypted2_index),
-                            coeff_count, coeff_modulus[i],
-                            tmp1_poly.get() + (i * coeff_count));
-                        // Dest[i+j]
-                        add_poly_poly_coeffmod(
-                            tmp1_poly.get() + (i * coeff_count),
-                            tmp_des.get() + (i * coeff_count) +
-                            (secret_power_index * coeff_count * coeff_mod_count),
-                            coeff_count, coeff_modulus[i],
-                            tmp_des.get() + (i * coeff_count) +
-                            (secret_power_index * coeff_count * coeff_mod_count));
+                        unsigned long long z[2];
+                        multiply_uint64(operand1[pair][k], operand2[pair][k], z);
+                        unsigned char carry = add_uint64(sum[0], z[0], sum);
+                        sum[1] += z[1] + carry;
                     }
+                    result[k] = montgomery_reduce_128(sum, coeff_modulus[i], neg_inv[i]);
                 }
             }
         }
 
         // Set the final result
+        encrypted1.resize(context_, context_data.parms_id(), dest_count);
         set_poly_poly(tmp_des.get(), coeff_count * dest_count,
             coeff_mod_count, encrypted1.data());
 
@@ -702,6 +717,8 @@ namespace seal
 
     void Evaluator::square_inplace(Ciphertext &encrypted, MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::square_inplace");
+
         // Verify parameters.
         if (!is_metadata_valid_for(encrypted, context_) || !is_buffer_valid(encrypted))
         {
@@ -1124,6 +1141,8 @@ namespace seal
         const RelinKeys &relin_keys, size_t destination_size,
         MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::relinearize");
+
         // Verify parameters.
         auto context_data_ptr = context_->get_context_data(encrypted.parms_id());
         if (!context_data_ptr)
@@ -1181,6 +1200,8 @@ namespace seal
     void Evaluator::mod_switch_scale_to_next(const Ciphertext &encrypted,
         Ciphertext &destination, MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::mod_switch_scale_to_next");
+
         auto context_data_ptr = context_->get_context_data(encrypted.parms_id());
         if (context_data_ptr->parms().scheme() == scheme_type::BFV &&
             encrypted.is_ntt_form())
@@ -1286,6 +1307,8 @@ namespace seal
     void Evaluator::mod_switch_drop_to_next(const Ciphertext &encrypted,
         Ciphertext &destination, MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::mod_switch_drop_to_next");
+
         // Assuming at this point encrypted is already validated.
         auto context_data_ptr = context_->get_context_data(encrypted.parms_id());
         if (context_data_ptr->parms().scheme() == scheme_type::CKKS &&
@@ -1592,6 +1615,8 @@ namespace seal
         const RelinKeys &relin_keys, Ciphertext &destination,
         MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::multiply_many");
+
         // Verify parameters.
         if (encrypteds.size() == 0)
         {
@@ -1668,6 +1693,8 @@ namespace seal
     void Evaluator::exponentiate_inplace(Ciphertext &encrypted, uint64_t exponent,
         const RelinKeys &relin_keys, MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::exponentiate_inplace");
+
         // Verify parameters.
         auto context_data_ptr = context_->get_context_data(encrypted.parms_id());
         if (!context_data_ptr)
@@ -1859,6 +1886,8 @@ namespace seal
     void Evaluator::multiply_plain_inplace(Ciphertext &encrypted,
         const Plaintext &plain, MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::multiply_plain_inplace");
+
         // Verify parameters.
         if (!is_metadata_valid_for(encrypted, context_) || !is_buffer_valid(encrypted))
         {
@@ -2125,6 +2154,8 @@ namespace seal
     void Evaluator::transform_to_ntt_inplace(Plaintext &plain,
         parms_id_type parms_id, MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::transform_to_ntt_inplace");
+
         // Verify parameters.
         if (!is_valid_for(plain, context_))
         {
@@ -2333,6 +2364,8 @@ namespace seal
     void Evaluator::apply_galois_inplace(Ciphertext &encrypted, uint64_t galois_elt,
         const GaloisKeys &galois_keys, MemoryPoolHandle pool)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::apply_galois_inplace");
+
         // Verify parameters.
         if (!is_metadata_valid_for(encrypted, context_) || !is_buffer_valid(encrypted))
         {
@@ -2365,8 +2398,6 @@ namespace seal
         }
 
         uint64_t m = mul_safe(static_cast<uint64_t>(coeff_count), uint64_t(2));
-        int n_power_of_two = get_power_of_two(static_cast<uint64_t>(coeff_count));
-
         // Verify parameters
         if (!(galois_elt & 1) || unsigned_geq(galois_elt, m))
         {
@@ -2377,75 +2408,52 @@ namespace seal
             throw invalid_argument("encrypted size must be 2");
         }
 
-        auto temp(allocate_poly(coeff_count, coeff_mod_count, pool));
-
-        // DO NOT CHANGE EXECUTION ORDER OF FOLLOWING SECTION
-        // BEGIN: Apply Galois for each ciphertext
-        // Execution order is sensitive, since apply_galois is not inplace!
+        // The automorphism is a permutation of the coefficients, negating some
+        // of them in coefficient form; the permutations are cached
+        auto &galois_tool = context_data.galois_tool();
+        const uint32_t *permutation = nullptr;
         if (parms.scheme() == scheme_type::BFV)
         {
-            // !!! DO NOT CHANGE EXECUTION ORDER!!!
-            for (size_t i = 0; i < coeff_mod_count; i++)
-            {
-                util::apply_galois(
-                    encrypted.data(0) + i * coeff_count,
-                    n_power_of_two,
-                    galois_elt,
-                    coeff_modulus[i],
-                    temp.get() + i * coeff_count);
-            }
-            // copy result to encrypted.data(0)
-            set_poly_poly(temp.get(), coeff_count, coeff_mod_count,
-                encrypted.data(0));
-            for (size_t i = 0; i < coeff_mod_count; i++)
-            {
-                util::apply_galois(
-                    encrypted.data(1) + i * coeff_count,
-                    n_power_of_two,
-                    galois_elt,
-                    coeff_modulus[i],
-                    temp.get() + i * coeff_count);
-            }
+            permutation = galois_tool.permutation(galois_elt);
         }
         else if (parms.scheme() == scheme_type::CKKS)
         {
-            // !!! DO NOT CHANGE EXECUTION ORDER!!!
-            for (size_t i = 0; i < coeff_mod_count; i++)
-            {
-                util::apply_galois_ntt(
-                    encrypted.data(0) + i * coeff_count,
-                    n_power_of_two,
-                    galois_elt,
-                    temp.get() + i * coeff_count);
-            }
-            // copy result to encrypted.data(0)
-            set_poly_poly(temp.get(), coeff_count, coeff_mod_count,
-                encrypted.data(0));
-            for (size_t i = 0; i < coeff_mod_count; i++)
-            {
-                util::apply_galois_ntt(
-                    encrypted.data(1) + i * coeff_count,
-                    n_power_of_two,
-                    galois_elt,
-                    temp.get() + i * coeff_count);
-            }
+            permutation = galois_tool.ntt_permutation(galois_elt);
         }
         else
         {
             throw logic_error("scheme not implemented");
         }
-        // wipe encrypted.data(1)
-        set_zero_poly(coeff_count, coeff_mod_count, encrypted.data(1));
-        // END: Apply Galois for each ciphertext
-        // REORDERING IS SAFE NOW
 
-        // Calculate (temp * galois_key[0], temp * galois_key[1]) + (ct[0], 0)
+        // Permute encrypted.data(0) one prime at a time through a buffer that
+        // stays in cache
+        auto temp(allocate_uint(coeff_count, pool));
+        for (size_t i = 0; i < coeff_mod_count; i++)
+        {
+            uint64_t *encrypted_ptr = encrypted.data(0) + i * coeff_count;
+            if (parms.scheme() == scheme_type::BFV)
+            {
+                apply_permutation(encrypted_ptr, permutation, coeff_count,
+                    coeff_modulus[i], temp.get());
+            }
+            else
+            {
+                apply_permutation_ntt(encrypted_ptr, permutation, coeff_count,
+                    temp.get());
+            }
+            set_uint_uint(temp.get(), coeff_count, encrypted_ptr);
+        }
+
+        // Calculate (perm(ct[1]) * galois_key[0], perm(ct[1]) * galois_key[1]) +
+        // (perm(ct[0]), 0); ct[1] is permuted as the key switch reads it and is
+        // then replaced
         switch_key_inplace(
             encrypted,
-            temp.get(),
+            encrypted.data(1),
             static_cast<const KSwitchKeys &>(galois_keys),
             GaloisKeys::get_index(galois_elt),
-            pool);
+            pool,
+            permutation);
 #ifdef SEAL_THROW_ON_TRANSPARENT_CIPHERTEXT
         // Transparent ciphertext output is not allowed.
         if (encrypted.is_transparent())
@@ -2481,39 +2489,65 @@ namespace seal
         size_t coeff_count = context_data_ptr->parms().poly_modulus_degree();
 
         // Check if Galois key is generated or not.
-        if (galois_keys.has_key(galois_elt_from_step(steps, coeff_count)))
+        uint64_t galois_elt = galois_elt_from_step(steps, coeff_count);
+        if (galois_keys.has_key(galois_elt))
         {
-        // Perform rotation and key switching
-        apply_galois_inplace(encrypted,
-            galois_elt_from_step(steps, coeff_count),
-            galois_keys, move(pool));
-    }
-        else
-        {
-            // Convert the steps to NAF: guarantees using smallest HW
-            vector<int> naf_steps = naf(steps);
-
-            // If naf_steps contains only one element, then this is a power-of-two
-            // rotation and we would have expected not to get to this part of the
-            // if-statement.
-            if (naf_steps.size() == 1)
-            {
-                throw invalid_argument("Galois key not present");
-            }
+            // Perform rotation and key switching
+            apply_galois_inplace(encrypted, galois_elt, galois_keys, move(pool));
+            return;
+        }
 
-            for (size_t i = 0; i < naf_steps.size(); i++)
+        // With all power-of-two keys in both directions, as generated by
+        // default, the NAF is a shortest decomposition; a term of size
+        // coeff_count / 2 is no rotation and is skipped
+        int row_size = safe_cast<int>(coeff_count >> 1);
+        bool has_power_of_two_keys = true;
+        for (int power = 1; power < row_size && has_power_of_two_keys; power <<= 1)
+        {
+            has_power_of_two_keys =
+                galois_keys.has_key(galois_elt_from_step(power, coeff_count)) &&
+                galois_keys.has_key(galois_elt_from_step(-power, coeff_count));
+        }
+        if (has_power_of_two_keys)
+        {
+            for (auto naf_step : naf(steps))
             {
-                // We might have a NAF-term of size coeff_count / 2; this corresponds
-                // to no rotation so we skip it.
-                if (safe_cast<size_t>(abs(naf_steps[i])) == (coeff_count >> 1))
+                if (abs(naf_step) != row_size)
                 {
-                    continue;
+                    apply_galois_inplace(encrypted,
+                        galois_elt_from_step(naf_step, coeff_count),
+                        galois_keys, pool);
                 }
+            }
+            return;
+        }
 
-                // Apply rotation for this step
-                rotate_internal(encrypted, naf_steps[i], galois_keys, pool);
+        // Otherwise find the rotation steps of the keys that are present; the
+        // powers of 3 modulo 2 * coeff_count generate the rotations to the left
+        uint64_t m = static_cast<uint64_t>(coeff_count) << 1;
+        vector<int> key_steps;
+        uint64_t key_galois_elt = 1;
+        for (int key_step = 1; key_step < row_size; key_step++)
+        {
+            key_galois_elt = (key_galois_elt * 3) & (m - 1);
+            if (galois_keys.has_key(key_galois_elt))
+            {
+                key_steps.push_back(key_step);
             }
         }
+
+        // Compose the rotation from the fewest available keys
+        vector<int> decomposed_steps = decompose_rotation(steps, key_steps, coeff_count);
+        if (decomposed_steps.empty())
+        {
+            throw invalid_argument("Galois key not present");
+        }
+        for (auto decomposed_step : decomposed_steps)
+        {
+            apply_galois_inplace(encrypted,
+                galois_elt_from_step(decomposed_step, coeff_count),
+                galois_keys, pool);
+        }
     }
 
     void Evaluator::switch_key_inplace(
@@ -2521,8 +2555,11 @@ namespace seal
         const uint64_t *target,
         const KSwitchKeys &kswitch_keys,
         size_t kswitch_keys_index,
-        MemoryPoolHandle pool)
+        MemoryPoolHandle pool,
+        const uint32_t *target_permutation)
     {
+        SEAL_ALLOCATION_SITE("Evaluator::switch_key_inplace");
+
         auto parms_id = encrypted.parms_id();
         auto &context_data = *context_->get_context_data(parms_id);
         auto &parms = context_data.parms();
@@ -2572,10 +2609,15 @@ namespace seal
         size_t decomp_mod_count = parms.coeff_modulus().size();
         auto &key_modulus = key_parms.coeff_modulus();
         size_t key_mod_count = key_modulus.size();
-        size_t rns_mod_count = decomp_mod_count + 1;
+        size_t special_mod_count = key_mod_count -
+            context_->first_context_data()->parms().coeff_modulus().size();
+        size_t rns_mod_count = decomp_mod_count + special_mod_count;
         auto &small_ntt_tables = key_context_data.small_ntt_tables();
-        auto &modswitch_factors = key_context_data.base_converter()->
-            get_inv_last_coeff_mod_array();
+
+        // The primes of encrypted are grouped into digits; the last digit may
+        // be smaller, or missing at lower levels
+        size_t digit_size = context_->keyswitching_digit_size();
+        size_t digit_count = (decomp_mod_count + digit_size - 1) / digit_size;
 
         // Size check
         if (!product_fits_in(coeff_count, rns_mod_count, size_t(2)))
@@ -2585,6 +2627,10 @@ namespace seal
 
         // Prepare input
         auto &key_vector = kswitch_keys.data()[kswitch_keys_index];
+        if (key_vector.size() < digit_count)
+        {
+            throw invalid_argument("kswitch_keys is not valid for encryption parameters");
+        }
 
         // Check only the used component in KSwitchKeys.
         for (auto &each_key : key_vector)
@@ -2603,50 +2649,175 @@ namespace seal
             allocate_zero_poly(2 * coeff_count, rns_mod_count, pool)
         };
 
-        // RNS decomposition index = key index
-        for (size_t i = 0; i < decomp_mod_count; i++)
+        // For each RNS decomposition, multiply with key data and sum up.
+        auto local_digit(allocate_poly(coeff_count, digit_size, pool));
+        auto local_small_poly_1(allocate_uint(coeff_count, pool));
+        auto punctured_prod(allocate_uint(digit_size, pool));
+        Pointer<uint64_t> local_target;
+        if (target_permutation)
+        {
+            local_target = allocate_poly(coeff_count, digit_size, pool);
+        }
+
+        // Digit index = key index
+        for (size_t i = 0; i < digit_count; i++)
         {
-            // For each RNS decomposition, multiply with key data and sum up.
-            auto local_small_poly_0(allocate_uint(coeff_count, pool));
-            auto local_small_poly_1(allocate_uint(coeff_count, pool));
-            auto local_small_poly_2(allocate_uint(coeff_count, pool));
+            size_t digit_begin = i * digit_size;
+            size_t digit_mod_count = min(digit_size, decomp_mod_count - digit_begin);
 
-            const uint64_t *local_encrypted_ptr = nullptr;
-            set_uint_uint(
-                target + i * coeff_count,
-                coeff_count,
-                local_small_poly_0.get());
-            if (scheme == scheme_type::CKKS)
+            // The components of target in this digit, permuted one prime at a
+            // time if needed
+            const uint64_t *digit_target = target + digit_begin * coeff_count;
+            if (target_permutation)
             {
-                inverse_ntt_negacyclic_harvey(
-                    local_small_poly_0.get(),
-                    small_ntt_tables[i]);
+                for (size_t m = 0; m < digit_mod_count; m++)
+                {
+                    uint64_t *local_target_ptr = local_target.get() + m * coeff_count;
+                    if (scheme == scheme_type::CKKS)
+                    {
+                        apply_permutation_ntt(
+                            digit_target + m * coeff_count,
+                            target_permutation,
+                            coeff_count,
+                            local_target_ptr);
+                    }
+                    else
+                    {
+                        apply_permutation(
+                            digit_target + m * coeff_count,
+                            target_permutation,
+                            coeff_count,
+                            key_modulus[digit_begin + m],
+                            local_target_ptr);
+                    }
+                }
+                digit_target = local_target.get();
+            }
+
+            // Bring the digit to coefficient form. With more than one prime,
+            // multiply by the inverse of the product of the other primes of the
+            // digit so that the digit can be lifted to the other primes by fast
+            // base conversion.
+            for (size_t m = 0; m < digit_mod_count; m++)
+            {
+                size_t mod_index = digit_begin + m;
+                uint64_t *digit_ptr = local_digit.get() + m * coeff_count;
+                set_uint_uint(
+                    digit_target + m * coeff_count,
+                    coeff_count,
+                    digit_ptr);
+                if (scheme == scheme_type::CKKS)
+                {
+                    inverse_ntt_negacyclic_harvey(
+                        digit_ptr,
+                        small_ntt_tables[mod_index]);
+                }
+                if (digit_mod_count > 1)
+                {
+                    uint64_t punctured_inv = 1;
+                    for (size_t m2 = 0; m2 < digit_mod_count; m2++)
+                    {
+                        if (m2 != m)
+                        {
+                            punctured_inv = multiply_uint_uint_mod(punctured_inv,
+                                barrett_reduce_63(key_modulus[digit_begin + m2].value(),
+                                    key_modulus[mod_index]),
+                                key_modulus[mod_index]);
+                        }
+                    }
+                    if (!try_invert_uint_mod(punctured_inv, key_modulus[mod_index],
+                        punctured_inv))
+                    {
+                        throw logic_error("invalid rns bases");
+                    }
+                    multiply_poly_scalar_coeffmod(
+                        digit_ptr,
+                        coeff_count,
+                        punctured_inv,
+                        key_modulus[mod_index],
+                        digit_ptr);
+                }
             }
-            // Key RNS representation
+
+            // Key RNS representation: the primes of encrypted, then the special
+            // primes
             for (size_t j = 0; j < rns_mod_count; j++)
             {
-                size_t index = (j == decomp_mod_count ? key_mod_count - 1 : j);
-                if (scheme == scheme_type::CKKS && i == j)
+                size_t index = (j < decomp_mod_count ? j : j + key_mod_count - rns_mod_count);
+                bool in_digit = (j >= digit_begin && j - digit_begin < digit_mod_count);
+                const uint64_t *local_encrypted_ptr = nullptr;
+                if (scheme == scheme_type::CKKS && in_digit)
                 {
-                    local_encrypted_ptr = target + j * coeff_count;
+                    local_encrypted_ptr = digit_target + (j - digit_begin) * coeff_count;
                 }
                 else
                 {
-                    // Reduce modulus only if needed
-                    if (key_modulus[i].value() <= key_modulus[index].value())
+                    if (in_digit)
                     {
                         set_uint_uint(
-                            local_small_poly_0.get(),
+                            digit_target + (j - digit_begin) * coeff_count,
                             coeff_count,
                             local_small_poly_1.get());
                     }
+                    else if (digit_mod_count == 1)
+                    {
+                        // Reduce modulus only if needed
+                        if (key_modulus[digit_begin].value() <= key_modulus[index].value())
+                        {
+                            set_uint_uint(
+                                local_digit.get(),
+                                coeff_count,
+                                local_small_poly_1.get());
+                        }
+                        else
+                        {
+                            modulo_poly_coeffs_63(
+                                local_digit.get(),
+                                coeff_count,
+                                key_modulus[index],
+                                local_small_poly_1.get());
+                        }
+                    }
                     else
                     {
-                        modulo_poly_coeffs_63(
-                            local_small_poly_0.get(),
-                            coeff_count,
-                            key_modulus[index],
-                            local_small_poly_1.get());
+                        // Fast base conversion: the sum of the digit components
+                        // times the products of the other primes of the digit
+                        for (size_t m = 0; m < digit_mod_count; m++)
+                        {
+                            uint64_t prod = 1;
+                            for (size_t m2 = 0; m2 < digit_mod_count; m2++)
+                            {
+                                if (m2 != m)
+                                {
+                                    prod = multiply_uint_uint_mod(prod,
+                                        barrett_reduce_63(
+                                            key_modulus[digit_begin + m2].value(),
+                                            key_modulus[index]),
+                                        key_modulus[index]);
+                                }
+                            }
+                            punctured_prod[m] = prod;
+                        }
+                        for (size_t l = 0; l < coeff_count; l++)
+                        {
+                            unsigned long long local_wide_sum[2]{ 0, 0 };
+                            for (size_t m = 0; m < digit_mod_count; m++)
+                            {
+                                unsigned long long local_wide_product[2];
+                                multiply_uint64(
+                                    local_digit[m * coeff_count + l],
+                                    punctured_prod[m],
+                                    local_wide_product);
+                                unsigned char local_carry = add_uint64(
+                                    local_wide_sum[0],
+                                    local_wide_product[0],
+                                    local_wide_sum);
+                                local_wide_sum[1] += local_wide_product[1] + local_carry;
+                            }
+                            local_small_poly_1[l] = barrett_reduce_128(
+                                local_wide_sum,
+                                key_modulus[index]);
+                        }
                     }
 
                     // Lazy reduction, output in [0, 4q).
@@ -2655,43 +2826,121 @@ namespace seal
                         small_ntt_tables[index]);
                     local_encrypted_ptr = local_small_poly_1.get();
                 }
-                // Two components in key
-                for (size_t k = 0; k < 2; k++)
+
+                // Two components in key, accumulated in a single pass. The
+                // products are less than 4q^2 < 2^122 and are summed without
+                // reduction in 128 bits; at most SEAL_COEFF_MOD_COUNT_MAX of them
+                // cannot overflow.
+                const uint64_t *key_ptr_0 = key_vector[i].data().data(0) +
+                    index * coeff_count;
+                const uint64_t *key_ptr_1 = key_vector[i].data().data(1) +
+                    index * coeff_count;
+                unsigned long long *temp_poly_ptr_0 =
+                    reinterpret_cast<unsigned long long *>(
+                        temp_poly[0].get() + j * coeff_count * 2);
+                unsigned long long *temp_poly_ptr_1 =
+                    reinterpret_cast<unsigned long long *>(
+                        temp_poly[1].get() + j * coeff_count * 2);
+                for (size_t l = 0; l < coeff_count;
+                    l++, temp_poly_ptr_0 += 2, temp_poly_ptr_1 += 2)
                 {
-                    // dyadic_product_coeffmod(
-                    //     local_encrypted_ptr,
-                    //     key_vector[i].data(k) + index * coeff_count,
-                    //     coeff_count,
-                    //     key_modulus[index],
-                    //     local_small_poly_2.get());
-                    // add_poly_poly_coeffmod(
-                    //     local_small_poly_2.get(),
-                    //     temp_poly[k].get() + j * coeff_count,
-                    //     coeff_count,
-                    //     key_modulus[index],
-                    //     temp_poly[k].get() + j * coeff_count);
-                    const uint64_t *key_ptr = key_vector[i].data().data(k);
-                    for (size_t l = 0; l < coeff_count; l++)
+                    unsigned long long local_wide_product[2];
+                    unsigned char local_carry;
+
+                    multiply_uint64(
+                        local_encrypted_ptr[l],
+                        key_ptr_0[l],
+                        local_wide_product);
+                    local_carry = add_uint64(
+                        temp_poly_ptr_0[0],
+                        local_wide_product[0],
+                        temp_poly_ptr_0);
+                    temp_poly_ptr_0[1] += local_wide_product[1] + local_carry;
+
+                    multiply_uint64(
+                        local_encrypted_ptr[l],
+                        key_ptr_1[l],
+                        local_wide_product);
+                    local_carry = add_uint64(
+                        temp_poly_ptr_1[0],
+                        local_wide_product[0],
+                        temp_poly_ptr_1);
+                    temp_poly_ptr_1[1] += local_wide_product[1] + local_carry;
+                }
+            }
+        }
+
+        // The target has been read; if it is c1 of encrypted, it is replaced
+        if (target == encrypted.data(1))
+        {
+            set_zero_poly(coeff_count, decomp_mod_count, encrypted.data(1));
+        }
+
+        // Constants for dividing by the product P of the special primes with
+        // rounding: (P / p_s)^(-1) mod p_s, P / p_s mod qi, P^(-1) mod qi and
+        // (P - 1) / 2 mod qi. Note that (P - 1) / 2 mod p_s is p_s / 2 rounded
+        // down.
+        auto special_inv(allocate_uint(special_mod_count, pool));
+        auto special_prod(allocate_uint(special_mod_count * decomp_mod_count, pool));
+        auto modswitch_factors(allocate_uint(decomp_mod_count, pool));
+        auto half_mod(allocate_uint(decomp_mod_count, pool));
+        for (size_t s = 0; s < special_mod_count; s++)
+        {
+            auto &special_mod = key_modulus[key_mod_count - special_mod_count + s];
+            special_inv[s] = 1;
+            for (size_t s2 = 0; s2 < special_mod_count; s2++)
+            {
+                if (s2 != s)
+                {
+                    special_inv[s] = multiply_uint_uint_mod(special_inv[s],
+                        barrett_reduce_63(
+                            key_modulus[key_mod_count - special_mod_count + s2].value(),
+                            special_mod),
+                        special_mod);
+                }
+            }
+            if (!try_invert_uint_mod(special_inv[s], special_mod, special_inv[s]))
+            {
+                throw logic_error("invalid rns bases");
+            }
+        }
+        for (size_t j = 0; j < decomp_mod_count; j++)
+        {
+            // P mod qi, then P / p_s mod qi for every special prime
+            uint64_t special_prod_all = 1;
+            for (size_t s = 0; s < special_mod_count; s++)
+            {
+                special_prod_all = multiply_uint_uint_mod(special_prod_all,
+                    barrett_reduce_63(
+                        key_modulus[key_mod_count - special_mod_count + s].value(),
+                        key_modulus[j]),
+                    key_modulus[j]);
+            }
+            for (size_t s = 0; s < special_mod_count; s++)
+            {
+                uint64_t prod = 1;
+                for (size_t s2 = 0; s2 < special_mod_count; s2++)
+                {
+                    if (s2 != s)
                     {
-                        unsigned long long local_wide_product[2];
-                        unsigned long long local_low_word;
-                        unsigned char local_carry;
-
-                        multiply_uint64(
-                            local_encrypted_ptr[l],
-                            key_ptr[(index * coeff_count) + l],
-                            local_wide_product);
-                        local_carry = add_uint64(
-                            temp_poly[k].get()[(j * coeff_count + l) * 2],
-                            local_wide_product[0],
-                            &local_low_word);
-                        temp_poly[k].get()[(j * coeff_count + l) * 2] =
-                            local_low_word;
-                        temp_poly[k].get()[(j * coeff_count + l) * 2 + 1] +=
-                            local_wide_product[1] + local_carry;
+                        prod = multiply_uint_uint_mod(prod,
+                            barrett_reduce_63(
+                                key_modulus[key_mod_count - special_mod_count + s2].value(),
+                                key_modulus[j]),
+                            key_modulus[j]);
                     }
                 }
+                special_prod[s * decomp_mod_count + j] = prod;
+            }
+            if (!try_invert_uint_mod(special_prod_all, key_modulus[j],
+                modswitch_factors[j]))
+            {
+                throw logic_error("invalid rns bases");
             }
+            half_mod[j] = multiply_uint_uint_mod(
+                sub_uint_uint_mod(special_prod_all, 1, key_modulus[j]),
+                (key_modulus[j].value() + 1) >> 1,
+                key_modulus[j]);
         }
 
         // Results are now stored in temp_poly[k]
@@ -2699,33 +2948,47 @@ namespace seal
         auto local_small_poly(allocate_uint(coeff_count, pool));
         for (size_t k = 0; k < 2; k++)
         {
-            // Reduce (ct mod 4qk) mod qk
-            uint64_t *temp_poly_ptr = temp_poly[k].get() +
-                decomp_mod_count * coeff_count * 2;
-            for (size_t l = 0; l < coeff_count; l++)
+            for (size_t s = 0; s < special_mod_count; s++)
             {
-                temp_poly_ptr[l] = barrett_reduce_128(
-                    temp_poly_ptr + l * 2,
-                    key_modulus[key_mod_count - 1]);
-            }
-            // Lazy reduction, they are then reduced mod qi
-            uint64_t *temp_last_poly_ptr = temp_poly[k].get() + decomp_mod_count * coeff_count * 2;
-            inverse_ntt_negacyclic_harvey_lazy(
-                temp_last_poly_ptr,
-                small_ntt_tables[key_mod_count - 1]);
+                size_t index = key_mod_count - special_mod_count + s;
 
-            // Add (p-1)/2 to change from flooring to rounding.
-            uint64_t half = key_modulus[key_mod_count - 1].value() >> 1;
-            for (size_t l = 0; l < coeff_count; l++)
-            {
-                temp_last_poly_ptr[l] = barrett_reduce_63(temp_last_poly_ptr[l] + half,
-                    key_modulus[key_mod_count - 1]);
+                // Reduce (ct mod 4p) mod p
+                uint64_t *temp_poly_ptr = temp_poly[k].get() +
+                    (decomp_mod_count + s) * coeff_count * 2;
+                for (size_t l = 0; l < coeff_count; l++)
+                {
+                    temp_poly_ptr[l] = barrett_reduce_128(
+                        temp_poly_ptr + l * 2,
+                        key_modulus[index]);
+                }
+                // Lazy reduction, they are then reduced mod p
+                inverse_ntt_negacyclic_harvey_lazy(
+                    temp_poly_ptr,
+                    small_ntt_tables[index]);
+
+                // Add (P-1)/2 to change from flooring to rounding, and prepare
+                // for fast base conversion from the special primes
+                uint64_t half = key_modulus[index].value() >> 1;
+                for (size_t l = 0; l < coeff_count; l++)
+                {
+                    temp_poly_ptr[l] = barrett_reduce_63(temp_poly_ptr[l] + half,
+                        key_modulus[index]);
+                }
+                if (special_mod_count > 1)
+                {
+                    multiply_poly_scalar_coeffmod(
+                        temp_poly_ptr,
+                        coeff_count,
+                        special_inv[s],
+                        key_modulus[index],
+                        temp_poly_ptr);
+                }
             }
 
             uint64_t *encrypted_ptr = encrypted.data(k);
             for (size_t j = 0; j < decomp_mod_count; j++)
             {
-                temp_poly_ptr = temp_poly[k].get() + j * coeff_count * 2;
+                uint64_t *temp_poly_ptr = temp_poly[k].get() + j * coeff_count * 2;
                 // (ct mod 4qi) mod qi
                 for (size_t l = 0; l < coeff_count; l++)
                 {
@@ -2733,19 +2996,43 @@ namespace seal
                         temp_poly_ptr + l * 2,
                         key_modulus[j]);
                 }
-                // (ct mod 4qk) mod qi
-                modulo_poly_coeffs_63(
-                    temp_last_poly_ptr,
-                    coeff_count,
-                    key_modulus[j],
-                    local_small_poly.get());
 
-                uint64_t half_mod = barrett_reduce_63(half, key_modulus[j]);
-                for (size_t l = 0; l < coeff_count; l++)
+                // (ct mod P) mod qi, with the rounding offset taken back out
+                const uint64_t *temp_special_ptr = temp_poly[k].get() +
+                    decomp_mod_count * coeff_count * 2;
+                if (special_mod_count == 1)
                 {
-                    local_small_poly.get()[l] = sub_uint_uint_mod(local_small_poly.get()[l],
-                        half_mod,
-                        key_modulus[j]);
+                    for (size_t l = 0; l < coeff_count; l++)
+                    {
+                        local_small_poly[l] = sub_uint_uint_mod(
+                            barrett_reduce_63(temp_special_ptr[l], key_modulus[j]),
+                            half_mod[j],
+                            key_modulus[j]);
+                    }
+                }
+                else
+                {
+                    for (size_t l = 0; l < coeff_count; l++)
+                    {
+                        unsigned long long local_wide_sum[2]{ 0, 0 };
+                        for (size_t s = 0; s < special_mod_count; s++)
+                        {
+                            unsigned long long local_wide_product[2];
+                            multiply_uint64(
+                                temp_special_ptr[s * coeff_count * 2 + l],
+                                special_prod[s * decomp_mod_count + j],
+                                local_wide_product);
+                            unsigned char local_carry = add_uint64(
+                                local_wide_sum[0],
+                                local_wide_product[0],
+                                local_wide_sum);
+                            local_wide_sum[1] += local_wide_product[1] + local_carry;
+                        }
+                        local_small_poly[l] = sub_uint_uint_mod(
+                            barrett_reduce_128(local_wide_sum, key_modulus[j]),
+                            half_mod[j],
+                            key_modulus[j]);
+                    }
                 }
 
                 if (scheme == scheme_type::CKKS)
@@ -2760,26 +3047,22 @@ namespace seal
                         temp_poly_ptr,
                         small_ntt_tables[j]);
                 }
-                // ((ct mod qi) - (ct mod qk)) mod qi
-                sub_poly_poly_coeffmod(
-                    temp_poly_ptr,
-                    local_small_poly.get(),
-                    coeff_count,
-                    key_modulus[j],
-                    temp_poly_ptr);
-                // qk^(-1) * ((ct mod qi) - (ct mod qk)) mod qi
-                multiply_poly_scalar_coeffmod(
-                    temp_poly_ptr,
-                    coeff_count,
-                    modswitch_factors[j],
-                    key_modulus[j],
-                    temp_poly_ptr);
-                add_poly_poly_coeffmod(
-                    temp_poly_ptr,
-                    encrypted_ptr + j * coeff_count,
-                    coeff_count,
-                    key_modulus[j],
-                    encrypted_ptr + j * coeff_count);
+                // Add P^(-1) * ((ct mod qi) - (ct mod P)) mod qi to encrypted
+                // in a single pass
+                uint64_t *encrypted_poly_ptr = encrypted_ptr + j * coeff_count;
+                for (size_t l = 0; l < coeff_count; l++)
+                {
+                    encrypted_poly_ptr[l] = add_uint_uint_mod(
+                        encrypted_poly_ptr[l],
+                        multiply_uint_uint_mod(
+                            sub_uint_uint_mod(
+                                temp_poly_ptr[l],
+                                local_small_poly[l],
+                                key_modulus[j]),
+                            modswitch_factors[j],
+                            key_modulus[j]),
+                        key_modulus[j]);
+                }
             }
         }
     }
@@ -1481,11 +1481,15 @@ namespace seal
             }
         }
 
+        // Adds the key switched target to (c0, c1) of encrypted. If given, the
+        // Galois permutation target_permutation is applied to target as it is
+        // read. The target may be the c1 of encrypted, which is then replaced.
         void switch_key_inplace(Ciphertext &encrypted,
             const std::uint64_t *target,
             const KSwitchKeys &kswitch_keys,
             std::size_t key_index,
-            MemoryPoolHandle pool = MemoryManager::GetPool());
+            MemoryPoolHandle pool = MemoryManager::GetPool(),
+            const std::uint32_t *target_permutation = nullptr);
 
         void multiply_plain_normal(Ciphertext &encrypted, const Plaintext &plain,
             util::MemoryPool &pool);
@@ -2,6 +2,7 @@
 // Licensed under the MIT license.
 
 #include <algorithm>
+#include <thread>
 #include "seal/keygenerator.h"
 #include "seal/randomtostd.h"
 #include "seal/util/common.h"
@@ -13,6 +14,8 @@
 #include "seal/util/polycore.h"
 #include "seal/util/smallntt.h"
 #include "seal/util/rlwe.h"
+#include "seal/util/galois.h"
+#include "seal/util/parallel.h"
 
 using namespace std;
 using namespace seal::util;
@@ -170,7 +173,8 @@ namespace seal
 
         shared_ptr<UniformRandomGenerator> random(
             parms.random_generator()->create());
-        encrypt_zero_symmetric(secret_key_, context_, context_data.parms_id(), true, false, public_key_.data());
+        encrypt_zero_symmetric(secret_key_, context_, context_data.parms_id(), true, false,
+            random, public_key_.data());
 
         // Set the parms_id for public key
         public_key_.parms_id() = context_data.parms_id();
@@ -227,6 +231,158 @@ namespace seal
     GaloisKeys KeyGenerator::galois_keys(
         const vector<uint64_t> &galois_elts,
         bool save_seed)
+    {
+        auto unique_elts = galois_elts_validate(galois_elts);
+        auto &context_data = *context_->key_context_data();
+        size_t coeff_count = context_data.parms().poly_modulus_degree();
+
+        // Create the GaloisKeys object to return
+        GaloisKeys galois_keys;
+
+        // The max number of keys is equal to number of coefficients
+        galois_keys.data().resize(coeff_count);
+
+        // Generate all keys at once so that work is spread across keys as well
+        // as across the decomposition components of each key
+        vector<vector<PublicKey> *> destination;
+        destination.reserve(unique_elts.size());
+        for (auto galois_elt : unique_elts)
+        {
+            destination.push_back(&galois_keys.data()[GaloisKeys::get_index(galois_elt)]);
+        }
+        generate_galois_keys(unique_elts.data(), unique_elts.size(),
+            destination.data(), save_seed);
+
+        // Set the parms_id
+        galois_keys.parms_id_ = context_data.parms_id();
+
+        return galois_keys;
+    }
+
+    streamoff KeyGenerator::galois_keys_save_internal(
+        const vector<uint64_t> &galois_elts,
+        bool bit_packed,
+        function<streamoff(function<void(ostream &)>, streamoff)> save)
+    {
+        auto key_compr_mode = bit_packed ?
+            compr_mode_type::bitpack : compr_mode_type::none;
+        auto unique_elts = galois_elts_validate(galois_elts);
+        auto &context_data = *context_->key_context_data();
+        auto parms_id = context_data.parms_id();
+        size_t coeff_count = context_data.parms().poly_modulus_degree();
+        size_t key_count = unique_elts.size();
+
+        // Keys are generated in batches of one key per thread and written out
+        // immediately, so at most one batch is held in memory at a time
+        size_t batch_size = min(max(get_thread_count(), size_t(1)), max(key_count, size_t(1)));
+        vector<vector<PublicKey>> batch(batch_size);
+
+        // Serialization::Save may evaluate save_members more than once, so the
+        // seeds of the generators for all key components are drawn up front;
+        // every evaluation then writes the same keys.
+        size_t decomp_mod_count = context_->first_context_data()->parms().coeff_modulus().size();
+        size_t digit_size = context_->keyswitching_digit_size();
+        size_t digit_count = (decomp_mod_count + digit_size - 1) / digit_size;
+        auto random_generator = context_data.parms().random_generator();
+        vector<random_seed_type> seeds(mul_safe(key_count, digit_count));
+        for (auto &seed : seeds)
+        {
+            seed = random_generator->create()->seed();
+        }
+
+        // The first key of the batch last generated
+        size_t batch_first = key_count;
+        auto generate_batch = [&](size_t first) {
+            if (batch_first == first)
+            {
+                return;
+            }
+            size_t count = min(batch_size, key_count - first);
+            vector<vector<PublicKey> *> destination(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                destination[i] = &batch[i];
+            }
+            generate_galois_keys(unique_elts.data() + first, count,
+                destination.data(), true, seeds.data() + first * digit_count);
+            batch_first = first;
+        };
+
+        // Every key has the same serialized size, so the first batch determines
+        // the total size that is needed for the header; bit-packed keys may
+        // differ slightly, but then the size is only used as an estimate
+        size_t key_save_size = 0;
+        if (key_count)
+        {
+            generate_batch(0);
+            for (auto &component : batch[0])
+            {
+                key_save_size = add_safe(key_save_size,
+                    safe_cast<size_t>(component.save_size(key_compr_mode)));
+            }
+        }
+        streamoff raw_size = safe_cast<streamoff>(add_safe(
+            sizeof(Serialization::SEALHeader),
+            sizeof(parms_id_type),
+            sizeof(uint64_t), // keys_dim1
+            mul_safe(coeff_count, sizeof(uint64_t)), // keys_dim2
+            mul_safe(key_count, key_save_size)));
+
+        // This writes the same layout as KSwitchKeys::save_members
+        auto save_members = [&](ostream &stream) {
+            auto old_except_mask = stream.exceptions();
+            try
+            {
+                // Throw exceptions on ios_base::badbit and ios_base::failbit
+                stream.exceptions(ios_base::badbit | ios_base::failbit);
+
+                uint64_t keys_dim1 = static_cast<uint64_t>(coeff_count);
+                stream.write(reinterpret_cast<const char*>(&parms_id),
+                    sizeof(parms_id_type));
+                stream.write(reinterpret_cast<const char*>(&keys_dim1), sizeof(uint64_t));
+
+                size_t next_key = 0;
+                for (size_t index = 0; index < coeff_count; index++)
+                {
+                    if (next_key == key_count ||
+                        GaloisKeys::get_index(unique_elts[next_key]) != index)
+                    {
+                        uint64_t keys_dim2 = 0;
+                        stream.write(reinterpret_cast<const char*>(&keys_dim2), sizeof(uint64_t));
+                        continue;
+                    }
+
+                    if (!(next_key % batch_size))
+                    {
+                        generate_batch(next_key);
+                    }
+                    auto &key = batch[next_key % batch_size];
+                    uint64_t keys_dim2 = static_cast<uint64_t>(key.size());
+                    stream.write(reinterpret_cast<const char*>(&keys_dim2), sizeof(uint64_t));
+                    for (auto &component : key)
+                    {
+                        component.save(stream, key_compr_mode);
+                    }
+                    next_key++;
+                }
+            }
+            catch (const ios_base::failure &)
+            {
+                stream.exceptions(old_except_mask);
+                throw runtime_error("I/O error");
+            }
+            catch (...)
+            {
+                stream.exceptions(old_except_mask);
+                throw;
+            }
+            stream.exceptions(old_except_mask);
+        };
+
+        return save(save_members, raw_size);
+    }
+
+    vector<uint64_t> KeyGenerator::galois_elts_validate(const vector<uint64_t> &galois_elts)
     {
         // Check to see if secret key and public key have been generated
         if (!sk_generated_)
@@ -240,12 +396,14 @@ namespace seal
         {
             throw logic_error("encryption parameters do not support batching");
         }
+        if (!context_->using_keyswitching())
+        {
+            throw logic_error("keyswitching is not supported by the context");
+        }
 
         auto &parms = context_data.parms();
-        auto &coeff_modulus = parms.coeff_modulus();
         size_t coeff_count = parms.poly_modulus_degree();
-        size_t coeff_mod_count = coeff_modulus.size();
-        int coeff_count_power = get_power_of_two(coeff_count);
+        size_t coeff_mod_count = parms.coeff_modulus().size();
 
         // Size check
         if (!product_fits_in(coeff_count, coeff_mod_count, size_t(2)))
@@ -253,54 +411,61 @@ namespace seal
             throw logic_error("invalid parameters");
         }
 
-        // Create the GaloisKeys object to return
-        GaloisKeys galois_keys;
-
-        // The max number of keys is equal to number of coefficients
-        galois_keys.data().resize(coeff_count);
-
+        // Verify coprime conditions.
         for (uint64_t galois_elt : galois_elts)
         {
-            // Verify coprime conditions.
             if (!(galois_elt & 1) ||
                 (galois_elt >= static_cast<uint64_t>(coeff_count) << 1))
             {
                 throw invalid_argument("Galois element is not valid");
             }
+        }
 
-            // Do we already have the key?
-            if (galois_keys.has_key(galois_elt))
-            {
-                continue;
-            }
+        // Sorting the elements also sorts them by their index in GaloisKeys
+        vector<uint64_t> unique_elts(galois_elts);
+        sort(unique_elts.begin(), unique_elts.end());
+        unique_elts.erase(unique(unique_elts.begin(), unique_elts.end()), unique_elts.end());
+        return unique_elts;
+    }
 
-            // Rotate secret key for each coeff_modulus
-            auto rotated_secret_key(
-                allocate_poly(coeff_count, coeff_mod_count, pool_));
+    void KeyGenerator::generate_galois_keys(
+        const uint64_t *galois_elts,
+        size_t num_keys,
+        vector<PublicKey> *const *destination,
+        bool save_seed,
+        const random_seed_type *seeds)
+    {
+        auto &key_context_data = *context_->key_context_data();
+        auto &parms = key_context_data.parms();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_mod_count = parms.coeff_modulus().size();
+
+        // Size check
+        if (!product_fits_in(coeff_count, coeff_mod_count, num_keys))
+        {
+            throw logic_error("invalid parameters");
+        }
+
+        // Rotate secret key for each Galois element and coeff_modulus; the
+        // permutations are cached for the Evaluator to use
+        auto rotated_secret_keys(allocate_poly(
+            mul_safe(coeff_count, num_keys), coeff_mod_count, pool_));
+        for (size_t l = 0; l < num_keys; l++)
+        {
+            const uint32_t *permutation =
+                key_context_data.galois_tool().ntt_permutation(galois_elts[l]);
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
-                apply_galois_ntt(
+                apply_permutation_ntt(
                     secret_key_.data().data() + i * coeff_count,
-                    coeff_count_power,
-                    galois_elt,
-                    rotated_secret_key.get() + i * coeff_count);
+                    permutation,
+                    coeff_count,
+                    rotated_secret_keys.get() + (l * coeff_mod_count + i) * coeff_count);
             }
-
-            // Initialize Galois key
-            // This is the location in the galois_keys vector
-            size_t index = GaloisKeys::get_index(galois_elt);
-            shared_ptr<UniformRandomGenerator> random(parms.random_generator()->create());
-
-            // Create Galois keys.
-            generate_one_kswitch_key(
-                rotated_secret_key.get(),
-                galois_keys.data()[index], save_seed);
         }
 
-        // Set the parms_id
-        galois_keys.parms_id_ = context_data.parms_id();
-
-        return galois_keys;
+        generate_kswitch_key_components(
+            rotated_secret_keys.get(), num_keys, destination, save_seed, seeds);
     }
 
     vector<uint64_t> KeyGenerator::galois_elts_from_steps(const vector<int> &steps)
@@ -314,6 +479,13 @@ namespace seal
         return galois_elts;
     }
 
+    vector<int> KeyGenerator::plan_galois_steps(
+        const map<int, size_t> &step_counts, size_t max_key_count) const
+    {
+        size_t coeff_count = context_->key_context_data()->parms().poly_modulus_degree();
+        return plan_rotation_steps(step_counts, coeff_count, max_key_count);
+    }
+
     vector<uint64_t> KeyGenerator::galois_elts_all()
     {
         size_t coeff_count = static_cast<size_t>(
@@ -447,79 +619,117 @@ namespace seal
         secret_key_array_.acquire(new_secret_key_array);
     }
 
-    void KeyGenerator::generate_one_kswitch_key(
+    void KeyGenerator::generate_kswitch_key_component(
         const uint64_t *new_key,
-        std::vector<PublicKey> &destination,
-        bool save_seed)
+        size_t j,
+        PublicKey &destination,
+        bool save_seed,
+        shared_ptr<UniformRandomGenerator> rng)
     {
-        if (!context_->using_keyswitching())
-        {
-            throw logic_error("keyswitching is not supported by the context");
-        }
-
         size_t coeff_count = context_->key_context_data()->parms().poly_modulus_degree();
-        size_t decomp_mod_count = context_->first_context_data()->parms().coeff_modulus().size();
         auto &key_context_data = *context_->key_context_data();
         auto &key_parms = key_context_data.parms();
         auto &key_modulus = key_parms.coeff_modulus();
-        shared_ptr<UniformRandomGenerator> random(key_parms.random_generator()->create());
-
-        // Size check
-        if (!product_fits_in(coeff_count, decomp_mod_count))
-        {
-            throw logic_error("invalid parameters");
-        }
 
-        // KSwitchKeys data allocated from pool given by MemoryManager::GetPool.
-        destination.resize(decomp_mod_count);
+        size_t decomp_mod_count = context_->first_context_data()->parms().coeff_modulus().size();
+        size_t digit_size = context_->keyswitching_digit_size();
 
         auto temp(allocate_uint(coeff_count, pool_));
-        uint64_t factor = 0;
-        for (size_t j = 0; j < decomp_mod_count; j++)
+        encrypt_zero_symmetric(secret_key_, context_,
+            key_context_data.parms_id(), true, save_seed, move(rng),
+            destination.data());
+
+        // Add P * new_key to the primes of the digit, where P is the product of
+        // the special primes; modulo all other primes P * (Q / Q_j) vanishes.
+        size_t digit_end = min((j + 1) * digit_size, decomp_mod_count);
+        for (size_t i = j * digit_size; i < digit_end; i++)
         {
-            encrypt_zero_symmetric(secret_key_, context_,
-                key_context_data.parms_id(), true, save_seed,
-                destination[j].data());
-            factor = key_modulus.back().value() % key_modulus[j].value();
+            uint64_t factor = 1;
+            for (size_t k = decomp_mod_count; k < key_modulus.size(); k++)
+            {
+                factor = multiply_uint_uint_mod(factor,
+                    barrett_reduce_63(key_modulus[k].value(), key_modulus[i]),
+                    key_modulus[i]);
+            }
             multiply_poly_scalar_coeffmod(
-                new_key + j * coeff_count,
+                new_key + i * coeff_count,
                 coeff_count,
                 factor,
-                key_modulus[j],
+                key_modulus[i],
                 temp.get());
             add_poly_poly_coeffmod(
-                destination[j].data().data() + j * coeff_count,
+                destination.data().data() + i * coeff_count,
                 temp.get(),
                 coeff_count,
-                key_modulus[j],
-                destination[j].data().data() + j * coeff_count);
+                key_modulus[i],
+                destination.data().data() + i * coeff_count);
         }
     }
 
-    void KeyGenerator::generate_kswitch_keys(
+    void KeyGenerator::generate_kswitch_key_components(
         const uint64_t *new_keys,
         size_t num_keys,
-        KSwitchKeys &destination,
-        bool save_seed)
+        vector<PublicKey> *const *destination,
+        bool save_seed,
+        const random_seed_type *seeds)
     {
+        if (!context_->using_keyswitching())
+        {
+            throw logic_error("keyswitching is not supported by the context");
+        }
+
         size_t coeff_count = context_->key_context_data()->parms().poly_modulus_degree();
-        auto &key_context_data = *context_->key_context_data();
-        auto &key_parms = key_context_data.parms();
-        size_t coeff_mod_count = key_parms.coeff_modulus().size();
-        shared_ptr<UniformRandomGenerator> random(key_parms.random_generator()->create());
+        size_t coeff_mod_count = context_->key_context_data()->parms().coeff_modulus().size();
+        size_t decomp_mod_count = context_->first_context_data()->parms().coeff_modulus().size();
+
+        // One key component per digit of the decomposition
+        size_t digit_size = context_->keyswitching_digit_size();
+        size_t digit_count = (decomp_mod_count + digit_size - 1) / digit_size;
 
         // Size check
-        if (!product_fits_in(coeff_count, coeff_mod_count, num_keys))
+        if (!product_fits_in(coeff_count, coeff_mod_count, num_keys) ||
+            !product_fits_in(num_keys, digit_count))
         {
             throw logic_error("invalid parameters");
         }
 
+        // KSwitchKeys data allocated from pool given by MemoryManager::GetPool.
+        for (size_t l = 0; l < num_keys; l++)
+        {
+            destination[l]->resize(digit_count);
+        }
+
+        auto random_generator = context_->key_context_data()->parms().random_generator();
+
+        // Every decomposition component of every key is an independent task
+        parallel_for(get_thread_count(), num_keys * digit_count, [&](size_t, size_t task) {
+            size_t l = task / digit_count;
+            size_t j = task % digit_count;
+            generate_kswitch_key_component(
+                new_keys + l * coeff_mod_count * coeff_count, j,
+                (*destination[l])[j], save_seed,
+                seeds ? random_generator->create(seeds[task]) :
+                    random_generator->create());
+        });
+    }
+
+    void KeyGenerator::generate_kswitch_keys(
+        const uint64_t *new_keys,
+        size_t num_keys,
+        KSwitchKeys &destination,
+        bool save_seed)
+    {
         destination.data().resize(num_keys);
-        auto temp(allocate_uint(coeff_count, pool_));
+        vector<vector<PublicKey> *> key_destination(num_keys);
         for (size_t l = 0; l < num_keys; l++)
         {
-            const uint64_t *new_key_ptr = new_keys + l * coeff_mod_count * coeff_count;
-            generate_one_kswitch_key(new_key_ptr, destination.data()[l], save_seed);
+            key_destination[l] = &destination.data()[l];
         }
+        generate_kswitch_key_components(new_keys, num_keys, key_destination.data(), save_seed);
+    }
+
+    size_t KeyGenerator::get_thread_count() const
+    {
+        return thread_count_ ? thread_count_ : max<size_t>(thread::hardware_concurrency(), 1);
     }
 }
@@ -3,8 +3,11 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
 #include <random>
+#include <vector>
+#include <functional>
 #include "seal/util/defines.h"
 #include "seal/context.h"
 #include "seal/util/smallntt.h"
@@ -112,7 +115,7 @@ namespace seal
         */
         inline std::streamoff relin_keys_save(
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default)
+            CompressionParameters compr_mode = Serialization::compr_mode_default)
         {
             return relin_keys(1, true).save(stream, compr_mode);
         }
@@ -138,7 +141,7 @@ namespace seal
         inline std::streamoff relin_keys_save(
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default)
+            CompressionParameters compr_mode = Serialization::compr_mode_default)
         {
             return relin_keys(1, true).save(out, size, compr_mode);
         }
@@ -180,7 +183,12 @@ namespace seal
         Half of the polynomials in Galois keys are randomly generated and are
         replaced with the seed used to compress output size. The output is in
         binary format and not human-readable. The output stream must have the
-        "binary" flag set.
+        "binary" flag set. The keys are generated and written a few at a time
+        (one per thread) so that the full GaloisKeys object is never held in
+        memory. With bit-packing or Deflate compression the keys are generated
+        twice, as the size of the output is needed before it is written; with
+        Zstandard compression the serialized bytes are buffered before
+        compression.
 
         @param[in] galois_elts The Galois elements for which to generate keys
         @param[out] stream The stream to save the Galois keys to
@@ -197,9 +205,13 @@ namespace seal
         inline std::streamoff galois_keys_save(
             const std::vector<std::uint64_t> &galois_elts,
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default)
+            CompressionParameters compr_mode = Serialization::compr_mode_default)
         {
-            return galois_keys(galois_elts, true).save(stream, compr_mode);
+            return galois_keys_save_internal(galois_elts,
+                Serialization::IsBitPacked(compr_mode),
+                [&](std::function<void(std::ostream &)> save_members, std::streamoff raw_size) {
+                    return Serialization::Save(save_members, raw_size, stream, compr_mode);
+                });
         }
 
         /**
@@ -231,9 +243,13 @@ namespace seal
             const std::vector<std::uint64_t> &galois_elts,
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default)
+            CompressionParameters compr_mode = Serialization::compr_mode_default)
         {
-            return galois_keys(galois_elts, true).save(out, size, compr_mode);
+            return galois_keys_save_internal(galois_elts,
+                Serialization::IsBitPacked(compr_mode),
+                [&](std::function<void(std::ostream &)> save_members, std::streamoff raw_size) {
+                    return Serialization::Save(save_members, raw_size, out, size, compr_mode);
+                });
         }
 
         /**
@@ -289,7 +305,7 @@ namespace seal
         inline std::streamoff galois_keys_save(
             const std::vector<int> &steps,
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default)
+            CompressionParameters compr_mode = Serialization::compr_mode_default)
         {
             return galois_keys_save(
                 galois_elts_from_steps(steps), stream, compr_mode);
@@ -327,12 +343,32 @@ namespace seal
             const std::vector<int> &steps,
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default)
+            CompressionParameters compr_mode = Serialization::compr_mode_default)
         {
             return galois_keys_save(
                 galois_elts_from_steps(steps), out, size, compr_mode);
         }
 
+        /**
+        Chooses the rotation step counts for which to generate Galois keys. The
+        user gives as input the rotations a computation performs, mapping each
+        step count to the number of times it is used, and the largest number of
+        Galois keys to generate. All Galois keys have the same size, so this is a
+        memory budget. The returned step counts are chosen so that the given
+        rotations take few key switches in total; rotations that do not have a
+        key of their own are composed from the fewest available keys. The result
+        can be passed to galois_keys or galois_keys_save.
+
+        @param[in] step_counts The rotation step counts and how often each is used
+        @param[in] max_key_count The largest number of Galois keys to generate
+        @throws std::invalid_argument if the step counts are not valid
+        @throws std::invalid_argument if max_key_count is zero, or if it is too
+        small to contain the key for a step count of zero
+        */
+        SEAL_NODISCARD std::vector<int> plan_galois_steps(
+            const std::map<int, std::size_t> &step_counts,
+            std::size_t max_key_count) const;
+
         /**
         Generates and returns Galois keys. This function creates logarithmically
         many (in degree of the polynomial modulus) Galois keys that is sufficient
@@ -370,7 +406,7 @@ namespace seal
         */
         inline std::streamoff galois_keys_save(
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default)
+            CompressionParameters compr_mode = Serialization::compr_mode_default)
         {
             return galois_keys_save(galois_elts_all(), stream, compr_mode);
         }
@@ -400,11 +436,33 @@ namespace seal
         inline std::streamoff galois_keys_save(
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default)
+            CompressionParameters compr_mode = Serialization::compr_mode_default)
         {
             return galois_keys_save(galois_elts_all(), out, size, compr_mode);
         }
 
+        /**
+        Sets the number of threads used to generate relinearization keys and
+        Galois keys. The work is split across keys as well as across the RNS
+        decomposition components of each key. The default is a single thread.
+
+        @param[in] thread_count The number of threads to use; zero selects the
+        number of hardware threads
+        */
+        inline void set_thread_count(std::size_t thread_count) noexcept
+        {
+            thread_count_ = thread_count;
+        }
+
+        /**
+        Returns the number of threads used for key generation as set with
+        set_thread_count.
+        */
+        SEAL_NODISCARD inline std::size_t thread_count() const noexcept
+        {
+            return thread_count_;
+        }
+
         /**
         Enables access to private members of seal::KeyGenerator for .NET wrapper.
         */
@@ -447,12 +505,42 @@ namespace seal
             bool save_seed = false);
 
         /**
-        Generates one key switching key for a new key.
+        Generates key switching keys for an array of new keys into the given
+        destinations, in parallel across keys and decomposition components.
+        If seeds is given, the generator for the j-th component of the l-th key
+        is created with seed seeds[l * digit_count + j], so that the same seeds
+        give the same keys.
         */
-        void generate_one_kswitch_key(
-            const uint64_t *new_key,
-            std::vector<PublicKey> &destination,
-            bool save_seed = false);
+        void generate_kswitch_key_components(
+            const std::uint64_t *new_keys,
+            std::size_t num_keys,
+            std::vector<PublicKey> *const *destination,
+            bool save_seed,
+            const random_seed_type *seeds = nullptr);
+
+        /**
+        Generates the j-th decomposition component of a key switching key for
+        a new key, drawing randomness from rng. The component covers the j-th
+        digit of primes of the first data level (see
+        SEALContext::keyswitching_digit_size).
+        */
+        void generate_kswitch_key_component(
+            const std::uint64_t *new_key,
+            std::size_t j,
+            PublicKey &destination,
+            bool save_seed,
+            std::shared_ptr<UniformRandomGenerator> rng);
+
+        /**
+        Generates Galois keys for an array of validated Galois elements into the
+        given destinations. See generate_kswitch_key_components for seeds.
+        */
+        void generate_galois_keys(
+            const std::uint64_t *galois_elts,
+            std::size_t num_keys,
+            std::vector<PublicKey> *const *destination,
+            bool save_seed,
+            const random_seed_type *seeds = nullptr);
 
         /**
         Generates and returns the specified number of relinearization keys.
@@ -486,6 +574,27 @@ namespace seal
             const std::vector<std::uint64_t> &galois_elts,
             bool save_seed);
 
+        /**
+        Generates Galois keys with seeds and writes them out one batch at a time.
+        The given function is called with a function writing the KSwitchKeys
+        members and the uncompressed size of the output; that function writes the
+        same keys each time it is called. If bit_packed is true, the keys are
+        written bit-packed and the size is only an estimate.
+        */
+        std::streamoff galois_keys_save_internal(
+            const std::vector<std::uint64_t> &galois_elts,
+            bool bit_packed,
+            std::function<std::streamoff(
+                std::function<void(std::ostream &)>, std::streamoff)> save);
+
+        // Check that Galois keys can be generated and return the given Galois
+        // elements sorted and without duplicates.
+        std::vector<std::uint64_t> galois_elts_validate(
+            const std::vector<std::uint64_t> &galois_elts);
+
+        // Get the number of threads to use for key generation.
+        std::size_t get_thread_count() const;
+
         // Get a vector of galois_elts from a vector of steps.
         std::vector<std::uint64_t> galois_elts_from_steps(const std::vector<int> &steps);
 
@@ -510,5 +619,7 @@ namespace seal
         bool sk_generated_ = false;
 
         bool pk_generated_ = false;
+
+        std::size_t thread_count_ = 1;
     };
 }
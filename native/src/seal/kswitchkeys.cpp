@@ -40,7 +40,7 @@ namespace seal
         return *this;
     }
 
-    void KSwitchKeys::save_members(ostream &stream) const
+    void KSwitchKeys::save_members(ostream &stream, bool bit_packed) const
     {
         auto old_except_mask = stream.exceptions();
         try
@@ -68,7 +68,8 @@ namespace seal
                 for (size_t j = 0; j < keys_dim2; j++)
                 {
                     // Save the key
-                    keys_[index][j].save(stream, compr_mode_type::none);
+                    keys_[index][j].save(stream, bit_packed ?
+                        compr_mode_type::bitpack : compr_mode_type::none);
                 }
             }
         }
@@ -149,4 +150,124 @@ namespace seal
 
         swap(keys_, new_keys);
     }
+
+    streamoff KSwitchKeys::save_aligned_size() const
+    {
+        size_t total_size = add_safe(
+            view_aligned_size(view_header_byte_count),
+            view_aligned_size(add_safe(
+                sizeof(parms_id_),
+                sizeof(uint64_t))), // keys_dim1
+            mul_safe(keys_.size(), view_aligned_size(sizeof(uint64_t)))); // keys_dim2
+        for (auto &key_dim1 : keys_)
+        {
+            for (auto &key_dim2 : key_dim1)
+            {
+                total_size = add_safe(total_size, key_dim2.pk_.view_members_size());
+            }
+        }
+        return safe_cast<streamoff>(total_size);
+    }
+
+    streamoff KSwitchKeys::save_aligned(ostream &stream) const
+    {
+        size_t total_size = safe_cast<size_t>(save_aligned_size());
+        auto old_except_mask = stream.exceptions();
+        try
+        {
+            // Throw exceptions on ios_base::badbit and ios_base::failbit
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+
+            ViewWriter writer(stream);
+            writer.write_header(total_size);
+            uint64_t keys_dim1 = static_cast<uint64_t>(keys_.size());
+            writer.write(&parms_id_, sizeof(parms_id_type));
+            writer.write(&keys_dim1, sizeof(uint64_t));
+            writer.align();
+            for (auto &key_dim1 : keys_)
+            {
+                uint64_t keys_dim2 = static_cast<uint64_t>(key_dim1.size());
+                writer.write(&keys_dim2, sizeof(uint64_t));
+                writer.align();
+                for (auto &key_dim2 : key_dim1)
+                {
+                    key_dim2.pk_.save_view_members(writer);
+                }
+            }
+            if (writer.offset() != total_size)
+            {
+                throw logic_error("invalid data size");
+            }
+        }
+        catch (const ios_base::failure &)
+        {
+            stream.exceptions(old_except_mask);
+            throw runtime_error("I/O error");
+        }
+        catch (...)
+        {
+            stream.exceptions(old_except_mask);
+            throw;
+        }
+        stream.exceptions(old_except_mask);
+        return safe_cast<streamoff>(total_size);
+    }
+
+    streamoff KSwitchKeys::unsafe_load_view(shared_ptr<SEALContext> context,
+        SEAL_BYTE *in, size_t size)
+    {
+        // Verify parameters
+        if (!context)
+        {
+            throw invalid_argument("invalid context");
+        }
+        if (!context->parameters_set())
+        {
+            throw invalid_argument("encryption parameters are not set correctly");
+        }
+
+        ViewReader reader(in, size);
+        size_t total_size = reader.read_header();
+
+        parms_id_type parms_id{};
+        reader.read(&parms_id, sizeof(parms_id_type));
+        uint64_t keys_dim1 = 0;
+        reader.read(&keys_dim1, sizeof(uint64_t));
+        reader.align();
+
+        // Every row takes at least view_alignment bytes, which bounds the
+        // memory reserved for a malformed count
+        if (unsigned_gt(keys_dim1, size / view_alignment))
+        {
+            throw logic_error("KSwitchKeys data is invalid");
+        }
+        vector<vector<PublicKey>> new_keys;
+        new_keys.reserve(safe_cast<size_t>(keys_dim1));
+        for (size_t index = 0; index < keys_dim1; index++)
+        {
+            uint64_t keys_dim2 = 0;
+            reader.read(&keys_dim2, sizeof(uint64_t));
+            reader.align();
+            if (unsigned_gt(keys_dim2, size / view_alignment))
+            {
+                throw logic_error("KSwitchKeys data is invalid");
+            }
+            new_keys.emplace_back();
+            new_keys.back().reserve(safe_cast<size_t>(keys_dim2));
+            for (size_t j = 0; j < keys_dim2; j++)
+            {
+                PublicKey key(pool_);
+                key.pk_.load_view_members(context, reader);
+                new_keys.back().emplace_back(move(key));
+            }
+        }
+        if (reader.offset() != total_size)
+        {
+            throw logic_error("invalid data size");
+        }
+
+        parms_id_ = parms_id;
+        swap(keys_, new_keys);
+        return safe_cast<streamoff>(total_size);
+    }
 }
@@ -170,8 +170,8 @@ namespace seal
                 for (auto &key_dim2 : key_dim1)
                 {
                     total_key_size = util::add_safe(total_key_size,
-                        util::safe_cast<std::size_t>(
-                            key_dim2.save_size(compr_mode_type::none)));
+                        util::safe_cast<std::size_t>(key_dim2.save_size(
+                            Serialization::RawComprMode(compr_mode))));
                 }
             }
 
@@ -201,12 +201,13 @@ namespace seal
         */
         inline std::streamoff save(
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
-                std::bind(&KSwitchKeys::save_members, this, _1),
-                save_size(compr_mode_type::none),
+                std::bind(&KSwitchKeys::save_members, this, _1,
+                    Serialization::IsBitPacked(compr_mode)),
+                save_size(Serialization::RawComprMode(compr_mode)),
                 stream, compr_mode);
         }
 
@@ -277,12 +278,13 @@ namespace seal
         inline std::streamoff save(
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
-                std::bind(&KSwitchKeys::save_members, this, _1),
-                save_size(compr_mode_type::none),
+                std::bind(&KSwitchKeys::save_members, this, _1,
+                    Serialization::IsBitPacked(compr_mode)),
+                save_size(Serialization::RawComprMode(compr_mode)),
                 out, size, compr_mode);
         }
 
@@ -344,6 +346,79 @@ namespace seal
             return in_size;
         }
 
+        /**
+        Returns the number of bytes save_aligned writes.
+
+        @throws std::logic_error if the size does not fit in the return type
+        */
+        SEAL_NODISCARD std::streamoff save_aligned_size() const;
+
+        /**
+        Saves the KSwitchKeys instance to an output stream in an uncompressed
+        layout in which the key data is aligned, so that it can be used in place
+        by load_view, e.g., from a memory-mapped file (see MappedFile). This
+        avoids reading and copying large keys, such as GaloisKeys, when they are
+        loaded. The output is in binary format and not human-readable. The output
+        stream must have the "binary" flag set. Data saved with save_aligned
+        cannot be loaded with load and vice versa.
+
+        @param[out] stream The stream to save the KSwitchKeys to
+        @throws std::logic_error if any key holds a seed instead of its data
+        @throws std::runtime_error if I/O operations failed
+        */
+        std::streamoff save_aligned(std::ostream &stream) const;
+
+        /**
+        Makes the KSwitchKeys refer to keys saved with save_aligned at a given
+        memory location, without copying the key data. The memory must remain
+        valid for as long as the KSwitchKeys refers to it, i.e., until it is
+        destroyed or assigned to. The keys can be used by Evaluator as any other
+        keys. Only the metadata is checked; the key data itself is not read, so
+        the memory can be paged in lazily as keys are used. This function should
+        not be used unless the keys come from a fully trusted source.
+
+        @param[in] context The SEALContext
+        @param[in] in The memory location holding the keys, aligned to 8 bytes
+        @param[in] size The number of bytes available in the given memory location
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if in is null or not aligned
+        @throws std::logic_error if the data is not in the layout written by
+        save_aligned or is invalid
+        */
+        std::streamoff unsafe_load_view(std::shared_ptr<SEALContext> context,
+            SEAL_BYTE *in, std::size_t size);
+
+        /**
+        Makes the KSwitchKeys refer to keys saved with save_aligned at a given
+        memory location, without copying the key data. The memory must remain
+        valid for as long as the KSwitchKeys refers to it, i.e., until it is
+        destroyed or assigned to. The keys are verified to be valid for the
+        given SEALContext, which reads all of the data.
+
+        @param[in] context The SEALContext
+        @param[in] in The memory location holding the keys, aligned to 8 bytes
+        @param[in] size The number of bytes available in the given memory location
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if in is null or not aligned
+        @throws std::logic_error if the data is not in the layout written by
+        save_aligned or is invalid
+        */
+        inline std::streamoff load_view(std::shared_ptr<SEALContext> context,
+            SEAL_BYTE *in, std::size_t size)
+        {
+            KSwitchKeys new_keys;
+            new_keys.pool_ = pool_;
+            auto in_size = new_keys.unsafe_load_view(context, in, size);
+            if (!is_valid_for(new_keys, std::move(context)))
+            {
+                throw std::logic_error("KSwitchKeys data is invalid");
+            }
+            std::swap(*this, new_keys);
+            return in_size;
+        }
+
         /**
         Returns the currently used MemoryPoolHandle.
         */
@@ -353,7 +428,7 @@ namespace seal
         }
 
     private:
-        void save_members(std::ostream &stream) const;
+        void save_members(std::ostream &stream, bool bit_packed) const;
 
         void load_members(std::shared_ptr<SEALContext> context, std::istream &stream);
 
@@ -0,0 +1,125 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include "seal/mappedfile.h"
+#include "seal/util/common.h"
+#if defined(__unix__) || defined(__APPLE__)
+#define SEAL_MAPPEDFILE_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace seal::util;
+
+namespace seal
+{
+    namespace
+    {
+        constexpr size_t buffer_alignment = 64;
+    }
+
+    MappedFile::MappedFile(const string &path)
+    {
+#ifdef SEAL_MAPPEDFILE_USE_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw runtime_error("cannot open file");
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size < 0)
+        {
+            close(fd);
+            throw runtime_error("cannot read file size");
+        }
+        size_ = safe_cast<size_t>(file_stat.st_size);
+        if (size_)
+        {
+            // Map privately so that writes to the memory never reach the file
+            void *ptr = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (ptr == MAP_FAILED)
+            {
+                size_ = 0;
+                throw runtime_error("cannot map file");
+            }
+            data_ = static_cast<SEAL_BYTE*>(ptr);
+        }
+        else
+        {
+            close(fd);
+        }
+#else
+        ifstream stream(path, ios::binary | ios::ate);
+        if (!stream)
+        {
+            throw runtime_error("cannot open file");
+        }
+        auto end_pos = stream.tellg();
+        if (end_pos < 0)
+        {
+            throw runtime_error("cannot read file size");
+        }
+        size_ = safe_cast<size_t>(static_cast<streamoff>(end_pos));
+        buffer_ = new SEAL_BYTE[add_safe(size_, buffer_alignment - 1)];
+        auto addr = (reinterpret_cast<uintptr_t>(buffer_) + buffer_alignment - 1) &
+            ~static_cast<uintptr_t>(buffer_alignment - 1);
+        data_ = reinterpret_cast<SEAL_BYTE*>(addr);
+        stream.seekg(0);
+        if (!stream.read(reinterpret_cast<char*>(data_), safe_cast<streamsize>(size_)))
+        {
+            unmap();
+            throw runtime_error("cannot read file");
+        }
+#endif
+    }
+
+    MappedFile::MappedFile(MappedFile &&source) noexcept :
+        data_(source.data_), size_(source.size_), buffer_(source.buffer_)
+    {
+        source.data_ = nullptr;
+        source.size_ = 0;
+        source.buffer_ = nullptr;
+    }
+
+    MappedFile &MappedFile::operator =(MappedFile &&assign) noexcept
+    {
+        if (this != &assign)
+        {
+            unmap();
+            swap(data_, assign.data_);
+            swap(size_, assign.size_);
+            swap(buffer_, assign.buffer_);
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        unmap();
+    }
+
+    void MappedFile::unmap() noexcept
+    {
+        if (buffer_)
+        {
+            delete[] buffer_;
+        }
+#ifdef SEAL_MAPPEDFILE_USE_MMAP
+        else if (data_)
+        {
+            munmap(data_, size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+        buffer_ = nullptr;
+    }
+}
@@ -0,0 +1,89 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "seal/util/defines.h"
+
+namespace seal
+{
+    /**
+    Class to map a file into memory for use with the load_view functions of
+    Ciphertext, Plaintext, and KSwitchKeys (RelinKeys, GaloisKeys). Objects
+    loaded with load_view refer to the mapped memory directly, so the file is
+    neither read up front nor copied, and the operating system pages in only
+    the data that is used. The MappedFile must outlive all such objects.
+
+    The file is mapped copy-on-write: objects referring to the mapping can be
+    modified, but the changes are never written to the file. On platforms
+    without memory mapping support the file is instead read into memory.
+
+    @par Thread Safety
+    The MappedFile itself is not modified after construction, so it can be
+    used from several threads.
+    */
+    class MappedFile
+    {
+    public:
+        /**
+        Maps the file at a given path into memory.
+
+        @param[in] path The path of the file to map
+        @throws std::runtime_error if the file cannot be opened or mapped
+        */
+        MappedFile(const std::string &path);
+
+        /**
+        Creates a new MappedFile by moving a given one.
+
+        @param[in] source The MappedFile to move from
+        */
+        MappedFile(MappedFile &&source) noexcept;
+
+        /**
+        Moves a given MappedFile to the current one, unmapping the file
+        currently mapped.
+
+        @param[in] assign The MappedFile to move from
+        */
+        MappedFile &operator =(MappedFile &&assign) noexcept;
+
+        /**
+        Unmaps the file.
+        */
+        ~MappedFile();
+
+        /**
+        Returns a pointer to the beginning of the mapped file. The memory is
+        aligned to at least 64 bytes.
+        */
+        SEAL_NODISCARD inline SEAL_BYTE *data() const noexcept
+        {
+            return data_;
+        }
+
+        /**
+        Returns the size of the mapped file in bytes.
+        */
+        SEAL_NODISCARD inline std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+    private:
+        MappedFile(const MappedFile &copy) = delete;
+
+        MappedFile &operator =(const MappedFile &assign) = delete;
+
+        void unmap() noexcept;
+
+        SEAL_BYTE *data_ = nullptr;
+
+        std::size_t size_ = 0;
+
+        // Memory to release if the file was read instead of mapped
+        SEAL_BYTE *buffer_ = nullptr;
+    };
+}
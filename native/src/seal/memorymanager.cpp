@@ -1,6 +1,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT license.
 
+#include <algorithm>
 #include "seal/memorymanager.h"
 
 namespace seal
@@ -9,6 +10,94 @@ namespace seal
         MemoryManager::mm_prof_{ new MMProfGlobal };
 #ifndef _M_CEE
     std::mutex MemoryManager::switch_mutex_;
+
+    MemoryPoolTrimmer::MemoryPoolTrimmer(MemoryPoolHandle pool,
+        std::chrono::milliseconds max_age, std::size_t max_retained_bytes) :
+        pool_(std::move(pool)), max_age_(max_age),
+        max_retained_bytes_(max_retained_bytes)
+    {
+        if (!pool_)
+        {
+            throw std::invalid_argument("pool is uninitialized");
+        }
+
+        // The background thread uses the pool concurrently with its owner
+        if (dynamic_cast<util::MemoryPoolST *>(&static_cast<util::MemoryPool &>(pool_)))
+        {
+            throw std::invalid_argument("pool is not thread-safe");
+        }
+        if (max_age_.count() <= 0)
+        {
+            throw std::invalid_argument("max_age must be positive");
+        }
+        thread_ = std::thread(&MemoryPoolTrimmer::run, this);
+    }
+
+    MemoryPoolTrimmer::~MemoryPoolTrimmer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        stop_cv_.notify_all();
+        thread_.join();
+    }
+
+    std::size_t MemoryPoolTrimmer::released_byte_count() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return released_byte_count_;
+    }
+
+    void MemoryPoolTrimmer::run()
+    {
+        std::chrono::milliseconds interval = std::max<std::chrono::milliseconds>(
+            max_age_ / samples_per_age, std::chrono::milliseconds(1));
+
+        // The smallest amount of unused memory seen over the last max_age has
+        // not been in use at any point during that time
+        std::deque<std::size_t> unused_samples;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_cv_.wait_for(lock, interval, [this]() { return stop_; }))
+        {
+            lock.unlock();
+
+            // An exception escaping the thread would terminate the process, so
+            // a round that fails is skipped and memory is released later
+            std::size_t released = 0;
+            try
+            {
+                std::size_t alloc_byte_count = pool_.alloc_byte_count();
+                std::size_t in_use_byte_count = pool_.in_use_byte_count();
+                std::size_t unused_byte_count = alloc_byte_count > in_use_byte_count ?
+                    alloc_byte_count - in_use_byte_count : 0;
+                unused_samples.push_back(unused_byte_count);
+
+                if (unused_samples.size() > samples_per_age)
+                {
+                    unused_samples.pop_front();
+                    std::size_t idle_byte_count = *std::min_element(
+                        unused_samples.cbegin(), unused_samples.cend());
+                    if (idle_byte_count > max_retained_bytes_)
+                    {
+                        released = pool_.trim(
+                            unused_byte_count - (idle_byte_count - max_retained_bytes_));
+
+                        // Released memory no longer counts as unused in past samples
+                        for (auto &sample : unused_samples)
+                        {
+                            sample = sample > released ? sample - released : 0;
+                        }
+                    }
+                }
+            }
+            catch (const std::exception &)
+            {
+            }
+            lock.lock();
+            released_byte_count_ += released;
+        }
+    }
 #else
 #pragma message("WARNING: MemoryManager compiled thread-unsafe and MMProfGuard disabled to support /clr")
 #endif
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <cassert>
 #include <memory>
 #include <stdexcept>
 #include <utility>
@@ -20,6 +21,9 @@ For .NET Framework wrapper support (C++/CLI) we need to
 #ifndef _M_CEE
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
 #endif
 
 namespace seal
@@ -158,12 +162,46 @@ namespace seal
         @param[in] clear_on_destruction Indicates whether the memory pool data
         should be cleared when destroyed. This can be important when memory pools
         are used to store private data.
+        @param[in] size_classes Indicates whether allocation sizes should be
+        rounded up to geometric size classes, so that allocations of similar
+        size (e.g. ciphertexts at neighboring levels) share memory instead of
+        each size keeping its own. At most a third of each allocation larger
+        than 128 bytes is unused.
+        @param[in] huge_pages Indicates whether large batch allocations (2 MB
+        or more) should be backed by huge pages to reduce TLB misses. This is
+        supported on Linux only; elsewhere, or if huge pages are unavailable,
+        regular allocations are used. In every case allocations of at least
+        64 bytes are 64-byte aligned.
         */
         SEAL_NODISCARD inline static MemoryPoolHandle New(
-            bool clear_on_destruction = false)
+            bool clear_on_destruction = false, bool size_classes = false,
+            bool huge_pages = false)
         {
-            return MemoryPoolHandle(
-                std::make_shared<util::MemoryPoolMT>(clear_on_destruction));
+            return MemoryPoolHandle(std::make_shared<util::MemoryPoolMT>(
+                clear_on_destruction, size_classes, huge_pages));
+        }
+
+        /**
+        Returns a MemoryPoolHandle pointing to a new thread-safe arena memory
+        pool. An arena allocates by advancing a pointer in a preallocated block
+        of memory, so allocations are very cheap, but returned memory is not
+        reused until the whole arena is reset. Arenas are meant to be used
+        through MMProfArena for the temporaries of a bounded piece of work.
+
+        @param[in] capacity_byte_count The size of the arena in bytes
+        @param[in] allow_overflow Indicates whether allocations that do not fit
+        in the arena are served from additional memory, released at the next
+        reset, instead of throwing std::bad_alloc
+        @param[in] huge_pages Indicates whether the arena should be backed by
+        huge pages where supported
+        @throws std::invalid_argument if capacity_byte_count is zero or too large
+        */
+        SEAL_NODISCARD inline static MemoryPoolHandle Arena(
+            std::size_t capacity_byte_count, bool allow_overflow = true,
+            bool huge_pages = false)
+        {
+            return MemoryPoolHandle(std::make_shared<util::MemoryPoolArena>(
+                capacity_byte_count, allow_overflow, huge_pages));
         }
 
         /**
@@ -204,6 +242,47 @@ namespace seal
             return !pool_ ? std::size_t(0) : pool_->alloc_byte_count();
         }
 
+        /**
+        Returns the size of memory currently in use. This function returns the
+        total amount of memory (in bytes) handed out by the memory pool pointed
+        to by the current MemoryPoolHandle and not yet returned to it. The
+        difference to alloc_byte_count() is memory the pool retains for reuse.
+        */
+        SEAL_NODISCARD inline std::size_t in_use_byte_count() const
+        {
+            return !pool_ ? std::size_t(0) : pool_->in_use_byte_count();
+        }
+
+        /**
+        Returns statistics for each allocation size the memory pool pointed to
+        by the current MemoryPoolHandle has made, largest size first. For each
+        size these are the number of items allocated and in use, the largest
+        number in use at once, how many requests were served by reusing memory
+        (hits) and how many needed new memory (misses), and, for thread-safe
+        pools, the total time threads waited for locks.
+        */
+        SEAL_NODISCARD inline std::vector<util::MemoryPoolHead::statistics>
+            size_stats() const
+        {
+            return !pool_ ? std::vector<util::MemoryPoolHead::statistics>{} :
+                pool_->size_stats();
+        }
+
+        /**
+        Releases memory retained by the memory pool back to the system. Memory
+        is allocated by the pool in batches, and only batches none of whose
+        memory is in use can be released. Batches are released until at most
+        max_retained_bytes of allocated memory is not in use, or until no fully
+        unused batches remain. Returns the number of bytes released.
+
+        @param[in] max_retained_bytes The largest amount of unused memory (in
+        bytes) to keep for reuse
+        */
+        inline std::size_t trim(std::size_t max_retained_bytes = 0) const
+        {
+            return !pool_ ? std::size_t(0) : pool_->trim(max_retained_bytes);
+        }
+
         /**
         Returns the number of MemoryPoolHandle objects sharing this memory pool.
         */
@@ -398,6 +477,108 @@ namespace seal
     private:
         MemoryPoolHandle pool_;
     };
+    /**
+    A memory manager profile that always returns a MemoryPoolHandle pointing to
+    an arena memory pool (see MemoryPoolHandle::Arena). Allocations of temporary
+    data, such as those made inside Evaluator, then cost only a pointer bump.
+    The arena is reset, making all of it available again, when the MMProfArena
+    is destroyed, e.g., at the end of the scope of an MMProfGuard, or when
+    reset() is called. For this to happen no memory from the arena can be in
+    use at that time; objects that outlive the scope should therefore be given
+    a different memory pool explicitly.
+
+    An arena handle can be kept and passed to a new MMProfArena for each piece
+    of work, so that the same memory is reused without any allocations.
+    */
+    class MMProfArena : public MMProf
+    {
+    public:
+        /**
+        Creates a new MMProfArena with a new arena of a given size.
+
+        @param[in] capacity_byte_count The size of the arena in bytes
+        @param[in] allow_overflow Indicates whether allocations that do not fit
+        in the arena are served from additional memory instead of throwing
+        std::bad_alloc
+        @throws std::invalid_argument if capacity_byte_count is zero or too large
+        */
+        MMProfArena(std::size_t capacity_byte_count, bool allow_overflow = true) :
+            MMProfArena(MemoryPoolHandle::Arena(capacity_byte_count, allow_overflow))
+        {
+        }
+
+        /**
+        Creates a new MMProfArena using an existing arena.
+
+        @param[in] pool The MemoryPoolHandle pointing to an arena memory pool
+        @throws std::invalid_argument if pool is uninitialized or does not point
+        to an arena memory pool
+        */
+        MMProfArena(MemoryPoolHandle pool) : pool_(std::move(pool))
+        {
+            if (!pool_)
+            {
+                throw std::invalid_argument("pool is uninitialized");
+            }
+            arena_ = dynamic_cast<util::MemoryPoolArena*>(&static_cast<util::MemoryPool &>(pool_));
+            if (!arena_)
+            {
+                throw std::invalid_argument("pool is not an arena");
+            }
+        }
+
+        /**
+        Destroys the MMProfArena and resets the arena. None of the memory from
+        the arena may be in use at this time; this is checked by an assertion,
+        as a destructor cannot throw. Use reset() to detect memory still in use
+        as an exception.
+        */
+        virtual ~MMProfArena() noexcept override
+        {
+            bool reset_done = arena_->reset();
+            assert(reset_done && "arena memory is still in use");
+            (void)reset_done;
+        }
+
+        /**
+        Returns a MemoryPoolHandle pointing to the arena. The mm_prof_opt_t
+        input parameter has no effect.
+        */
+        SEAL_NODISCARD inline virtual MemoryPoolHandle get_pool(
+            mm_prof_opt_t) override
+        {
+            return pool_;
+        }
+
+        /**
+        Resets the arena, making all of it available again and releasing any
+        overflow memory.
+
+        @throws std::logic_error if memory from the arena is still in use
+        */
+        inline void reset()
+        {
+            if (!arena_->reset())
+            {
+                throw std::logic_error("arena memory is still in use");
+            }
+        }
+
+        /**
+        Returns statistics on the use of the arena: its capacity, the bytes
+        used since the last reset and at most, how many allocations and bytes
+        did not fit in the arena, and the number of resets.
+        */
+        SEAL_NODISCARD inline util::MemoryPoolArena::statistics statistics() const noexcept
+        {
+            return arena_->stats();
+        }
+
+    private:
+        MemoryPoolHandle pool_;
+
+        util::MemoryPoolArena *arena_ = nullptr;
+    };
 #ifndef _M_CEE
     /**
     A memory manager profile that always returns a MemoryPoolHandle pointing to
@@ -564,6 +745,72 @@ namespace seal
 #endif
     };
 #ifndef _M_CEE
+    /**
+    Trims a memory pool in the background. A MemoryPoolTrimmer periodically
+    measures how much of the memory allocated by the pool is not in use, and
+    releases memory that has not been in use for at least a given amount of
+    time, keeping at most max_retained_bytes of such memory for reuse. This
+    allows a long-lived process to return memory to the system after a burst of
+    large allocations. The background thread is stopped when the
+    MemoryPoolTrimmer is destroyed.
+    */
+    class MemoryPoolTrimmer
+    {
+    public:
+        /**
+        Creates a MemoryPoolTrimmer and starts its background thread.
+
+        @param[in] pool The MemoryPoolHandle pointing to the pool to trim
+        @param[in] max_age Memory not in use for this long is released
+        @param[in] max_retained_bytes The amount of unused memory (in bytes)
+        that is never released
+        @throws std::invalid_argument if pool is uninitialized
+        @throws std::invalid_argument if pool is a thread-local (not thread-safe)
+        memory pool
+        @throws std::invalid_argument if max_age is not positive
+        */
+        MemoryPoolTrimmer(MemoryPoolHandle pool, std::chrono::milliseconds max_age,
+            std::size_t max_retained_bytes = 0);
+
+        /**
+        Stops the background thread.
+        */
+        ~MemoryPoolTrimmer();
+
+        /**
+        Returns the total number of bytes released so far.
+        */
+        SEAL_NODISCARD std::size_t released_byte_count() const;
+
+        /**
+        The number of samples of unused memory taken per max_age.
+        */
+        static constexpr std::size_t samples_per_age = 4;
+
+    private:
+        MemoryPoolTrimmer(const MemoryPoolTrimmer &copy) = delete;
+
+        MemoryPoolTrimmer &operator =(const MemoryPoolTrimmer &assign) = delete;
+
+        void run();
+
+        MemoryPoolHandle pool_;
+
+        std::chrono::milliseconds max_age_;
+
+        std::size_t max_retained_bytes_;
+
+        std::size_t released_byte_count_ = 0;
+
+        bool stop_ = false;
+
+        mutable std::mutex mutex_;
+
+        std::condition_variable stop_cv_;
+
+        std::thread thread_;
+    };
+
     /**
     Class for a scoped switch of memory manager profile. This class acts as a scoped
     "guard" for changing the memory manager profile so that the programmer does
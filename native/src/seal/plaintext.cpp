@@ -306,4 +306,100 @@ namespace seal
 
         swap(*this, new_data);
     }
+
+    size_t Plaintext::view_members_size() const
+    {
+        return add_safe(
+            view_aligned_size(add_safe(
+                sizeof(parms_id_),
+                sizeof(uint64_t), // coeff_count_
+                sizeof(scale_))),
+            view_aligned_size(mul_safe(data_.size(), sizeof(pt_coeff_type))));
+    }
+
+    streamoff Plaintext::save_aligned_size() const
+    {
+        return safe_cast<streamoff>(add_safe(
+            view_aligned_size(view_header_byte_count), view_members_size()));
+    }
+
+    streamoff Plaintext::save_aligned(ostream &stream) const
+    {
+        size_t total_size = safe_cast<size_t>(save_aligned_size());
+        auto old_except_mask = stream.exceptions();
+        try
+        {
+            // Throw exceptions on std::ios_base::badbit and std::ios_base::failbit
+            stream.exceptions(ios_base::badbit | ios_base::failbit);
+
+            ViewWriter writer(stream);
+            writer.write_header(total_size);
+            uint64_t coeff_count64 = static_cast<uint64_t>(coeff_count_);
+            writer.write(&parms_id_, sizeof(parms_id_type));
+            writer.write(&coeff_count64, sizeof(uint64_t));
+            writer.write(&scale_, sizeof(double));
+            writer.align();
+            writer.write(data_.cbegin(), mul_safe(data_.size(), sizeof(pt_coeff_type)));
+            writer.align();
+        }
+        catch (const ios_base::failure &)
+        {
+            stream.exceptions(old_except_mask);
+            throw runtime_error("I/O error");
+        }
+        catch (...)
+        {
+            stream.exceptions(old_except_mask);
+            throw;
+        }
+        stream.exceptions(old_except_mask);
+        return safe_cast<streamoff>(total_size);
+    }
+
+    streamoff Plaintext::unsafe_load_view(shared_ptr<SEALContext> context,
+        SEAL_BYTE *in, size_t size)
+    {
+        // Verify parameters
+        if (!context)
+        {
+            throw invalid_argument("invalid context");
+        }
+        if (!context->parameters_set())
+        {
+            throw invalid_argument("encryption parameters are not set correctly");
+        }
+
+        ViewReader reader(in, size);
+        size_t total_size = reader.read_header();
+
+        parms_id_type parms_id{};
+        reader.read(&parms_id, sizeof(parms_id_type));
+        uint64_t coeff_count64 = 0;
+        reader.read(&coeff_count64, sizeof(uint64_t));
+        double scale = 0;
+        reader.read(&scale, sizeof(double));
+
+        Plaintext new_data(data_.pool());
+        new_data.parms_id_ = parms_id;
+        new_data.coeff_count_ = safe_cast<size_t>(coeff_count64);
+        new_data.scale_ = scale;
+
+        // As in load_members, pure key levels are allowed here
+        if (!is_metadata_valid_for(new_data, context, true))
+        {
+            throw logic_error("plaintext data is invalid");
+        }
+
+        // Refer to the data in place
+        pt_coeff_type *data = reader.take_array<pt_coeff_type>(new_data.coeff_count_);
+        new_data.data_ = IntArray<pt_coeff_type>(Pointer<pt_coeff_type>::Aliasing(data),
+            new_data.coeff_count_, false, data_.pool());
+        if (reader.offset() != total_size)
+        {
+            throw logic_error("invalid data size");
+        }
+
+        swap(*this, new_data);
+        return safe_cast<streamoff>(total_size);
+    }
 }
@@ -17,6 +17,7 @@
 #include "seal/intarray.h"
 #include "seal/context.h"
 #include "seal/valcheck.h"
+#include "seal/util/viewlayout.h"
 #include "seal/util/ztools.h"
 #ifdef SEAL_USE_MSGSL_SPAN
 #include <gsl/span>
@@ -589,7 +590,7 @@ namespace seal
         */
         inline std::streamoff save(
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
@@ -664,7 +665,7 @@ namespace seal
         inline std::streamoff save(
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             using namespace std::placeholders;
             return Serialization::Save(
@@ -729,6 +730,79 @@ namespace seal
             return in_size;
         }
 
+        /**
+        Returns the number of bytes save_aligned writes.
+
+        @throws std::logic_error if the size does not fit in the return type
+        */
+        SEAL_NODISCARD std::streamoff save_aligned_size() const;
+
+        /**
+        Saves the plaintext to an output stream in an uncompressed layout in
+        which the plaintext data is aligned, so that it can be used in place by
+        load_view, e.g., from a memory-mapped file (see MappedFile). The output
+        is in binary format and not human-readable. The output stream must have
+        the "binary" flag set. Data saved with save_aligned cannot be loaded with
+        load and vice versa.
+
+        @param[out] stream The stream to save the plaintext to
+        @throws std::runtime_error if I/O operations failed
+        */
+        std::streamoff save_aligned(std::ostream &stream) const;
+
+        /**
+        Makes the plaintext refer to plaintext data saved with save_aligned at a
+        given memory location, without copying it. The memory must remain valid
+        for as long as the plaintext refers to it, i.e., until it is destroyed or
+        resized beyond its size. Changes to the plaintext, also by assignment,
+        are made in the memory. Only the metadata is checked; the data itself is
+        not read. This function should not be used unless the plaintext comes
+        from a fully trusted source.
+
+        @param[in] context The SEALContext
+        @param[in] in The memory location holding the plaintext, aligned to
+        8 bytes
+        @param[in] size The number of bytes available in the given memory location
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if in is null or not aligned
+        @throws std::logic_error if the data is not in the layout written by
+        save_aligned or is invalid
+        */
+        std::streamoff unsafe_load_view(std::shared_ptr<SEALContext> context,
+            SEAL_BYTE *in, std::size_t size);
+
+        /**
+        Makes the plaintext refer to plaintext data saved with save_aligned at a
+        given memory location, without copying it. The memory must remain valid
+        for as long as the plaintext refers to it, i.e., until it is destroyed or
+        resized beyond its size. Changes to the plaintext, also by assignment,
+        are made in the memory. The plaintext is verified to be valid for the
+        given SEALContext, which reads all of the data.
+
+        @param[in] context The SEALContext
+        @param[in] in The memory location holding the plaintext, aligned to
+        8 bytes
+        @param[in] size The number of bytes available in the given memory location
+        @throws std::invalid_argument if the context is not set or encryption
+        parameters are not valid
+        @throws std::invalid_argument if in is null or not aligned
+        @throws std::logic_error if the data is not in the layout written by
+        save_aligned or is invalid
+        */
+        inline std::streamoff load_view(std::shared_ptr<SEALContext> context,
+            SEAL_BYTE *in, std::size_t size)
+        {
+            Plaintext new_data(pool());
+            auto in_size = new_data.unsafe_load_view(context, in, size);
+            if (!is_valid_for(new_data, std::move(context)))
+            {
+                throw std::logic_error("plaintext data is invalid");
+            }
+            std::swap(*this, new_data);
+            return in_size;
+        }
+
         /**
         Returns whether the plaintext is in NTT form.
         */
@@ -796,6 +870,8 @@ namespace seal
 
         void load_members(std::shared_ptr<SEALContext> context, std::istream &stream);
 
+        SEAL_NODISCARD std::size_t view_members_size() const;
+
         parms_id_type parms_id_ = parms_id_zero;
 
         std::size_t coeff_count_ = 0;
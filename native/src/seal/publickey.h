@@ -105,7 +105,7 @@ namespace seal
         */
         inline std::streamoff save(
             std::ostream &stream,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             return pk_.save(stream, compr_mode);
         }
@@ -176,7 +176,7 @@ namespace seal
         inline std::streamoff save(
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode = Serialization::compr_mode_default) const
+            CompressionParameters compr_mode = Serialization::compr_mode_default) const
         {
             return pk_.save(out, size, compr_mode);
         }
@@ -81,4 +81,48 @@ namespace seal
         }
         counter_++;
     }
+
+    namespace
+    {
+        // Derive the AES key and nonce from the full 512-bit seed with Blake2b
+        util::AES128CTR make_aes_ctr(const IntArray<uint64_t> &seed)
+        {
+            array<uint64_t, 3> key_material;
+            if (blake2b(
+                key_material.data(),
+                sizeof(key_material),
+                seed.cbegin(), seed.size() * sizeof(uint64_t),
+                nullptr, 0) != 0)
+            {
+                throw runtime_error("blake2b failed");
+            }
+            return util::AES128CTR({ key_material[0], key_material[1] }, key_material[2]);
+        }
+    }
+
+    AESPRNG::AESPRNG(random_seed_type seed, size_t buffer_size) :
+        UniformRandomGenerator(seed, buffer_size),
+        aes_(make_aes_ctr(seed_))
+    {
+    }
+
+    void AESPRNG::refill_buffer()
+    {
+        // The buffer size is a multiple of the AES block size
+        size_t block_count = buffer_size_ / util::AES128CTR::block_byte_count;
+        aes_.keystream(counter_, block_count, buffer_begin_);
+        counter_ += block_count;
+    }
+
+    Shake128PRNG::Shake128PRNG(random_seed_type seed, size_t buffer_size) :
+        UniformRandomGenerator(seed, buffer_size)
+    {
+        shake_.absorb(reinterpret_cast<const SEAL_BYTE*>(seed_.cbegin()),
+            seed_.size() * sizeof(decltype(seed_)::T));
+    }
+
+    void Shake128PRNG::refill_buffer()
+    {
+        shake_.squeeze(buffer_begin_, buffer_size_);
+    }
 }
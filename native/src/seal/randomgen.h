@@ -15,6 +15,8 @@
 #include "seal/util/common.h"
 #include "seal/intarray.h"
 #include "seal/memorymanager.h"
+#include "seal/util/aes.h"
+#include "seal/util/keccak.h"
 
 namespace seal
 {
@@ -41,8 +43,12 @@ namespace seal
         Creates a new UniformRandomGenerator instance initialized with the given seed.
 
         @param[in] seed The seed for the random number generator
+        @param[in] buffer_size The size in bytes of the randomness buffer
+        @throws std::invalid_argument if buffer_size is zero, not a multiple of
+        buffer_size_granularity, or larger than buffer_size_max
         */
-        UniformRandomGenerator(random_seed_type seed) :
+        UniformRandomGenerator(random_seed_type seed,
+            std::size_t buffer_size = buffer_size_default) :
             seed_([&seed]() {
                 // Create a new seed allocation
                 IntArray<std::uint64_t> new_seed(
@@ -53,6 +59,13 @@ namespace seal
                 std::copy(seed.cbegin(), seed.cend(), new_seed.begin());
                 return new_seed;
             }()),
+            buffer_size_([buffer_size]() {
+                if (!is_valid_buffer_size(buffer_size))
+                {
+                    throw std::invalid_argument("buffer_size is invalid");
+                }
+                return buffer_size;
+            }()),
             buffer_(buffer_size_,
                 MemoryManager::GetPool(mm_prof_opt::FORCE_NEW, true)),
             buffer_begin_(buffer_.begin()),
@@ -61,6 +74,36 @@ namespace seal
         {
         }
 
+        /**
+        The default size in bytes of the randomness buffer.
+        */
+        static constexpr std::size_t buffer_size_default = 4096;
+
+        /**
+        The size of the randomness buffer must be a multiple of this value.
+        */
+        static constexpr std::size_t buffer_size_granularity = 64;
+
+        /**
+        The largest supported size in bytes of the randomness buffer.
+        */
+        static constexpr std::size_t buffer_size_max = std::size_t(1) << 24;
+
+        /**
+        Returns whether the given value is a valid randomness buffer size.
+
+        @param[in] buffer_size The buffer size in bytes
+        */
+        SEAL_NODISCARD static constexpr bool is_valid_buffer_size(
+            std::size_t buffer_size) noexcept
+        {
+            return buffer_size && !(buffer_size % buffer_size_granularity) &&
+                buffer_size <= buffer_size_max;
+        }
+
+        /**
+        Returns the seed of the random number generator.
+        */
         SEAL_NODISCARD inline random_seed_type seed() const noexcept
         {
             random_seed_type ret;
@@ -73,6 +116,14 @@ namespace seal
         */
         void generate(std::size_t byte_count, SEAL_BYTE *destination);
 
+        /**
+        Returns the size in bytes of the randomness buffer.
+        */
+        SEAL_NODISCARD inline std::size_t buffer_size() const noexcept
+        {
+            return buffer_size_;
+        }
+
         /**
         Generates a new unsigned 32-bit random number.
         */
@@ -104,7 +155,7 @@ namespace seal
 
         const IntArray<std::uint64_t> seed_;
 
-        const std::size_t buffer_size_ = 4096;
+        const std::size_t buffer_size_;
 
     private:
         IntArray<SEAL_BYTE> buffer_;
@@ -185,6 +236,34 @@ namespace seal
             return create_impl(seed);
         }
 
+        /**
+        Sets the size in bytes of the randomness buffer of all subsequently
+        created UniformRandomGenerator instances. A larger buffer reduces the
+        number of calls to the underlying primitive at the cost of memory.
+
+        @param[in] buffer_size The buffer size in bytes
+        @throws std::invalid_argument if buffer_size is zero, not a multiple of
+        UniformRandomGenerator::buffer_size_granularity, or larger than
+        UniformRandomGenerator::buffer_size_max
+        */
+        inline void set_buffer_size(std::size_t buffer_size)
+        {
+            if (!UniformRandomGenerator::is_valid_buffer_size(buffer_size))
+            {
+                throw std::invalid_argument("buffer_size is invalid");
+            }
+            buffer_size_ = buffer_size;
+        }
+
+        /**
+        Returns the size in bytes of the randomness buffer of created
+        UniformRandomGenerator instances.
+        */
+        SEAL_NODISCARD inline std::size_t buffer_size() const noexcept
+        {
+            return buffer_size_;
+        }
+
         /**
         Destroys the random number generator factory.
         */
@@ -205,6 +284,8 @@ namespace seal
         random_seed_type default_seed_ = {};
 
         bool use_random_seed_ = false;
+
+        std::size_t buffer_size_ = UniformRandomGenerator::buffer_size_default;
     };
 
     /**
@@ -218,8 +299,12 @@ namespace seal
         Creates a new BlakePRNG instance initialized with the given seed.
 
         @param[in] seed The seed for the random number generator
+        @param[in] buffer_size The size in bytes of the randomness buffer
+        @throws std::invalid_argument if buffer_size is invalid
         */
-        BlakePRNG(random_seed_type seed) : UniformRandomGenerator(seed)
+        BlakePRNG(random_seed_type seed,
+            std::size_t buffer_size = buffer_size_default) :
+            UniformRandomGenerator(seed, buffer_size)
         {
         }
 
@@ -272,9 +357,158 @@ namespace seal
         SEAL_NODISCARD virtual auto create_impl(random_seed_type seed)
             -> std::shared_ptr<UniformRandomGenerator> override
         {
-            return std::make_shared<BlakePRNG>(seed);
+            return std::make_shared<BlakePRNG>(seed, buffer_size());
         }
 
     private:
     };
+
+    /**
+    Provides an implementation of UniformRandomGenerator using AES-128 in counter
+    mode. The key and nonce are derived from the seed with Blake2b.
+    The AES-NI instructions are used when the processor supports them; otherwise
+    a (much slower) portable implementation is used.
+    */
+    class AESPRNG : public UniformRandomGenerator
+    {
+    public:
+        /**
+        Creates a new AESPRNG instance initialized with the given seed.
+
+        @param[in] seed The seed for the random number generator
+        @param[in] buffer_size The size in bytes of the randomness buffer
+        @throws std::invalid_argument if buffer_size is invalid
+        */
+        AESPRNG(random_seed_type seed,
+            std::size_t buffer_size = buffer_size_default);
+
+        /**
+        Destroys the random number generator.
+        */
+        virtual ~AESPRNG() override = default;
+
+    protected:
+        virtual void refill_buffer() override;
+
+    private:
+        util::AES128CTR aes_;
+
+        std::uint64_t counter_ = 0;
+    };
+
+    class AESPRNGFactory : public UniformRandomGeneratorFactory
+    {
+    public:
+        /**
+        Creates a new AESPRNGFactory. The seed will be sampled randomly for each
+        AESPRNG instance created by the factory instance, which is desirable in
+        most normal use-cases.
+        */
+        AESPRNGFactory() : UniformRandomGeneratorFactory()
+        {
+        }
+
+        /**
+        Creates a new AESPRNGFactory and sets the default seed to the given value.
+        For debugging purposes it may sometimes be convenient to have the same
+        randomness be used deterministically and repeatedly. Such randomness
+        sampling is naturally insecure and must be strictly restricted to debugging
+        situations. Thus, most users should never have a reason to use this
+        constructor.
+
+        @param[in] default_seed The default value for a seed to be used by all
+        created instances of AESPRNG
+        */
+        AESPRNGFactory(random_seed_type default_seed) :
+            UniformRandomGeneratorFactory(default_seed)
+        {
+        }
+
+        /**
+        Destroys the random number generator factory.
+        */
+        virtual ~AESPRNGFactory() = default;
+
+    protected:
+        SEAL_NODISCARD virtual auto create_impl(random_seed_type seed)
+            -> std::shared_ptr<UniformRandomGenerator> override
+        {
+            return std::make_shared<AESPRNG>(seed, buffer_size());
+        }
+    };
+
+    /**
+    Provides an implementation of UniformRandomGenerator using the SHAKE-128
+    extendable-output function. The seed is absorbed once and the buffer is
+    refilled by squeezing further output, so the generated stream does not
+    depend on the buffer size.
+    */
+    class Shake128PRNG : public UniformRandomGenerator
+    {
+    public:
+        /**
+        Creates a new Shake128PRNG instance initialized with the given seed.
+
+        @param[in] seed The seed for the random number generator
+        @param[in] buffer_size The size in bytes of the randomness buffer
+        @throws std::invalid_argument if buffer_size is invalid
+        */
+        Shake128PRNG(random_seed_type seed,
+            std::size_t buffer_size = buffer_size_default);
+
+        /**
+        Destroys the random number generator.
+        */
+        virtual ~Shake128PRNG() override
+        {
+            shake_.reset();
+        }
+
+    protected:
+        virtual void refill_buffer() override;
+
+    private:
+        util::Shake128 shake_;
+    };
+
+    class Shake128PRNGFactory : public UniformRandomGeneratorFactory
+    {
+    public:
+        /**
+        Creates a new Shake128PRNGFactory. The seed will be sampled randomly for
+        each Shake128PRNG instance created by the factory instance, which is
+        desirable in most normal use-cases.
+        */
+        Shake128PRNGFactory() : UniformRandomGeneratorFactory()
+        {
+        }
+
+        /**
+        Creates a new Shake128PRNGFactory and sets the default seed to the given
+        value. For debugging purposes it may sometimes be convenient to have the
+        same randomness be used deterministically and repeatedly. Such randomness
+        sampling is naturally insecure and must be strictly restricted to debugging
+        situations. Thus, most users should never have a reason to use this
+        constructor.
+
+        @param[in] default_seed The default value for a seed to be used by all
+        created instances of Shake128PRNG
+        */
+        Shake128PRNGFactory(random_seed_type default_seed) :
+            UniformRandomGeneratorFactory(default_seed)
+        {
+        }
+
+        /**
+        Destroys the random number generator factory.
+        */
+        virtual ~Shake128PRNGFactory() = default;
+
+    protected:
+        SEAL_NODISCARD virtual auto create_impl(random_seed_type seed)
+            -> std::shared_ptr<UniformRandomGenerator> override
+        {
+            return std::make_shared<Shake128PRNG>(seed, buffer_size());
+        }
+    };
 }
@@ -14,6 +14,7 @@
 #include "seal/encryptor.h"
 #include "seal/evaluator.h"
 #include "seal/intarray.h"
+#include "seal/mappedfile.h"
 #include "seal/keygenerator.h"
 #include "seal/memorymanager.h"
 #include "seal/plaintext.h"
@@ -8,6 +8,7 @@
 #include <type_traits>
 #include <utility>
 #include <algorithm>
+#include <thread>
 #include "seal/context.h"
 #include "seal/intarray.h"
 #include "seal/serialization.h"
@@ -456,6 +457,47 @@ namespace seal
 
             iterator_type head_;
         };
+
+        // An output stream buffer that discards what is written to it, but
+        // counts the bytes. Saving to it first gives the size of the output, so
+        // the header can be written before the output, without seeking back.
+        class CountingBuffer final : public streambuf
+        {
+        public:
+            SEAL_NODISCARD streamoff count() const noexcept
+            {
+                return count_;
+            }
+
+        private:
+            streamsize xsputn(const char_type *, streamsize count) override
+            {
+                count_ = add_safe(count_, static_cast<streamoff>(count));
+                return count;
+            }
+
+            int_type overflow(int_type ch) override
+            {
+                if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                {
+                    count_ = add_safe(count_, streamoff(1));
+                }
+                return traits_type::not_eof(ch);
+            }
+
+            // Only supports finding the current position, as with tellp
+            pos_type seekoff(off_type off, ios_base::seekdir dir,
+                ios_base::openmode which) override
+            {
+                if (off || dir != ios_base::cur || !(which & ios_base::out))
+                {
+                    return pos_type(off_type(-1));
+                }
+                return pos_type(count_);
+            }
+
+            streamoff count_ = 0;
+        };
     }
 
     size_t Serialization::ComprSizeEstimate(
@@ -470,9 +512,17 @@ namespace seal
         {
 #ifdef SEAL_USE_ZLIB
         case compr_mode_type::deflate:
+            /* fall through */
+        case compr_mode_type::bitpack_deflate:
             return ztools::deflate_size_bound(in_size);
+#endif
+#ifdef SEAL_USE_ZSTD
+        case compr_mode_type::zstd:
+            return ztools::zstd_size_bound(in_size);
 #endif
         case compr_mode_type::none:
+            /* fall through */
+        case compr_mode_type::bitpack:
             // No compression
             return in_size;
 
@@ -531,7 +581,7 @@ namespace seal
         function<void(ostream &stream)> save_members,
         streamoff raw_size,
         ostream &stream,
-        compr_mode_type compr_mode)
+        CompressionParameters compr_mode)
     {
         if (!save_members)
         {
@@ -571,12 +621,69 @@ namespace seal
                 // Write rest of the data
                 save_members(stream);
                 break;
+
+            case compr_mode_type::bitpack:
+                {
+                    // The size of bit-packed data depends on the coefficients, so
+                    // raw_size may not be exact. A first pass only counts the
+                    // bytes; the second writes directly to stream.
+                    CountingBuffer counting_buffer;
+                    ostream counting_stream(&counting_buffer);
+                    counting_stream.exceptions(ios_base::badbit | ios_base::failbit);
+                    save_members(counting_stream);
+
+                    header.compr_mode = compr_mode;
+                    header.size = safe_cast<uint32_t>(add_safe(
+                        static_cast<streamoff>(sizeof(SEALHeader)),
+                        counting_buffer.count()));
+                    SaveHeader(header, stream);
+                    save_members(stream);
+                    break;
+                }
 #ifdef SEAL_USE_ZLIB
             case compr_mode_type::deflate:
+                /* fall through */
+            case compr_mode_type::bitpack_deflate:
                 {
-                    // First save_members to a temporary byte stream; set the size
-                    // of the temporary stream to be right from the start to avoid
-                    // extra reallocs.
+                    // Bit-packed data has few redundant bytes left, so the fastest
+                    // compression level is used.
+                    int level = compr_mode == compr_mode_type::bitpack_deflate ?
+                        ztools::level_fast : ztools::level_default;
+                    auto safe_pool(MemoryManager::GetPool(mm_prof_opt::FORCE_NEW, true));
+
+                    // Compress in chunks twice, as the compressed size must be in
+                    // the header: the first pass only counts the output bytes, and
+                    // the second, which produces the same output, writes directly
+                    // to stream. Neither the uncompressed nor the compressed data
+                    // is held in memory in full.
+                    CountingBuffer counting_buffer;
+                    ostream counting_stream(&counting_buffer);
+                    counting_stream.exceptions(ios_base::badbit | ios_base::failbit);
+                    auto compr_size = ztools::deflate_save_members(
+                        save_members, counting_stream, safe_pool, level);
+
+                    header.compr_mode = compr_mode;
+                    header.size = safe_cast<uint32_t>(add_safe(
+                        static_cast<streamoff>(sizeof(SEALHeader)), compr_size));
+                    SaveHeader(header, stream);
+                    if (ztools::deflate_save_members(
+                        save_members, stream, safe_pool, level) != compr_size)
+                    {
+                        throw logic_error("deflate failed");
+                    }
+                    break;
+                }
+#endif
+#ifdef SEAL_USE_ZSTD
+            case compr_mode_type::zstd:
+                {
+                    if (compr_mode.zstd_level < ztools::zstd_min_level() ||
+                        compr_mode.zstd_level > ztools::zstd_max_level())
+                    {
+                        throw invalid_argument("zstd_level is not valid");
+                    }
+
+                    // As with Deflate, first save_members to a temporary byte stream
                     SafeByteBuffer safe_buffer(
                         raw_size - static_cast<streamoff>(sizeof(SEALHeader)));
                     iostream temp_stream(&safe_buffer);
@@ -590,11 +697,15 @@ namespace seal
                         Pointer<SEAL_BYTE>::Aliasing(safe_buffer.data()),
                         static_cast<size_t>(temp_stream.tellp()), false, safe_pool);
 
-                    // After compression, write_header_deflate_buffer will write the
-                    // final size to the given header and write the header to stream,
-                    // before writing the compressed output.
-                    ztools::write_header_deflate_buffer(safe_buffer_array,
-                        reinterpret_cast<void*>(&header), stream, safe_pool);
+                    size_t thread_count = compr_mode.zstd_thread_count;
+                    if (!thread_count)
+                    {
+                        thread_count = max<size_t>(thread::hardware_concurrency(), 1);
+                    }
+                    header.compr_mode = compr_mode;
+                    ztools::write_header_zstd_buffer(safe_buffer_array,
+                        reinterpret_cast<void*>(&header), stream, safe_pool,
+                        compr_mode.zstd_level, thread_count);
                     break;
                 }
 #endif
@@ -652,6 +763,8 @@ namespace seal
             switch (header.compr_mode)
             {
             case compr_mode_type::none:
+                /* fall through */
+            case compr_mode_type::bitpack:
                 // Read rest of the data
                 load_members(stream);
                 if (header.size != stream.tellg() - stream_start_pos)
@@ -661,23 +774,34 @@ namespace seal
                 break;
 #ifdef SEAL_USE_ZLIB
             case compr_mode_type::deflate:
+                /* fall through */
+            case compr_mode_type::bitpack_deflate:
                 {
                     auto compr_size = header.size - (stream.tellg() - stream_start_pos);
 
-                    // We don't know the decompressed size, but use compr_size as
-                    // starting point for the buffer.
-                    SafeByteBuffer safe_buffer(safe_cast<streamsize>(compr_size));
+                    // Decompress in chunks as load_members consumes the data
+                    ztools::inflate_load_members(load_members, stream, compr_size,
+                        MemoryManager::GetPool(mm_prof_opt::FORCE_NEW, true));
+                    break;
+                }
+#endif
+#ifdef SEAL_USE_ZSTD
+            case compr_mode_type::zstd:
+                {
+                    auto compr_size = header.size - (stream.tellg() - stream_start_pos);
 
-                    iostream temp_stream(&safe_buffer);
+                    // The frames declare the decompressed size, which is allocated
+                    // up front and never exceeded
+                    auto safe_pool(MemoryManager::GetPool(mm_prof_opt::FORCE_NEW, true));
+                    IntArray<SEAL_BYTE> safe_buffer_array(safe_pool);
+                    ztools::zstd_decompress_stream(
+                        stream, compr_size, safe_buffer_array, safe_pool);
+
+                    ArrayGetBuffer agbuf(
+                        reinterpret_cast<const char*>(safe_buffer_array.cbegin()),
+                        safe_cast<streamsize>(safe_buffer_array.size()));
+                    istream temp_stream(&agbuf);
                     temp_stream.exceptions(ios_base::badbit | ios_base::failbit);
-
-                    constexpr int Z_OK = 0;
-                    if (ztools::inflate_stream(
-                        stream, compr_size, temp_stream,
-                        MemoryManager::GetPool(mm_prof_opt::FORCE_NEW, true)) != Z_OK)
-                    {
-                        throw logic_error("stream inflate failed");
-                    }
                     load_members(temp_stream);
                     break;
                 }
@@ -708,7 +832,7 @@ namespace seal
         streamoff raw_size,
         SEAL_BYTE *out,
         size_t size,
-        compr_mode_type compr_mode)
+        CompressionParameters compr_mode)
     {
         if (!out)
         {
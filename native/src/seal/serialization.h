@@ -4,6 +4,7 @@
 #pragma once
 
 #include <iostream>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include "seal/util/defines.h"
@@ -17,6 +18,16 @@ namespace seal
     a large number of zero bytes in the output. Any compression algorithm should
     be able to clean up these zero bytes and hence compress both ciphertext and
     key data.
+
+    The bit-packing modes instead store each coefficient of Ciphertext and key
+    data in only as many bits as its coefficient modulus prime needs, which
+    removes the zero bytes at almost no computational cost. Other objects are
+    saved as with compr_mode_type::none or compr_mode_type::deflate.
+
+    Zstandard compression is typically several times faster than Deflate at a
+    similar or better compression ratio. Its level and the number of threads used
+    to compress large objects can be given for each save with
+    CompressionParameters.
     */
     enum class compr_mode_type : std::uint8_t
     {
@@ -26,6 +37,72 @@ namespace seal
         // Use Deflate compression
         deflate = 1,
 #endif
+        // Bit-pack ciphertext and key coefficients
+        bitpack = 2,
+#ifdef SEAL_USE_ZLIB
+        // Bit-pack ciphertext and key coefficients and use fast Deflate
+        // compression on the result
+        bitpack_deflate = 3,
+#endif
+#ifdef SEAL_USE_ZSTD
+        // Use Zstandard compression
+        zstd = 4,
+#endif
+    };
+
+    /**
+    The compression settings for a single save: a compr_mode_type together with
+    the parameters of the compression algorithm. CompressionParameters converts
+    implicitly from and to compr_mode_type, so functions that save objects can be
+    given a compr_mode_type alone to use the default parameters.
+    */
+    struct CompressionParameters
+    {
+        /**
+        The default Zstandard compression level.
+        */
+        static constexpr int zstd_level_default = 3;
+
+        /**
+        Creates compression settings for a given compression mode.
+
+        @param[in] mode The compression mode
+        @param[in] level The Zstandard compression level
+        @param[in] thread_count The number of threads used to compress with
+        compr_mode_type::zstd; zero selects the number of hardware threads
+        */
+        CompressionParameters(compr_mode_type mode,
+            int level = zstd_level_default,
+            std::size_t thread_count = 1) noexcept :
+            compr_mode(mode), zstd_level(level), zstd_thread_count(thread_count)
+        {
+        }
+
+        SEAL_NODISCARD inline operator compr_mode_type() const noexcept
+        {
+            return compr_mode;
+        }
+
+        /**
+        The compression mode.
+        */
+        compr_mode_type compr_mode;
+
+        /**
+        The Zstandard compression level used by compr_mode_type::zstd. Higher
+        levels compress better but more slowly, and negative levels trade
+        compression ratio for speed.
+        */
+        int zstd_level;
+
+        /**
+        The number of threads used to compress with compr_mode_type::zstd. Large
+        objects are split into chunks that are compressed in parallel into
+        independent Zstandard frames; the output can be loaded regardless of the
+        number of threads used to save it. Zero selects the number of hardware
+        threads.
+        */
+        std::size_t zstd_thread_count;
     };
 
     /**
@@ -84,8 +161,16 @@ namespace seal
             {
             case static_cast<std::uint8_t>(compr_mode_type::none) :
                 /* fall through */
+            case static_cast<std::uint8_t>(compr_mode_type::bitpack) :
+                /* fall through */
 #ifdef SEAL_USE_ZLIB
             case static_cast<std::uint8_t>(compr_mode_type::deflate) :
+                /* fall through */
+            case static_cast<std::uint8_t>(compr_mode_type::bitpack_deflate) :
+                /* fall through */
+#endif
+#ifdef SEAL_USE_ZSTD
+            case static_cast<std::uint8_t>(compr_mode_type::zstd) :
 #endif
                 return true;
             }
@@ -103,10 +188,43 @@ namespace seal
             return IsSupportedComprMode(static_cast<uint8_t>(compr_mode));
         }
 
+        /**
+        Returns true if the given compression mode bit-packs ciphertext and key
+        coefficients.
+
+        @param[in] compr_mode The compression mode
+        */
+        SEAL_NODISCARD static inline bool IsBitPacked(
+            compr_mode_type compr_mode) noexcept
+        {
+#ifdef SEAL_USE_ZLIB
+            return compr_mode == compr_mode_type::bitpack ||
+                compr_mode == compr_mode_type::bitpack_deflate;
+#else
+            return compr_mode == compr_mode_type::bitpack;
+#endif
+        }
+
+        /**
+        Returns the compression mode that produces the uncompressed output of
+        save_members for a given compression mode: compr_mode_type::bitpack if
+        the given mode bit-packs coefficients, and compr_mode_type::none otherwise.
+        Objects pass the size of their output in this mode as raw_size to Save.
+
+        @param[in] compr_mode The compression mode
+        */
+        SEAL_NODISCARD static inline compr_mode_type RawComprMode(
+            compr_mode_type compr_mode) noexcept
+        {
+            return IsBitPacked(compr_mode) ?
+                compr_mode_type::bitpack : compr_mode_type::none;
+        }
+
         /**
         Returns an upper bound on the output size of data compressed according to
         a given compression mode with given input size. If compr_mode is
-        compr_mode_type::none, the return value is exactly in_size.
+        compr_mode_type::none or compr_mode_type::bitpack, the return value is
+        exactly in_size.
 
         @param[in] in_size The input size to a compression algorithm
         @param[in] in_size The compression mode
@@ -168,15 +286,24 @@ namespace seal
 
         For any given compression mode, raw_size must be the exact right size
         (in bytes) of what save_members writes to a stream in the uncompressed
-        mode. Otherwise the behavior of Save is unspecified.
+        mode (see RawComprMode). Otherwise the behavior of Save is unspecified.
+        With the bit-packing modes, raw_size may only approximate the size.
+
+        Bit-packed and Deflate-compressed output is written to stream in
+        fixed-size chunks as it is produced, and stream is written to only
+        sequentially. As the header holds the size of the output, save_members
+        is evaluated twice: first to find the size, discarding the output, and
+        then to write it. Zstandard-compressed output is buffered in memory.
 
         @param[in] save_members A function taking an std::ostream reference as an
         argument, possibly writing some number of bytes into it
         @param[in] raw_size The exact uncompressed output size of save_members
         @param[out] stream The stream to write to
-        @param[in] compr_mode The desired compression mode
+        @param[in] compr_mode The desired compression mode and its parameters
         @throws std::invalid_argument if save_members is invalid
         @throws std::invalid_argument if raw_size is smaller than SEALHeader size
+        @throws std::invalid_argument if the Zstandard compression level is not
+        valid
         @throws std::logic_error if the data to be saved is invalid, if compression
         mode is not supported, or if compression failed
         @throws std::runtime_error if I/O operations failed
@@ -185,12 +312,13 @@ namespace seal
             std::function<void(std::ostream &stream)> save_members,
             std::streamoff raw_size,
             std::ostream &stream,
-            compr_mode_type compr_mode);
+            CompressionParameters compr_mode);
 
         /**
         Deserializes data from stream that was serialized by Save. Once stream has
         been decompressed (depending on compression mode), load_members is applied
-        to the decompressed stream. In typical use-cases load_members would be
+        to the decompressed stream. Deflate-compressed data is decompressed in
+        fixed-size chunks as load_members reads it. In typical use-cases load_members would be
         a function that deserializes the member variables of an object from the
         given stream.
 
@@ -216,16 +344,18 @@ namespace seal
 
         For any given compression mode, raw_size must be the exact right size
         (in bytes) of what save_members writes to a stream in the uncompressed
-        mode. Otherwise the behavior of Save is unspecified.
+        mode (see RawComprMode). Otherwise the behavior of Save is unspecified.
+        With the bit-packing modes, raw_size may only approximate the size.
 
         @param[in] save_members A function that takes an std::ostream reference as
         an argument and writes some number of bytes into it
         @param[in] raw_size The exact uncompressed output size of save_members
         @param[out] out The memory location to write to
         @param[in] size The number of bytes available in the given memory location
-        @param[in] compr_mode The desired compression mode
+        @param[in] compr_mode The desired compression mode and its parameters
         @throws std::invalid_argument if save_members is invalid, if raw_size or
-        size is smaller than SEALHeader size, or if out is null
+        size is smaller than SEALHeader size, if out is null, or if the Zstandard
+        compression level is not valid
         @throws std::logic_error if the data to be saved is invalid, if compression
         mode is not supported, or if compression failed
         @throws std::runtime_error if I/O operations failed
@@ -235,7 +365,7 @@ namespace seal
             std::streamoff raw_size,
             SEAL_BYTE *out,
             std::size_t size,
-            compr_mode_type compr_mode);
+            CompressionParameters compr_mode);
 
         /**
         Deserializes data from a memory location that was serialized by Save.
@@ -0,0 +1,359 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cstring>
+#include "seal/util/aes.h"
+
+#if defined(SEAL_USE_INTRIN) && (defined(__x86_64__) || defined(_M_X64))
+#define SEAL_AES_USE_AES_NI
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#if SEAL_COMPILER == SEAL_COMPILER_MSVC
+#include <intrin.h>
+#define SEAL_AES_NI_TARGET
+#else
+#define SEAL_AES_NI_TARGET __attribute__((target("aes,sse2")))
+#endif
+#endif
+
+using namespace std;
+
+namespace seal
+{
+    namespace util
+    {
+        namespace
+        {
+            constexpr uint8_t aes_rcon[10]{
+                0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36
+            };
+
+            inline uint8_t xtime(uint8_t value) noexcept
+            {
+                return static_cast<uint8_t>((value << 1) ^ (((value >> 7) & 1) * 0x1B));
+            }
+
+            inline void store_counter_block(
+                uint64_t nonce, uint64_t counter, uint8_t *block) noexcept
+            {
+                for (size_t k = 0; k < 8; k++)
+                {
+                    block[k] = static_cast<uint8_t>(nonce >> (8 * k));
+                    block[k + 8] = static_cast<uint8_t>(counter >> (8 * k));
+                }
+            }
+
+            // Transposes the 8x8 bit matrix whose rows are the bytes of value
+            inline uint64_t transpose_bits(uint64_t value) noexcept
+            {
+                uint64_t t = (value ^ (value >> 7)) & 0x00AA00AA00AA00AAULL;
+                value ^= t ^ (t << 7);
+                t = (value ^ (value >> 14)) & 0x0000CCCC0000CCCCULL;
+                value ^= t ^ (t << 14);
+                t = (value ^ (value >> 28)) & 0x00000000F0F0F0F0ULL;
+                value ^= t ^ (t << 28);
+                return value;
+            }
+
+            // Reduces a bitsliced product of two elements of GF(2^8) modulo
+            // the AES polynomial x^8 + x^4 + x^3 + x + 1
+            inline void reduce_bitsliced(uint64_t *product, uint64_t *result) noexcept
+            {
+                for (size_t k = 14; k >= 8; k--)
+                {
+                    product[k - 4] ^= product[k];
+                    product[k - 5] ^= product[k];
+                    product[k - 7] ^= product[k];
+                    product[k - 8] ^= product[k];
+                }
+                for (size_t i = 0; i < 8; i++)
+                {
+                    result[i] = product[i];
+                }
+            }
+
+            inline void multiply_bitsliced(
+                const uint64_t *a, const uint64_t *b, uint64_t *result) noexcept
+            {
+                uint64_t product[15]{};
+                for (size_t i = 0; i < 8; i++)
+                {
+                    for (size_t j = 0; j < 8; j++)
+                    {
+                        product[i + j] ^= a[i] & b[j];
+                    }
+                }
+                reduce_bitsliced(product, result);
+            }
+
+            inline void square_bitsliced(const uint64_t *a, uint64_t *result) noexcept
+            {
+                uint64_t product[15]{};
+                for (size_t i = 0; i < 8; i++)
+                {
+                    product[2 * i] = a[i];
+                }
+                reduce_bitsliced(product, result);
+            }
+
+            // Applies the AES S-box to count bytes, where count is a multiple
+            // of 8 and at most 64. Table lookups indexed by secret bytes leak
+            // through the cache, so the bytes are instead bitsliced into eight
+            // words holding one bit of every byte each, inverted in GF(2^8)
+            // as x^254 with only logical operations, and mapped through the
+            // affine transform. The running time depends only on count.
+            void sub_bytes(uint8_t *bytes, size_t count) noexcept
+            {
+                uint64_t x[8]{};
+                for (size_t k = 0; k < count / 8; k++)
+                {
+                    uint64_t rows = 0;
+                    for (size_t i = 0; i < 8; i++)
+                    {
+                        rows |= static_cast<uint64_t>(bytes[8 * k + i]) << (8 * i);
+                    }
+                    rows = transpose_bits(rows);
+                    for (size_t b = 0; b < 8; b++)
+                    {
+                        x[b] |= ((rows >> (8 * b)) & 0xFF) << (8 * k);
+                    }
+                }
+
+                // x^254 = x^240 * x^14 with x^240 = (x^12 * x^3)^16
+                uint64_t x2[8], x3[8], x12[8], x14[8], x15[8];
+                square_bitsliced(x, x2);
+                multiply_bitsliced(x2, x, x3);
+                square_bitsliced(x3, x12);
+                square_bitsliced(x12, x12);
+                multiply_bitsliced(x12, x2, x14);
+                multiply_bitsliced(x12, x3, x15);
+                for (size_t i = 0; i < 4; i++)
+                {
+                    square_bitsliced(x15, x15);
+                }
+                multiply_bitsliced(x15, x14, x);
+
+                uint64_t y[8];
+                for (size_t b = 0; b < 8; b++)
+                {
+                    y[b] = x[b] ^ x[(b + 4) & 7] ^ x[(b + 5) & 7] ^ x[(b + 6) & 7] ^
+                        x[(b + 7) & 7] ^ (uint64_t(0) - ((0x63 >> b) & 1));
+                }
+
+                for (size_t k = 0; k < count / 8; k++)
+                {
+                    uint64_t rows = 0;
+                    for (size_t b = 0; b < 8; b++)
+                    {
+                        rows |= ((y[b] >> (8 * k)) & 0xFF) << (8 * b);
+                    }
+                    rows = transpose_bits(rows);
+                    for (size_t i = 0; i < 8; i++)
+                    {
+                        bytes[8 * k + i] = static_cast<uint8_t>(rows >> (8 * i));
+                    }
+                }
+            }
+
+            // Blocks encrypted together share the cost of sub_bytes
+            constexpr size_t portable_lanes = 4;
+
+            // Encrypts block_count <= portable_lanes blocks in place
+            void encrypt_blocks_portable(
+                const uint8_t *round_keys, uint8_t *blocks, size_t block_count) noexcept
+            {
+                for (size_t i = 0; i < 16 * block_count; i++)
+                {
+                    blocks[i] ^= round_keys[i & 15];
+                }
+                for (size_t round = 1; round <= 10; round++)
+                {
+                    sub_bytes(blocks, 16 * block_count);
+                    const uint8_t *round_key = round_keys + 16 * round;
+                    for (uint8_t *state = blocks; state != blocks + 16 * block_count; state += 16)
+                    {
+                        // ShiftRows; the state is stored column by column
+                        uint8_t temp[16];
+                        for (size_t c = 0; c < 4; c++)
+                        {
+                            for (size_t r = 0; r < 4; r++)
+                            {
+                                temp[4 * c + r] = state[4 * ((c + r) & 3) + r];
+                            }
+                        }
+
+                        // MixColumns in all but the last round
+                        if (round != 10)
+                        {
+                            for (size_t c = 0; c < 4; c++)
+                            {
+                                uint8_t *col = temp + 4 * c;
+                                uint8_t all = col[0] ^ col[1] ^ col[2] ^ col[3];
+                                uint8_t first = col[0];
+                                col[0] ^= all ^ xtime(col[0] ^ col[1]);
+                                col[1] ^= all ^ xtime(col[1] ^ col[2]);
+                                col[2] ^= all ^ xtime(col[2] ^ col[3]);
+                                col[3] ^= all ^ xtime(col[3] ^ first);
+                            }
+                        }
+
+                        for (size_t i = 0; i < 16; i++)
+                        {
+                            state[i] = temp[i] ^ round_key[i];
+                        }
+                    }
+                }
+            }
+
+#ifdef SEAL_AES_USE_AES_NI
+            bool detect_aes_ni() noexcept
+            {
+#if SEAL_COMPILER == SEAL_COMPILER_MSVC
+                int info[4];
+                __cpuid(info, 1);
+                return (info[2] & (1 << 25)) != 0;
+#else
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("aes");
+#endif
+            }
+
+            SEAL_AES_NI_TARGET void keystream_aes_ni(
+                const uint8_t *round_keys, uint64_t nonce, uint64_t counter,
+                size_t block_count, uint8_t *destination) noexcept
+            {
+                __m128i keys[11];
+                for (size_t i = 0; i < 11; i++)
+                {
+                    keys[i] = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(round_keys + 16 * i));
+                }
+
+                // Four independent blocks per iteration keep the AES unit busy
+                constexpr size_t lanes = 4;
+                while (block_count)
+                {
+                    size_t current_count = block_count < lanes ? block_count : lanes;
+                    __m128i blocks[lanes];
+                    for (size_t j = 0; j < current_count; j++)
+                    {
+                        blocks[j] = _mm_xor_si128(_mm_set_epi64x(
+                            static_cast<long long>(counter + j),
+                            static_cast<long long>(nonce)), keys[0]);
+                    }
+                    for (size_t round = 1; round < 10; round++)
+                    {
+                        for (size_t j = 0; j < current_count; j++)
+                        {
+                            blocks[j] = _mm_aesenc_si128(blocks[j], keys[round]);
+                        }
+                    }
+                    for (size_t j = 0; j < current_count; j++)
+                    {
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination),
+                            _mm_aesenclast_si128(blocks[j], keys[10]));
+                        destination += 16;
+                    }
+                    counter += current_count;
+                    block_count -= current_count;
+                }
+            }
+
+            SEAL_AES_NI_TARGET void encrypt_block_aes_ni(
+                const uint8_t *round_keys, const uint8_t *input, uint8_t *output) noexcept
+            {
+                __m128i block = _mm_xor_si128(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(input)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(round_keys)));
+                for (size_t round = 1; round < 10; round++)
+                {
+                    block = _mm_aesenc_si128(block, _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(round_keys + 16 * round)));
+                }
+                block = _mm_aesenclast_si128(block, _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(round_keys + 160)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output), block);
+            }
+#endif
+        }
+
+        AES128CTR::AES128CTR(
+            const key_type &key, nonce_type nonce, bool allow_aes_ni) noexcept :
+            nonce_(nonce), aes_ni_(allow_aes_ni && using_aes_ni())
+        {
+            // Standard AES-128 key expansion
+            for (size_t k = 0; k < 16; k++)
+            {
+                round_keys_[k] = static_cast<uint8_t>(key[k >> 3] >> (8 * (k & 7)));
+            }
+            for (size_t i = 16; i < round_keys_.size(); i += 4)
+            {
+                uint8_t temp[4];
+                memcpy(temp, round_keys_.data() + i - 4, 4);
+                if (!(i & 15))
+                {
+                    uint8_t word[8]{ temp[1], temp[2], temp[3], temp[0] };
+                    sub_bytes(word, 8);
+                    memcpy(temp, word, 4);
+                    temp[0] ^= aes_rcon[(i >> 4) - 1];
+                }
+                for (size_t k = 0; k < 4; k++)
+                {
+                    round_keys_[i + k] = round_keys_[i + k - 16] ^ temp[k];
+                }
+            }
+        }
+
+        bool AES128CTR::using_aes_ni() noexcept
+        {
+#ifdef SEAL_AES_USE_AES_NI
+            static const bool has_aes_ni = detect_aes_ni();
+            return has_aes_ni;
+#else
+            return false;
+#endif
+        }
+
+        void AES128CTR::encrypt_block(
+            const SEAL_BYTE *input, SEAL_BYTE *output) const noexcept
+        {
+            auto in_ptr = reinterpret_cast<const uint8_t*>(input);
+            auto out_ptr = reinterpret_cast<uint8_t*>(output);
+#ifdef SEAL_AES_USE_AES_NI
+            if (aes_ni_)
+            {
+                encrypt_block_aes_ni(round_keys_.data(), in_ptr, out_ptr);
+                return;
+            }
+#endif
+            memmove(out_ptr, in_ptr, 16);
+            encrypt_blocks_portable(round_keys_.data(), out_ptr, 1);
+        }
+
+        void AES128CTR::keystream(uint64_t counter, size_t block_count,
+            SEAL_BYTE *destination) const noexcept
+        {
+            auto dest_ptr = reinterpret_cast<uint8_t*>(destination);
+#ifdef SEAL_AES_USE_AES_NI
+            if (aes_ni_)
+            {
+                keystream_aes_ni(round_keys_.data(), nonce_, counter, block_count, dest_ptr);
+                return;
+            }
+#endif
+            while (block_count)
+            {
+                size_t current_count = min(block_count, portable_lanes);
+                for (size_t j = 0; j < current_count; j++)
+                {
+                    store_counter_block(nonce_, counter + j, dest_ptr + 16 * j);
+                }
+                encrypt_blocks_portable(round_keys_.data(), dest_ptr, current_count);
+                dest_ptr += 16 * current_count;
+                counter += current_count;
+                block_count -= current_count;
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "seal/util/defines.h"
+
+namespace seal
+{
+    namespace util
+    {
+        /**
+        Implements AES-128 encryption in counter mode. On x86-64 the AES-NI
+        instructions are used when the processor supports them, otherwise a
+        portable implementation is used that computes the S-box with bitsliced
+        logical operations instead of table lookups, so that its memory access
+        pattern and running time do not depend on the key or the data. Both
+        produce the same output.
+        */
+        class AES128CTR
+        {
+        public:
+            static constexpr std::size_t block_byte_count = 16;
+
+            using key_type = std::array<std::uint64_t, 2>;
+
+            using nonce_type = std::uint64_t;
+
+            /**
+            Creates an instance for the given key and nonce. If allow_aes_ni is
+            false, the portable implementation is used even when AES-NI is
+            available.
+            */
+            AES128CTR(const key_type &key, nonce_type nonce,
+                bool allow_aes_ni = true) noexcept;
+
+            /**
+            Encrypts a single 16-byte block.
+            */
+            void encrypt_block(const SEAL_BYTE *input, SEAL_BYTE *output) const noexcept;
+
+            /**
+            Writes the keystream blocks for counter values counter, counter + 1, ...,
+            counter + block_count - 1 to the given buffer. Each counter block is the
+            nonce followed by the 64-bit counter, both in little-endian byte order.
+            */
+            void keystream(std::uint64_t counter, std::size_t block_count,
+                SEAL_BYTE *destination) const noexcept;
+
+            /**
+            Returns whether the AES-NI code path is available on this processor.
+            */
+            SEAL_NODISCARD static bool using_aes_ni() noexcept;
+
+        private:
+            std::array<std::uint8_t, 11 * block_byte_count> round_keys_;
+
+            nonce_type nonce_;
+
+            bool aes_ni_;
+        };
+    }
+}
@@ -25,7 +25,8 @@ namespace seal
     {
         BaseConverter::BaseConverter(const std::vector<SmallModulus> &coeff_base,
             size_t coeff_count, const SmallModulus &small_plain_mod,
-            MemoryPoolHandle pool) : pool_(move(pool))
+            MemoryPoolHandle pool, shared_ptr<SmallNTTTablesCache> ntt_tables_cache) :
+            pool_(move(pool))
         {
 #ifdef SEAL_DEBUG
             if (!pool)
@@ -33,11 +34,12 @@ namespace seal
                 throw std::invalid_argument("pool is uninitialized");
             }
 #endif
-            generate(coeff_base, coeff_count, small_plain_mod);
+            generate(coeff_base, coeff_count, small_plain_mod, move(ntt_tables_cache));
         }
 
         void BaseConverter::generate(const std::vector<SmallModulus> &coeff_base,
-            size_t coeff_count, const SmallModulus &small_plain_mod)
+            size_t coeff_count, const SmallModulus &small_plain_mod,
+            shared_ptr<SmallNTTTablesCache> ntt_tables_cache)
         {
 #ifdef SEAL_DEBUG
             if (get_power_of_two(coeff_count) < 0)
@@ -131,11 +133,20 @@ namespace seal
             copy_n(aux_base_array_.get(), aux_base_mod_count_, bsk_base_array_.get());
             bsk_base_array_[bsk_base_mod_count_ - 1] = m_sk_;
 
-            // Generate Bsk U {mtilde} small ntt tables which is used in Evaluator
+            // Generate Bsk U {mtilde} small ntt tables which is used in Evaluator.
+            // With a cache the tables are shared with other BaseConverters using
+            // the same Bsk moduli.
+            if (ntt_tables_cache && ntt_tables_cache->coeff_count_power() != coeff_count_power)
+            {
+                throw invalid_argument("ntt_tables_cache does not match coeff_count");
+            }
+            ntt_tables_cache_ = move(ntt_tables_cache);
             bsk_small_ntt_tables_ = allocate<SmallNTTTables>(bsk_base_mod_count_, pool_);
             for (size_t i = 0; i < bsk_base_mod_count_; i++)
             {
-                if (!bsk_small_ntt_tables_[i].generate(coeff_count_power, bsk_base_array_[i]))
+                if (!(ntt_tables_cache_ ?
+                    ntt_tables_cache_->get(bsk_base_array_[i], bsk_small_ntt_tables_[i]) :
+                    bsk_small_ntt_tables_[i].generate(coeff_count_power, bsk_base_array_[i])))
                 {
                     reset();
                     return;
@@ -498,6 +509,7 @@ namespace seal
             neg_inv_coeff_products_all_mod_plain_gamma_array_.release();
             plain_gamma_product_mod_coeff_array_.release();
             bsk_small_ntt_tables_.release();
+            ntt_tables_cache_.reset();
             inv_last_coeff_mod_array_.release();
             inv_coeff_products_mod_mtilde_ = 0;
             m_tilde_ = 0;
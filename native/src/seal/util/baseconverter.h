@@ -29,13 +29,17 @@ namespace seal
 
             BaseConverter(const std::vector<SmallModulus> &coeff_base,
                 std::size_t coeff_count, const SmallModulus &small_plain_mod,
-                MemoryPoolHandle pool);
+                MemoryPoolHandle pool,
+                std::shared_ptr<SmallNTTTablesCache> ntt_tables_cache = nullptr);
 
             /**
-            Generates the pre-computations for the given parameters.
+            Generates the pre-computations for the given parameters. If an NTT
+            tables cache is given, the NTT tables for Bsk refer to tables in the
+            cache instead of being generated separately.
             */
             void generate(const std::vector<SmallModulus> &coeff_base,
-                std::size_t coeff_count, const SmallModulus &small_plain_mod);
+                std::size_t coeff_count, const SmallModulus &small_plain_mod,
+                std::shared_ptr<SmallNTTTablesCache> ntt_tables_cache = nullptr);
 
             void floor_last_coeff_modulus_inplace(
                 std::uint64_t *rns_poly,
@@ -276,6 +280,9 @@ namespace seal
             // Array of small NTT tables for moduli in Bsk
             Pointer<SmallNTTTables> bsk_small_ntt_tables_;
 
+            // Owner of the NTT tables for Bsk, if they refer to a cache
+            std::shared_ptr<SmallNTTTablesCache> ntt_tables_cache_;
+
             // For modulus switching: inverses of the last coeff base modulus
             Pointer<std::uint64_t> inv_last_coeff_mod_array_;
 
@@ -109,6 +109,14 @@ namespace seal
 // Which random number generator factory to use by default
 #define SEAL_DEFAULT_RNG_FACTORY BlakePRNGFactory()
 
+// Which distribution to use for noise sampling: clipped rounded Gaussian by
+// default, or centered binomial
+#ifdef SEAL_USE_CBD_NOISE
+#define SEAL_NOISE_SAMPLER sample_poly_cbd
+#else
+#define SEAL_NOISE_SAMPLER sample_poly_normal
+#endif
+
 // Use generic functions as (slower) fallback
 #ifndef SEAL_ADD_CARRY_UINT64
 #define SEAL_ADD_CARRY_UINT64(operand1, operand2, carry, result) add_uint64_generic(operand1, operand2, carry, result)
@@ -0,0 +1,364 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include "seal/util/galois.h"
+#include "seal/util/common.h"
+#include "seal/util/uintcore.h"
+
+using namespace std;
+
+namespace seal
+{
+    namespace util
+    {
+        namespace
+        {
+            size_t rotation_group_order(size_t coeff_count)
+            {
+                if (coeff_count < 4 || get_power_of_two(
+                    static_cast<uint64_t>(coeff_count)) < 0)
+                {
+                    throw invalid_argument("coeff_count is not valid");
+                }
+                return coeff_count >> 1;
+            }
+
+            // Maps a step count to the corresponding element of the rotation
+            // group, represented as an integer in [0, row_size)
+            size_t rotation_residue(int step, size_t row_size)
+            {
+                size_t pos_step = static_cast<size_t>(
+                    abs(static_cast<long long>(step)));
+                if (pos_step >= row_size)
+                {
+                    throw invalid_argument("step count too large");
+                }
+                return (step < 0 && pos_step) ? row_size - pos_step : pos_step;
+            }
+
+            int rotation_step(size_t residue, size_t row_size)
+            {
+                return residue <= (row_size >> 1) ? safe_cast<int>(residue) :
+                    -safe_cast<int>(row_size - residue);
+            }
+
+            // Breadth-first search from the identity; rotations that cannot be
+            // reached get distance row_size
+            vector<size_t> rotation_distances(
+                const vector<size_t> &keys, size_t row_size)
+            {
+                vector<size_t> dist(row_size, row_size);
+                vector<size_t> queue;
+                queue.reserve(row_size);
+                dist[0] = 0;
+                queue.push_back(0);
+                for (size_t head = 0; head < queue.size(); head++)
+                {
+                    size_t x = queue[head];
+                    for (auto key : keys)
+                    {
+                        size_t y = x + key;
+                        y -= (y >= row_size) ? row_size : 0;
+                        if (dist[y] == row_size)
+                        {
+                            dist[y] = dist[x] + 1;
+                            queue.push_back(y);
+                        }
+                    }
+                }
+                return dist;
+            }
+        }
+
+        vector<int> decompose_rotation(
+            int step, const vector<int> &key_steps, size_t coeff_count)
+        {
+            size_t row_size = rotation_group_order(coeff_count);
+            size_t target = rotation_residue(step, row_size);
+            if (!target)
+            {
+                throw invalid_argument("step cannot be zero");
+            }
+
+            vector<size_t> keys;
+            for (auto key_step : key_steps)
+            {
+                size_t key = rotation_residue(key_step, row_size);
+                if (key && find(keys.begin(), keys.end(), key) == keys.end())
+                {
+                    keys.push_back(key);
+                }
+            }
+
+            // Record for every rotation reached the index of the key that
+            // reached it first; this is a shortest path back to the identity
+            const size_t unreached = numeric_limits<size_t>::max();
+            vector<size_t> via(row_size, unreached);
+            vector<size_t> queue;
+            queue.reserve(row_size);
+            via[0] = keys.size();
+            queue.push_back(0);
+            for (size_t head = 0; head < queue.size() && via[target] == unreached; head++)
+            {
+                size_t x = queue[head];
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    size_t y = x + keys[i];
+                    y -= (y >= row_size) ? row_size : 0;
+                    if (via[y] == unreached)
+                    {
+                        via[y] = i;
+                        queue.push_back(y);
+                    }
+                }
+            }
+
+            vector<int> result;
+            if (via[target] == unreached)
+            {
+                return result;
+            }
+            for (size_t x = target; x; )
+            {
+                size_t key = keys[via[x]];
+                result.push_back(rotation_step(key, row_size));
+                x += (x < key) ? row_size - key : size_t(0) - key;
+            }
+            return result;
+        }
+
+        vector<int> plan_rotation_steps(
+            const map<int, size_t> &step_counts,
+            size_t coeff_count, size_t max_key_count)
+        {
+            size_t row_size = rotation_group_order(coeff_count);
+            if (!max_key_count)
+            {
+                throw invalid_argument("max_key_count cannot be zero");
+            }
+
+            // Merge the counts of steps that are the same rotation
+            vector<int> result;
+            map<size_t, size_t> targets;
+            for (auto &step_count : step_counts)
+            {
+                if (!step_count.second)
+                {
+                    continue;
+                }
+                if (!step_count.first)
+                {
+                    result.push_back(0);
+                    continue;
+                }
+                size_t residue = rotation_residue(step_count.first, row_size);
+                targets[residue] = add_safe(targets[residue], step_count.second);
+            }
+            if (targets.empty())
+            {
+                return result;
+            }
+            if (result.size() >= max_key_count)
+            {
+                throw invalid_argument("max_key_count is too small");
+            }
+            size_t key_budget = max_key_count - result.size();
+
+            set<size_t> candidates;
+            for (auto &target : targets)
+            {
+                candidates.insert(target.first);
+            }
+            for (size_t power = 1; power < row_size; power <<= 1)
+            {
+                candidates.insert(power);
+                candidates.insert(row_size - power);
+            }
+
+            // Cost of a key set is the number of requested rotations it cannot
+            // reach, and then the weighted number of key switches. Adding the
+            // key c to a key set with distances dist, every rotation x is
+            // reached by j uses of c and a shortest path to x - j * c.
+            auto cost_with = [&](const vector<size_t> &dist, size_t c) {
+                pair<size_t, size_t> cost{ 0, 0 };
+                for (auto &target : targets)
+                {
+                    size_t best = dist[target.first];
+                    size_t x = target.first;
+                    for (size_t j = 1; c && j < best; j++)
+                    {
+                        x += (x < c) ? row_size - c : size_t(0) - c;
+                        best = min(best, dist[x] + j);
+                    }
+                    if (best == row_size)
+                    {
+                        cost.first++;
+                    }
+                    else
+                    {
+                        cost.second = add_safe(cost.second,
+                            mul_safe(best, target.second));
+                    }
+                }
+                return cost;
+            };
+
+            vector<size_t> keys;
+            auto dist = rotation_distances(keys, row_size);
+            auto cost = cost_with(dist, 0);
+            while (keys.size() < key_budget)
+            {
+                size_t best_key = 0;
+                auto best_cost = cost;
+                for (auto c : candidates)
+                {
+                    if (find(keys.begin(), keys.end(), c) != keys.end())
+                    {
+                        continue;
+                    }
+                    auto new_cost = cost_with(dist, c);
+                    if (new_cost < best_cost)
+                    {
+                        best_key = c;
+                        best_cost = new_cost;
+                    }
+                }
+                if (!best_key)
+                {
+                    break;
+                }
+                keys.push_back(best_key);
+                dist = rotation_distances(keys, row_size);
+                cost = best_cost;
+            }
+
+            // A greedy choice can be poor in hindsight; replace keys by better
+            // candidates until no single swap lowers the cost
+            for (bool improved = true; improved; )
+            {
+                improved = false;
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    vector<size_t> rest(keys);
+                    rest.erase(rest.begin() + static_cast<ptrdiff_t>(i));
+                    auto rest_dist = rotation_distances(rest, row_size);
+                    for (auto c : candidates)
+                    {
+                        if (find(keys.begin(), keys.end(), c) != keys.end())
+                        {
+                            continue;
+                        }
+                        auto new_cost = cost_with(rest_dist, c);
+                        if (new_cost < cost)
+                        {
+                            keys[i] = c;
+                            cost = new_cost;
+                            improved = true;
+                        }
+                    }
+                }
+            }
+
+            // Keys chosen early may have been made redundant by later ones
+            for (size_t i = keys.size(); i--; )
+            {
+                vector<size_t> rest(keys);
+                rest.erase(rest.begin() + static_cast<ptrdiff_t>(i));
+                if (!(cost < cost_with(rotation_distances(rest, row_size), 0)))
+                {
+                    keys = move(rest);
+                }
+            }
+
+            for (auto key : keys)
+            {
+                result.push_back(rotation_step(key, row_size));
+            }
+            sort(result.begin(), result.end());
+            return result;
+        }
+
+        GaloisTool::GaloisTool(int coeff_count_power, MemoryPoolHandle pool) :
+            coeff_count_power_(coeff_count_power), pool_(move(pool))
+        {
+            if (!pool_)
+            {
+                throw invalid_argument("pool is uninitialized");
+            }
+            if ((coeff_count_power < get_power_of_two(SEAL_POLY_MOD_DEGREE_MIN)) ||
+                coeff_count_power > get_power_of_two(SEAL_POLY_MOD_DEGREE_MAX))
+            {
+                throw invalid_argument("coeff_count_power out of range");
+            }
+        }
+
+        const uint32_t *GaloisTool::permutation(uint64_t galois_elt) const
+        {
+            return get_table(galois_elt, false);
+        }
+
+        const uint32_t *GaloisTool::ntt_permutation(uint64_t galois_elt) const
+        {
+            return get_table(galois_elt, true);
+        }
+
+        const uint32_t *GaloisTool::get_table(uint64_t galois_elt, bool ntt_form) const
+        {
+            size_t coeff_count = size_t(1) << coeff_count_power_;
+            uint64_t m_minus_one = 2 * static_cast<uint64_t>(coeff_count) - 1;
+            if (!(galois_elt & 1) || galois_elt > m_minus_one)
+            {
+                throw invalid_argument("Galois element is not valid");
+            }
+
+            auto &tables = ntt_form ? ntt_tables_ : tables_;
+            {
+                ReaderLock lock(tables_locker_.acquire_read());
+                auto it = tables.find(galois_elt);
+                if (it != tables.end())
+                {
+                    return it->second.get();
+                }
+            }
+
+            WriterLock lock(tables_locker_.acquire_write());
+            auto &table = tables[galois_elt];
+            if (table)
+            {
+                return table.get();
+            }
+            auto new_table(allocate<uint32_t>(coeff_count, pool_));
+            if (ntt_form)
+            {
+                // In NTT form the automorphism permutes the evaluation points,
+                // which are stored in bit-reversed order
+                for (size_t i = 0; i < coeff_count; i++)
+                {
+                    uint64_t reversed = reverse_bits(i, coeff_count_power_);
+                    uint64_t index_raw = (galois_elt * (2 * reversed + 1)) & m_minus_one;
+                    new_table[i] = static_cast<uint32_t>(
+                        reverse_bits((index_raw - 1) >> 1, coeff_count_power_));
+                }
+            }
+            else
+            {
+                // X^i maps to X^(i * galois_elt), which is negated when the
+                // exponent reduced modulo 2 * coeff_count is at least coeff_count
+                for (size_t i = 0; i < coeff_count; i++)
+                {
+                    uint64_t index_raw = (i * galois_elt) & m_minus_one;
+                    new_table[index_raw & (coeff_count - 1)] = static_cast<uint32_t>(i) |
+                        (static_cast<uint32_t>(index_raw >> coeff_count_power_) << 31);
+                }
+            }
+            table = move(new_table);
+            return table.get();
+        }
+    }
+}
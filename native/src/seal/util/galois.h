@@ -0,0 +1,131 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "seal/memorymanager.h"
+#include "seal/smallmodulus.h"
+#include "seal/util/defines.h"
+#include "seal/util/locks.h"
+#include "seal/util/pointer.h"
+
+namespace seal
+{
+    namespace util
+    {
+        // Row rotations form a cyclic group of order coeff_count / 2. A set of
+        // Galois keys for rotations by key_steps generates every rotation that
+        // can be written as a sum of key steps (modulo coeff_count / 2), and
+        // each term of the sum costs one key switch.
+
+        // Returns the shortest sequence of rotations by elements of key_steps
+        // that composes to a rotation by step, or an empty vector if there is
+        // none. The step must be non-zero and less than coeff_count / 2 in
+        // absolute value.
+        SEAL_NODISCARD std::vector<int> decompose_rotation(
+            int step, const std::vector<int> &key_steps, std::size_t coeff_count);
+
+        // Chooses at most max_key_count rotation steps for which to generate
+        // Galois keys so that the rotations in step_counts, each weighted by
+        // its count, take as few key switches in total as possible. The choice
+        // is greedy, then refined by swapping keys for other candidates:
+        // candidates are the requested steps and the power-of-two steps in
+        // both directions, and keys that stop paying for themselves are
+        // dropped at the end. A step of zero (column rotation in BFV,
+        // complex conjugation in CKKS) cannot be composed from other keys and
+        // is always returned as is.
+        SEAL_NODISCARD std::vector<int> plan_rotation_steps(
+            const std::map<int, std::size_t> &step_counts,
+            std::size_t coeff_count, std::size_t max_key_count);
+
+        /**
+        Caches the permutations by which Galois automorphisms act on polynomials,
+        so that they are computed only once for each Galois element. A
+        permutation is a table of coeff_count entries giving for each position of
+        the result the position of the input coefficient that moves there. In
+        coefficient form the coefficient is also negated if the top bit of the
+        entry is set; in NTT form it never is. Tables are created on first use
+        and are never freed. This class is thread-safe.
+        */
+        class GaloisTool
+        {
+        public:
+            GaloisTool(int coeff_count_power,
+                MemoryPoolHandle pool = MemoryManager::GetPool());
+
+            /**
+            Returns the permutation for polynomials in coefficient form.
+
+            @throws std::invalid_argument if galois_elt is not valid
+            */
+            SEAL_NODISCARD const std::uint32_t *permutation(
+                std::uint64_t galois_elt) const;
+
+            /**
+            Returns the permutation for polynomials in NTT form.
+
+            @throws std::invalid_argument if galois_elt is not valid
+            */
+            SEAL_NODISCARD const std::uint32_t *ntt_permutation(
+                std::uint64_t galois_elt) const;
+
+            SEAL_NODISCARD inline int coeff_count_power() const noexcept
+            {
+                return coeff_count_power_;
+            }
+
+        private:
+            GaloisTool(const GaloisTool &copy) = delete;
+
+            GaloisTool &operator =(const GaloisTool &assign) = delete;
+
+            const std::uint32_t *get_table(
+                std::uint64_t galois_elt, bool ntt_form) const;
+
+            int coeff_count_power_;
+
+            MemoryPoolHandle pool_;
+
+            mutable ReaderWriterLocker tables_locker_;
+
+            mutable std::unordered_map<std::uint64_t, Pointer<std::uint32_t>> tables_;
+
+            mutable std::unordered_map<std::uint64_t, Pointer<std::uint32_t>> ntt_tables_;
+        };
+
+        // Sets result[i] = operand[permutation[i]], negated modulo modulus if
+        // the top bit of permutation[i] is set; result cannot alias operand
+        inline void apply_permutation(const std::uint64_t *operand,
+            const std::uint32_t *permutation, std::size_t coeff_count,
+            const SmallModulus &modulus, std::uint64_t *result)
+        {
+            const std::uint32_t negate_bit = std::uint32_t(1) << 31;
+            const std::uint64_t modulus_value = modulus.value();
+            for (std::size_t i = 0; i < coeff_count; i++)
+            {
+                std::uint32_t entry = permutation[i];
+                std::uint64_t value = operand[entry & (negate_bit - 1)];
+                std::uint64_t negate_mask = static_cast<std::uint64_t>(
+                    -static_cast<std::int64_t>((entry >> 31) & (value != 0)));
+                result[i] = value ^ ((value ^ (modulus_value - value)) & negate_mask);
+            }
+        }
+
+        // Sets result[i] = operand[permutation[i]] for a permutation in NTT
+        // form; result cannot alias operand
+        inline void apply_permutation_ntt(const std::uint64_t *operand,
+            const std::uint32_t *permutation, std::size_t coeff_count,
+            std::uint64_t *result)
+        {
+            for (std::size_t i = 0; i < coeff_count; i++)
+            {
+                result[i] = operand[permutation[i]];
+            }
+        }
+    }
+}
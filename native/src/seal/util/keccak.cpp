@@ -0,0 +1,169 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <stdexcept>
+#include <algorithm>
+#include "seal/util/keccak.h"
+
+using namespace std;
+
+namespace seal
+{
+    namespace util
+    {
+        namespace
+        {
+            constexpr uint64_t keccak_round_constants[24]{
+                0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL,
+                0x8000000080008000ULL, 0x000000000000808BULL, 0x0000000080000001ULL,
+                0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008AULL,
+                0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
+                0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL,
+                0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+                0x000000000000800AULL, 0x800000008000000AULL, 0x8000000080008081ULL,
+                0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+            };
+
+            // Rotation offsets and lane permutation for the combined rho and pi steps
+            constexpr unsigned keccak_rho[24]{
+                1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14,
+                27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44
+            };
+
+            constexpr size_t keccak_pi[24]{
+                10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4,
+                15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1
+            };
+
+            inline uint64_t rotl64(uint64_t value, unsigned shift) noexcept
+            {
+                return (value << shift) | (value >> (64 - shift));
+            }
+        }
+
+        void keccak_f1600(array<uint64_t, 25> &state) noexcept
+        {
+            uint64_t c[5];
+            for (size_t round = 0; round < 24; round++)
+            {
+                // Theta
+                for (size_t x = 0; x < 5; x++)
+                {
+                    c[x] = state[x] ^ state[x + 5] ^ state[x + 10] ^
+                        state[x + 15] ^ state[x + 20];
+                }
+                for (size_t x = 0; x < 5; x++)
+                {
+                    uint64_t d = c[(x + 4) % 5] ^ rotl64(c[(x + 1) % 5], 1);
+                    for (size_t y = 0; y < 25; y += 5)
+                    {
+                        state[y + x] ^= d;
+                    }
+                }
+
+                // Rho and pi
+                uint64_t current = state[1];
+                for (size_t i = 0; i < 24; i++)
+                {
+                    size_t j = keccak_pi[i];
+                    uint64_t temp = state[j];
+                    state[j] = rotl64(current, keccak_rho[i]);
+                    current = temp;
+                }
+
+                // Chi
+                for (size_t y = 0; y < 25; y += 5)
+                {
+                    for (size_t x = 0; x < 5; x++)
+                    {
+                        c[x] = state[y + x];
+                    }
+                    for (size_t x = 0; x < 5; x++)
+                    {
+                        state[y + x] = c[x] ^ (~c[(x + 1) % 5] & c[(x + 2) % 5]);
+                    }
+                }
+
+                // Iota
+                state[0] ^= keccak_round_constants[round];
+            }
+        }
+
+        void Shake128::absorb(const SEAL_BYTE *input, size_t byte_count)
+        {
+            if (squeezing_)
+            {
+                throw logic_error("cannot absorb after squeezing");
+            }
+            if (!input && byte_count)
+            {
+                throw invalid_argument("input cannot be null");
+            }
+            for (size_t i = 0; i < byte_count; i++)
+            {
+                xor_byte(position_++, static_cast<uint8_t>(input[i]));
+                if (position_ == rate_byte_count)
+                {
+                    keccak_f1600(state_);
+                    position_ = 0;
+                }
+            }
+        }
+
+        void Shake128::squeeze(SEAL_BYTE *output, size_t byte_count)
+        {
+            if (!output && byte_count)
+            {
+                throw invalid_argument("output cannot be null");
+            }
+            if (!squeezing_)
+            {
+                finalize();
+            }
+            while (byte_count)
+            {
+                if (position_ == rate_byte_count)
+                {
+                    keccak_f1600(state_);
+                    position_ = 0;
+                }
+
+                // Copy whole lanes when aligned; this is the common case
+                if (!(position_ & 7) && byte_count >= 8)
+                {
+                    size_t lane_count = min(byte_count, rate_byte_count - position_) >> 3;
+                    for (size_t i = 0; i < lane_count; i++)
+                    {
+                        uint64_t lane = state_[(position_ >> 3) + i];
+                        for (size_t k = 0; k < 8; k++)
+                        {
+                            *output++ = static_cast<SEAL_BYTE>(lane >> (8 * k));
+                        }
+                    }
+                    position_ += lane_count << 3;
+                    byte_count -= lane_count << 3;
+                    continue;
+                }
+                *output++ = static_cast<SEAL_BYTE>(get_byte(position_++));
+                byte_count--;
+            }
+        }
+
+        void Shake128::reset() noexcept
+        {
+            state_.fill(0);
+            position_ = 0;
+            squeezing_ = false;
+        }
+
+        void Shake128::finalize() noexcept
+        {
+            // SHAKE domain separation and pad10*1
+            xor_byte(position_, 0x1F);
+            xor_byte(rate_byte_count - 1, 0x80);
+            keccak_f1600(state_);
+            position_ = 0;
+            squeezing_ = true;
+        }
+    }
+}
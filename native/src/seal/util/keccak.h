@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "seal/util/defines.h"
+
+namespace seal
+{
+    namespace util
+    {
+        /**
+        Applies the Keccak-f[1600] permutation to the given state.
+        */
+        void keccak_f1600(std::array<std::uint64_t, 25> &state) noexcept;
+
+        /**
+        Implements the SHAKE-128 extendable-output function from FIPS 202. Input is
+        absorbed with absorb, after which arbitrarily many output bytes can be read
+        with squeeze. Absorbing after the first call to squeeze is not allowed.
+        */
+        class Shake128
+        {
+        public:
+            static constexpr std::size_t rate_byte_count = 168;
+
+            Shake128() = default;
+
+            void absorb(const SEAL_BYTE *input, std::size_t byte_count);
+
+            void squeeze(SEAL_BYTE *output, std::size_t byte_count);
+
+            /**
+            Clears the state and any buffered bytes.
+            */
+            void reset() noexcept;
+
+        private:
+            void finalize() noexcept;
+
+            void xor_byte(std::size_t index, std::uint8_t value) noexcept
+            {
+                state_[index >> 3] ^= static_cast<std::uint64_t>(value) << (8 * (index & 7));
+            }
+
+            SEAL_NODISCARD std::uint8_t get_byte(std::size_t index) const noexcept
+            {
+                return static_cast<std::uint8_t>(state_[index >> 3] >> (8 * (index & 7)));
+            }
+
+            std::array<std::uint64_t, 25> state_{};
+
+            std::size_t position_ = 0;
+
+            bool squeezing_ = false;
+        };
+    }
+}
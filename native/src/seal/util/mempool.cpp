@@ -6,9 +6,16 @@
 #include <numeric>
 #include <stdexcept>
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <vector>
 #include "seal/util/mempool.h"
 #include "seal/util/common.h"
 #include "seal/util/uintarith.h"
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 using namespace std;
 
@@ -16,16 +23,260 @@ namespace seal
 {
     namespace util
     {
+        namespace
+        {
+            // Allocates a batch of byte_count bytes aligned to
+            // MemoryPool::alloc_alignment. Large batches are backed by huge
+            // pages if requested and supported.
+            void allocate_batch(MemoryPoolHead::allocation &alloc,
+                size_t byte_count, bool huge_pages)
+            {
+#if defined(__linux__)
+                if (huge_pages && byte_count >= MemoryPool::huge_page_byte_count)
+                {
+                    const size_t page_byte_count = MemoryPool::huge_page_byte_count;
+                    size_t map_byte_count = add_safe(byte_count, page_byte_count - 1) &
+                        ~(page_byte_count - 1);
+                    void *ptr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+                    // Explicitly reserved huge pages are used when available
+                    ptr = mmap(nullptr, map_byte_count, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+                    if (ptr == MAP_FAILED)
+                    {
+                        // Otherwise map a huge-page-aligned range and ask for
+                        // transparent huge pages
+                        size_t over_byte_count = add_safe(map_byte_count, page_byte_count);
+                        void *over_ptr = mmap(nullptr, over_byte_count, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                        if (over_ptr != MAP_FAILED)
+                        {
+                            auto over_addr = reinterpret_cast<uintptr_t>(over_ptr);
+                            auto addr = (over_addr + page_byte_count - 1) &
+                                ~static_cast<uintptr_t>(page_byte_count - 1);
+                            size_t head_byte_count = static_cast<size_t>(addr - over_addr);
+                            if (head_byte_count)
+                            {
+                                munmap(over_ptr, head_byte_count);
+                            }
+                            size_t tail_byte_count = over_byte_count - head_byte_count - map_byte_count;
+                            if (tail_byte_count)
+                            {
+                                munmap(reinterpret_cast<void*>(addr + map_byte_count),
+                                    tail_byte_count);
+                            }
+                            ptr = reinterpret_cast<void*>(addr);
+#ifdef MADV_HUGEPAGE
+                            madvise(ptr, map_byte_count, MADV_HUGEPAGE);
+#endif
+                        }
+                    }
+                    if (ptr != MAP_FAILED)
+                    {
+                        alloc.raw_ptr = static_cast<SEAL_BYTE*>(ptr);
+                        alloc.data_ptr = alloc.raw_ptr;
+                        alloc.mapped_byte_count = map_byte_count;
+                        return;
+                    }
+
+                    // Fall back to a regular allocation
+                }
+#else
+                (void)huge_pages;
+#endif
+                // Over-allocate so that the start can be aligned
+                const size_t alignment = MemoryPool::alloc_alignment;
+                alloc.raw_ptr = new SEAL_BYTE[add_safe(byte_count, alignment - 1)];
+                auto addr = (reinterpret_cast<uintptr_t>(alloc.raw_ptr) + alignment - 1) &
+                    ~static_cast<uintptr_t>(alignment - 1);
+                alloc.data_ptr = reinterpret_cast<SEAL_BYTE*>(addr);
+                alloc.mapped_byte_count = 0;
+            }
+
+            // Frees a batch, clearing it first if requested
+            void free_batch(MemoryPoolHead::allocation &alloc,
+                size_t item_stride, bool clear_on_destruction) noexcept
+            {
+                if (clear_on_destruction)
+                {
+                    // The product was checked with mul_safe when the batch was
+                    // allocated, so it cannot overflow here
+                    size_t curr_alloc_byte_count = item_stride * alloc.size;
+                    volatile SEAL_BYTE *data_ptr = alloc.data_ptr;
+                    while (curr_alloc_byte_count--)
+                    {
+                        *data_ptr++ = static_cast<SEAL_BYTE>(0);
+                    }
+                }
+#if defined(__linux__)
+                if (alloc.mapped_byte_count)
+                {
+                    munmap(alloc.raw_ptr, alloc.mapped_byte_count);
+                    alloc.raw_ptr = nullptr;
+                    alloc.data_ptr = nullptr;
+                    return;
+                }
+#endif
+                delete[] alloc.raw_ptr;
+                alloc.raw_ptr = nullptr;
+                alloc.data_ptr = nullptr;
+            }
+
+            // Acquires a spin lock, adding any time spent waiting to wait_ns
+            void acquire_timed(atomic<bool> &flag, atomic<uint64_t> &wait_ns) noexcept
+            {
+                bool expected = false;
+                if (flag.compare_exchange_strong(expected, true, memory_order_acquire))
+                {
+                    return;
+                }
+
+                // Only contended acquisitions are timed
+                auto start = chrono::steady_clock::now();
+                do
+                {
+                    expected = false;
+                } while (!flag.compare_exchange_weak(expected, true, memory_order_acquire));
+                auto wait_time = chrono::duration_cast<chrono::nanoseconds>(
+                    chrono::steady_clock::now() - start);
+                wait_ns.fetch_add(static_cast<uint64_t>(wait_time.count()), memory_order_relaxed);
+            }
+
+            // Raises peak to at least value
+            void update_peak(atomic<size_t> &peak, size_t value) noexcept
+            {
+                size_t old_peak = peak.load(memory_order_relaxed);
+                while (old_peak < value &&
+                    !peak.compare_exchange_weak(old_peak, value, memory_order_relaxed))
+                {
+                }
+            }
+
+            // Holds a spin lock on an atomic flag for the lifetime of the object
+            class SpinLockGuard
+            {
+            public:
+                SpinLockGuard(atomic<bool> &flag) noexcept : flag_(flag)
+                {
+                    bool expected = false;
+                    while (!flag_.compare_exchange_weak(
+                        expected, true, memory_order_acquire))
+                    {
+                        expected = false;
+                    }
+                }
+
+                ~SpinLockGuard() noexcept
+                {
+                    flag_.store(false, memory_order_release);
+                }
+
+            private:
+                SpinLockGuard(const SpinLockGuard &copy) = delete;
+
+                SpinLockGuard &operator =(const SpinLockGuard &assign) = delete;
+
+                atomic<bool> &flag_;
+            };
+
+            // Releases allocations in which every item is free, newest first,
+            // until at least byte_count bytes have been released. Released free
+            // items are deleted and set to null in free_items.
+            size_t release_unused_allocs(
+                vector<MemoryPoolHead::allocation> &allocs,
+                vector<MemoryPoolItem*> &free_items,
+                size_t item_byte_count,
+                size_t item_stride,
+                bool clear_on_destruction,
+                size_t byte_count)
+            {
+                if (!byte_count || allocs.empty())
+                {
+                    return 0;
+                }
+
+                // Allocation indices sorted by address, for finding the
+                // allocation that owns each free item
+                vector<size_t> by_address(allocs.size());
+                iota(by_address.begin(), by_address.end(), size_t(0));
+                sort(by_address.begin(), by_address.end(), [&](size_t a, size_t b) {
+                    return less<SEAL_BYTE*>()(allocs[a].data_ptr, allocs[b].data_ptr);
+                });
+
+                // Items never handed out also count as free
+                vector<size_t> free_counts(allocs.size());
+                for (size_t i = 0; i < allocs.size(); i++)
+                {
+                    free_counts[i] = allocs[i].free;
+                }
+                vector<size_t> owners(free_items.size());
+                for (size_t i = 0; i < free_items.size(); i++)
+                {
+                    auto it = upper_bound(by_address.begin(), by_address.end(),
+                        free_items[i]->data(), [&](SEAL_BYTE *ptr, size_t index) {
+                            return less<SEAL_BYTE*>()(ptr, allocs[index].data_ptr);
+                        });
+                    owners[i] = *(it - 1);
+                    free_counts[owners[i]]++;
+                }
+
+                // Newer allocations are larger, so try those first
+                vector<bool> released(allocs.size(), false);
+                size_t released_byte_count = 0;
+                for (size_t i = allocs.size(); i-- && released_byte_count < byte_count; )
+                {
+                    if (free_counts[i] == allocs[i].size)
+                    {
+                        released[i] = true;
+                        released_byte_count = add_safe(released_byte_count,
+                            mul_safe(allocs[i].size, item_byte_count));
+                    }
+                }
+                if (!released_byte_count)
+                {
+                    return 0;
+                }
+
+                // Nothing below allocates, so an exception above leaves
+                // everything unchanged
+                vector<MemoryPoolHead::allocation> kept_allocs;
+                kept_allocs.reserve(allocs.size());
+                for (size_t i = 0; i < free_items.size(); i++)
+                {
+                    if (released[owners[i]])
+                    {
+                        delete free_items[i];
+                        free_items[i] = nullptr;
+                    }
+                }
+                for (size_t i = 0; i < allocs.size(); i++)
+                {
+                    if (!released[i])
+                    {
+                        kept_allocs.push_back(allocs[i]);
+                        continue;
+                    }
+                    free_batch(allocs[i], item_stride, clear_on_destruction);
+                }
+                allocs.swap(kept_allocs);
+
+                return released_byte_count;
+            }
+        }
+
         MemoryPoolHeadMT::MemoryPoolHeadMT(size_t item_byte_count,
-            bool clear_on_destruction) :
+            bool clear_on_destruction, bool huge_pages) :
             clear_on_destruction_(clear_on_destruction),
+            huge_pages_(huge_pages),
             locked_(false), item_byte_count_(item_byte_count),
+            item_stride_(MemoryPool::item_stride(item_byte_count)),
             item_count_(MemoryPool::first_alloc_count),
-            first_item_(nullptr)
+            stripes_()
         {
             if ((item_byte_count_ == 0) ||
                 (item_byte_count_ > MemoryPool::max_batch_alloc_byte_count) ||
-                (mul_safe(item_byte_count_, MemoryPool::first_alloc_count) >
+                (mul_safe(item_stride_, MemoryPool::first_alloc_count) >
                     MemoryPool::max_batch_alloc_byte_count))
             {
                 throw invalid_argument("invalid allocation size");
@@ -33,16 +284,8 @@ namespace seal
 
             // Initial allocation
             allocation new_alloc;
-            try
-            {
-                new_alloc.data_ptr = new SEAL_BYTE[
-                    mul_safe(MemoryPool::first_alloc_count, item_byte_count_)];
-            }
-            catch (const bad_alloc &)
-            {
-                // Allocation failed; rethrow
-                throw;
-            }
+            allocate_batch(new_alloc,
+                mul_safe(MemoryPool::first_alloc_count, item_stride_), huge_pages_);
 
             new_alloc.size = MemoryPool::first_alloc_count;
             new_alloc.free = MemoryPool::first_alloc_count;
@@ -61,123 +304,309 @@ namespace seal
             }
 
             // Delete the items (but not the memory)
-            MemoryPoolItem *curr_item = first_item_;
-            while (curr_item)
+            for (auto &curr_stripe : stripes_)
             {
-                MemoryPoolItem *next_item = curr_item->next();
-                delete curr_item;
-                curr_item = next_item;
+                MemoryPoolItem *curr_item = curr_stripe.first_item.load(memory_order_acquire);
+                while (curr_item)
+                {
+                    MemoryPoolItem *next_item = curr_item->next();
+                    delete curr_item;
+                    curr_item = next_item;
+                }
+                curr_stripe.first_item.store(nullptr, memory_order_relaxed);
             }
-            first_item_ = nullptr;
 
-            // Do we need to clear the memory?
-            if (clear_on_destruction_)
+            // Delete the memory, clearing it first if needed
+            for (auto &alloc : allocs_)
             {
-                // Delete the memory
-                for (auto &alloc : allocs_)
-                {
-                    size_t curr_alloc_byte_count = mul_safe(item_byte_count_, alloc.size);
-                    volatile SEAL_BYTE *data_ptr = reinterpret_cast<SEAL_BYTE*>(alloc.data_ptr);
-                    while (curr_alloc_byte_count--)
-                    {
-                        *data_ptr++ = static_cast<SEAL_BYTE>(0);
-                    }
+                free_batch(alloc, item_stride_, clear_on_destruction_);
+            }
 
-                    // Delete this allocation
-                    delete[] alloc.data_ptr;
-                }
+            allocs_.clear();
+        }
+
+        size_t MemoryPoolHeadMT::this_thread_stripe() noexcept
+        {
+            // Threads are assigned stripes round-robin on first use
+            static atomic<size_t> next_stripe{ 0 };
+            thread_local size_t stripe_index =
+                next_stripe.fetch_add(1, memory_order_relaxed) % stripe_count;
+            return stripe_index;
+        }
+
+        MemoryPoolItem *MemoryPoolHeadMT::try_pop(stripe &from, bool wait) noexcept
+        {
+            // Cheap check before taking the pop lock
+            if (!from.first_item.load(memory_order_relaxed))
+            {
+                return nullptr;
+            }
+
+            if (wait)
+            {
+                acquire_timed(from.pop_locked, lock_wait_ns_);
             }
             else
             {
-                // Delete the memory
-                for (auto &alloc : allocs_)
+                bool expected = false;
+                if (!from.pop_locked.compare_exchange_strong(
+                    expected, true, memory_order_acquire))
                 {
-                    // Delete this allocation
-                    delete[] alloc.data_ptr;
+                    return nullptr;
                 }
             }
 
-            allocs_.clear();
+            // Only the lock holder pops, so old_first cannot be removed and
+            // pushed back while we read its next pointer
+            MemoryPoolItem *old_first = from.first_item.load(memory_order_acquire);
+            while (old_first && !from.first_item.compare_exchange_weak(
+                old_first, old_first->next(), memory_order_acquire, memory_order_acquire))
+            {
+            }
+            from.pop_locked.store(false, memory_order_release);
+
+            if (old_first)
+            {
+                old_first->next() = nullptr;
+            }
+            return old_first;
         }
 
         MemoryPoolItem *MemoryPoolHeadMT::get()
         {
+            // First look in the calling thread's own free list, then try the
+            // others without waiting for them
+            size_t own_stripe = this_thread_stripe();
+            stripes_[own_stripe].in_use_delta.fetch_add(1, memory_order_relaxed);
+            MemoryPoolItem *item = try_pop(stripes_[own_stripe], true);
+            for (size_t i = 1; !item && i < stripe_count; i++)
+            {
+                item = try_pop(stripes_[(own_stripe + i) % stripe_count], false);
+            }
+
+            // Free items in lists that were busy must be used before allocating,
+            // or memory would grow with contention rather than with use; only
+            // non-empty lists are waited for
+            for (size_t i = 1; !item && i < stripe_count; i++)
+            {
+                item = try_pop(stripes_[(own_stripe + i) % stripe_count], true);
+            }
+            if (item)
+            {
+                stripes_[own_stripe].hit_count.fetch_add(1, memory_order_relaxed);
+                update_peak(peak_in_use_count_, in_use_count());
+#ifdef SEAL_USE_ALLOCATION_TRACING
+                trace_allocation(item_byte_count_, 0);
+#endif
+                return item;
+            }
+
+            acquire_timed(locked_, lock_wait_ns_);
+
+            // All free lists were seen empty
+            MemoryPoolItem *new_item = nullptr;
+            size_t new_byte_count = 0;
+            if (!allocs_.empty() && allocs_.back().free > 0)
+            {
+                // Pool is empty; there is memory
+                allocation &last_alloc = allocs_.back();
+                new_item = new MemoryPoolItem(last_alloc.head_ptr);
+                last_alloc.free--;
+                last_alloc.head_ptr += item_stride_;
+            }
+            else
+            {
+                // Pool is empty; there is no memory
+                allocation new_alloc;
+
+                // Increase allocation size unless we are already at max; if all
+                // allocations were trimmed, start over from the first size
+                size_t last_size = allocs_.empty() ?
+                    MemoryPool::first_alloc_count : allocs_.back().size;
+                size_t new_size = allocs_.empty() ? last_size : safe_cast<size_t>(
+                    ceil(MemoryPool::alloc_size_multiplier *
+                        static_cast<double>(last_size)));
+                size_t new_alloc_byte_count = mul_safe(new_size, item_stride_);
+                if (new_alloc_byte_count >
+                    MemoryPool::max_batch_alloc_byte_count)
+                {
+                    new_size = last_size;
+                    new_alloc_byte_count = new_size * item_stride_;
+                }
+
+                try
+                {
+                    allocate_batch(new_alloc, new_alloc_byte_count, huge_pages_);
+                }
+                catch (const bad_alloc &)
+                {
+                    // Allocation failed; release the lock and rethrow
+                    locked_.store(false, memory_order_release);
+                    stripes_[own_stripe].in_use_delta.fetch_sub(1, memory_order_relaxed);
+                    throw;
+                }
+
+                new_alloc.size = new_size;
+                new_alloc.free = new_size - 1;
+                new_alloc.head_ptr = new_alloc.data_ptr + item_stride_;
+                allocs_.push_back(new_alloc);
+                item_count_ += new_size;
+                new_item = new MemoryPoolItem(new_alloc.data_ptr);
+                new_byte_count = new_alloc_byte_count;
+            }
+
+            miss_count_.fetch_add(1, memory_order_relaxed);
+            update_peak(peak_in_use_count_, in_use_count());
+            locked_.store(false, memory_order_release);
+#ifdef SEAL_USE_ALLOCATION_TRACING
+            trace_allocation(item_byte_count_, new_byte_count);
+#else
+            (void)new_byte_count;
+#endif
+            return new_item;
+        }
+
+        MemoryPoolHead::statistics MemoryPoolHeadMT::stats() const noexcept
+        {
+            statistics result;
+            result.item_byte_count = item_byte_count_;
+            result.item_count = item_count_;
+            result.in_use_count = in_use_count();
+            result.peak_in_use_count = peak_in_use_count_.load(memory_order_relaxed);
+            for (auto &curr_stripe : stripes_)
+            {
+                result.hit_count += curr_stripe.hit_count.load(memory_order_relaxed);
+            }
+            result.miss_count = miss_count_.load(memory_order_relaxed);
+            result.lock_wait_time = chrono::nanoseconds(
+                lock_wait_ns_.load(memory_order_relaxed));
+            return result;
+        }
+
+        size_t MemoryPoolHeadMT::in_use_count() const noexcept
+        {
+            ptrdiff_t count = 0;
+            for (auto &curr_stripe : stripes_)
+            {
+                count += curr_stripe.in_use_delta.load(memory_order_relaxed);
+            }
+
+            // The sum can be transiently negative while other threads move
+            // items between stripes
+            return count > 0 ? static_cast<size_t>(count) : 0;
+        }
+
+        size_t MemoryPoolHeadMT::trim(size_t byte_count)
+        {
+            if (!byte_count)
+            {
+                return 0;
+            }
+
+            // Lock out allocation and all poppers; pushers may still add items
+            // while we work, and those simply stay in their free lists
             bool expected = false;
             while (!locked_.compare_exchange_strong(
                 expected, true, memory_order_acquire))
             {
                 expected = false;
             }
-            MemoryPoolItem *old_first = first_item_;
-
-            // Is pool empty?
-            if (old_first == nullptr)
+            for (auto &curr_stripe : stripes_)
             {
-                allocation &last_alloc = allocs_.back();
-                MemoryPoolItem *new_item = nullptr;
-                if (last_alloc.free > 0)
+                expected = false;
+                while (!curr_stripe.pop_locked.compare_exchange_strong(
+                    expected, true, memory_order_acquire))
                 {
-                    // Pool is empty; there is memory
-                    new_item = new MemoryPoolItem(last_alloc.head_ptr);
-                    last_alloc.free--;
-                    last_alloc.head_ptr += item_byte_count_;
+                    expected = false;
                 }
-                else
+            }
+
+            // Take all free lists; the links stay intact until items are
+            // released, so they can be put back as they are on failure
+            MemoryPoolItem *chains[stripe_count];
+            for (size_t s = 0; s < stripe_count; s++)
+            {
+                chains[s] = stripes_[s].first_item.exchange(nullptr, memory_order_acquire);
+            }
+
+            auto push_item = [](stripe &to, MemoryPoolItem *item) {
+                MemoryPoolItem *old_first = to.first_item.load(memory_order_relaxed);
+                do
                 {
-                    // Pool is empty; there is no memory
-                    allocation new_alloc;
+                    item->next() = old_first;
+                } while (!to.first_item.compare_exchange_weak(old_first, item,
+                    memory_order_release, memory_order_relaxed));
+            };
 
-                    // Increase allocation size unless we are already at max
-                    size_t new_size = safe_cast<size_t>(
-                        ceil(MemoryPool::alloc_size_multiplier *
-                            static_cast<double>(last_alloc.size)));
-                    size_t new_alloc_byte_count = mul_safe(new_size, item_byte_count_);
-                    if (new_alloc_byte_count >
-                        MemoryPool::max_batch_alloc_byte_count)
+            vector<MemoryPoolItem*> free_items;
+            size_t stripe_ends[stripe_count];
+            size_t released_byte_count = 0;
+            bool failed = false;
+            try
+            {
+                for (size_t s = 0; s < stripe_count; s++)
+                {
+                    for (MemoryPoolItem *curr_item = chains[s]; curr_item;
+                        curr_item = curr_item->next())
                     {
-                        new_size = last_alloc.size;
-                        new_alloc_byte_count = new_size * item_byte_count_;
+                        free_items.push_back(curr_item);
                     }
+                    stripe_ends[s] = free_items.size();
+                }
 
-                    try
+                released_byte_count = release_unused_allocs(allocs_, free_items,
+                    item_byte_count_, item_stride_, clear_on_destruction_, byte_count);
+                item_count_ -= released_byte_count / item_byte_count_;
+            }
+            catch (...)
+            {
+                failed = true;
+            }
+
+            // Return the remaining items to the stripes they came from
+            size_t begin = 0;
+            for (size_t s = 0; s < stripe_count; s++)
+            {
+                if (failed)
+                {
+                    MemoryPoolItem *curr_item = chains[s];
+                    while (curr_item)
                     {
-                        new_alloc.data_ptr = new SEAL_BYTE[new_alloc_byte_count];
+                        MemoryPoolItem *next_item = curr_item->next();
+                        push_item(stripes_[s], curr_item);
+                        curr_item = next_item;
                     }
-                    catch (const bad_alloc &)
+                }
+                else
+                {
+                    for (size_t i = begin; i < stripe_ends[s]; i++)
                     {
-                        // Allocation failed; rethrow
-                        throw;
+                        if (free_items[i])
+                        {
+                            push_item(stripes_[s], free_items[i]);
+                        }
                     }
-
-                    new_alloc.size = new_size;
-                    new_alloc.free = new_size - 1;
-                    new_alloc.head_ptr = new_alloc.data_ptr + item_byte_count_;
-                    allocs_.push_back(new_alloc);
-                    item_count_ += new_size;
-                    new_item = new MemoryPoolItem(new_alloc.data_ptr);
+                    begin = stripe_ends[s];
                 }
-
-                locked_.store(false, memory_order_release);
-                return new_item;
+                stripes_[s].pop_locked.store(false, memory_order_release);
             }
-
-            // Pool is not empty
-            first_item_ = old_first->next();
-            old_first->next() = nullptr;
             locked_.store(false, memory_order_release);
-            return old_first;
+
+            return released_byte_count;
         }
 
         MemoryPoolHeadST::MemoryPoolHeadST(size_t item_byte_count,
-            bool clear_on_destruction) :
+            bool clear_on_destruction, bool huge_pages) :
             clear_on_destruction_(clear_on_destruction),
+            huge_pages_(huge_pages),
             item_byte_count_(item_byte_count),
+            item_stride_(MemoryPool::item_stride(item_byte_count)),
             item_count_(MemoryPool::first_alloc_count),
             first_item_(nullptr)
         {
             if ((item_byte_count_ == 0) ||
                 (item_byte_count_ > MemoryPool::max_batch_alloc_byte_count) ||
-                (mul_safe(item_byte_count_, MemoryPool::first_alloc_count) >
+                (mul_safe(item_stride_, MemoryPool::first_alloc_count) >
                     MemoryPool::max_batch_alloc_byte_count))
             {
                 throw invalid_argument("invalid allocation size");
@@ -185,16 +614,8 @@ namespace seal
 
             // Initial allocation
             allocation new_alloc;
-            try
-            {
-                new_alloc.data_ptr = new SEAL_BYTE[
-                    mul_safe(MemoryPool::first_alloc_count, item_byte_count_)];
-            }
-            catch (const bad_alloc &)
-            {
-                // Allocation failed; rethrow
-                throw;
-            }
+            allocate_batch(new_alloc,
+                mul_safe(MemoryPool::first_alloc_count, item_stride_), huge_pages_);
 
             new_alloc.size = MemoryPool::first_alloc_count;
             new_alloc.free = MemoryPool::first_alloc_count;
@@ -215,31 +636,10 @@ namespace seal
             }
             first_item_ = nullptr;
 
-            // Do we need to clear the memory?
-            if (clear_on_destruction_)
-            {
-                // Delete the memory
-                for (auto &alloc : allocs_)
-                {
-                    size_t curr_alloc_byte_count = mul_safe(item_byte_count_, alloc.size);
-                    volatile SEAL_BYTE *data_ptr = reinterpret_cast<SEAL_BYTE*>(alloc.data_ptr);
-                    while (curr_alloc_byte_count--)
-                    {
-                        *data_ptr++ = static_cast<SEAL_BYTE>(0);
-                    }
-
-                    // Delete this allocation
-                    delete[] alloc.data_ptr;
-                }
-            }
-            else
+            // Delete the memory, clearing it first if needed
+            for (auto &alloc : allocs_)
             {
-                // Delete the memory
-                for (auto &alloc : allocs_)
-                {
-                    // Delete this allocation
-                    delete[] alloc.data_ptr;
-                }
+                free_batch(alloc, item_stride_, clear_on_destruction_);
             }
 
             allocs_.clear();
@@ -248,63 +648,119 @@ namespace seal
         MemoryPoolItem *MemoryPoolHeadST::get()
         {
             MemoryPoolItem *old_first = first_item_;
+            in_use_count_++;
 
             // Is pool empty?
             if (old_first == nullptr)
             {
-                allocation &last_alloc = allocs_.back();
                 MemoryPoolItem *new_item = nullptr;
-                if (last_alloc.free > 0)
+                size_t new_byte_count = 0;
+                if (!allocs_.empty() && allocs_.back().free > 0)
                 {
                     // Pool is empty; there is memory
+                    allocation &last_alloc = allocs_.back();
                     new_item = new MemoryPoolItem(last_alloc.head_ptr);
                     last_alloc.free--;
-                    last_alloc.head_ptr += item_byte_count_;
+                    last_alloc.head_ptr += item_stride_;
                 }
                 else
                 {
                     // Pool is empty; there is no memory
                     allocation new_alloc;
 
-                    // Increase allocation size unless we are already at max
-                    size_t new_size = safe_cast<size_t>(
+                    // Increase allocation size unless we are already at max; if all
+                    // allocations were trimmed, start over from the first size
+                    size_t last_size = allocs_.empty() ?
+                        MemoryPool::first_alloc_count : allocs_.back().size;
+                    size_t new_size = allocs_.empty() ? last_size : safe_cast<size_t>(
                         ceil(MemoryPool::alloc_size_multiplier *
-                            static_cast<double>(last_alloc.size)));
-                    size_t new_alloc_byte_count = mul_safe(new_size, item_byte_count_);
+                            static_cast<double>(last_size)));
+                    size_t new_alloc_byte_count = mul_safe(new_size, item_stride_);
                     if (new_alloc_byte_count >
                         MemoryPool::max_batch_alloc_byte_count)
                     {
-                        new_size = last_alloc.size;
-                        new_alloc_byte_count = new_size * item_byte_count_;
+                        new_size = last_size;
+                        new_alloc_byte_count = new_size * item_stride_;
                     }
 
                     try
                     {
-                        new_alloc.data_ptr = new SEAL_BYTE[new_alloc_byte_count];
+                        allocate_batch(new_alloc, new_alloc_byte_count, huge_pages_);
                     }
                     catch (const bad_alloc &)
                     {
                         // Allocation failed; rethrow
+                        in_use_count_--;
                         throw;
                     }
 
                     new_alloc.size = new_size;
                     new_alloc.free = new_size - 1;
-                    new_alloc.head_ptr = new_alloc.data_ptr + item_byte_count_;
+                    new_alloc.head_ptr = new_alloc.data_ptr + item_stride_;
                     allocs_.push_back(new_alloc);
                     item_count_ += new_size;
                     new_item = new MemoryPoolItem(new_alloc.data_ptr);
+                    new_byte_count = new_alloc_byte_count;
                 }
 
+                miss_count_++;
+                peak_in_use_count_ = max(peak_in_use_count_, in_use_count_);
+#ifdef SEAL_USE_ALLOCATION_TRACING
+                trace_allocation(item_byte_count_, new_byte_count);
+#else
+                (void)new_byte_count;
+#endif
                 return new_item;
             }
 
             // Pool is not empty
             first_item_ = old_first->next();
             old_first->next() = nullptr;
+            hit_count_++;
+#ifdef SEAL_USE_ALLOCATION_TRACING
+            trace_allocation(item_byte_count_, 0);
+#endif
             return old_first;
         }
 
+        MemoryPoolHead::statistics MemoryPoolHeadST::stats() const noexcept
+        {
+            statistics result;
+            result.item_byte_count = item_byte_count_;
+            result.item_count = item_count_;
+            result.in_use_count = in_use_count_;
+            result.peak_in_use_count = peak_in_use_count_;
+            result.hit_count = hit_count_;
+            result.miss_count = miss_count_;
+            return result;
+        }
+
+        size_t MemoryPoolHeadST::trim(size_t byte_count)
+        {
+            vector<MemoryPoolItem*> free_items;
+            for (MemoryPoolItem *curr_item = first_item_; curr_item; curr_item = curr_item->next())
+            {
+                free_items.push_back(curr_item);
+            }
+
+            size_t released_byte_count = release_unused_allocs(allocs_, free_items,
+                item_byte_count_, item_stride_, clear_on_destruction_, byte_count);
+            item_count_ -= released_byte_count / item_byte_count_;
+
+            // Relink the remaining items
+            first_item_ = nullptr;
+            for (auto it = free_items.rbegin(); it != free_items.rend(); ++it)
+            {
+                if (*it)
+                {
+                    (*it)->next() = first_item_;
+                    first_item_ = *it;
+                }
+            }
+
+            return released_byte_count;
+        }
+
         const size_t MemoryPool::max_single_alloc_byte_count =
             []() -> size_t {
                 int bit_shift = static_cast<int>(
@@ -329,29 +785,48 @@ namespace seal
                 return numeric_limits<size_t>::max() >> bit_shift;
             }();
 
-        MemoryPoolMT::~MemoryPoolMT() noexcept
+        namespace
         {
-            WriterLock lock(pools_locker_.acquire_write());
-            for (MemoryPoolHead *head : pools_)
+            // Per-thread direct-mapped cache from (pool, byte count) to pool
+            // head. Entries are not invalidated: a matching entry is valid only
+            // because pool ids are never reused and heads are never removed
+            // from a live pool (trimming releases memory, not heads). Removing
+            // heads would require invalidating these caches.
+            struct HeadCacheEntry
             {
-                delete head;
-            }
-            pools_.clear();
-        }
+                uint64_t pool_id = 0;
 
-        Pointer<SEAL_BYTE> MemoryPoolMT::get_for_byte_count(size_t byte_count)
-        {
-            if (byte_count > max_single_alloc_byte_count)
-            {
-                throw invalid_argument("invalid allocation size");
-            }
-            else if (byte_count == 0)
+                size_t byte_count = 0;
+
+                MemoryPoolHead *head = nullptr;
+            };
+
+            constexpr size_t head_cache_size = 64;
+
+            thread_local array<HeadCacheEntry, head_cache_size> head_cache;
+
+            inline HeadCacheEntry &head_cache_entry(
+                uint64_t pool_id, size_t byte_count) noexcept
             {
-                return Pointer<SEAL_BYTE>();
+                uint64_t hash = (static_cast<uint64_t>(byte_count) ^
+                    (pool_id * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+                return head_cache[static_cast<size_t>(hash >> 58) % head_cache_size];
             }
 
-            // Attempt to find size.
-            ReaderLock reader_lock(pools_locker_.acquire_read());
+            atomic<uint64_t> next_pool_id{ 1 };
+        }
+
+        MemoryPoolMT::MemoryPoolMT(bool clear_on_destruction, bool size_classes,
+            bool huge_pages) :
+            clear_on_destruction_(clear_on_destruction),
+            size_classes_(size_classes),
+            huge_pages_(huge_pages),
+            id_(next_pool_id.fetch_add(1, memory_order_relaxed))
+        {
+        }
+
+        MemoryPoolHead *MemoryPoolMT::find_head(size_t byte_count) const noexcept
+        {
             size_t start = 0;
             size_t end = pools_.size();
             while (start < end)
@@ -369,52 +844,116 @@ namespace seal
                 }
                 else
                 {
-                    return Pointer<SEAL_BYTE>(mid_head);
+                    return mid_head;
                 }
             }
-            reader_lock.unlock();
+            return nullptr;
+        }
 
-            // Size was not found, so obtain an exclusive lock and search again.
-            WriterLock writer_lock(pools_locker_.acquire_write());
-            start = 0;
-            end = pools_.size();
-            while (start < end)
+        size_t MemoryPool::item_stride(size_t item_byte_count) noexcept
+        {
+            if (item_byte_count < alloc_alignment ||
+                item_byte_count > max_batch_alloc_byte_count - alloc_alignment)
             {
-                size_t mid = (start + end) / 2;
-                MemoryPoolHead *mid_head = pools_[mid];
-                size_t mid_byte_count = mid_head->item_byte_count();
-                if (byte_count < mid_byte_count)
-                {
-                    start = mid + 1;
-                }
-                else if (byte_count > mid_byte_count)
-                {
-                    end = mid;
-                }
-                else
-                {
-                    return Pointer<SEAL_BYTE>(mid_head);
-                }
+                return item_byte_count;
             }
+            return (item_byte_count + alloc_alignment - 1) & ~(alloc_alignment - 1);
+        }
 
-            // Size was still not found, but we own an exclusive lock so just add it,
-            // but first check if we are at maximum pool head count already.
-            if (pools_.size() >= max_pool_head_count)
+        size_t MemoryPool::size_class_byte_count(size_t byte_count) noexcept
+        {
+            if (byte_count <= size_class_alignment)
             {
-                throw runtime_error("maximum pool head count reached");
+                return byte_count ? size_class_alignment : 0;
+            }
+            if (byte_count > (max_single_alloc_byte_count >> 1))
+            {
+                return byte_count;
             }
 
-            MemoryPoolHead *new_head = new MemoryPoolHeadMT(byte_count, clear_on_destruction_);
-            if (!pools_.empty())
+            // Find the largest power of two smaller than byte_count
+            size_t power = (size_t(1) << get_significant_bit_count(
+                static_cast<uint64_t>(byte_count - 1))) >> 1;
+            size_t class_byte_count = 2 * power;
+            if (byte_count <= power + (power >> 1))
             {
-                pools_.insert(pools_.begin() + static_cast<ptrdiff_t>(start), new_head);
+                class_byte_count = power + (power >> 1);
             }
-            else
+
+            // Only 3 * size_class_page_byte_count / 2 is not already a multiple
+            // of its alignment, so aligning never merges two classes
+            size_t alignment = class_byte_count >= 2 * size_class_page_byte_count ?
+                size_class_page_byte_count : size_class_alignment;
+            return (class_byte_count + alignment - 1) & ~(alignment - 1);
+        }
+
+        MemoryPoolMT::~MemoryPoolMT() noexcept
+        {
+            WriterLock lock(pools_locker_.acquire_write());
+            for (MemoryPoolHead *head : pools_)
             {
-                pools_.emplace_back(new_head);
+                delete head;
             }
+            pools_.clear();
+        }
 
-            return Pointer<SEAL_BYTE>(new_head);
+        Pointer<SEAL_BYTE> MemoryPoolMT::get_for_byte_count(size_t byte_count)
+        {
+            if (byte_count > max_single_alloc_byte_count)
+            {
+                throw invalid_argument("invalid allocation size");
+            }
+            else if (byte_count == 0)
+            {
+                return Pointer<SEAL_BYTE>();
+            }
+            if (size_classes_)
+            {
+                byte_count = size_class_byte_count(byte_count);
+            }
+
+            // The per-thread cache avoids taking the reader lock for sizes this
+            // thread has requested before; the cached head pointer stays valid
+            // only because heads are never removed from pools_
+            auto &cache_entry = head_cache_entry(id_, byte_count);
+            if (cache_entry.pool_id == id_ && cache_entry.byte_count == byte_count)
+            {
+                return Pointer<SEAL_BYTE>(cache_entry.head);
+            }
+
+            // Attempt to find size.
+            ReaderLock reader_lock(pools_locker_.acquire_read());
+            MemoryPoolHead *head = find_head(byte_count);
+            reader_lock.unlock();
+
+            if (!head)
+            {
+                // Size was not found, so obtain an exclusive lock and search again.
+                WriterLock writer_lock(pools_locker_.acquire_write());
+                head = find_head(byte_count);
+                if (!head)
+                {
+                    // Size was still not found, but we own an exclusive lock so just
+                    // add it, but first check if we are at maximum pool head count
+                    // already.
+                    if (pools_.size() >= max_pool_head_count)
+                    {
+                        throw runtime_error("maximum pool head count reached");
+                    }
+
+                    head = new MemoryPoolHeadMT(byte_count, clear_on_destruction_, huge_pages_);
+                    auto pos = find_if(pools_.begin(), pools_.end(),
+                        [byte_count](MemoryPoolHead *curr_head) {
+                            return curr_head->item_byte_count() < byte_count;
+                        });
+                    pools_.insert(pos, head);
+                }
+            }
+
+            cache_entry.pool_id = id_;
+            cache_entry.byte_count = byte_count;
+            cache_entry.head = head;
+            return Pointer<SEAL_BYTE>(head);
         }
 
         size_t MemoryPoolMT::alloc_byte_count() const
@@ -428,6 +967,49 @@ namespace seal
                 });
         }
 
+        size_t MemoryPoolMT::in_use_byte_count() const
+        {
+            ReaderLock lock(pools_locker_.acquire_read());
+
+            return accumulate(pools_.cbegin(), pools_.cend(), size_t(0),
+                [](size_t byte_count, MemoryPoolHead *head) {
+                    return add_safe(byte_count,
+                        mul_safe(head->in_use_count(), head->item_byte_count()));
+                });
+        }
+
+        size_t MemoryPoolMT::trim(size_t max_retained_bytes)
+        {
+            // Heads are never removed, so a reader lock is enough
+            ReaderLock lock(pools_locker_.acquire_read());
+
+            size_t free_byte_count = 0;
+            for (MemoryPoolHead *head : pools_)
+            {
+                size_t item_count = head->item_count();
+                size_t in_use_count = min(head->in_use_count(), item_count);
+                free_byte_count = add_safe(free_byte_count,
+                    mul_safe(item_count - in_use_count, head->item_byte_count()));
+            }
+            if (free_byte_count <= max_retained_bytes)
+            {
+                return 0;
+            }
+
+            // Largest items first
+            size_t excess_byte_count = free_byte_count - max_retained_bytes;
+            size_t released_byte_count = 0;
+            for (MemoryPoolHead *head : pools_)
+            {
+                if (released_byte_count >= excess_byte_count)
+                {
+                    break;
+                }
+                released_byte_count += head->trim(excess_byte_count - released_byte_count);
+            }
+            return released_byte_count;
+        }
+
         MemoryPoolST::~MemoryPoolST() noexcept
         {
             for (MemoryPoolHead *head : pools_)
@@ -447,6 +1029,10 @@ namespace seal
             {
                 return Pointer<SEAL_BYTE>();
             }
+            if (size_classes_)
+            {
+                byte_count = size_class_byte_count(byte_count);
+            }
 
             // Attempt to find size.
             size_t start = 0;
@@ -477,7 +1063,7 @@ namespace seal
                 throw runtime_error("maximum pool head count reached");
             }
 
-            MemoryPoolHead *new_head = new MemoryPoolHeadST(byte_count, clear_on_destruction_);
+            MemoryPoolHead *new_head = new MemoryPoolHeadST(byte_count, clear_on_destruction_, huge_pages_);
             if (!pools_.empty())
             {
                 pools_.insert(pools_.begin() + static_cast<ptrdiff_t>(start), new_head);
@@ -498,5 +1084,380 @@ namespace seal
                         mul_safe(head->item_count(), head->item_byte_count()));
                 });
         }
+    
+
+        size_t MemoryPoolST::in_use_byte_count() const
+        {
+            return accumulate(pools_.cbegin(), pools_.cend(), size_t(0),
+                [](size_t byte_count, MemoryPoolHead *head) {
+                    return add_safe(byte_count,
+                        mul_safe(head->in_use_count(), head->item_byte_count()));
+                });
+        }
+
+        size_t MemoryPoolST::trim(size_t max_retained_bytes)
+        {
+            size_t free_byte_count = 0;
+            for (MemoryPoolHead *head : pools_)
+            {
+                free_byte_count = add_safe(free_byte_count,
+                    mul_safe(head->item_count() - head->in_use_count(), head->item_byte_count()));
+            }
+            if (free_byte_count <= max_retained_bytes)
+            {
+                return 0;
+            }
+
+            // Largest items first
+            size_t excess_byte_count = free_byte_count - max_retained_bytes;
+            size_t released_byte_count = 0;
+            for (MemoryPoolHead *head : pools_)
+            {
+                if (released_byte_count >= excess_byte_count)
+                {
+                    break;
+                }
+                released_byte_count += head->trim(excess_byte_count - released_byte_count);
+            }
+            return released_byte_count;
+        }
+
+        MemoryPoolItem *MemoryPoolHeadArena::get()
+        {
+            size_t new_byte_count = 0;
+            MemoryPoolItem *item = arena_.allocate(item_byte_count_, new_byte_count);
+            item_count_.fetch_add(1, memory_order_relaxed);
+            miss_count_.fetch_add(1, memory_order_relaxed);
+            update_peak(peak_in_use_count_,
+                in_use_count_.fetch_add(1, memory_order_relaxed) + 1);
+#ifdef SEAL_USE_ALLOCATION_TRACING
+            trace_allocation(item_byte_count_, new_byte_count);
+#endif
+            return item;
+        }
+
+        MemoryPoolHead::statistics MemoryPoolHeadArena::stats() const noexcept
+        {
+            statistics result;
+            result.item_byte_count = item_byte_count_;
+            result.item_count = item_count();
+            result.in_use_count = in_use_count();
+            result.peak_in_use_count = peak_in_use_count_.load(memory_order_relaxed);
+            result.miss_count = miss_count_.load(memory_order_relaxed);
+            return result;
+        }
+
+        void MemoryPoolHeadArena::add(MemoryPoolItem *) noexcept
+        {
+            // The memory is reclaimed only when the arena is reset
+            in_use_count_.fetch_sub(1, memory_order_relaxed);
+            arena_.in_use_count_.fetch_sub(1, memory_order_release);
+        }
+
+        MemoryPoolArena::MemoryPoolArena(size_t capacity_byte_count,
+            bool allow_overflow, bool huge_pages) :
+            allow_overflow_(allow_overflow), huge_pages_(huge_pages)
+        {
+            if (!capacity_byte_count ||
+                capacity_byte_count > max_batch_alloc_byte_count)
+            {
+                throw invalid_argument("invalid arena capacity");
+            }
+
+            // Round up so that every item starts at an aligned address
+            capacity_byte_count = (capacity_byte_count + alloc_alignment - 1) &
+                ~(alloc_alignment - 1);
+            MemoryPoolHead::allocation arena;
+            allocate_batch(arena, capacity_byte_count, huge_pages_);
+            arena.size = capacity_byte_count;
+            arena.free = capacity_byte_count;
+            arena.head_ptr = arena.data_ptr;
+            try
+            {
+                chunks_.push_back(arena);
+            }
+            catch (...)
+            {
+                free_batch(arena, 1, false);
+                throw;
+            }
+            stats_.capacity_byte_count = capacity_byte_count;
+        }
+
+        MemoryPoolArena::~MemoryPoolArena() noexcept
+        {
+            for (MemoryPoolHeadArena *head : pools_)
+            {
+                delete head;
+            }
+            pools_.clear();
+            for (auto &chunk : chunks_)
+            {
+                free_batch(chunk, 1, false);
+            }
+            chunks_.clear();
+        }
+
+        Pointer<SEAL_BYTE> MemoryPoolArena::get_for_byte_count(size_t byte_count)
+        {
+            if (byte_count > max_single_alloc_byte_count)
+            {
+                throw invalid_argument("invalid allocation size");
+            }
+            else if (byte_count == 0)
+            {
+                return Pointer<SEAL_BYTE>();
+            }
+
+            MemoryPoolHeadArena *head = nullptr;
+            {
+                SpinLockGuard lock(locked_);
+                auto it = find_if(pools_.cbegin(), pools_.cend(),
+                    [byte_count](MemoryPoolHeadArena *curr_head) {
+                        return curr_head->item_byte_count() == byte_count;
+                    });
+                if (it != pools_.cend())
+                {
+                    head = *it;
+                }
+                else
+                {
+                    if (pools_.size() >= max_pool_head_count)
+                    {
+                        throw runtime_error("maximum pool head count reached");
+                    }
+                    pools_.reserve(pools_.size() + 1);
+                    head = new MemoryPoolHeadArena(*this, byte_count);
+                    pools_.push_back(head);
+                }
+            }
+            return Pointer<SEAL_BYTE>(head);
+        }
+
+        MemoryPoolItem *MemoryPoolArena::allocate(size_t item_byte_count,
+            size_t &new_byte_count)
+        {
+            // The item is placed after its data; the total keeps the next
+            // allocation aligned
+            size_t item_offset = add_safe(item_byte_count,
+                alignof(MemoryPoolItem) - 1) & ~(alignof(MemoryPoolItem) - 1);
+            size_t total_byte_count = add_safe(item_offset,
+                sizeof(MemoryPoolItem), alloc_alignment - 1) & ~(alloc_alignment - 1);
+
+            SpinLockGuard lock(locked_);
+            MemoryPoolHead::allocation *chunk = &chunks_[current_chunk_];
+            if (chunk->free < total_byte_count)
+            {
+                stats_.overflow_count++;
+                if (!allow_overflow_)
+                {
+                    throw bad_alloc();
+                }
+
+                // Overflow memory kept by trim is used before allocating more
+                while (chunk->free < total_byte_count && current_chunk_ + 1 < chunks_.size())
+                {
+                    chunk = &chunks_[++current_chunk_];
+                }
+                if (chunk->free < total_byte_count)
+                {
+                    size_t chunk_byte_count = max(total_byte_count, stats_.capacity_byte_count);
+                    MemoryPoolHead::allocation overflow;
+                    chunks_.reserve(chunks_.size() + 1);
+                    allocate_batch(overflow, chunk_byte_count, huge_pages_);
+                    overflow.size = chunk_byte_count;
+                    overflow.free = chunk_byte_count;
+                    overflow.head_ptr = overflow.data_ptr;
+                    chunks_.push_back(overflow);
+                    current_chunk_ = chunks_.size() - 1;
+                    chunk = &chunks_.back();
+                    new_byte_count = chunk_byte_count;
+                }
+            }
+            if (current_chunk_)
+            {
+                stats_.overflow_byte_count += total_byte_count;
+            }
+
+            SEAL_BYTE *data = chunk->head_ptr;
+            chunk->head_ptr += total_byte_count;
+            chunk->free -= total_byte_count;
+            stats_.used_byte_count += total_byte_count;
+            stats_.peak_used_byte_count = max(
+                stats_.peak_used_byte_count, stats_.used_byte_count);
+            in_use_count_.fetch_add(1, memory_order_relaxed);
+            return new (data + item_offset) MemoryPoolItem(data);
+        }
+
+        size_t MemoryPoolArena::pool_count() const
+        {
+            SpinLockGuard lock(locked_);
+            return pools_.size();
+        }
+
+        size_t MemoryPoolArena::alloc_byte_count() const
+        {
+            SpinLockGuard lock(locked_);
+            return chunk_byte_count();
+        }
+
+        size_t MemoryPoolArena::in_use_byte_count() const
+        {
+            SpinLockGuard lock(locked_);
+            return accumulate(pools_.cbegin(), pools_.cend(), size_t(0),
+                [](size_t byte_count, MemoryPoolHead *head) {
+                    return add_safe(byte_count,
+                        mul_safe(head->in_use_count(), head->item_byte_count()));
+                });
+        }
+
+        size_t MemoryPoolArena::trim(size_t max_retained_bytes)
+        {
+            SpinLockGuard lock(locked_);
+            size_t old_byte_count = chunk_byte_count();
+            if (old_byte_count <= max_retained_bytes || !reset_locked(max_retained_bytes))
+            {
+                return 0;
+            }
+            return old_byte_count - chunk_byte_count();
+        }
+
+        bool MemoryPoolArena::reset() noexcept
+        {
+            SpinLockGuard lock(locked_);
+            return reset_locked(0);
+        }
+
+        size_t MemoryPoolArena::chunk_byte_count() const noexcept
+        {
+            // Every chunk was allocated, so the sum fits in memory
+            size_t byte_count = 0;
+            for (auto &chunk : chunks_)
+            {
+                byte_count += chunk.size;
+            }
+            return byte_count;
+        }
+
+        bool MemoryPoolArena::reset_locked(size_t max_retained_bytes) noexcept
+        {
+            if (in_use_count_.load(memory_order_acquire))
+            {
+                return false;
+            }
+
+            // Overflow chunks go newest first; the arena itself is always kept
+            size_t byte_count = chunk_byte_count();
+            while (chunks_.size() > 1 && byte_count > max_retained_bytes)
+            {
+                byte_count -= chunks_.back().size;
+                free_batch(chunks_.back(), 1, false);
+                chunks_.pop_back();
+            }
+            for (auto &chunk : chunks_)
+            {
+                chunk.head_ptr = chunk.data_ptr;
+                chunk.free = chunk.size;
+            }
+            current_chunk_ = 0;
+            for (MemoryPoolHeadArena *head : pools_)
+            {
+                head->item_count_.store(0, memory_order_relaxed);
+            }
+            stats_.used_byte_count = 0;
+            stats_.reset_count++;
+            return true;
+        }
+
+        MemoryPoolArena::statistics MemoryPoolArena::stats() const noexcept
+        {
+            SpinLockGuard lock(locked_);
+            return stats_;
+        }
+
+        vector<MemoryPoolHead::statistics> MemoryPoolMT::size_stats() const
+        {
+            ReaderLock lock(pools_locker_.acquire_read());
+            vector<MemoryPoolHead::statistics> result;
+            result.reserve(pools_.size());
+            for (MemoryPoolHead *head : pools_)
+            {
+                result.push_back(head->stats());
+            }
+            return result;
+        }
+
+        vector<MemoryPoolHead::statistics> MemoryPoolST::size_stats() const
+        {
+            vector<MemoryPoolHead::statistics> result;
+            result.reserve(pools_.size());
+            for (MemoryPoolHead *head : pools_)
+            {
+                result.push_back(head->stats());
+            }
+            return result;
+        }
+
+        vector<MemoryPoolHead::statistics> MemoryPoolArena::size_stats() const
+        {
+            vector<MemoryPoolHead::statistics> result;
+            {
+                SpinLockGuard lock(locked_);
+                result.reserve(pools_.size());
+                for (MemoryPoolHead *head : pools_)
+                {
+                    result.push_back(head->stats());
+                }
+            }
+            sort(result.begin(), result.end(),
+                [](const MemoryPoolHead::statistics &a, const MemoryPoolHead::statistics &b) {
+                    return a.item_byte_count > b.item_byte_count;
+                });
+            return result;
+        }
+#ifdef SEAL_USE_ALLOCATION_TRACING
+        namespace
+        {
+            thread_local const AllocationSite *current_allocation_site = nullptr;
+
+            shared_ptr<allocation_trace_hook> allocation_trace_hook_ptr;
+        }
+
+        AllocationSite::AllocationSite(const char *name) noexcept :
+            name_(name), parent_(current_allocation_site)
+        {
+            current_allocation_site = this;
+        }
+
+        AllocationSite::~AllocationSite() noexcept
+        {
+            current_allocation_site = parent_;
+        }
+
+        const AllocationSite *AllocationSite::Current() noexcept
+        {
+            return current_allocation_site;
+        }
+
+        void set_allocation_trace_hook(allocation_trace_hook hook)
+        {
+            shared_ptr<allocation_trace_hook> new_hook;
+            if (hook)
+            {
+                new_hook = make_shared<allocation_trace_hook>(move(hook));
+            }
+            atomic_store(&allocation_trace_hook_ptr, move(new_hook));
+        }
+
+        void trace_allocation(size_t item_byte_count, size_t new_byte_count)
+        {
+            auto hook = atomic_load(&allocation_trace_hook_ptr);
+            if (hook)
+            {
+                (*hook)(allocation_event{ current_allocation_site,
+                    item_byte_count, new_byte_count });
+            }
+        }
+#endif
     }
 }
@@ -13,6 +13,8 @@
 #include <type_traits>
 #include <new>
 #include <algorithm>
+#include <chrono>
+#include <functional>
 #include "seal/util/defines.h"
 #include "seal/util/globals.h"
 #include "seal/util/common.h"
@@ -76,14 +78,16 @@ namespace seal
             struct allocation
             {
                 allocation() :
-                    size(0), data_ptr(nullptr), free(0), head_ptr(nullptr)
+                    size(0), data_ptr(nullptr), free(0), head_ptr(nullptr),
+                    raw_ptr(nullptr), mapped_byte_count(0)
                 {
                 }
 
                 // Size of the allocation (number of items it can hold)
                 std::size_t size;
 
-                // Pointer to start of the allocation
+                // Pointer to start of the allocation; aligned to
+                // MemoryPool::alloc_alignment
                 SEAL_BYTE *data_ptr;
 
                 // How much free space is left (number of items that still fit)
@@ -91,6 +95,13 @@ namespace seal
 
                 // Pointer to current head of allocation
                 SEAL_BYTE *head_ptr;
+
+                // Pointer returned by the underlying allocator
+                SEAL_BYTE *raw_ptr;
+
+                // Byte size of the mapping if the allocation was mapped
+                // directly (for huge pages); zero otherwise
+                std::size_t mapped_byte_count;
             };
 
             // The overriding functions are noexcept(false)
@@ -102,18 +113,115 @@ namespace seal
             // Total number of items allocated
             virtual std::size_t item_count() const noexcept = 0;
 
+            // Number of items currently handed out and not yet returned
+            virtual std::size_t in_use_count() const noexcept = 0;
+
             virtual MemoryPoolItem *get() = 0;
 
             // Return item back to this pool
             virtual void add(MemoryPoolItem *new_first) noexcept = 0;
+
+            // Releases allocations none of whose items are in use, until at
+            // least byte_count bytes have been released or no such allocations
+            // remain. Returns the number of bytes released.
+            virtual std::size_t trim(std::size_t byte_count) = 0;
+
+            struct statistics
+            {
+                std::size_t item_byte_count = 0;
+
+                std::size_t item_count = 0;
+
+                std::size_t in_use_count = 0;
+
+                // Largest number of items in use at once
+                std::size_t peak_in_use_count = 0;
+
+                // Number of items handed out by reusing a returned item
+                std::size_t hit_count = 0;
+
+                // Number of items handed out that needed new memory
+                std::size_t miss_count = 0;
+
+                // Time threads spent waiting for locks (thread-safe pools only)
+                std::chrono::nanoseconds lock_wait_time{ 0 };
+            };
+
+            SEAL_NODISCARD virtual statistics stats() const noexcept = 0;
         };
+#ifdef SEAL_USE_ALLOCATION_TRACING
+        // Names the code that requests memory from memory pools on the calling
+        // thread while the object is alive. Sites nest: parent() is the site
+        // that was current when this one was created.
+        class AllocationSite
+        {
+        public:
+            AllocationSite(const char *name) noexcept;
+
+            ~AllocationSite() noexcept;
+
+            SEAL_NODISCARD inline const char *name() const noexcept
+            {
+                return name_;
+            }
+
+            SEAL_NODISCARD inline const AllocationSite *parent() const noexcept
+            {
+                return parent_;
+            }
+
+            // Returns the innermost site on the calling thread, or nullptr
+            SEAL_NODISCARD static const AllocationSite *Current() noexcept;
+
+        private:
+            AllocationSite(const AllocationSite &copy) = delete;
+
+            AllocationSite &operator =(const AllocationSite &assign) = delete;
+
+            const char *name_;
+
+            const AllocationSite *parent_;
+        };
+
+        struct allocation_event
+        {
+            // The innermost allocation site, or nullptr if none is set
+            const AllocationSite *site;
+
+            std::size_t item_byte_count;
+
+            // Bytes newly allocated to serve the request; zero if memory was
+            // reused
+            std::size_t new_byte_count;
+        };
+
+        using allocation_trace_hook = std::function<void(const allocation_event &)>;
+
+        // Sets a function called for every item handed out by any memory pool.
+        // The function may be called concurrently from several threads. An
+        // empty function disables tracing.
+        void set_allocation_trace_hook(allocation_trace_hook hook);
+
+        // Reports an allocation to the trace hook, if one is set
+        void trace_allocation(std::size_t item_byte_count, std::size_t new_byte_count);
+#define SEAL_ALLOCATION_SITE(name) \
+    seal::util::AllocationSite seal_allocation_site_(name)
+#else
+#define SEAL_ALLOCATION_SITE(name)
+#endif
 
         class MemoryPoolHeadMT : public MemoryPoolHead
         {
         public:
+            // Number of free lists; threads are spread over these so that
+            // concurrent threads rarely touch the same list
+            static constexpr std::size_t stripe_count = 16;
+
             // Creates a new MemoryPoolHeadMT with allocation for one single item.
+            // If huge_pages is true, large batches are backed by huge pages
+            // where the platform supports it.
             MemoryPoolHeadMT(std::size_t item_byte_count,
-                bool clear_on_destruction = false);
+                bool clear_on_destruction = false, bool huge_pages = false);
 
             ~MemoryPoolHeadMT() noexcept override;
 
@@ -129,46 +237,87 @@ namespace seal
                 return item_count_;
             }
 
+            SEAL_NODISCARD std::size_t in_use_count() const noexcept override;
+
             MemoryPoolItem *get() override;
 
+            // Items are returned to the calling thread's free list without
+            // taking any lock
             inline void add(MemoryPoolItem *new_first) noexcept override
             {
-                bool expected = false;
-                while (!locked_.compare_exchange_strong(
-                    expected, true, std::memory_order_acquire))
+                auto &curr_stripe = stripes_[this_thread_stripe()];
+                curr_stripe.in_use_delta.fetch_sub(1, std::memory_order_relaxed);
+                MemoryPoolItem *old_first = curr_stripe.first_item.load(std::memory_order_relaxed);
+                do
                 {
-                    expected = false;
-                }
-                MemoryPoolItem *old_first = first_item_;
-                new_first->next() = old_first;
-                first_item_ = new_first;
-                locked_.store(false, std::memory_order_release);
+                    new_first->next() = old_first;
+                } while (!curr_stripe.first_item.compare_exchange_weak(old_first, new_first,
+                    std::memory_order_release, std::memory_order_relaxed));
             }
 
+            std::size_t trim(std::size_t byte_count) override;
+
+            SEAL_NODISCARD statistics stats() const noexcept override;
+
+            // Returns the index of the free list used by the calling thread
+            SEAL_NODISCARD static std::size_t this_thread_stripe() noexcept;
+
         private:
             MemoryPoolHeadMT(const MemoryPoolHeadMT &copy) = delete;
 
             MemoryPoolHeadMT &operator =(const MemoryPoolHeadMT &assign) = delete;
 
+            // A free list with any number of lock-free pushers and a single
+            // popper at a time, which makes popping safe from ABA
+            struct alignas(64) stripe
+            {
+                std::atomic<MemoryPoolItem*> first_item{ nullptr };
+
+                std::atomic<bool> pop_locked{ false };
+
+                // Items taken minus items returned by threads using this stripe
+                std::atomic<std::ptrdiff_t> in_use_delta{ 0 };
+
+                // Items taken from a free list by threads using this stripe
+                std::atomic<std::size_t> hit_count{ 0 };
+            };
+
+            // Pops an item from the given free list. Returns nullptr if the list
+            // is empty or, unless wait is true, if another thread is popping.
+            MemoryPoolItem *try_pop(stripe &from, bool wait) noexcept;
+
             const bool clear_on_destruction_;
 
+            const bool huge_pages_;
+
             mutable std::atomic<bool> locked_;
 
             const std::size_t item_byte_count_;
 
+            // Distance between consecutive items in an allocation
+            const std::size_t item_stride_;
+
             volatile std::size_t item_count_;
 
             std::vector<allocation> allocs_;
 
-            MemoryPoolItem* volatile first_item_;
+            std::atomic<std::size_t> miss_count_{ 0 };
+
+            std::atomic<std::size_t> peak_in_use_count_{ 0 };
+
+            mutable std::atomic<std::uint64_t> lock_wait_ns_{ 0 };
+
+            stripe stripes_[stripe_count];
         };
 
         class MemoryPoolHeadST : public MemoryPoolHead
         {
         public:
             // Creates a new MemoryPoolHeadST with allocation for one single item.
+            // If huge_pages is true, large batches are backed by huge pages
+            // where the platform supports it.
             MemoryPoolHeadST(std::size_t item_byte_count,
-                bool clear_on_destruction = false);
+                bool clear_on_destruction = false, bool huge_pages = false);
 
             ~MemoryPoolHeadST() noexcept override;
 
@@ -184,14 +333,24 @@ namespace seal
                 return item_count_;
             }
 
+            SEAL_NODISCARD inline std::size_t in_use_count() const noexcept override
+            {
+                return in_use_count_;
+            }
+
             SEAL_NODISCARD MemoryPoolItem *get() override;
 
             inline void add(MemoryPoolItem *new_first) noexcept override
             {
                 new_first->next() = first_item_;
                 first_item_ = new_first;
+                in_use_count_--;
             }
 
+            std::size_t trim(std::size_t byte_count) override;
+
+            SEAL_NODISCARD statistics stats() const noexcept override;
+
         private:
             MemoryPoolHeadST(const MemoryPoolHeadST &copy) = delete;
 
@@ -199,15 +358,89 @@ namespace seal
 
             const bool clear_on_destruction_;
 
+            const bool huge_pages_;
+
             std::size_t item_byte_count_;
 
+            // Distance between consecutive items in an allocation
+            std::size_t item_stride_;
+
             std::size_t item_count_;
 
+            std::size_t in_use_count_ = 0;
+
+            std::size_t peak_in_use_count_ = 0;
+
+            std::size_t hit_count_ = 0;
+
+            std::size_t miss_count_ = 0;
+
             std::vector<allocation> allocs_;
 
             MemoryPoolItem *first_item_;
         };
 
+        class MemoryPoolArena;
+
+        // Hands out items of one size from a MemoryPoolArena. Returned items are
+        // not reused; their memory is reclaimed when the arena is reset.
+        class MemoryPoolHeadArena : public MemoryPoolHead
+        {
+        public:
+            MemoryPoolHeadArena(MemoryPoolArena &arena, std::size_t item_byte_count) noexcept :
+                arena_(arena), item_byte_count_(item_byte_count)
+            {
+            }
+
+            SEAL_NODISCARD inline std::size_t item_byte_count() const noexcept override
+            {
+                return item_byte_count_;
+            }
+
+            // Returns the number of items allocated since the arena was last reset
+            SEAL_NODISCARD inline std::size_t item_count() const noexcept override
+            {
+                return item_count_.load(std::memory_order_relaxed);
+            }
+
+            SEAL_NODISCARD inline std::size_t in_use_count() const noexcept override
+            {
+                return in_use_count_.load(std::memory_order_relaxed);
+            }
+
+            SEAL_NODISCARD MemoryPoolItem *get() override;
+
+            void add(MemoryPoolItem *new_first) noexcept override;
+
+            // Individual items cannot be released
+            inline std::size_t trim(std::size_t) override
+            {
+                return 0;
+            }
+
+            // Every item is new memory, so all are counted as misses
+            SEAL_NODISCARD statistics stats() const noexcept override;
+
+        private:
+            friend class MemoryPoolArena;
+
+            MemoryPoolHeadArena(const MemoryPoolHeadArena &copy) = delete;
+
+            MemoryPoolHeadArena &operator =(const MemoryPoolHeadArena &assign) = delete;
+
+            MemoryPoolArena &arena_;
+
+            const std::size_t item_byte_count_;
+
+            std::atomic<std::size_t> item_count_{ 0 };
+
+            std::atomic<std::size_t> in_use_count_{ 0 };
+
+            std::atomic<std::size_t> peak_in_use_count_{ 0 };
+
+            std::atomic<std::size_t> miss_count_{ 0 };
+        };
+
         class MemoryPool
         {
         public:
@@ -225,6 +458,36 @@ namespace seal
 
             static constexpr std::size_t first_alloc_count = 1;
 
+            // Alignment of every allocation; items of at least this size are
+            // also aligned to it, which suits aligned SIMD loads and stores
+            static constexpr std::size_t alloc_alignment = 64;
+
+            // Size of a huge page; only batches at least this large are backed
+            // by huge pages
+            static constexpr std::size_t huge_page_byte_count = std::size_t(1) << 21;
+
+            // Returns the distance between consecutive items of the given size
+            // in an allocation: item_byte_count rounded up to alloc_alignment if
+            // it is at least alloc_alignment, and item_byte_count otherwise
+            SEAL_NODISCARD static std::size_t item_stride(
+                std::size_t item_byte_count) noexcept;
+
+            // Alignment of size classes smaller than twice the page size
+            static constexpr std::size_t size_class_alignment = 64;
+
+            // Size classes at least twice this large are multiples of this size
+            static constexpr std::size_t size_class_page_byte_count = 4096;
+
+            // Returns the size class for an allocation of byte_count bytes. The
+            // classes are 2^k and 3*2^(k-1) from 64 bytes up; each is a multiple
+            // of size_class_alignment, or of size_class_page_byte_count from
+            // twice that size up. For byte_count above 128 at most a third of
+            // an item is unused. Smaller sizes use the classes 64 and 128, as
+            // items of 64 bytes or more are spaced by multiples of 64 bytes
+            // anyway. Sizes too large to round up are returned unchanged.
+            SEAL_NODISCARD static std::size_t size_class_byte_count(
+                std::size_t byte_count) noexcept;
+
             virtual ~MemoryPool() = default;
 
             virtual Pointer<SEAL_BYTE> get_for_byte_count(std::size_t byte_count) = 0;
@@ -232,15 +495,27 @@ namespace seal
             virtual std::size_t pool_count() const = 0;
 
             virtual std::size_t alloc_byte_count() const = 0;
+
+            // Total byte count of the items currently in use
+            virtual std::size_t in_use_byte_count() const = 0;
+
+            // Releases unused allocations until at most max_retained_bytes of
+            // allocated memory is not in use, or until no fully unused
+            // allocations remain. Returns the number of bytes released.
+            virtual std::size_t trim(std::size_t max_retained_bytes) = 0;
+
+            // Returns statistics for each allocation size, largest first
+            SEAL_NODISCARD virtual std::vector<MemoryPoolHead::statistics> size_stats() const = 0;
         };
 
         class MemoryPoolMT : public MemoryPool
         {
         public:
-            MemoryPoolMT(bool clear_on_destruction = false) :
-                clear_on_destruction_(clear_on_destruction)
-            {
-            };
+            // If size_classes is true, allocation sizes are rounded up to size
+            // classes so that similar sizes share memory. If huge_pages is true,
+            // large batch allocations are backed by huge pages where supported.
+            MemoryPoolMT(bool clear_on_destruction = false, bool size_classes = false,
+                bool huge_pages = false);
 
             ~MemoryPoolMT() noexcept override;
 
@@ -255,23 +530,47 @@ namespace seal
 
             SEAL_NODISCARD std::size_t alloc_byte_count() const override;
 
+            SEAL_NODISCARD std::size_t in_use_byte_count() const override;
+
+            std::size_t trim(std::size_t max_retained_bytes) override;
+
+            SEAL_NODISCARD std::vector<MemoryPoolHead::statistics> size_stats() const override;
+
         protected:
             MemoryPoolMT(const MemoryPoolMT &copy) = delete;
 
             MemoryPoolMT &operator =(const MemoryPoolMT &assign) = delete;
 
+            MemoryPoolHead *find_head(std::size_t byte_count) const noexcept;
+
             const bool clear_on_destruction_;
 
+            const bool size_classes_;
+
+            const bool huge_pages_;
+
+            // Unique across all MemoryPoolMT instances ever created; identifies
+            // this pool in the per-thread head caches
+            const std::uint64_t id_;
+
             mutable ReaderWriterLocker pools_locker_;
 
+            // Heads are only ever added until the pool is destroyed; per-thread
+            // caches hold pointers to them without any lock
             std::vector<MemoryPoolHead*> pools_;
         };
 
         class MemoryPoolST : public MemoryPool
         {
         public:
-            MemoryPoolST(bool clear_on_destruction = false) :
-                clear_on_destruction_(clear_on_destruction)
+            // If size_classes is true, allocation sizes are rounded up to size
+            // classes so that similar sizes share memory. If huge_pages is true,
+            // large batch allocations are backed by huge pages where supported.
+            MemoryPoolST(bool clear_on_destruction = false, bool size_classes = false,
+                bool huge_pages = false) :
+                clear_on_destruction_(clear_on_destruction),
+                size_classes_(size_classes),
+                huge_pages_(huge_pages)
             {
             };
 
@@ -287,6 +586,12 @@ namespace seal
 
             std::size_t alloc_byte_count() const override;
 
+            SEAL_NODISCARD std::size_t in_use_byte_count() const override;
+
+            std::size_t trim(std::size_t max_retained_bytes) override;
+
+            SEAL_NODISCARD std::vector<MemoryPoolHead::statistics> size_stats() const override;
+
         protected:
             MemoryPoolST(const MemoryPoolST &copy) = delete;
 
@@ -294,7 +599,116 @@ namespace seal
 
             const bool clear_on_destruction_;
 
+            const bool size_classes_;
+
+            const bool huge_pages_;
+
             std::vector<MemoryPoolHead*> pools_;
         };
+
+        // A thread-safe memory pool that allocates by advancing a pointer in a
+        // preallocated arena. Memory is not reused when items are returned;
+        // instead the whole arena is reset at once when none of its items are in
+        // use, for example at the end of handling a request.
+        class MemoryPoolArena : public MemoryPool
+        {
+        public:
+            struct statistics
+            {
+                // Byte size of the arena, excluding overflow allocations
+                std::size_t capacity_byte_count = 0;
+
+                // Bytes used since the last reset, including overflow
+                std::size_t used_byte_count = 0;
+
+                // Largest used_byte_count seen
+                std::size_t peak_used_byte_count = 0;
+
+                // Number of allocations that did not fit in the arena
+                std::size_t overflow_count = 0;
+
+                // Total bytes used by allocations that did not fit in the arena
+                std::size_t overflow_byte_count = 0;
+
+                // Number of times the arena has been reset
+                std::size_t reset_count = 0;
+            };
+
+            // Creates an arena of capacity_byte_count bytes. If allow_overflow is
+            // true, allocations that do not fit are served from additional
+            // memory that is released at the next reset; otherwise they throw
+            // std::bad_alloc. If huge_pages is true, the arena is backed by huge
+            // pages where supported.
+            MemoryPoolArena(std::size_t capacity_byte_count,
+                bool allow_overflow = true, bool huge_pages = false);
+
+            ~MemoryPoolArena() noexcept override;
+
+            SEAL_NODISCARD Pointer<SEAL_BYTE> get_for_byte_count(
+                std::size_t byte_count) override;
+
+            SEAL_NODISCARD std::size_t pool_count() const override;
+
+            // Returns the byte size of the arena plus any overflow memory
+            SEAL_NODISCARD std::size_t alloc_byte_count() const override;
+
+            SEAL_NODISCARD std::size_t in_use_byte_count() const override;
+
+            // Resets the arena if none of its items are in use and more than
+            // max_retained_bytes are allocated, releasing overflow memory,
+            // newest first, until at most max_retained_bytes are allocated.
+            // Overflow memory that is kept is used again before any new memory
+            // is allocated. The arena itself is never released.
+            std::size_t trim(std::size_t max_retained_bytes) override;
+
+            SEAL_NODISCARD std::vector<MemoryPoolHead::statistics> size_stats() const override;
+
+            // Makes all of the arena available again and releases overflow
+            // memory. Returns false and does nothing if any items are in use.
+            bool reset() noexcept;
+
+            SEAL_NODISCARD statistics stats() const noexcept;
+
+            SEAL_NODISCARD inline bool allow_overflow() const noexcept
+            {
+                return allow_overflow_;
+            }
+
+        private:
+            friend class MemoryPoolHeadArena;
+
+            MemoryPoolArena(const MemoryPoolArena &copy) = delete;
+
+            MemoryPoolArena &operator =(const MemoryPoolArena &assign) = delete;
+
+            // Allocates an item of item_byte_count bytes with its MemoryPoolItem;
+            // new_byte_count is set to the size of any overflow memory allocated
+            MemoryPoolItem *allocate(std::size_t item_byte_count, std::size_t &new_byte_count);
+
+            // Total byte size of the arena and overflow memory
+            std::size_t chunk_byte_count() const noexcept;
+
+            // Releases overflow memory until at most max_retained_bytes are
+            // allocated and makes the rest available again
+            bool reset_locked(std::size_t max_retained_bytes) noexcept;
+
+            const bool allow_overflow_;
+
+            const bool huge_pages_;
+
+            mutable std::atomic<bool> locked_{ false };
+
+            std::atomic<std::size_t> in_use_count_{ 0 };
+
+            // The first chunk is the arena; any others are overflow memory
+            std::vector<MemoryPoolHead::allocation> chunks_;
+
+            // Index of the chunk new items are taken from
+            std::size_t current_chunk_ = 0;
+
+            std::vector<MemoryPoolHeadArena*> pools_;
+
+            statistics stats_;
+        };
     }
 }
@@ -0,0 +1,75 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+#include "seal/util/parallel.h"
+
+using namespace std;
+
+namespace seal
+{
+    namespace util
+    {
+        void parallel_for(size_t thread_count, size_t task_count,
+            const function<void(size_t, size_t)> &task)
+        {
+            if (!thread_count)
+            {
+                thread_count = max<size_t>(thread::hardware_concurrency(), 1);
+            }
+            thread_count = min(thread_count, task_count);
+
+            atomic<size_t> next_task(0);
+            auto worker = [&](size_t thread_index) {
+                size_t i;
+                while ((i = next_task.fetch_add(1, memory_order_relaxed)) < task_count)
+                {
+                    task(thread_index, i);
+                }
+            };
+
+            if (thread_count <= 1)
+            {
+                worker(0);
+                return;
+            }
+
+            vector<exception_ptr> exceptions(thread_count);
+            auto guarded_worker = [&](size_t thread_index) {
+                try
+                {
+                    worker(thread_index);
+                }
+                catch (...)
+                {
+                    // Stop other workers from picking up new work
+                    next_task = task_count;
+                    exceptions[thread_index] = current_exception();
+                }
+            };
+
+            vector<thread> threads;
+            threads.reserve(thread_count - 1);
+            for (size_t t = 1; t < thread_count; t++)
+            {
+                threads.emplace_back(guarded_worker, t);
+            }
+            guarded_worker(0);
+            for (auto &th : threads)
+            {
+                th.join();
+            }
+            for (auto &e : exceptions)
+            {
+                if (e)
+                {
+                    rethrow_exception(e);
+                }
+            }
+        }
+    }
+}
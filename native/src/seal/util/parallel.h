@@ -0,0 +1,25 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace seal
+{
+    namespace util
+    {
+        /**
+        Calls task(thread_index, i) for every i in [0, task_count) on up to
+        thread_count threads, one of which is the calling thread. Each thread
+        takes the next unprocessed index from a shared counter, and the thread
+        index (less than thread_count) can be used to keep per-thread state. If
+        a call throws, no further tasks are started, and once all threads have
+        finished the exception thrown on the lowest thread index is rethrown.
+        A thread_count of zero uses one thread per hardware thread.
+        */
+        void parallel_for(std::size_t thread_count, std::size_t task_count,
+            const std::function<void(std::size_t, std::size_t)> &task);
+    }
+}
@@ -20,6 +20,7 @@ namespace seal
         {
             friend class MemoryPoolST;
             friend class MemoryPoolMT;
+            friend class MemoryPoolArena;
 
         public:
             template<typename, typename> friend class Pointer;
@@ -204,6 +205,7 @@ namespace seal
         {
             friend class MemoryPoolST;
             friend class MemoryPoolMT;
+            friend class MemoryPoolArena;
 
         public:
             friend class Pointer<SEAL_BYTE>;
@@ -520,6 +522,7 @@ namespace seal
         {
             friend class MemoryPoolST;
             friend class MemoryPoolMT;
+            friend class MemoryPoolArena;
 
         public:
             template<typename, typename> friend class ConstPointer;
@@ -721,6 +724,7 @@ namespace seal
         {
             friend class MemoryPoolST;
             friend class MemoryPoolMT;
+            friend class MemoryPoolArena;
 
         public:
             ConstPointer() = default;
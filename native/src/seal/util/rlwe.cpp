@@ -1,6 +1,8 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT license.
 
+#include <array>
+#include <algorithm>
 #include "seal/randomtostd.h"
 #include "seal/util/rlwe.h"
 #include "seal/util/common.h"
@@ -17,41 +19,76 @@ namespace seal
 {
     namespace util
     {
+        namespace
+        {
+            // Number of coefficients sampled per call to the random generator; the
+            // random bytes and the sampled noise for one block fit comfortably on
+            // the stack and the per-limb writes below become contiguous loops.
+            constexpr size_t sample_block_coeff_count = 256;
+
+            // Branch-free population count for 64-bit words
+            SEAL_NODISCARD inline uint64_t popcount_uint64(uint64_t value) noexcept
+            {
+                value = value - ((value >> 1) & 0x5555555555555555ULL);
+                value = (value & 0x3333333333333333ULL) +
+                    ((value >> 2) & 0x3333333333333333ULL);
+                value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+                return (value * 0x0101010101010101ULL) >> 56;
+            }
+
+            // Writes a block of signed small values into every RNS component of
+            // destination. Negative values are mapped to modulus - |value| with a
+            // mask instead of a branch so that the inner loop vectorizes.
+            inline void set_small_poly_block(
+                const int64_t *noise, size_t block_count,
+                const vector<SmallModulus> &coeff_modulus,
+                size_t coeff_count, uint64_t *destination)
+            {
+                size_t coeff_mod_count = coeff_modulus.size();
+                for (size_t j = 0; j < coeff_mod_count; j++)
+                {
+                    uint64_t modulus = coeff_modulus[j].value();
+                    uint64_t *dest_ptr = destination + j * coeff_count;
+                    for (size_t i = 0; i < block_count; i++)
+                    {
+                        uint64_t flag = static_cast<uint64_t>(-static_cast<int64_t>(noise[i] < 0));
+                        dest_ptr[i] = static_cast<uint64_t>(noise[i]) + (flag & modulus);
+                    }
+                }
+            }
+        }
+
         void sample_poly_ternary(
             shared_ptr<UniformRandomGenerator> rng,
             const EncryptionParameters &parms,
             uint64_t *destination)
         {
-            auto coeff_modulus = parms.coeff_modulus();
-            size_t coeff_mod_count = coeff_modulus.size();
+            auto &coeff_modulus = parms.coeff_modulus();
             size_t coeff_count = parms.poly_modulus_degree();
-            RandomToStandardAdapter engine(rng);
-            uniform_int_distribution<int> dist(-1, 1);
 
-            for (size_t i = 0; i < coeff_count; i++)
+            // Each random byte below 255 = 3 * 85 gives one uniform ternary value;
+            // the rare byte 255 is rejected and the remaining slots are refilled.
+            array<uint8_t, sample_block_coeff_count> random_bytes;
+            array<int64_t, sample_block_coeff_count> noise;
+            for (size_t block_start = 0; block_start < coeff_count;
+                block_start += sample_block_coeff_count)
             {
-                int rand_index = dist(engine);
-                if (rand_index == 1)
+                size_t block_count = min(sample_block_coeff_count, coeff_count - block_start);
+                size_t filled = 0;
+                while (filled < block_count)
                 {
-                    for (size_t j = 0; j < coeff_mod_count; j++)
+                    size_t request_count = block_count - filled;
+                    rng->generate(request_count,
+                        reinterpret_cast<SEAL_BYTE*>(random_bytes.data()));
+                    for (size_t i = 0; i < request_count; i++)
                     {
-                        destination[i + j * coeff_count] = 1;
-                    }
-                }
-                else if (rand_index == -1)
-                {
-                    for (size_t j = 0; j < coeff_mod_count; j++)
-                    {
-                        destination[i + j * coeff_count] = coeff_modulus[j].value() - 1;
-                    }
-                }
-                else
-                {
-                    for (size_t j = 0; j < coeff_mod_count; j++)
-                    {
-                        destination[i + j * coeff_count] = 0;
+                        uint8_t value = random_bytes[i];
+                        noise[filled] = static_cast<int64_t>(value % 3) - 1;
+                        filled += static_cast<size_t>(value != 0xFF);
                     }
                 }
+                set_small_poly_block(noise.data(), block_count, coeff_modulus,
+                    coeff_count, destination + block_start);
             }
         }
 
@@ -60,7 +97,7 @@ namespace seal
             const EncryptionParameters &parms,
             uint64_t *destination)
         {
-            auto coeff_modulus = parms.coeff_modulus();
+            auto &coeff_modulus = parms.coeff_modulus();
             size_t coeff_mod_count = coeff_modulus.size();
             size_t coeff_count = parms.poly_modulus_degree();
 
@@ -74,32 +111,68 @@ namespace seal
             ClippedNormalDistribution dist(
                 0, global_variables::noise_standard_deviation,
                 global_variables::noise_max_deviation);
-            for (size_t i = 0; i < coeff_count; i++)
+            array<int64_t, sample_block_coeff_count> noise;
+            for (size_t block_start = 0; block_start < coeff_count;
+                block_start += sample_block_coeff_count)
             {
-                int64_t noise = static_cast<int64_t>(dist(engine));
-                if (noise > 0)
-                {
-                    for (size_t j = 0; j < coeff_mod_count; j++)
-                    {
-                        destination[i + j * coeff_count] = static_cast<uint64_t>(noise);
-                    }
-                }
-                else if (noise < 0)
+                size_t block_count = min(sample_block_coeff_count, coeff_count - block_start);
+                for (size_t i = 0; i < block_count; i++)
                 {
-                    noise = -noise;
-                    for (size_t j = 0; j < coeff_mod_count; j++)
-                    {
-                        destination[i + j * coeff_count] = coeff_modulus[j].value() -
-                            static_cast<uint64_t>(noise);
-                    }
+                    noise[i] = static_cast<int64_t>(dist(engine));
                 }
-                else
+                set_small_poly_block(noise.data(), block_count, coeff_modulus,
+                    coeff_count, destination + block_start);
+            }
+        }
+
+        void sample_poly_cbd(
+            shared_ptr<UniformRandomGenerator> rng,
+            const EncryptionParameters &parms,
+            uint64_t *destination)
+        {
+            auto &coeff_modulus = parms.coeff_modulus();
+            size_t coeff_mod_count = coeff_modulus.size();
+            size_t coeff_count = parms.poly_modulus_degree();
+
+            if (are_close(global_variables::noise_max_deviation, 0.0))
+            {
+                set_zero_poly(coeff_count, coeff_mod_count, destination);
+                return;
+            }
+
+            if (!are_close(global_variables::noise_standard_deviation, 3.2))
+            {
+                throw logic_error(
+                    "centered binomial distribution only supports standard deviation 3.2; "
+                    "use rounded Gaussian instead");
+            }
+
+            // Each coefficient is the difference of the Hamming weights of two 21-bit
+            // strings, giving variance 21 / 2 = 10.5, close to 3.2^2. The six random
+            // bytes used per coefficient are drawn for a whole block at once.
+            constexpr size_t cbd_byte_count = 6;
+            constexpr uint64_t cbd_mask = (uint64_t(1) << 21) - 1;
+            array<uint8_t, sample_block_coeff_count * cbd_byte_count> random_bytes;
+            array<int64_t, sample_block_coeff_count> noise;
+            for (size_t block_start = 0; block_start < coeff_count;
+                block_start += sample_block_coeff_count)
+            {
+                size_t block_count = min(sample_block_coeff_count, coeff_count - block_start);
+                rng->generate(block_count * cbd_byte_count,
+                    reinterpret_cast<SEAL_BYTE*>(random_bytes.data()));
+                const uint8_t *bytes = random_bytes.data();
+                for (size_t i = 0; i < block_count; i++, bytes += cbd_byte_count)
                 {
-                    for (size_t j = 0; j < coeff_mod_count; j++)
+                    uint64_t x = 0;
+                    for (size_t k = 0; k < cbd_byte_count; k++)
                     {
-                        destination[i + j * coeff_count] = 0;
+                        x |= static_cast<uint64_t>(bytes[k]) << (8 * k);
                     }
+                    noise[i] = static_cast<int64_t>(popcount_uint64(x & cbd_mask)) -
+                        static_cast<int64_t>(popcount_uint64((x >> 21) & cbd_mask));
                 }
+                set_small_poly_block(noise.data(), block_count, coeff_modulus,
+                    coeff_count, destination + block_start);
             }
         }
 
@@ -142,6 +215,7 @@ namespace seal
             shared_ptr<SEALContext> context,
             parms_id_type parms_id,
             bool is_ntt_form,
+            shared_ptr<UniformRandomGenerator> rng,
             Ciphertext &destination)
         {
 #ifdef SEAL_DEBUG
@@ -168,9 +242,7 @@ namespace seal
             destination.scale() = 1.0;
 
             // c[j] = public_key[j] * u + e[j] where e[j] <-- chi, u <-- R_3.
-
-            // Create RNG, u and error share one RNG.
-            auto rng = parms.random_generator()->create();
+            // u and error share one RNG.
 
             // Generate u <-- R_3
             auto u(allocate_poly(coeff_count, coeff_mod_count, pool));
@@ -205,7 +277,7 @@ namespace seal
             // c[j] = public_key[j] * u + e[j]
             for (size_t j = 0; j < encrypted_size; j++)
             {
-                sample_poly_normal(rng, parms, u.get());
+                SEAL_NOISE_SAMPLER(rng, parms, u.get());
                 for (size_t i = 0; i < coeff_mod_count; i++)
                 {
                     // addition with e_0, e_1 is in NTT form.
@@ -231,6 +303,7 @@ namespace seal
             parms_id_type parms_id,
             bool is_ntt_form,
             bool save_seed,
+            shared_ptr<UniformRandomGenerator> rng,
             Ciphertext &destination)
         {
 #ifdef SEAL_DEBUG
@@ -262,14 +335,32 @@ namespace seal
             destination.is_ntt_form() = is_ntt_form;
             destination.scale() = 1.0;
 
-            auto rng_error = parms.random_generator()->create();
-            shared_ptr<UniformRandomGenerator> rng_ciphertext;
-            rng_ciphertext = BlakePRNGFactory().create();
+            auto rng_error = rng;
 
             // Generate ciphertext: (c[0], c[1]) = ([-(as+e)]_q, a)
             uint64_t *c0 = destination.data();
             uint64_t *c1 = destination.data(1);
 
+            // Sample e <-- chi before a. Without a saved seed, a is drawn from
+            // the same generator as e; sampling e first keeps the error the same
+            // whether or not the seed is saved, as it was when e and a always
+            // came from separate generators.
+            auto noise(allocate_poly(coeff_count, coeff_mod_count, pool));
+            SEAL_NOISE_SAMPLER(rng_error, parms, noise.get());
+
+            // The seed of the generator for a must be stored and is expanded with
+            // BlakePRNG on load, so only a BlakePRNG can be used when saving the
+            // seed. Its seed is drawn from rng, so that the output depends only
+            // on the state of rng in either case.
+            shared_ptr<UniformRandomGenerator> rng_ciphertext = rng;
+            if (save_seed)
+            {
+                random_seed_type ciphertext_seed;
+                rng->generate(sizeof(ciphertext_seed),
+                    reinterpret_cast<SEAL_BYTE*>(ciphertext_seed.data()));
+                rng_ciphertext = BlakePRNGFactory().create(ciphertext_seed);
+            }
+
             // Sample a uniformly at random
             if (is_ntt_form || !save_seed)
             {
@@ -289,10 +380,6 @@ namespace seal
                 }
             }
 
-            // Sample e <-- chi
-            auto noise(allocate_poly(coeff_count, coeff_mod_count, pool));
-            sample_poly_normal(rng_error, parms, noise.get());
-
             // calculate -(a*s + e) (mod q) and store in c[0]
             for (size_t i = 0; i < coeff_mod_count; i++)
             {
@@ -17,11 +17,11 @@ namespace seal
     namespace util
     {
         /**
-        Generate a ternary polynomial uniformlly and store in RNS representation.
+        Generate a ternary polynomial uniformly and store in RNS representation.
 
         @param[in] rng A uniform random generator.
-        @param[in] parms EncryptionParameters used to parametize an RNS polynomial.
-        @param[out] destination Allocated space to store a random polynomia.
+        @param[in] parms EncryptionParameters used to parameterize an RNS polynomial.
+        @param[out] destination Allocated space to store a random polynomial.
         */
         void sample_poly_ternary(
             std::shared_ptr<UniformRandomGenerator> rng,
@@ -32,20 +32,39 @@ namespace seal
         Generate a polynomial from a normal distribution and store in RNS representation.
 
         @param[in] rng A uniform random generator.
-        @param[in] parms EncryptionParameters used to parametize an RNS polynomial.
-        @param[out] destination Allocated space to store a random polynomia.
+        @param[in] parms EncryptionParameters used to parameterize an RNS polynomial.
+        @param[out] destination Allocated space to store a random polynomial.
         */
         void sample_poly_normal(
             std::shared_ptr<UniformRandomGenerator> rng,
             const EncryptionParameters &parms,
             std::uint64_t *destination);
 
+        /**
+        Generate a polynomial from a centered binomial distribution and store in RNS
+        representation. The distribution has variance 10.5, approximating a normal
+        distribution with standard deviation 3.2, and is sampled in blocks from bulk
+        random bytes without branching on the sampled values. Unlike
+        sample_poly_normal, it does not clip to noise_max_deviation: samples are
+        bounded by 21 in absolute value instead. Encryption uses it only if SEAL
+        is built with SEAL_USE_CBD_NOISE.
+
+        @param[in] rng A uniform random generator.
+        @param[in] parms EncryptionParameters used to parameterize an RNS polynomial.
+        @param[out] destination Allocated space to store a random polynomial.
+        @throws std::logic_error if the noise standard deviation is not 3.2
+        */
+        void sample_poly_cbd(
+            std::shared_ptr<UniformRandomGenerator> rng,
+            const EncryptionParameters &parms,
+            std::uint64_t *destination);
+
         /**
         Generate a polynomial uniformly from Rq and store in RNS representation.
 
         @param[in] rng A uniform random generator.
-        @param[in] parms EncryptionParameters used to parametize an RNS polynomial.
-        @param[out] destination Allocated space to store a random polynomia.
+        @param[in] parms EncryptionParameters used to parameterize an RNS polynomial.
+        @param[out] destination Allocated space to store a random polynomial.
         */
         void sample_poly_uniform(
             std::shared_ptr<UniformRandomGenerator> rng,
@@ -59,6 +78,7 @@ namespace seal
         @param[in] context The SEALContext containing a chain of ContextData.
         @param[in] parms_id Indicates the level of encryption.
         @param[in] is_ntt_form If true, store Ciphertext in NTT form.
+        @param[in] rng A uniform random generator for sampling u and the errors.
         @param[out] destination The output ciphertext - an encryption of zero.
         */
         void encrypt_zero_asymmetric(
@@ -66,6 +86,7 @@ namespace seal
             std::shared_ptr<SEALContext> context,
             parms_id_type parms_id,
             bool is_ntt_form,
+            std::shared_ptr<UniformRandomGenerator> rng,
             Ciphertext &destination);
 
         /**
@@ -78,6 +99,8 @@ namespace seal
         @param[in] is_ntt_form If true, store Ciphertext in NTT form.
         @param[in] save_seed If true, The second component of ciphertext is
         replaced with the random seed used to sample this component.
+        @param[in] rng A uniform random generator for sampling the error; unless
+        save_seed is true, it is also used for sampling the second component.
         */
         void encrypt_zero_symmetric(
             const SecretKey &secret_key,
@@ -85,6 +108,7 @@ namespace seal
             parms_id_type parms_id,
             bool is_ntt_form,
             bool save_seed,
+            std::shared_ptr<UniformRandomGenerator> rng,
             Ciphertext &destination);
     }
 }
@@ -7,7 +7,10 @@
 #include "seal/smallmodulus.h"
 #include "seal/util/uintarithsmallmod.h"
 #include "seal/util/defines.h"
+#include "seal/util/common.h"
 #include <algorithm>
+#include <tuple>
+#include <vector>
 
 using namespace std;
 
@@ -47,6 +50,68 @@ namespace seal
             inv_degree_modulo_ = 0;
             coeff_count_power_ = 0;
             coeff_count_ = 0;
+            loaded_digest_.reset();
+        }
+
+        void SmallNTTTables::alias(SmallNTTTables &source)
+        {
+            if (!source.generated_)
+            {
+                throw invalid_argument("source tables are not generated");
+            }
+            reset();
+
+            root_ = source.root_;
+            coeff_count_power_ = source.coeff_count_power_;
+            coeff_count_ = source.coeff_count_;
+            modulus_ = source.modulus_;
+            inv_degree_modulo_ = source.inv_degree_modulo_;
+            root_powers_ = Pointer<uint64_t>::Aliasing(source.root_powers_.get());
+            scaled_root_powers_ = Pointer<uint64_t>::Aliasing(source.scaled_root_powers_.get());
+            inv_root_powers_ = Pointer<uint64_t>::Aliasing(source.inv_root_powers_.get());
+            scaled_inv_root_powers_ =
+                Pointer<uint64_t>::Aliasing(source.scaled_inv_root_powers_.get());
+            inv_root_powers_div_two_ =
+                Pointer<uint64_t>::Aliasing(source.inv_root_powers_div_two_.get());
+            scaled_inv_root_powers_div_two_ =
+                Pointer<uint64_t>::Aliasing(source.scaled_inv_root_powers_div_two_.get());
+            loaded_digest_ = source.loaded_digest_;
+            generated_ = true;
+        }
+
+        HashFunction::hash_block_type SmallNTTTables::digest(uint64_t modulus_value) const
+        {
+            // Covers the modulus, the root, the inverse degree and the arrays
+            blake2b_state state;
+            uint64_t values[3]{ modulus_value, root_, inv_degree_modulo_ };
+            size_t byte_count = mul_safe(coeff_count_, sizeof(uint64_t));
+            bool failed = blake2b_init(&state, HashFunction::hash_block_byte_count) ||
+                blake2b_update(&state, values, sizeof(values));
+            for (auto array : { root_powers_.get(), scaled_root_powers_.get(),
+                inv_root_powers_.get(), scaled_inv_root_powers_.get(),
+                inv_root_powers_div_two_.get(), scaled_inv_root_powers_div_two_.get() })
+            {
+                failed = failed || blake2b_update(&state, array, byte_count);
+            }
+            HashFunction::hash_block_type result;
+            if (failed || blake2b_final(&state, result.data(),
+                HashFunction::hash_block_byte_count))
+            {
+                throw runtime_error("blake2b failed");
+            }
+            return result;
+        }
+
+        void SmallNTTTables::verify_loaded_digest() const
+        {
+            // If the check throws, the flag is not set and the next call checks
+            // again
+            call_once(loaded_digest_->verified, [this]() {
+                if (digest(modulus_.value()) != loaded_digest_->digest)
+                {
+                    throw logic_error("invalid NTT tables");
+                }
+            });
         }
 
         bool SmallNTTTables::generate(int coeff_count_power,
@@ -149,6 +214,179 @@ namespace seal
             }
         }
 
+        SmallNTTTablesCache::SmallNTTTablesCache(int coeff_count_power,
+            MemoryPoolHandle pool) :
+            coeff_count_power_(coeff_count_power), pool_(move(pool))
+        {
+            if (!pool_)
+            {
+                throw invalid_argument("pool is uninitialized");
+            }
+            if ((coeff_count_power < get_power_of_two(SEAL_POLY_MOD_DEGREE_MIN)) ||
+                coeff_count_power > get_power_of_two(SEAL_POLY_MOD_DEGREE_MAX))
+            {
+                throw invalid_argument("coeff_count_power out of range");
+            }
+        }
+
+        bool SmallNTTTablesCache::get(const SmallModulus &modulus,
+            SmallNTTTables &destination)
+        {
+            auto it = tables_.find(modulus.value());
+            if (it == tables_.end())
+            {
+                // Moduli for which generation fails are stored too, so that they
+                // are not tried again
+                it = tables_.emplace(piecewise_construct,
+                    forward_as_tuple(modulus.value()),
+                    forward_as_tuple(pool_)).first;
+                it->second.generate(coeff_count_power_, modulus);
+            }
+            auto &tables = it->second;
+            if (!tables.is_generated())
+            {
+                destination.reset();
+                return false;
+            }
+            if (tables.modulus_.is_zero())
+            {
+                // Tables loaded with load_view: the root must be a primitive 2n-th
+                // root of unity and the inverse degree must be correct; the powers
+                // themselves are trusted
+                if (!modulus.is_prime() || tables.root_ >= modulus.value() ||
+                    exponentiate_uint_mod(tables.root_, tables.coeff_count_, modulus) !=
+                        modulus.value() - 1 ||
+                    multiply_uint_uint_mod(tables.inv_degree_modulo_, tables.coeff_count_,
+                        modulus) != 1)
+                {
+                    throw logic_error("invalid NTT tables");
+                }
+                tables.modulus_ = modulus;
+            }
+            destination.alias(tables);
+            return true;
+        }
+
+        size_t SmallNTTTablesCache::view_size() const
+        {
+            size_t table_size = add_safe(view_aligned_size(3 * sizeof(uint64_t)),
+                view_aligned_size(HashFunction::hash_block_byte_count));
+            table_size = add_safe(table_size, mul_safe(size_t(6),
+                view_aligned_size(mul_safe(size_t(1) << coeff_count_power_, sizeof(uint64_t)))));
+            size_t table_count = safe_cast<size_t>(count_if(tables_.cbegin(), tables_.cend(),
+                [](auto &entry) { return entry.second.is_generated(); }));
+            return add_safe(view_aligned_size(2 * sizeof(uint64_t)),
+                mul_safe(table_count, table_size));
+        }
+
+        void SmallNTTTablesCache::save_view(ViewWriter &writer) const
+        {
+            // Sort by modulus so that the output does not depend on the hash map
+            vector<const pair<const uint64_t, SmallNTTTables>*> generated_tables;
+            for (auto &entry : tables_)
+            {
+                if (entry.second.is_generated())
+                {
+                    generated_tables.push_back(&entry);
+                }
+            }
+            sort(generated_tables.begin(), generated_tables.end(),
+                [](auto a, auto b) { return a->first < b->first; });
+
+            uint64_t coeff_count_power64 = static_cast<uint64_t>(coeff_count_power_);
+            uint64_t table_count64 = safe_cast<uint64_t>(generated_tables.size());
+            writer.write(&coeff_count_power64, sizeof(uint64_t));
+            writer.write(&table_count64, sizeof(uint64_t));
+            writer.align();
+
+            for (auto entry : generated_tables)
+            {
+                // Loaded tables are checked so that a digest is never computed
+                // over corrupted arrays
+                auto tables = &entry->second;
+                tables->verify();
+                auto digest = tables->digest(entry->first);
+                size_t byte_count = mul_safe(tables->coeff_count_, sizeof(uint64_t));
+                writer.write(&entry->first, sizeof(uint64_t));
+                writer.write(&tables->root_, sizeof(uint64_t));
+                writer.write(&tables->inv_degree_modulo_, sizeof(uint64_t));
+                writer.align();
+                writer.write(&digest, sizeof(digest));
+                writer.align();
+                for (auto array : { tables->root_powers_.get(),
+                    tables->scaled_root_powers_.get(),
+                    tables->inv_root_powers_.get(),
+                    tables->scaled_inv_root_powers_.get(),
+                    tables->inv_root_powers_div_two_.get(),
+                    tables->scaled_inv_root_powers_div_two_.get() })
+                {
+                    writer.write(array, byte_count);
+                    writer.align();
+                }
+            }
+        }
+
+        void SmallNTTTablesCache::load_view(ViewReader &reader)
+        {
+            uint64_t coeff_count_power64 = 0;
+            uint64_t table_count64 = 0;
+            reader.read(&coeff_count_power64, sizeof(uint64_t));
+            reader.read(&table_count64, sizeof(uint64_t));
+            reader.align();
+            if (coeff_count_power64 != static_cast<uint64_t>(coeff_count_power_))
+            {
+                throw logic_error("loaded tables have a different coeff_count_power");
+            }
+
+            size_t coeff_count = size_t(1) << coeff_count_power_;
+            for (uint64_t i = 0; i < table_count64; i++)
+            {
+                uint64_t modulus_value = 0;
+                uint64_t root = 0;
+                uint64_t inv_degree_modulo = 0;
+                reader.read(&modulus_value, sizeof(uint64_t));
+                reader.read(&root, sizeof(uint64_t));
+                reader.read(&inv_degree_modulo, sizeof(uint64_t));
+                reader.align();
+                auto loaded_digest = make_shared<SmallNTTTables::LoadedDigest>();
+                reader.read(&loaded_digest->digest, sizeof(loaded_digest->digest));
+                reader.align();
+
+                if (modulus_value < 2 || modulus_value >> 62)
+                {
+                    throw logic_error("invalid modulus");
+                }
+
+                auto result = tables_.emplace(piecewise_construct,
+                    forward_as_tuple(modulus_value), forward_as_tuple(pool_));
+                if (!result.second)
+                {
+                    throw logic_error("duplicate NTT tables");
+                }
+                // The modulus is set and the tables are checked when they are
+                // first requested, as constructing a SmallModulus tests primality
+                auto &tables = result.first->second;
+                tables.coeff_count_power_ = coeff_count_power_;
+                tables.coeff_count_ = coeff_count;
+                tables.root_ = root;
+                tables.inv_degree_modulo_ = inv_degree_modulo;
+                tables.loaded_digest_ = move(loaded_digest);
+                tables.root_powers_ = Pointer<uint64_t>::Aliasing(
+                    reader.take_array<uint64_t>(coeff_count));
+                tables.scaled_root_powers_ = Pointer<uint64_t>::Aliasing(
+                    reader.take_array<uint64_t>(coeff_count));
+                tables.inv_root_powers_ = Pointer<uint64_t>::Aliasing(
+                    reader.take_array<uint64_t>(coeff_count));
+                tables.scaled_inv_root_powers_ = Pointer<uint64_t>::Aliasing(
+                    reader.take_array<uint64_t>(coeff_count));
+                tables.inv_root_powers_div_two_ = Pointer<uint64_t>::Aliasing(
+                    reader.take_array<uint64_t>(coeff_count));
+                tables.scaled_inv_root_powers_div_two_ = Pointer<uint64_t>::Aliasing(
+                    reader.take_array<uint64_t>(coeff_count));
+                tables.generated_ = true;
+            }
+        }
+
         /**
         This function computes in-place the negacyclic NTT. The input is
         a polynomial a of degree n in R_q, where n is assumed to be a power of
@@ -162,6 +400,7 @@ namespace seal
         void ntt_negacyclic_harvey_lazy(uint64_t *operand,
             const SmallNTTTables &tables)
         {
+            tables.verify();
             uint64_t modulus = tables.modulus().value();
             uint64_t two_times_modulus = modulus * 2;
 
@@ -211,29 +450,48 @@ namespace seal
                         }
                     }
                 }
+                else if (t == 2)
+                {
+                    // The butterflies of the last two stages are written out, as
+                    // the inner loop is too short for the loop overhead to pay off
+                    uint64_t *X = operand;
+                    for (size_t i = 0; i < m; i++, X += 4)
+                    {
+                        const uint64_t W = tables.get_from_root_powers(m + i);
+                        const uint64_t Wprime = tables.get_from_scaled_root_powers(m + i);
+
+                        uint64_t currX;
+                        unsigned long long Q;
+                        currX = X[0] - (two_times_modulus & static_cast<uint64_t>(-static_cast<int64_t>(X[0] >= two_times_modulus)));
+                        multiply_uint64_hw64(Wprime, X[2], &Q);
+                        Q = W * X[2] - Q * modulus;
+                        X[0] = currX + Q;
+                        X[2] = currX + (two_times_modulus - Q);
+
+                        currX = X[1] - (two_times_modulus & static_cast<uint64_t>(-static_cast<int64_t>(X[1] >= two_times_modulus)));
+                        multiply_uint64_hw64(Wprime, X[3], &Q);
+                        Q = W * X[3] - Q * modulus;
+                        X[1] = currX + Q;
+                        X[3] = currX + (two_times_modulus - Q);
+                    }
+                }
                 else
                 {
-                    for (size_t i = 0; i < m; i++)
+                    uint64_t *X = operand;
+                    for (size_t i = 0; i < m; i++, X += 2)
                     {
-                        size_t j1 = 2 * i * t;
-                        size_t j2 = j1 + t;
                         const uint64_t W = tables.get_from_root_powers(m + i);
                         const uint64_t Wprime = tables.get_from_scaled_root_powers(m + i);
 
-                        uint64_t *X = operand + j1;
-                        uint64_t *Y = X + t;
+                        // The Harvey butterfly: assume X, Y in [0, 2p), and return X', Y' in [0, 4p).
+                        // X', Y' = X + WY, X - WY (mod p).
                         uint64_t currX;
                         unsigned long long Q;
-                        for (size_t j = j1; j < j2; j++)
-                        {
-                            // The Harvey butterfly: assume X, Y in [0, 2p), and return X', Y' in [0, 4p).
-                            // X', Y' = X + WY, X - WY (mod p).
-                            currX = *X - (two_times_modulus & static_cast<uint64_t>(-static_cast<int64_t>(*X >= two_times_modulus)));
-                            multiply_uint64_hw64(Wprime, *Y, &Q);
-                            Q = W * *Y - Q * modulus;
-                            *X++ = currX + Q;
-                            *Y++ = currX + (two_times_modulus - Q);
-                        }
+                        currX = X[0] - (two_times_modulus & static_cast<uint64_t>(-static_cast<int64_t>(X[0] >= two_times_modulus)));
+                        multiply_uint64_hw64(Wprime, X[1], &Q);
+                        Q = W * X[1] - Q * modulus;
+                        X[0] = currX + Q;
+                        X[1] = currX + (two_times_modulus - Q);
                     }
                 }
                 t >>= 1;
@@ -243,6 +501,7 @@ namespace seal
         // Inverse negacyclic NTT using Harvey's butterfly. (See Patrick Longa and Michael Naehrig).
         void inverse_ntt_negacyclic_harvey_lazy(uint64_t *operand, const SmallNTTTables &tables)
         {
+            tables.verify();
             uint64_t modulus = tables.modulus().value();
             uint64_t two_times_modulus = modulus * 2;
 
@@ -297,45 +556,60 @@ namespace seal
                         j1 += (t << 1);
                     }
                 }
+                else if (t == 2)
+                {
+                    // The butterflies of the first two stages are written out, as
+                    // the inner loop is too short for the loop overhead to pay off
+                    uint64_t *U = operand;
+                    for (size_t i = 0; i < h; i++, U += 4)
+                    {
+                        const uint64_t W = tables.get_from_inv_root_powers_div_two(h + i);
+                        const uint64_t Wprime = tables.get_from_scaled_inv_root_powers_div_two(h + i);
+
+                        uint64_t currU;
+                        uint64_t T;
+                        unsigned long long H;
+                        T = two_times_modulus - U[2] + U[0];
+                        currU = U[0] + U[2] - (two_times_modulus & static_cast<uint64_t>(-static_cast<int64_t>((U[0] << 1) >= T)));
+                        U[0] = (currU + (modulus & static_cast<uint64_t>(-static_cast<int64_t>(T & 1)))) >> 1;
+                        multiply_uint64_hw64(Wprime, T, &H);
+                        U[2] = W * T - H * modulus;
+
+                        T = two_times_modulus - U[3] + U[1];
+                        currU = U[1] + U[3] - (two_times_modulus & static_cast<uint64_t>(-static_cast<int64_t>((U[1] << 1) >= T)));
+                        U[1] = (currU + (modulus & static_cast<uint64_t>(-static_cast<int64_t>(T & 1)))) >> 1;
+                        multiply_uint64_hw64(Wprime, T, &H);
+                        U[3] = W * T - H * modulus;
+                    }
+                }
                 else
                 {
-                    for (size_t i = 0; i < h; i++)
+                    uint64_t *U = operand;
+                    for (size_t i = 0; i < h; i++, U += 2)
                     {
-                        size_t j2 = j1 + t;
                         // Need the powers of  phi^{-1} in bit-reversed order
                         const uint64_t W = tables.get_from_inv_root_powers_div_two(h + i);
                         const uint64_t Wprime = tables.get_from_scaled_inv_root_powers_div_two(h + i);
 
-                        uint64_t *U = operand + j1;
-                        uint64_t *V = U + t;
+                        // U = x[i], V = x[i+m]
                         uint64_t currU;
                         uint64_t T;
                         unsigned long long H;
-                        for (size_t j = j1; j < j2; j++)
-                        {
-                            // U = x[i], V = x[i+m]
 
-                            // Compute U - V + 2q
-                            T = two_times_modulus - *V + *U;
+                        // Compute U - V + 2q
+                        T = two_times_modulus - U[1] + U[0];
 
-                            // Cleverly check whether currU + currV >= two_times_modulus
-                            currU = *U + *V - (two_times_modulus & static_cast<uint64_t>(-static_cast<int64_t>((*U << 1) >= T)));
+                        // Cleverly check whether currU + currV >= two_times_modulus
+                        currU = U[0] + U[1] - (two_times_modulus & static_cast<uint64_t>(-static_cast<int64_t>((U[0] << 1) >= T)));
 
-                            // Need to make it so that div2_uint_mod takes values that are > q.
-                            //div2_uint_mod(U, modulusptr, coeff_uint64_count, U);
-                            // We use also the fact that parity of currU is same as parity of T.
-                            // Since our modulus is always so small that currU + masked_modulus < 2^64,
-                            // we never need to worry about wrapping around when adding masked_modulus.
-                            //uint64_t masked_modulus = modulus & static_cast<uint64_t>(-static_cast<int64_t>(T & 1));
-                            //uint64_t carry = add_uint64(currU, masked_modulus, 0, &currU);
-                            //currU += modulus & static_cast<uint64_t>(-static_cast<int64_t>(T & 1));
-                            *U++ = (currU + (modulus & static_cast<uint64_t>(-static_cast<int64_t>(T & 1)))) >> 1;
+                        // We use also the fact that parity of currU is same as parity of T.
+                        // Since our modulus is always so small that currU + masked_modulus < 2^64,
+                        // we never need to worry about wrapping around when adding masked_modulus.
+                        U[0] = (currU + (modulus & static_cast<uint64_t>(-static_cast<int64_t>(T & 1)))) >> 1;
 
-                            multiply_uint64_hw64(Wprime, T, &H);
-                            // effectively, the next two multiply perform multiply modulo beta = 2**wordsize.
-                            *V++ = W * T - H * modulus;
-                        }
-                        j1 += (t << 1);
+                        multiply_uint64_hw64(Wprime, T, &H);
+                        // effectively, the next two multiply perform multiply modulo beta = 2**wordsize.
+                        U[1] = W * T - H * modulus;
                     }
                 }
                 t <<= 1;
@@ -3,8 +3,13 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_map>
+#include "seal/util/hash.h"
 #include "seal/util/pointer.h"
+#include "seal/util/viewlayout.h"
 #include "seal/memorymanager.h"
 #include "seal/smallmodulus.h"
 
@@ -36,8 +41,31 @@ namespace seal
 
             bool generate(int coeff_count_power, const SmallModulus &modulus);
 
+            /**
+            Makes these tables refer to the arrays of the given generated tables
+            instead of owning a copy. The source tables must outlive this object
+            and must not be regenerated or reset while it is in use.
+            */
+            void alias(SmallNTTTables &source);
+
             void reset();
 
+            /**
+            Checks the arrays of tables loaded with SmallNTTTablesCache::load_view
+            against the digest saved with them, the first time it is called for
+            the loaded tables or any tables aliasing them. The transforms call
+            this before reading the arrays; for generated tables it does nothing.
+
+            @throws std::logic_error if the arrays do not match the digest
+            */
+            inline void verify() const
+            {
+                if (loaded_digest_)
+                {
+                    verify_loaded_digest();
+                }
+            }
+
             SEAL_NODISCARD inline std::uint64_t get_root() const
             {
 #ifdef SEAL_DEBUG
@@ -173,6 +201,8 @@ namespace seal
             }
 
         private:
+            friend class SmallNTTTablesCache;
+
             SmallNTTTables(const SmallNTTTables &copy) = delete;
 
             SmallNTTTables(SmallNTTTables &&source) = delete;
@@ -191,6 +221,19 @@ namespace seal
             void ntt_scale_powers_of_primitive_root(const std::uint64_t *input,
                 std::uint64_t *destination) const;
 
+            // Computes the digest saved with the tables by SmallNTTTablesCache
+            SEAL_NODISCARD HashFunction::hash_block_type digest(
+                std::uint64_t modulus_value) const;
+
+            void verify_loaded_digest() const;
+
+            struct LoadedDigest
+            {
+                std::once_flag verified;
+
+                HashFunction::hash_block_type digest;
+            };
+
             MemoryPoolHandle pool_;
 
             bool generated_ = false;
@@ -223,6 +266,75 @@ namespace seal
 
             std::uint64_t inv_degree_modulo_ = 0;
 
+            // Set for tables loaded with SmallNTTTablesCache::load_view, and
+            // shared with the tables aliasing them
+            std::shared_ptr<LoadedDigest> loaded_digest_;
+        };
+
+        /**
+        Stores SmallNTTTables by modulus, so that the tables for a prime used in
+        several places, such as every level of the modulus switching chain, are
+        generated and stored only once. Tables handed out by get alias the cached
+        tables, so the cache must outlive them. This class is not thread-safe.
+        */
+        class SmallNTTTablesCache
+        {
+        public:
+            SmallNTTTablesCache(int coeff_count_power,
+                MemoryPoolHandle pool = MemoryManager::GetPool());
+
+            /**
+            Makes destination alias the cached tables for the given modulus,
+            generating them first if needed. Returns false if NTT tables cannot
+            be generated for the modulus.
+
+            @throws std::logic_error if the tables were loaded and are invalid
+            */
+            bool get(const SmallModulus &modulus, SmallNTTTables &destination);
+
+            SEAL_NODISCARD inline int coeff_count_power() const noexcept
+            {
+                return coeff_count_power_;
+            }
+
+            /**
+            Returns the number of moduli for which tables have been requested.
+            */
+            SEAL_NODISCARD inline std::size_t size() const noexcept
+            {
+                return tables_.size();
+            }
+
+            /**
+            Returns the number of bytes save_view writes.
+            */
+            SEAL_NODISCARD std::size_t view_size() const;
+
+            /**
+            Writes all generated tables in the view layout (see ViewWriter).
+            */
+            void save_view(ViewWriter &writer) const;
+
+            /**
+            Adds the tables written by save_view to the cache. The tables refer to
+            the data in place, so it must outlive the cache. The roots and inverse
+            degrees are checked when the tables are first requested with get, and
+            the arrays of powers are checked against their saved digest when they
+            are first used by a transform (see SmallNTTTables::verify), so loading
+            does not read them.
+            */
+            void load_view(ViewReader &reader);
+
+        private:
+            SmallNTTTablesCache(const SmallNTTTablesCache &copy) = delete;
+
+            SmallNTTTablesCache &operator =(const SmallNTTTablesCache &assign) = delete;
+
+            int coeff_count_power_;
+
+            MemoryPoolHandle pool_;
+
+            std::unordered_map<std::uint64_t, SmallNTTTables> tables_;
         };
 
         void ntt_negacyclic_harvey_lazy(std::uint64_t *operand,
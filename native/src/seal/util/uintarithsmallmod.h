@@ -218,6 +218,63 @@ namespace seal
                     -static_cast<std::int64_t>(tmp[0] >= modulus.value())));
         }
 
+        // Returns -modulus^(-1) mod 2^64, the constant used by Montgomery
+        // reduction; the modulus must be odd
+        SEAL_NODISCARD inline std::uint64_t montgomery_neg_inv(
+            const SmallModulus &modulus)
+        {
+#ifdef SEAL_DEBUG
+            if (!(modulus.value() & 1))
+            {
+                throw std::invalid_argument("modulus");
+            }
+#endif
+            // Newton iteration doubles the number of correct low bits each
+            // round; modulus is its own inverse modulo 2^3
+            std::uint64_t inv = modulus.value();
+            for (int i = 0; i < 5; i++)
+            {
+                inv *= 2 - modulus.value() * inv;
+            }
+            return std::uint64_t(0) - inv;
+        }
+
+        template<typename T, typename = std::enable_if<is_uint64_v<T>>>
+        SEAL_NODISCARD inline std::uint64_t montgomery_reduce_128(
+            const T *input, const SmallModulus &modulus, std::uint64_t neg_inv)
+        {
+#ifdef SEAL_DEBUG
+            if (!input)
+            {
+                throw std::invalid_argument("input");
+            }
+            if (modulus.is_zero())
+            {
+                throw std::invalid_argument("modulus");
+            }
+            if (input[1] >= modulus.value())
+            {
+                throw std::invalid_argument("input");
+            }
+#endif
+            // Computes input * 2^(-64) mod modulus using Montgomery reduction;
+            // input must be less than modulus * 2^64 and neg_inv must be the
+            // value returned by montgomery_neg_inv
+
+            unsigned long long tmp[2], low;
+            std::uint64_t m = static_cast<std::uint64_t>(input[0]) * neg_inv;
+            multiply_uint64(m, modulus.value(), tmp);
+
+            // The low words cancel; only the carry out of the sum remains
+            unsigned char carry = add_uint64(input[0], tmp[0], &low);
+            std::uint64_t result = static_cast<std::uint64_t>(input[1]) +
+                static_cast<std::uint64_t>(tmp[1]) + carry;
+
+            // One more subtraction is enough
+            return result - (modulus.value() & static_cast<std::uint64_t>(
+                -static_cast<std::int64_t>(result >= modulus.value())));
+        }
+
         SEAL_NODISCARD inline std::uint64_t multiply_uint_uint_mod(
             std::uint64_t operand1, std::uint64_t operand2,
             const SmallModulus &modulus)
@@ -0,0 +1,172 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include "seal/util/defines.h"
+#include "seal/util/common.h"
+
+namespace seal
+{
+    namespace util
+    {
+        // Objects saved in the view layout (see Ciphertext::save_aligned) start
+        // with a 16-byte header: a magic number (2 bytes), 0x00 (1 byte), a
+        // reserved byte and 4 reserved bytes, and the size in bytes of the
+        // entire object including the header (8 bytes). Every field after the
+        // header, and every array, starts at a multiple of view_alignment from
+        // the beginning of the object, so that arrays can be used in place.
+        constexpr std::uint16_t view_magic = 0xA15F;
+
+        constexpr std::size_t view_alignment = 64;
+
+        constexpr std::size_t view_header_byte_count = 16;
+
+        // Rounds byte_count up to a multiple of view_alignment
+        SEAL_NODISCARD inline std::size_t view_aligned_size(std::size_t byte_count)
+        {
+            return add_safe(byte_count, view_alignment - 1) & ~(view_alignment - 1);
+        }
+
+        class ViewWriter
+        {
+        public:
+            ViewWriter(std::ostream &stream) : stream_(stream)
+            {
+            }
+
+            void write_header(std::size_t total_byte_count)
+            {
+                std::uint16_t magic = view_magic;
+                std::uint8_t zero_bytes[6]{};
+                std::uint64_t size64 = static_cast<std::uint64_t>(total_byte_count);
+                write(&magic, sizeof(magic));
+                write(zero_bytes, sizeof(zero_bytes));
+                write(&size64, sizeof(size64));
+                align();
+            }
+
+            void write(const void *data, std::size_t byte_count)
+            {
+                stream_.write(reinterpret_cast<const char*>(data),
+                    safe_cast<std::streamsize>(byte_count));
+                offset_ = add_safe(offset_, byte_count);
+            }
+
+            // Pads with zeros to the next multiple of view_alignment
+            void align()
+            {
+                static const char zeros[view_alignment]{};
+                std::size_t padding = view_aligned_size(offset_) - offset_;
+                stream_.write(zeros, static_cast<std::streamsize>(padding));
+                offset_ += padding;
+            }
+
+            SEAL_NODISCARD inline std::size_t offset() const noexcept
+            {
+                return offset_;
+            }
+
+        private:
+            std::ostream &stream_;
+
+            std::size_t offset_ = 0;
+        };
+
+        class ViewReader
+        {
+        public:
+            // The data must be aligned for 64-bit access
+            ViewReader(SEAL_BYTE *data, std::size_t byte_count) :
+                data_(data), byte_count_(byte_count)
+            {
+                if (!data)
+                {
+                    throw std::invalid_argument("in cannot be null");
+                }
+                if (reinterpret_cast<std::uintptr_t>(data) % alignof(std::uint64_t))
+                {
+                    throw std::invalid_argument("in is not aligned");
+                }
+            }
+
+            // Reads the header and limits reading to the object it describes.
+            // Returns the size of the object.
+            std::size_t read_header()
+            {
+                std::uint16_t magic = 0;
+                std::uint8_t zero_byte = 0xFF;
+                std::uint64_t size64 = 0;
+                read(&magic, sizeof(magic));
+                read(&zero_byte, sizeof(zero_byte));
+                (void)take(5);
+                read(&size64, sizeof(size64));
+                if (magic != view_magic || zero_byte != 0x00)
+                {
+                    throw std::logic_error("loaded data is not in the view layout");
+                }
+                if (size64 < view_header_byte_count || unsigned_gt(size64, byte_count_))
+                {
+                    throw std::logic_error("invalid data size");
+                }
+                byte_count_ = static_cast<std::size_t>(size64);
+                align();
+                return byte_count_;
+            }
+
+            void read(void *dest, std::size_t byte_count)
+            {
+                std::memcpy(dest, take(byte_count), byte_count);
+            }
+
+            // Returns a pointer to the next byte_count bytes and skips over them
+            SEAL_NODISCARD SEAL_BYTE *take(std::size_t byte_count)
+            {
+                if (byte_count > byte_count_ - offset_)
+                {
+                    throw std::logic_error("unexpected end of data");
+                }
+                SEAL_BYTE *result = data_ + offset_;
+                offset_ += byte_count;
+                return result;
+            }
+
+            // Returns a pointer to an aligned array of count elements of type T
+            // and skips over it
+            template<typename T>
+            SEAL_NODISCARD T *take_array(std::size_t count)
+            {
+                align();
+                T *result = reinterpret_cast<T*>(take(mul_safe(count, sizeof(T))));
+                align();
+                return result;
+            }
+
+            void align()
+            {
+                std::size_t aligned = view_aligned_size(offset_);
+                if (aligned > byte_count_)
+                {
+                    throw std::logic_error("unexpected end of data");
+                }
+                offset_ = aligned;
+            }
+
+            SEAL_NODISCARD inline std::size_t offset() const noexcept
+            {
+                return offset_;
+            }
+
+        private:
+            SEAL_BYTE *data_;
+
+            std::size_t byte_count_;
+
+            std::size_t offset_ = 0;
+        };
+    }
+}
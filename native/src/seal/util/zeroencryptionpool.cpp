@@ -0,0 +1,143 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <stdexcept>
+#include "seal/util/zeroencryptionpool.h"
+
+using namespace std;
+
+namespace seal
+{
+    namespace util
+    {
+        ZeroEncryptionPool::ZeroEncryptionPool(generator_type generator,
+            shared_ptr<UniformRandomGeneratorFactory> random_generator,
+            size_t depth, size_t thread_count) :
+            generator_(move(generator)),
+            random_generator_(move(random_generator)),
+            depth_(depth)
+        {
+            if (!generator_ || !random_generator_)
+            {
+                throw invalid_argument("generator and random_generator cannot be null");
+            }
+            if (!depth_ || !thread_count)
+            {
+                throw invalid_argument("depth and thread_count must be positive");
+            }
+            threads_.reserve(thread_count);
+            for (size_t i = 0; i < thread_count; i++)
+            {
+                threads_.emplace_back(&ZeroEncryptionPool::refill_worker, this);
+            }
+        }
+
+        ZeroEncryptionPool::~ZeroEncryptionPool()
+        {
+            {
+                lock_guard<mutex> lock(mutex_);
+                stop_ = true;
+            }
+            refill_cv_.notify_all();
+            for (auto &th : threads_)
+            {
+                th.join();
+            }
+        }
+
+        void ZeroEncryptionPool::reserve(const parms_id_type &parms_id)
+        {
+            {
+                lock_guard<mutex> lock(mutex_);
+                levels_[parms_id];
+            }
+            refill_cv_.notify_all();
+        }
+
+        bool ZeroEncryptionPool::try_take(const parms_id_type &parms_id,
+            Ciphertext &destination)
+        {
+            unique_lock<mutex> lock(mutex_);
+            auto &level = levels_[parms_id];
+            if (level.ready.empty())
+            {
+                lock.unlock();
+                refill_cv_.notify_all();
+                return false;
+            }
+
+            // The entry is removed before the lock is released, so it can never
+            // be handed out twice
+            destination = move(level.ready.front());
+            level.ready.pop_front();
+            lock.unlock();
+            refill_cv_.notify_one();
+            return true;
+        }
+
+        size_t ZeroEncryptionPool::size(const parms_id_type &parms_id)
+        {
+            lock_guard<mutex> lock(mutex_);
+            auto it = levels_.find(parms_id);
+            return it == levels_.end() ? 0 : it->second.ready.size();
+        }
+
+        void ZeroEncryptionPool::refill_worker()
+        {
+            auto rng = random_generator_->create();
+            unique_lock<mutex> lock(mutex_);
+            while (true)
+            {
+                // Find a level that needs more ciphertexts
+                parms_id_type parms_id;
+                Level *level = nullptr;
+                refill_cv_.wait(lock, [&]() {
+                    if (stop_)
+                    {
+                        return true;
+                    }
+                    for (auto &entry : levels_)
+                    {
+                        if (!entry.second.failed &&
+                            entry.second.ready.size() + entry.second.in_flight < depth_)
+                        {
+                            parms_id = entry.first;
+                            level = &entry.second;
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+                if (stop_)
+                {
+                    return;
+                }
+
+                // Generate without holding the lock; references to unordered_map
+                // elements remain valid across insertions
+                level->in_flight++;
+                lock.unlock();
+                Ciphertext encrypted(pool_);
+                bool success = true;
+                try
+                {
+                    generator_(parms_id, rng, encrypted);
+                }
+                catch (...)
+                {
+                    success = false;
+                }
+                lock.lock();
+                level->in_flight--;
+                if (success)
+                {
+                    level->ready.push_back(move(encrypted));
+                }
+                else
+                {
+                    level->failed = true;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,128 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "seal/encryptionparams.h"
+#include "seal/ciphertext.h"
+#include "seal/memorymanager.h"
+#include "seal/randomgen.h"
+
+namespace seal
+{
+    namespace util
+    {
+        /**
+        A bounded pool of fresh encryptions of zero, kept per parms_id and
+        refilled by background threads. Each pooled ciphertext is handed out
+        exactly once. A parms_id is filled in the background after it has been
+        reserved or requested for the first time.
+        */
+        class ZeroEncryptionPool
+        {
+        public:
+            /**
+            The function producing an encryption of zero for a given parms_id,
+            using the given random number generator.
+            */
+            using generator_type = std::function<void(
+                const parms_id_type &, std::shared_ptr<UniformRandomGenerator>,
+                Ciphertext &)>;
+
+            /**
+            Creates the pool and starts the refill threads.
+
+            @param[in] generator The function producing encryptions of zero
+            @param[in] random_generator The factory for the per-thread random
+            number generators
+            @param[in] depth The number of ciphertexts kept per parms_id
+            @param[in] thread_count The number of refill threads
+            @throws std::invalid_argument if generator or random_generator is null
+            @throws std::invalid_argument if depth or thread_count is zero
+            */
+            ZeroEncryptionPool(generator_type generator,
+                std::shared_ptr<UniformRandomGeneratorFactory> random_generator,
+                std::size_t depth, std::size_t thread_count);
+
+            /**
+            Stops the refill threads and destroys all pooled ciphertexts.
+            */
+            ~ZeroEncryptionPool();
+
+            /**
+            Starts filling the pool for the given parms_id in the background.
+            */
+            void reserve(const parms_id_type &parms_id);
+
+            /**
+            Moves a pooled encryption of zero for the given parms_id into
+            destination and returns true, or returns false if none is available.
+            In the latter case the parms_id is reserved for future requests.
+            */
+            SEAL_NODISCARD bool try_take(const parms_id_type &parms_id,
+                Ciphertext &destination);
+
+            /**
+            Returns the number of ready ciphertexts for the given parms_id.
+            */
+            SEAL_NODISCARD std::size_t size(const parms_id_type &parms_id);
+
+            SEAL_NODISCARD inline std::size_t depth() const noexcept
+            {
+                return depth_;
+            }
+
+            SEAL_NODISCARD inline std::size_t thread_count() const noexcept
+            {
+                return threads_.size();
+            }
+
+        private:
+            ZeroEncryptionPool(const ZeroEncryptionPool &copy) = delete;
+
+            ZeroEncryptionPool &operator =(const ZeroEncryptionPool &assign) = delete;
+
+            struct Level
+            {
+                std::deque<Ciphertext> ready;
+
+                std::size_t in_flight = 0;
+
+                // Set if generation failed; the level is then no longer refilled
+                // and requests fall back to the caller
+                bool failed = false;
+            };
+
+            void refill_worker();
+
+            generator_type generator_;
+
+            std::shared_ptr<UniformRandomGeneratorFactory> random_generator_;
+
+            std::size_t depth_;
+
+            // Pooled ciphertexts are as sensitive as the randomness used to
+            // create them, so they live in a pool that is cleared on destruction
+            MemoryPoolHandle pool_ = MemoryManager::GetPool(mm_prof_opt::FORCE_NEW, true);
+
+            std::unordered_map<parms_id_type, Level> levels_;
+
+            std::mutex mutex_;
+
+            std::condition_variable refill_cv_;
+
+            bool stop_ = false;
+
+            std::vector<std::thread> threads_;
+        };
+    }
+}
@@ -3,11 +3,22 @@
 
 #include "seal/util/defines.h"
 
-#ifdef SEAL_USE_ZLIB
+#if defined(SEAL_USE_ZLIB) || defined(SEAL_USE_ZSTD)
 
 #include <cstddef>
-#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
 #include <unordered_map>
+#ifdef SEAL_USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SEAL_USE_ZSTD
+#include <zstd.h>
+#endif
 #include "seal/serialization.h"
 #include "seal/util/ztools.h"
 #include "seal/util/pointer.h"
@@ -20,6 +31,12 @@ namespace seal
     {
         namespace ztools
         {
+#ifdef SEAL_USE_ZLIB
+            static_assert(level_default == Z_DEFAULT_COMPRESSION,
+                "level_default does not match zlib");
+            static_assert(level_fast == Z_BEST_SPEED,
+                "level_fast does not match zlib");
+
             namespace
             {
                 class PointerStorage
@@ -83,6 +100,233 @@ namespace seal
                 {
                     reinterpret_cast<PointerStorage*>(ptr_storage)->free(addr);
                 }
+
+                // An output stream buffer that compresses everything written to it
+                // with Deflate, buf_size bytes at a time, and writes the compressed
+                // output to out_stream as it is produced. The buffer is not seekable,
+                // so Serialization::Save buffers nested objects that need to rewrite
+                // their header.
+                class DeflateBuffer final : public streambuf
+                {
+                public:
+                    DeflateBuffer(ostream &out_stream, MemoryPoolHandle pool, int level) :
+                        out_stream_(out_stream), ptr_storage_(pool),
+                        in_(allocate<char>(buf_size, pool)),
+                        out_(allocate<unsigned char>(buf_size, pool))
+                    {
+                        zstream_.data_type = Z_BINARY;
+                        zstream_.zalloc = alloc_impl;
+                        zstream_.zfree = free_impl;
+                        zstream_.opaque = reinterpret_cast<voidpf>(&ptr_storage_);
+                        if (deflateInit(&zstream_, level) != Z_OK)
+                        {
+                            throw logic_error("deflate failed");
+                        }
+                        setp(in_.get(), in_.get() + buf_size);
+                    }
+
+                    ~DeflateBuffer() override
+                    {
+                        deflateEnd(&zstream_);
+                    }
+
+                    DeflateBuffer(const DeflateBuffer &copy) = delete;
+
+                    DeflateBuffer &operator =(const DeflateBuffer &assign) = delete;
+
+                    // Compresses any remaining input and ends the Deflate stream
+                    void finish()
+                    {
+                        deflate_put_area(Z_FINISH);
+                    }
+
+                    SEAL_NODISCARD streamoff out_size() const noexcept
+                    {
+                        return out_size_;
+                    }
+
+                private:
+                    int_type overflow(int_type ch = traits_type::eof()) override
+                    {
+                        deflate_put_area(Z_NO_FLUSH);
+                        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                        {
+                            *pptr() = traits_type::to_char_type(ch);
+                            pbump(1);
+                        }
+                        return traits_type::not_eof(ch);
+                    }
+
+                    void deflate_put_area(int flush)
+                    {
+                        zstream_.avail_in = static_cast<uInt>(pptr() - pbase());
+                        zstream_.next_in = reinterpret_cast<unsigned char*>(pbase());
+                        int result;
+                        do
+                        {
+                            zstream_.avail_out = static_cast<uInt>(buf_size);
+                            zstream_.next_out = out_.get();
+                            result = deflate(&zstream_, flush);
+                            if (result == Z_STREAM_ERROR)
+                            {
+                                throw logic_error("deflate failed");
+                            }
+                            auto out_have = buf_size - static_cast<size_t>(zstream_.avail_out);
+                            out_stream_.write(reinterpret_cast<const char*>(out_.get()),
+                                static_cast<streamsize>(out_have));
+                            out_size_ += static_cast<streamoff>(out_have);
+                        } while (!zstream_.avail_out);
+                        if (flush == Z_FINISH && result != Z_STREAM_END)
+                        {
+                            throw logic_error("deflate failed");
+                        }
+                        setp(in_.get(), in_.get() + buf_size);
+                    }
+
+                    ostream &out_stream_;
+
+                    PointerStorage ptr_storage_;
+
+                    z_stream zstream_;
+
+                    Pointer<char> in_;
+
+                    Pointer<unsigned char> out_;
+
+                    streamoff out_size_ = 0;
+                };
+
+                // An input stream buffer that reads in_size bytes of Deflate data
+                // from in_stream, buf_size bytes at a time, and decompresses them
+                // only as the output is consumed.
+                class InflateBuffer final : public streambuf
+                {
+                public:
+                    InflateBuffer(istream &in_stream, streamoff in_size, MemoryPoolHandle pool) :
+                        in_stream_(in_stream), in_remaining_(in_size), ptr_storage_(pool),
+                        in_(allocate<unsigned char>(buf_size, pool)),
+                        out_(allocate<char>(buf_size, pool))
+                    {
+                        zstream_.data_type = Z_BINARY;
+                        zstream_.zalloc = alloc_impl;
+                        zstream_.zfree = free_impl;
+                        zstream_.opaque = reinterpret_cast<voidpf>(&ptr_storage_);
+                        zstream_.avail_in = 0;
+                        zstream_.next_in = Z_NULL;
+                        if (inflateInit(&zstream_) != Z_OK)
+                        {
+                            throw logic_error("stream inflate failed");
+                        }
+                        setg(out_.get(), out_.get(), out_.get());
+                    }
+
+                    ~InflateBuffer() override
+                    {
+                        inflateEnd(&zstream_);
+                    }
+
+                    InflateBuffer(const InflateBuffer &copy) = delete;
+
+                    InflateBuffer &operator =(const InflateBuffer &assign) = delete;
+
+                    // Decompresses and discards any output that was not consumed,
+                    // and skips to the end of the compressed data in in_stream.
+                    void finish()
+                    {
+                        while (!traits_type::eq_int_type(underflow(), traits_type::eof()))
+                        {
+                            setg(eback(), egptr(), egptr());
+                        }
+                        if (!stream_end_)
+                        {
+                            throw logic_error("stream inflate failed");
+                        }
+                        in_stream_.ignore(static_cast<streamsize>(in_remaining_));
+                        in_remaining_ = 0;
+                    }
+
+                private:
+                    int_type underflow() override
+                    {
+                        if (gptr() < egptr())
+                        {
+                            return traits_type::to_int_type(*gptr());
+                        }
+                        out_offset_ += static_cast<streamoff>(egptr() - eback());
+                        setg(out_.get(), out_.get(), out_.get());
+
+                        zstream_.avail_out = static_cast<uInt>(buf_size);
+                        zstream_.next_out = reinterpret_cast<unsigned char*>(out_.get());
+                        while (!stream_end_ && zstream_.avail_out == buf_size)
+                        {
+                            if (!zstream_.avail_in)
+                            {
+                                if (!in_remaining_)
+                                {
+                                    // The compressed data is truncated
+                                    break;
+                                }
+                                auto read_size = static_cast<streamsize>(
+                                    min(static_cast<streamoff>(buf_size), in_remaining_));
+                                in_stream_.read(reinterpret_cast<char*>(in_.get()), read_size);
+                                in_remaining_ -= read_size;
+                                zstream_.avail_in = static_cast<uInt>(read_size);
+                                zstream_.next_in = in_.get();
+                            }
+                            switch (inflate(&zstream_, Z_NO_FLUSH))
+                            {
+                            case Z_STREAM_END:
+                                stream_end_ = true;
+                                break;
+
+                            case Z_OK:
+                                /* fall through */
+                            case Z_BUF_ERROR:
+                                break;
+
+                            default:
+                                throw logic_error("stream inflate failed");
+                            }
+                        }
+
+                        auto have = buf_size - static_cast<size_t>(zstream_.avail_out);
+                        if (!have)
+                        {
+                            return traits_type::eof();
+                        }
+                        setg(out_.get(), out_.get(), out_.get() + have);
+                        return traits_type::to_int_type(*gptr());
+                    }
+
+                    pos_type seekoff(
+                        off_type off,
+                        ios_base::seekdir dir,
+                        ios_base::openmode which = ios_base::in) override
+                    {
+                        // Only support querying the current position
+                        if (off != 0 || dir != ios_base::cur || which != ios_base::in)
+                        {
+                            return pos_type(off_type(-1));
+                        }
+                        return pos_type(out_offset_ + static_cast<off_type>(gptr() - eback()));
+                    }
+
+                    istream &in_stream_;
+
+                    streamoff in_remaining_;
+
+                    PointerStorage ptr_storage_;
+
+                    z_stream zstream_;
+
+                    Pointer<unsigned char> in_;
+
+                    Pointer<char> out_;
+
+                    streamoff out_offset_ = 0;
+
+                    bool stream_end_ = false;
+                };
             }
 
             size_t deflate_size_bound(size_t in_size) noexcept
@@ -98,7 +342,8 @@ namespace seal
             int deflate_array(
                 const IntArray<SEAL_BYTE> &in,
                 IntArray<SEAL_BYTE> &out,
-                MemoryPoolHandle pool)
+                MemoryPoolHandle pool,
+                int level)
             {
                 if (!pool)
                 {
@@ -107,7 +352,6 @@ namespace seal
 
                 streamoff in_size = safe_cast<streamoff>(in.size());
                 int result, flush;
-                int level = Z_DEFAULT_COMPRESSION;
 
                 z_stream zstream;
                 zstream.data_type = Z_BINARY;
@@ -152,124 +396,237 @@ namespace seal
                 return Z_OK;
             }
 
-            int inflate_stream(istream &in_stream,
-                streamoff in_size, ostream &out_stream,
+            streamoff deflate_save_members(
+                function<void(ostream &stream)> save_members,
+                ostream &out_stream,
+                MemoryPoolHandle pool,
+                int level)
+            {
+                if (!pool)
+                {
+                    throw invalid_argument("pool is uninitialized");
+                }
+
+                DeflateBuffer deflate_buffer(out_stream, move(pool), level);
+                ostream deflate_stream(&deflate_buffer);
+                deflate_stream.exceptions(ios_base::badbit | ios_base::failbit);
+                save_members(deflate_stream);
+                deflate_stream.flush();
+                deflate_buffer.finish();
+                return deflate_buffer.out_size();
+            }
+
+            void inflate_load_members(
+                function<void(istream &stream)> load_members,
+                istream &in_stream,
+                streamoff in_size,
                 MemoryPoolHandle pool)
             {
-                // Clear the exception masks; this function returns an error code
-                // on failure rather than throws an IO exception.
-                auto in_stream_except_mask = in_stream.exceptions();
-                in_stream.exceptions(ios_base::goodbit);
-                auto out_stream_except_mask = out_stream.exceptions();
-                out_stream.exceptions(ios_base::goodbit);
+                if (!pool)
+                {
+                    throw invalid_argument("pool is uninitialized");
+                }
 
-                auto in_stream_start_pos = in_stream.tellg();
-                auto in_stream_end_pos = in_stream_start_pos + in_size;
+                InflateBuffer inflate_buffer(in_stream, in_size, move(pool));
+                istream inflate_stream(&inflate_buffer);
+                inflate_stream.exceptions(ios_base::badbit | ios_base::failbit);
+                load_members(inflate_stream);
+                inflate_buffer.finish();
+            }
 
-                int result;
-                size_t have;
+            void write_header_deflate_buffer(
+                const IntArray<SEAL_BYTE> &in,
+                void *header_ptr,
+                ostream &out_stream,
+                MemoryPoolHandle pool,
+                int level)
+            {
+                Serialization::SEALHeader &header =
+                    *reinterpret_cast<Serialization::SEALHeader*>(header_ptr);
 
-                auto in(allocate<unsigned char>(buf_size, pool));
-                auto out(allocate<unsigned char>(buf_size, pool));
+                IntArray<SEAL_BYTE> out_array(pool);
+                auto ret = deflate_array(in, out_array, move(pool), level);
+                if (Z_OK != ret)
+                {
+                    throw logic_error("deflate failed");
+                }
 
-                z_stream zstream;
-                zstream.data_type = Z_BINARY;
+                // Populate the header
+                header.size = safe_cast<uint32_t>(add_safe(
+                    sizeof(Serialization::SEALHeader),
+                    out_array.size()));
 
-                PointerStorage ptr_storage(pool);
-                zstream.zalloc = alloc_impl;
-                zstream.zfree = free_impl;
-                zstream.opaque = reinterpret_cast<voidpf>(&ptr_storage);
+                auto old_except_mask = out_stream.exceptions();
+                try
+                {
+                    // Throw exceptions on ios_base::badbit and ios_base::failbit
+                    out_stream.exceptions(ios_base::badbit | ios_base::failbit);
 
-                zstream.avail_in = 0;
-                zstream.next_in = Z_NULL;
-                result = inflateInit(&zstream);
-                if (result != Z_OK)
+                    // Write the header and the data
+                    out_stream.write(
+                        reinterpret_cast<const char*>(&header),
+                        sizeof(Serialization::SEALHeader));
+                    out_stream.write(
+                        reinterpret_cast<const char*>(out_array.cbegin()),
+                        safe_cast<streamsize>(out_array.size()));
+
+                }
+                catch (...)
                 {
-                    in_stream.exceptions(in_stream_except_mask);
-                    out_stream.exceptions(out_stream_except_mask);
-                    return result;
+                    out_stream.exceptions(old_except_mask);
+                    throw;
                 }
 
-                do
+                out_stream.exceptions(old_except_mask);
+            }
+#endif
+#ifdef SEAL_USE_ZSTD
+            static_assert(CompressionParameters::zstd_level_default == ZSTD_CLEVEL_DEFAULT,
+                "zstd_level_default does not match Zstandard");
+
+            namespace
+            {
+                struct ZSTDCCtxDeleter
                 {
-                    if (!in_stream.read(reinterpret_cast<char*>(in.get()),
-                        min(static_cast<streamoff>(buf_size),
-                            in_stream_end_pos - in_stream.tellg())))
+                    void operator()(ZSTD_CCtx *cctx) const noexcept
                     {
-                        inflateEnd(&zstream);
-                        in_stream.exceptions(in_stream_except_mask);
-                        out_stream.exceptions(out_stream_except_mask);
-                        return Z_ERRNO;
+                        ZSTD_freeCCtx(cctx);
                     }
-                    if (!(zstream.avail_in =
-                        static_cast<decltype(zstream.avail_in)>(in_stream.gcount())))
+                };
+
+                struct ZSTDDCtxDeleter
+                {
+                    void operator()(ZSTD_DCtx *dctx) const noexcept
                     {
-                        break;
+                        ZSTD_freeDCtx(dctx);
                     }
-                    zstream.next_in = in.get();
+                };
 
-                    do
-                    {
-                        zstream.avail_out = buf_size;
-                        zstream.next_out = out.get();
-                        result = inflate(&zstream, Z_NO_FLUSH);
+                // Returns the number of chunks an input of given size is split
+                // into; every chunk is at least zstd_min_chunk_size bytes long.
+                size_t zstd_chunk_count(size_t in_size, size_t thread_count) noexcept
+                {
+                    return max<size_t>(
+                        min(thread_count, in_size / zstd_min_chunk_size), 1);
+                }
 
-                        switch (result)
-                        {
-                        case Z_NEED_DICT:
-                            result = Z_DATA_ERROR;
-                            /* fall through */
-
-                        case Z_DATA_ERROR:
-                            /* fall through */
-
-                        case Z_MEM_ERROR:
-                            inflateEnd(&zstream);
-                            in_stream.exceptions(in_stream_except_mask);
-                            out_stream.exceptions(out_stream_except_mask);
-                            return result;
-                        }
+                // Every block of a Zstandard frame takes at least 3 bytes and
+                // decompresses to at most 128 KiB, which bounds the content size
+                // a frame of given size can declare.
+                size_t zstd_content_size_bound(size_t frame_size)
+                {
+                    return mul_safe(frame_size / 3 + 1, size_t(1) << 17);
+                }
+            }
 
-                        have = buf_size - static_cast<size_t>(zstream.avail_out);
+            int zstd_min_level() noexcept
+            {
+                return ZSTD_minCLevel();
+            }
 
-                        if (!out_stream.write(reinterpret_cast<const char*>(out.get()),
-                            static_cast<streamsize>(have)))
-                        {
-                            inflateEnd(&zstream);
-                            in_stream.exceptions(in_stream_except_mask);
-                            out_stream.exceptions(out_stream_except_mask);
-                            return Z_ERRNO;
-                        }
-                    } while (!zstream.avail_out);
-                } while (result != Z_STREAM_END);
+            int zstd_max_level() noexcept
+            {
+                return ZSTD_maxCLevel();
+            }
 
-                inflateEnd(&zstream);
-                in_stream.exceptions(in_stream_except_mask);
-                out_stream.exceptions(out_stream_except_mask);
-                return result == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
+            size_t zstd_size_bound(size_t in_size) noexcept
+            {
+                // Every additional chunk adds at most the bound for an empty frame
+                size_t max_chunk_count = max<size_t>(in_size / zstd_min_chunk_size, 1);
+                return util::add_safe(
+                    ZSTD_compressBound(in_size),
+                    util::mul_safe(max_chunk_count - 1, ZSTD_compressBound(0)));
             }
 
-            void write_header_deflate_buffer(
+            void write_header_zstd_buffer(
                 const IntArray<SEAL_BYTE> &in,
                 void *header_ptr,
                 ostream &out_stream,
-                MemoryPoolHandle pool)
+                MemoryPoolHandle pool,
+                int level,
+                size_t thread_count)
             {
+                if (!pool)
+                {
+                    throw invalid_argument("pool is uninitialized");
+                }
+
                 Serialization::SEALHeader &header =
                     *reinterpret_cast<Serialization::SEALHeader*>(header_ptr);
 
-                IntArray<SEAL_BYTE> out_array(pool);
-                auto ret = deflate_array(in, out_array, move(pool));
-                if (Z_OK != ret)
+                size_t in_size = in.size();
+                size_t chunk_count = zstd_chunk_count(in_size, max<size_t>(thread_count, 1));
+                size_t chunk_size = (in_size + chunk_count - 1) / chunk_count;
+
+                // Allocate the output for every chunk up front
+                vector<IntArray<SEAL_BYTE>> out_arrays;
+                out_arrays.reserve(chunk_count);
+                for (size_t i = 0; i < chunk_count; i++)
                 {
-                    throw logic_error("deflate failed");
+                    size_t this_chunk_size = min(chunk_size, in_size - i * chunk_size);
+                    out_arrays.emplace_back(ZSTD_compressBound(this_chunk_size), pool);
+                }
+
+                // Every chunk is compressed into an independent frame; workers take
+                // the next unprocessed chunk from a shared counter.
+                atomic<size_t> next_chunk(0);
+                atomic<bool> failed(false);
+                auto worker = [&]() {
+                    unique_ptr<ZSTD_CCtx, ZSTDCCtxDeleter> cctx(ZSTD_createCCtx());
+                    if (!cctx)
+                    {
+                        failed = true;
+                        return;
+                    }
+                    size_t i;
+                    while ((i = next_chunk.fetch_add(1, memory_order_relaxed)) < chunk_count)
+                    {
+                        size_t offset = i * chunk_size;
+                        size_t this_chunk_size = min(chunk_size, in_size - offset);
+                        size_t result = ZSTD_compressCCtx(cctx.get(),
+                            out_arrays[i].begin(), out_arrays[i].size(),
+                            in.cbegin() + offset, this_chunk_size, level);
+                        if (ZSTD_isError(result))
+                        {
+                            failed = true;
+                            next_chunk = chunk_count;
+                            return;
+                        }
+                        out_arrays[i].resize(result);
+                    }
+                };
+
+                size_t worker_count = min(thread_count, chunk_count);
+                if (worker_count <= 1)
+                {
+                    worker();
+                }
+                else
+                {
+                    vector<thread> threads;
+                    threads.reserve(worker_count - 1);
+                    for (size_t t = 1; t < worker_count; t++)
+                    {
+                        threads.emplace_back(worker);
+                    }
+                    worker();
+                    for (auto &th : threads)
+                    {
+                        th.join();
+                    }
+                }
+                if (failed)
+                {
+                    throw logic_error("zstd compression failed");
                 }
 
                 // Populate the header
-                header.compr_mode = compr_mode_type::deflate;
-                header.size = safe_cast<uint32_t>(add_safe(
-                    sizeof(Serialization::SEALHeader),
-                    out_array.size()));
+                size_t out_size = sizeof(Serialization::SEALHeader);
+                for (const auto &out_array : out_arrays)
+                {
+                    out_size = add_safe(out_size, out_array.size());
+                }
+                header.size = safe_cast<uint32_t>(out_size);
 
                 auto old_except_mask = out_stream.exceptions();
                 try
@@ -277,14 +634,16 @@ namespace seal
                     // Throw exceptions on ios_base::badbit and ios_base::failbit
                     out_stream.exceptions(ios_base::badbit | ios_base::failbit);
 
-                    // Write the header and the data
+                    // Write the header and the frames
                     out_stream.write(
                         reinterpret_cast<const char*>(&header),
                         sizeof(Serialization::SEALHeader));
-                    out_stream.write(
-                        reinterpret_cast<const char*>(out_array.cbegin()),
-                        safe_cast<streamsize>(out_array.size()));
-
+                    for (const auto &out_array : out_arrays)
+                    {
+                        out_stream.write(
+                            reinterpret_cast<const char*>(out_array.cbegin()),
+                            safe_cast<streamsize>(out_array.size()));
+                    }
                 }
                 catch (...)
                 {
@@ -294,6 +653,67 @@ namespace seal
 
                 out_stream.exceptions(old_except_mask);
             }
+
+            void zstd_decompress_stream(istream &in_stream,
+                streamoff in_size, IntArray<SEAL_BYTE> &out,
+                MemoryPoolHandle pool)
+            {
+                if (!pool)
+                {
+                    throw invalid_argument("pool is uninitialized");
+                }
+
+                IntArray<SEAL_BYTE> in(safe_cast<size_t>(in_size), pool);
+                in_stream.read(reinterpret_cast<char*>(in.begin()),
+                    safe_cast<streamsize>(in_size));
+
+                // Find the frames and the content sizes they declare
+                vector<pair<size_t, size_t>> frames;
+                size_t out_size = 0;
+                for (size_t offset = 0; offset < in.size(); )
+                {
+                    size_t frame_size = ZSTD_findFrameCompressedSize(
+                        in.cbegin() + offset, in.size() - offset);
+                    if (ZSTD_isError(frame_size))
+                    {
+                        throw logic_error("zstd data is invalid");
+                    }
+                    unsigned long long content_size = ZSTD_getFrameContentSize(
+                        in.cbegin() + offset, frame_size);
+                    if (content_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+                        content_size == ZSTD_CONTENTSIZE_ERROR ||
+                        content_size > zstd_content_size_bound(frame_size))
+                    {
+                        throw logic_error("zstd data is invalid");
+                    }
+                    frames.emplace_back(frame_size, static_cast<size_t>(content_size));
+                    out_size = add_safe(out_size, static_cast<size_t>(content_size));
+                    offset += frame_size;
+                }
+
+                unique_ptr<ZSTD_DCtx, ZSTDDCtxDeleter> dctx(ZSTD_createDCtx());
+                if (!dctx)
+                {
+                    throw logic_error("zstd decompression failed");
+                }
+
+                // Every frame must decompress to exactly its declared size
+                out.resize(out_size, false);
+                const SEAL_BYTE *in_ptr = in.cbegin();
+                SEAL_BYTE *out_ptr = out.begin();
+                for (const auto &frame : frames)
+                {
+                    size_t result = ZSTD_decompressDCtx(dctx.get(),
+                        out_ptr, frame.second, in_ptr, frame.first);
+                    if (ZSTD_isError(result) || result != frame.second)
+                    {
+                        throw logic_error("zstd decompression failed");
+                    }
+                    in_ptr += frame.first;
+                    out_ptr += frame.second;
+                }
+            }
+#endif
         }
     }
 }
@@ -5,6 +5,7 @@
 
 #include <iostream>
 #include <ios>
+#include <functional>
 #include "seal/util/defines.h"
 #include "seal/intarray.h"
 #include "seal/memorymanager.h"
@@ -17,11 +18,17 @@ namespace seal
         {
             constexpr std::size_t buf_size = 16384;
 
+            // Compression levels; these match Z_DEFAULT_COMPRESSION and
+            // Z_BEST_SPEED in zlib
+            constexpr int level_default = -1;
+
+            constexpr int level_fast = 1;
+
             /**
             Compresses data in the given buffer, completes the given SEALHeader
-            by writing in the size of the output and setting the compression mode
-            to compr_mode_type::deflate, and finally writes the SEALHeader followed
-            by the compressed data in the given stream.
+            by writing in the size of the output, and finally writes the SEALHeader
+            followed by the compressed data in the given stream. The compression
+            mode in the SEALHeader must be set by the caller.
 
             @param[in] in The buffer to compress
             @param[in] in_size The size of the buffer to compress in bytes
@@ -29,6 +36,7 @@ namespace seal
             of the compression
             @param[out] out_stream The stream to write to
             @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+            @param[in] level The compression level
             @throws std::invalid_argument if pool is uninitialized
             @throws std::logic_error if compression failed
             */
@@ -36,18 +44,110 @@ namespace seal
                 const IntArray<SEAL_BYTE> &in,
                 void *header_ptr,
                 std::ostream &out_stream,
-                MemoryPoolHandle pool);
+                MemoryPoolHandle pool,
+                int level = level_default);
 
             int deflate_array(
                 const IntArray<SEAL_BYTE> &in,
                 IntArray<SEAL_BYTE> &out,
-                MemoryPoolHandle pool);
+                MemoryPoolHandle pool,
+                int level = level_default);
+
+            /**
+            Evaluates save_members on a stream that compresses its input with
+            Deflate in chunks of buf_size bytes and writes the compressed output to
+            out_stream as it is produced, so that neither the uncompressed nor the
+            compressed data is ever held in memory in full.
+
+            @param[in] save_members A function taking an std::ostream reference as
+            an argument, possibly writing some number of bytes into it
+            @param[out] out_stream The stream to write to
+            @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+            @param[in] level The compression level
+            @throws std::invalid_argument if pool is uninitialized
+            @throws std::logic_error if compression failed
+            */
+            std::streamoff deflate_save_members(
+                std::function<void(std::ostream &stream)> save_members,
+                std::ostream &out_stream,
+                MemoryPoolHandle pool,
+                int level = level_default);
+
+            /**
+            Applies load_members to a stream that decompresses in_size bytes of
+            Deflate data from in_stream in chunks of buf_size bytes as the output
+            is consumed. Afterwards in_stream is positioned after the compressed
+            data.
 
-            int inflate_stream(std::istream &in_stream,
-                std::streamoff in_size, std::ostream &out_stream,
+            @param[in] load_members A function taking an std::istream reference as
+            an argument, possibly reading some number of bytes from it
+            @param[in] in_stream The stream to read from
+            @param[in] in_size The size of the compressed data in bytes
+            @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+            @throws std::invalid_argument if pool is uninitialized
+            @throws std::logic_error if decompression failed
+            */
+            void inflate_load_members(
+                std::function<void(std::istream &stream)> load_members,
+                std::istream &in_stream,
+                std::streamoff in_size,
                 MemoryPoolHandle pool);
 
             SEAL_NODISCARD std::size_t deflate_size_bound(std::size_t in_size) noexcept;
+
+            // Inputs are split into chunks of at least this many bytes when
+            // compressing with multiple threads
+            constexpr std::size_t zstd_min_chunk_size = std::size_t(1) << 20;
+
+            SEAL_NODISCARD int zstd_min_level() noexcept;
+
+            SEAL_NODISCARD int zstd_max_level() noexcept;
+
+            /**
+            Compresses data in the given buffer with Zstandard, completes the given
+            SEALHeader by writing in the size of the output, and finally writes the
+            SEALHeader followed by the compressed data in the given stream. With
+            more than one thread the input is split into chunks that are compressed
+            in parallel into consecutive Zstandard frames. The compression mode in
+            the SEALHeader must be set by the caller.
+
+            @param[in] in The buffer to compress
+            @param[out] header A pointer to a SEALHeader instance matching the output
+            of the compression
+            @param[out] out_stream The stream to write to
+            @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+            @param[in] level The compression level
+            @param[in] thread_count The number of threads to use
+            @throws std::invalid_argument if pool is uninitialized
+            @throws std::logic_error if compression failed
+            */
+            void write_header_zstd_buffer(
+                const IntArray<SEAL_BYTE> &in,
+                void *header_ptr,
+                std::ostream &out_stream,
+                MemoryPoolHandle pool,
+                int level,
+                std::size_t thread_count);
+
+            /**
+            Decompresses in_size bytes of Zstandard frames from in_stream into out.
+            Every frame must declare its decompressed size in its frame header, and
+            out is resized to the sum of the declared sizes; decompression fails if
+            a frame does not decompress to exactly its declared size.
+
+            @param[in] in_stream The stream to read from
+            @param[in] in_size The size of the compressed data in bytes
+            @param[out] out The array to write the decompressed data to
+            @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+            @throws std::invalid_argument if pool is uninitialized
+            @throws std::logic_error if the data is invalid or if decompression
+            failed
+            */
+            void zstd_decompress_stream(std::istream &in_stream,
+                std::streamoff in_size, IntArray<SEAL_BYTE> &out,
+                MemoryPoolHandle pool);
+
+            SEAL_NODISCARD std::size_t zstd_size_bound(std::size_t in_size) noexcept;
         }
     }
 }
@@ -156,12 +156,16 @@ namespace seal
             return false;
         }
 
+        // There is one component for each digit of the decomposition
         size_t decomp_mod_count =
             context->first_context_data()->parms().coeff_modulus().size();
+        size_t digit_size = context->keyswitching_digit_size();
+        size_t digit_count = digit_size ?
+            (decomp_mod_count + digit_size - 1) / digit_size : decomp_mod_count;
         for (auto &a : in.data())
         {
             // Check that each highest level component has right size
-            if (a.size() && (a.size() != decomp_mod_count))
+            if (a.size() && (a.size() != digit_count))
             {
                 return false;
             }
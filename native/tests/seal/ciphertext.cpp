@@ -1,10 +1,13 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT license.
 
+#include <algorithm>
+#include <vector>
 #include "gtest/gtest.h"
 #include "seal/ciphertext.h"
 #include "seal/context.h"
 #include "seal/keygenerator.h"
+#include "seal/decryptor.h"
 #include "seal/encryptor.h"
 #include "seal/memorymanager.h"
 #include "seal/modulus.h"
@@ -124,4 +127,111 @@ namespace SEALTest
             parms.poly_modulus_degree() * parms.coeff_modulus().size() * 2));
         ASSERT_TRUE(ctxt.data() != ctxt2.data());
     }
+
+    TEST(CiphertextTest, SaveAlignedLoadView)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(1024);
+        parms.set_coeff_modulus(CoeffModulus::BFVDefault(1024));
+        parms.set_plain_modulus(0xF0F0);
+        auto context = SEALContext::Create(parms, false);
+        KeyGenerator keygen(context);
+        Encryptor encryptor(context, keygen.public_key());
+
+        Ciphertext ctxt;
+        encryptor.encrypt(Plaintext("Ax^10 + 9x^9 + 8x^8 + 1"), ctxt);
+        stringstream stream;
+        auto out_size = ctxt.save_aligned(stream);
+        ASSERT_EQ(ctxt.save_aligned_size(), out_size);
+        ASSERT_EQ(0, out_size % 64);
+
+        string str = stream.str();
+        ASSERT_EQ(static_cast<size_t>(out_size), str.size());
+        vector<uint64_t> buffer((str.size() + 7) / 8);
+        auto buffer_bytes = reinterpret_cast<SEAL_BYTE*>(buffer.data());
+        copy_n(reinterpret_cast<const SEAL_BYTE*>(str.data()), str.size(), buffer_bytes);
+
+        Ciphertext ctxt2;
+        ASSERT_EQ(out_size, ctxt2.load_view(context, buffer_bytes, str.size()));
+        ASSERT_TRUE(ctxt.parms_id() == ctxt2.parms_id());
+        ASSERT_EQ(ctxt.size(), ctxt2.size());
+        ASSERT_FALSE(ctxt2.is_ntt_form());
+        ASSERT_EQ(0, (ctxt2.data() - buffer.data()) % 8);
+        ASSERT_TRUE(is_equal_uint_uint(ctxt.data(), ctxt2.data(),
+            parms.poly_modulus_degree() * parms.coeff_modulus().size() * 2));
+
+        // The ciphertext refers to the buffer
+        ASSERT_TRUE(ctxt2.data() >= buffer.data() &&
+            ctxt2.data() < buffer.data() + buffer.size());
+        ctxt2[0] = 12345;
+        ASSERT_EQ(12345ULL, ctxt2.data()[0]);
+
+        // The layouts are not interchangeable
+        ASSERT_THROW(ctxt2.load(context, stream), logic_error);
+        ASSERT_THROW(ctxt2.load_view(context, buffer_bytes, str.size() - 64), logic_error);
+        ASSERT_THROW(ctxt2.load_view(context, buffer_bytes + 1, str.size() - 1), invalid_argument);
+        ASSERT_THROW(ctxt2.load_view(context, nullptr, str.size()), invalid_argument);
+    }
+
+    TEST(CiphertextTest, SaveLoadCiphertextBitPacked)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(1024);
+        parms.set_coeff_modulus(CoeffModulus::Create(1024, { 30, 40 }));
+        parms.set_plain_modulus(0xF0F0);
+        auto context = SEALContext::Create(parms, false, sec_level_type::none);
+        KeyGenerator keygen(context);
+        Encryptor encryptor(context, keygen.public_key(), keygen.secret_key());
+        Decryptor decryptor(context, keygen.secret_key());
+
+        // An empty ciphertext
+        stringstream stream;
+        Ciphertext ctxt(context);
+        Ciphertext ctxt2;
+        ASSERT_EQ(ctxt.save_size(compr_mode_type::bitpack),
+            ctxt.save(stream, compr_mode_type::bitpack));
+        ctxt2.load(context, stream);
+        ASSERT_TRUE(ctxt.parms_id() == ctxt2.parms_id());
+        ASSERT_EQ(0ULL, ctxt2.size());
+
+        Plaintext plain("Ax^10 + 9x^9 + 8x^8 + 7x^7 + 6x^6 + 5x^5 + 4x^4 + 3x^3 + 2x^2 + 1");
+        encryptor.encrypt(plain, ctxt);
+        auto full_size = ctxt.save(stream, compr_mode_type::none);
+        ctxt2.load(context, stream);
+        auto packed_size = ctxt.save(stream, compr_mode_type::bitpack);
+        ASSERT_EQ(ctxt.save_size(compr_mode_type::bitpack), packed_size);
+
+        // Coefficients take 30 bits instead of 64 at the data level
+        ASSERT_GT(full_size * 30 / 64 + 128, packed_size);
+        ASSERT_LT(full_size * 30 / 64 - 128, packed_size);
+        ASSERT_EQ(packed_size, ctxt2.load(context, stream));
+        ASSERT_TRUE(ctxt.parms_id() == ctxt2.parms_id());
+        ASSERT_TRUE(is_equal_uint_uint(ctxt.data(), ctxt2.data(), ctxt.int_array().size()));
+
+        // To and from a memory location
+        vector<SEAL_BYTE> buffer(static_cast<size_t>(packed_size));
+        ASSERT_EQ(packed_size, ctxt.save(buffer.data(), buffer.size(),
+            compr_mode_type::bitpack));
+        ctxt2.load(context, buffer.data(), buffer.size());
+        ASSERT_TRUE(is_equal_uint_uint(ctxt.data(), ctxt2.data(), ctxt.int_array().size()));
+
+        // A seeded ciphertext keeps its seed
+        encryptor.encrypt_symmetric_save(plain, stream, compr_mode_type::bitpack);
+        ctxt2.load(context, stream);
+        Plaintext plain2;
+        decryptor.decrypt(ctxt2, plain2);
+        ASSERT_TRUE(plain == plain2);
+
+        // Corrupted bit counts are detected
+        ctxt.save(stream, compr_mode_type::bitpack);
+        string str = stream.str();
+        stringstream corrupt_stream(str.substr(str.size() - static_cast<size_t>(packed_size)));
+        size_t bit_counts_offset = sizeof(Serialization::SEALHeader) + sizeof(parms_id_type) + 1 +
+            4 * sizeof(uint64_t) + sizeof(Serialization::SEALHeader) + sizeof(uint64_t);
+        string corrupt = corrupt_stream.str();
+        ASSERT_EQ(30, corrupt[bit_counts_offset]);
+        corrupt[bit_counts_offset] = 65;
+        corrupt_stream.str(corrupt);
+        ASSERT_THROW(ctxt2.load(context, corrupt_stream), logic_error);
+    }
 }
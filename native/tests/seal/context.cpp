@@ -2,8 +2,17 @@
 // Licensed under the MIT license.
 
 #include "gtest/gtest.h"
+#include "seal/batchencoder.h"
 #include "seal/context.h"
+#include "seal/keygenerator.h"
 #include "seal/modulus.h"
+#include "seal/randomgen.h"
+#include <memory>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 using namespace seal;
 using namespace std;
@@ -377,4 +386,285 @@ namespace SEALTest
             ASSERT_TRUE(!!context->first_context_data()->prev_context_data());
         }
     }
+
+    TEST(ContextTest, SharedNTTTables)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 40, 30, 30, 30, 40 }));
+        auto context = SEALContext::Create(parms, true, sec_level_type::none);
+
+        // Every level has tables for its primes that agree with the key level
+        auto key_context_data = context->key_context_data();
+        auto &key_tables = key_context_data->small_ntt_tables();
+        auto context_data = context->first_context_data();
+        size_t level_count = 0;
+        while (context_data)
+        {
+            auto &tables = context_data->small_ntt_tables();
+            for (size_t i = 0; i < context_data->parms().coeff_modulus().size(); i++)
+            {
+                ASSERT_TRUE(tables[i].is_generated());
+                ASSERT_EQ(key_tables[i].modulus().value(), tables[i].modulus().value());
+                ASSERT_EQ(key_tables[i].get_from_root_powers(1), tables[i].get_from_root_powers(1));
+            }
+            context_data = context_data->next_context_data();
+            level_count++;
+        }
+        ASSERT_EQ(4ULL, level_count);
+
+        // The tables outlive the SEALContext along with the ContextData
+        context_data = context->last_context_data();
+        context.reset();
+        key_context_data.reset();
+        auto &tables = context_data->small_ntt_tables();
+        ASSERT_EQ(parms.coeff_modulus()[0].value(), tables[0].modulus().value());
+        vector<uint64_t> poly(64, 1);
+        seal::util::ntt_negacyclic_harvey(poly.data(), tables[0]);
+        seal::util::inverse_ntt_negacyclic_harvey(poly.data(), tables[0]);
+        ASSERT_EQ(vector<uint64_t>(64, 1), poly);
+    }
+
+    TEST(ContextTest, CreateShared)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(65537);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 30, 30 }));
+
+        auto context1 = SEALContext::CreateShared(parms, true, sec_level_type::none);
+        auto context2 = SEALContext::CreateShared(parms, true, sec_level_type::none);
+        ASSERT_TRUE(context1->parameters_set());
+        ASSERT_EQ(context1, context2);
+
+        // Different arguments give different contexts
+        ASSERT_NE(context1, SEALContext::CreateShared(parms, false, sec_level_type::none));
+        ASSERT_FALSE(SEALContext::CreateShared(parms)->parameters_set());
+        auto parms2 = parms;
+        parms2.set_plain_modulus(257);
+        ASSERT_NE(context1, SEALContext::CreateShared(parms2, true, sec_level_type::none));
+        parms2 = parms;
+        parms2.set_random_generator(make_shared<BlakePRNGFactory>());
+        ASSERT_NE(context1, SEALContext::CreateShared(parms2, true, sec_level_type::none));
+
+        // The context is destroyed once it is no longer used
+        weak_ptr<SEALContext> weak_context = context1;
+        context1.reset();
+        context2.reset();
+        ASSERT_TRUE(weak_context.expired());
+        context1 = SEALContext::CreateShared(parms, true, sec_level_type::none);
+        ASSERT_TRUE(context1->parameters_set());
+
+        // Concurrent callers receive the same context
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 30, 40 }));
+        vector<shared_ptr<SEALContext>> contexts(4);
+        vector<thread> threads;
+        for (size_t i = 0; i < contexts.size(); i++)
+        {
+            threads.emplace_back([&, i]() {
+                contexts[i] = SEALContext::CreateShared(parms, true, sec_level_type::none);
+            });
+        }
+        for (auto &th : threads)
+        {
+            th.join();
+        }
+        for (auto &context : contexts)
+        {
+            ASSERT_EQ(contexts[0], context);
+        }
+    }
+
+    TEST(ContextTest, SavePrecomputation)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(65537);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 30, 30, 30 }));
+        auto context = SEALContext::Create(parms, true, sec_level_type::none);
+
+        stringstream stream;
+        auto out_size = context->save_precomputation(stream);
+        ASSERT_EQ(context->save_precomputation_size(), out_size);
+        ASSERT_EQ(out_size, static_cast<streamoff>(stream.str().size()));
+
+        // Copy to memory aligned for 64-bit access
+        string str = stream.str();
+        vector<uint64_t> buffer(str.size() / sizeof(uint64_t));
+        memcpy(buffer.data(), str.data(), str.size());
+        auto data = reinterpret_cast<SEAL_BYTE*>(buffer.data());
+
+        auto loaded_context = SEALContext::Create(parms, data, str.size(), true,
+            sec_level_type::none);
+        ASSERT_TRUE(loaded_context->parameters_set());
+        ASSERT_EQ(context->last_parms_id(), loaded_context->last_parms_id());
+        auto context_data = context->key_context_data();
+        auto loaded_context_data = loaded_context->key_context_data();
+        while (context_data)
+        {
+            ASSERT_EQ(context_data->parms_id(), loaded_context_data->parms_id());
+            for (size_t i = 0; i < context_data->parms().coeff_modulus().size(); i++)
+            {
+                auto &tables = context_data->small_ntt_tables()[i];
+                auto &loaded_tables = loaded_context_data->small_ntt_tables()[i];
+                ASSERT_EQ(tables.get_root(), loaded_tables.get_root());
+                for (size_t j = 0; j < tables.coeff_count(); j++)
+                {
+                    ASSERT_EQ(tables.get_from_scaled_inv_root_powers_div_two(j),
+                        loaded_tables.get_from_scaled_inv_root_powers_div_two(j));
+                }
+            }
+
+            context_data = context_data->next_context_data();
+            loaded_context_data = loaded_context_data->next_context_data();
+        }
+
+        // The loaded tables are used in place. The header, parms_id, digest, table
+        // count, and the metadata and digest of each table take 64 bytes each, and
+        // the first saved tables are for the smallest modulus, i.e., the plain
+        // modulus.
+        auto &plain_ntt_tables = *loaded_context->key_context_data()->plain_ntt_tables();
+        size_t root_powers_offset = 64 + 64 + 64 + 64 + 64 + 64;
+        ASSERT_EQ(1ULL, plain_ntt_tables.get_from_root_powers(0));
+        buffer[root_powers_offset / sizeof(uint64_t)] = 2;
+        ASSERT_EQ(2ULL, plain_ntt_tables.get_from_root_powers(0));
+        buffer[root_powers_offset / sizeof(uint64_t)] = 1;
+
+        // Different parameters
+        auto parms2 = parms;
+        parms2.set_plain_modulus(257);
+        ASSERT_THROW((void)SEALContext::Create(parms2, data, str.size()),
+            invalid_argument);
+
+        // Truncated data
+        ASSERT_THROW((void)SEALContext::Create(parms, data, str.size() - 64),
+            logic_error);
+
+        // Corrupted root
+        size_t root_offset = 64 + 64 + 64 + 64 + sizeof(uint64_t);
+        buffer[root_offset / sizeof(uint64_t)]++;
+        ASSERT_THROW((void)SEALContext::Create(parms, data, str.size(), true,
+            sec_level_type::none), logic_error);
+        buffer[root_offset / sizeof(uint64_t)]--;
+
+        // A corrupted byte after parms_id does not match the digest checked by
+        // Create
+        data[64 + sizeof(parms_id_type)] ^= SEAL_BYTE(1);
+        ASSERT_THROW((void)SEALContext::Create(parms, data, str.size(), true,
+            sec_level_type::none), logic_error);
+        data[64 + sizeof(parms_id_type)] ^= SEAL_BYTE(1);
+
+        // A corrupted byte in a table does not match the digest of that table,
+        // which is only checked when the table is first used; the second saved
+        // tables are for the smallest coefficient modulus
+        size_t table_byte_count = 64 + 64 + 6 * 64 * sizeof(uint64_t);
+        data[root_powers_offset + table_byte_count + 3] ^= SEAL_BYTE(1);
+        auto loaded_context2 = SEALContext::Create(parms, data, str.size(), true,
+            sec_level_type::none);
+        ASSERT_TRUE(loaded_context2->parameters_set());
+        ASSERT_THROW(KeyGenerator keygen(loaded_context2), logic_error);
+        data[root_powers_offset + table_byte_count + 3] ^= SEAL_BYTE(1);
+
+        data[root_powers_offset + 3] ^= SEAL_BYTE(1);
+        auto loaded_context3 = SEALContext::Create(parms, data, str.size(), true,
+            sec_level_type::none);
+        KeyGenerator keygen(loaded_context3);
+        BatchEncoder encoder(loaded_context3);
+        Plaintext plain;
+        ASSERT_THROW(encoder.encode(vector<uint64_t>(64, 1), plain), logic_error);
+        data[root_powers_offset + 3] ^= SEAL_BYTE(1);
+        encoder.encode(vector<uint64_t>(64, 1), plain);
+    }
+
+    TEST(ContextTest, LazyModulusChain)
+    {
+        auto check_chain = [](shared_ptr<SEALContext> context,
+            shared_ptr<SEALContext> lazy_context)
+        {
+            ASSERT_TRUE(lazy_context->parameters_set());
+            ASSERT_EQ(context->key_parms_id(), lazy_context->key_parms_id());
+            ASSERT_EQ(context->first_parms_id(), lazy_context->first_parms_id());
+            ASSERT_EQ(context->last_parms_id(), lazy_context->last_parms_id());
+
+            // Access the last level first
+            auto last_context_data = lazy_context->last_context_data();
+            ASSERT_EQ(size_t(0), last_context_data->chain_index());
+            ASSERT_EQ(last_context_data,
+                lazy_context->get_context_data(context->last_parms_id()));
+
+            auto context_data = context->key_context_data();
+            auto lazy_context_data = lazy_context->key_context_data();
+            while (context_data)
+            {
+                ASSERT_EQ(context_data->parms_id(), lazy_context_data->parms_id());
+                ASSERT_EQ(context_data->chain_index(), lazy_context_data->chain_index());
+                ASSERT_EQ(lazy_context_data,
+                    lazy_context->get_context_data(context_data->parms_id()));
+                ASSERT_EQ(context_data->total_coeff_modulus_bit_count(),
+                    lazy_context_data->total_coeff_modulus_bit_count());
+                ASSERT_EQ(context_data->qualifiers().using_fast_plain_lift,
+                    lazy_context_data->qualifiers().using_fast_plain_lift);
+                if (context_data->prev_context_data())
+                {
+                    ASSERT_EQ(context_data->prev_context_data()->parms_id(),
+                        lazy_context_data->prev_context_data()->parms_id());
+                }
+                context_data = context_data->next_context_data();
+                lazy_context_data = lazy_context_data->next_context_data();
+            }
+            ASSERT_FALSE(lazy_context_data);
+        };
+
+        {
+            EncryptionParameters parms(scheme_type::CKKS);
+            parms.set_poly_modulus_degree(64);
+            parms.set_coeff_modulus(CoeffModulus::Create(64, { 30, 30, 30, 30, 30 }));
+            auto context = SEALContext::Create(parms, true, sec_level_type::none);
+            auto lazy_context = SEALContext::Create(parms, true, sec_level_type::none, true);
+            ASSERT_EQ(size_t(3), context->first_context_data()->chain_index());
+            check_chain(context, lazy_context);
+        }
+        {
+            // The chain ends when plain_modulus is no longer smaller than the
+            // coefficient modulus
+            EncryptionParameters parms(scheme_type::BFV);
+            parms.set_poly_modulus_degree(64);
+            parms.set_plain_modulus((uint64_t(1) << 40) + 1);
+            parms.set_coeff_modulus(CoeffModulus::Create(64, { 30, 30, 30, 30 }));
+            auto context = SEALContext::Create(parms, true, sec_level_type::none);
+            auto lazy_context = SEALContext::Create(parms, true, sec_level_type::none, true);
+            ASSERT_EQ(size_t(1), context->first_context_data()->chain_index());
+            check_chain(context, lazy_context);
+        }
+        {
+            // Levels are created once when accessed concurrently
+            EncryptionParameters parms(scheme_type::CKKS);
+            parms.set_poly_modulus_degree(64);
+            parms.set_coeff_modulus(CoeffModulus::Create(64, { 30, 30, 30, 30, 30 }));
+            auto lazy_context = SEALContext::Create(parms, true, sec_level_type::none, true);
+            auto first_context_data = lazy_context->first_context_data();
+            ASSERT_TRUE(noexcept(first_context_data->next_context_data()));
+            vector<shared_ptr<const SEALContext::ContextData>> last_context_data(4);
+            vector<thread> threads;
+            for (size_t i = 0; i < last_context_data.size(); i++)
+            {
+                threads.emplace_back([&, i]() {
+                    auto context_data = lazy_context->first_context_data();
+                    while (context_data->next_context_data())
+                    {
+                        context_data = context_data->next_context_data();
+                    }
+                    last_context_data[i] = context_data;
+                });
+            }
+            for (auto &th : threads)
+            {
+                th.join();
+            }
+            for (auto &context_data : last_context_data)
+            {
+                ASSERT_EQ(lazy_context->last_context_data(), context_data);
+            }
+        }
+    }
 }
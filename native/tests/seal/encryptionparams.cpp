@@ -106,6 +106,16 @@ namespace SEALTest
         parms3.set_poly_modulus_degree(64);
         ASSERT_TRUE(parms3 == parms1);
 
+        parms3 = parms2;
+        parms3.set_special_prime_count(2);
+        ASSERT_FALSE(parms3 == parms2);
+        parms3.set_special_prime_count(1);
+        ASSERT_TRUE(parms3 == parms2);
+        parms3.set_decomposition_count(1);
+        ASSERT_FALSE(parms3 == parms2);
+        parms3.set_decomposition_count(0);
+        ASSERT_TRUE(parms3 == parms2);
+
         parms3 = parms2;
         parms3.set_coeff_modulus({ 2 });
         parms3.set_coeff_modulus(CoeffModulus::Create(64, { 50 }));
@@ -145,5 +155,13 @@ namespace SEALTest
         ASSERT_TRUE(parms.plain_modulus() == parms2.plain_modulus());
         ASSERT_TRUE(parms.poly_modulus_degree() == parms2.poly_modulus_degree());
         ASSERT_TRUE(parms == parms2);
+
+        parms.set_special_prime_count(2);
+        parms.set_decomposition_count(1);
+        parms.save(stream);
+        parms2.load(stream);
+        ASSERT_EQ(2ULL, parms2.special_prime_count());
+        ASSERT_EQ(1ULL, parms2.decomposition_count());
+        ASSERT_TRUE(parms == parms2);
     }
 }
@@ -10,9 +10,13 @@
 #include "seal/ckks.h"
 #include "seal/intencoder.h"
 #include "seal/modulus.h"
+#include "seal/randomgen.h"
+#include "seal/util/polyarithsmallmod.h"
+#include <chrono>
 #include <cstdint>
 #include <cstddef>
 #include <ctime>
+#include <thread>
 
 using namespace seal;
 using namespace std;
@@ -391,6 +395,57 @@ namespace SEALTest
         }
     }
 
+    TEST(EncryptorTest, CKKSEncryptZeroSymmetricSeedIndependentError)
+    {
+        // With a deterministic generator the error of a symmetric encryption of
+        // zero must not depend on whether the seed of the second component is
+        // saved, even though only the unsaved variant draws it from the same
+        // generator as the error.
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 40, 40, 40 }));
+        random_seed_type seed;
+        for (auto &i : seed)
+        {
+            i = random_uint64();
+        }
+        parms.set_random_generator(make_shared<BlakePRNGFactory>(seed));
+
+        auto context = SEALContext::Create(parms, false, sec_level_type::none);
+        KeyGenerator keygen(context);
+        Encryptor encryptor(context, keygen.secret_key());
+
+        // In NTT form the error is c0 + c1 * s, computed coefficient-wise
+        auto get_error = [&](const Ciphertext &encrypted) {
+            auto &coeff_modulus = context->get_context_data(
+                encrypted.parms_id())->parms().coeff_modulus();
+            size_t coeff_count = encrypted.poly_modulus_degree();
+            vector<uint64_t> error(coeff_count * coeff_modulus.size());
+            for (size_t i = 0; i < coeff_modulus.size(); i++)
+            {
+                uint64_t *error_ptr = error.data() + i * coeff_count;
+                util::dyadic_product_coeffmod(encrypted.data(1) + i * coeff_count,
+                    keygen.secret_key().data().data() + i * coeff_count,
+                    coeff_count, coeff_modulus[i], error_ptr);
+                util::add_poly_poly_coeffmod(error_ptr, encrypted.data() + i * coeff_count,
+                    coeff_count, coeff_modulus[i], error_ptr);
+            }
+            return error;
+        };
+
+        Ciphertext ct;
+        encryptor.encrypt_zero_symmetric(ct);
+        ASSERT_TRUE(ct.is_ntt_form());
+
+        stringstream stream;
+        Ciphertext ct_seeded;
+        encryptor.encrypt_zero_symmetric_save(stream);
+        ct_seeded.load(context, stream);
+        ASSERT_TRUE(get_error(ct) == get_error(ct_seeded));
+        ASSERT_FALSE(equal(ct.data(1), ct.data(1) + ct.poly_modulus_degree(),
+            ct_seeded.data(1)));
+    }
+
     TEST(EncryptorTest, CKKSEncryptDecrypt)
     {
         EncryptionParameters parms(scheme_type::CKKS);
@@ -656,4 +711,180 @@ namespace SEALTest
             }
         }
     }
+
+    TEST(EncryptorTest, BFVEncryptManyDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_poly_modulus_degree(128);
+        parms.set_coeff_modulus(CoeffModulus::Create(128, { 40, 40, 40 }));
+        auto context = SEALContext::Create(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+
+        IntegerEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key(), keygen.secret_key());
+        Decryptor decryptor(context, keygen.secret_key());
+
+        vector<Plaintext> plains;
+        for (uint64_t i = 0; i < 23; i++)
+        {
+            plains.push_back(encoder.encode(0x1000 * i + 17));
+        }
+
+        for (size_t thread_count : { size_t(0), size_t(1), size_t(4) })
+        {
+            vector<Ciphertext> encrypted;
+            encryptor.encrypt_many(plains, encrypted, thread_count);
+            ASSERT_EQ(plains.size(), encrypted.size());
+            Plaintext plain;
+            for (uint64_t i = 0; i < plains.size(); i++)
+            {
+                ASSERT_TRUE(encrypted[i].parms_id() == context->first_parms_id());
+                decryptor.decrypt(encrypted[i], plain);
+                ASSERT_EQ(0x1000 * i + 17, encoder.decode_uint64(plain));
+            }
+
+            encryptor.encrypt_symmetric_many(plains, encrypted, thread_count);
+            ASSERT_EQ(plains.size(), encrypted.size());
+            for (uint64_t i = 0; i < plains.size(); i++)
+            {
+                ASSERT_TRUE(encrypted[i].parms_id() == context->first_parms_id());
+                decryptor.decrypt(encrypted[i], plain);
+                ASSERT_EQ(0x1000 * i + 17, encoder.decode_uint64(plain));
+            }
+        }
+
+        // Two encryptions of the same plaintext must not share randomness
+        vector<Plaintext> same(2, encoder.encode(5));
+        vector<Ciphertext> encrypted;
+        encryptor.encrypt_many(same, encrypted, 1);
+        ASSERT_FALSE(equal(encrypted[0].data(1),
+            encrypted[0].data(1) + encrypted[0].poly_modulus_degree(), encrypted[1].data(1)));
+
+        vector<Ciphertext> empty;
+        encryptor.encrypt_many({}, empty);
+        ASSERT_TRUE(empty.empty());
+
+        Encryptor sym_encryptor(context, keygen.secret_key());
+        ASSERT_THROW(sym_encryptor.encrypt_many(plains, encrypted), logic_error);
+    }
+
+    TEST(EncryptorTest, BFVZeroPoolEncryptDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_plain_modulus(1 << 6);
+        parms.set_poly_modulus_degree(128);
+        parms.set_coeff_modulus(CoeffModulus::Create(128, { 40, 40, 40 }));
+        auto context = SEALContext::Create(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+
+        IntegerEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+
+        ASSERT_FALSE(encryptor.zero_pool_enabled());
+        ASSERT_THROW(encryptor.enable_zero_pool(0), invalid_argument);
+        ASSERT_THROW(encryptor.enable_zero_pool(4, 0), invalid_argument);
+        encryptor.enable_zero_pool(4, 2);
+        ASSERT_TRUE(encryptor.zero_pool_enabled());
+
+        // Pooled and freshly computed encryptions must both decrypt correctly,
+        // no two may share randomness, and each keeps its own memory pool
+        vector<Ciphertext> encrypted;
+        vector<MemoryPoolHandle> pools;
+        for (int i = 0; i < 16; i++)
+        {
+            pools.push_back(MemoryManager::GetPool(mm_prof_opt::FORCE_NEW));
+            encrypted.emplace_back(pools.back());
+        }
+        this_thread::sleep_for(chrono::milliseconds(100));
+        Plaintext plain;
+        for (uint64_t i = 0; i < encrypted.size(); i++)
+        {
+            encryptor.encrypt(encoder.encode(i + 3), encrypted[i]);
+            ASSERT_TRUE(encrypted[i].parms_id() == context->first_parms_id());
+            ASSERT_TRUE(encrypted[i].pool() == pools[i]);
+            decryptor.decrypt(encrypted[i], plain);
+            ASSERT_EQ(i + 3, encoder.decode_uint64(plain));
+            for (uint64_t j = 0; j < i; j++)
+            {
+                ASSERT_FALSE(equal(encrypted[i].data(1),
+                    encrypted[i].data(1) + encrypted[i].poly_modulus_degree(), encrypted[j].data(1)));
+            }
+        }
+
+        // Lower levels are pooled on first use
+        auto next_parms_id = context->first_context_data()->next_context_data()->parms_id();
+        for (int i = 0; i < 4; i++)
+        {
+            Ciphertext zero;
+            encryptor.encrypt_zero(next_parms_id, zero);
+            ASSERT_TRUE(zero.parms_id() == next_parms_id);
+            decryptor.decrypt(zero, plain);
+            ASSERT_TRUE(plain.is_zero());
+        }
+
+        // Replacing the public key refills the pool under the new key
+        KeyGenerator keygen2(context);
+        Decryptor decryptor2(context, keygen2.secret_key());
+        encryptor.set_public_key(keygen2.public_key());
+        ASSERT_TRUE(encryptor.zero_pool_enabled());
+        for (uint64_t i = 0; i < 8; i++)
+        {
+            Ciphertext ct;
+            encryptor.encrypt(encoder.encode(i + 1), ct);
+            decryptor2.decrypt(ct, plain);
+            ASSERT_EQ(i + 1, encoder.decode_uint64(plain));
+        }
+
+        encryptor.disable_zero_pool();
+        ASSERT_FALSE(encryptor.zero_pool_enabled());
+
+        Encryptor sym_encryptor(context, keygen.secret_key());
+        ASSERT_THROW(sym_encryptor.enable_zero_pool(4), logic_error);
+    }
+
+    TEST(EncryptorTest, CKKSEncryptManyDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        size_t slot_size = 32;
+        parms.set_poly_modulus_degree(2 * slot_size);
+        parms.set_coeff_modulus(CoeffModulus::Create(2 * slot_size, { 40, 40, 40, 40 }));
+        auto context = SEALContext::Create(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, keygen.public_key(), keygen.secret_key());
+        Decryptor decryptor(context, keygen.secret_key());
+
+        const double delta = static_cast<double>(1 << 16);
+        auto second_parms_id = context->first_context_data()->next_context_data()->parms_id();
+        vector<Plaintext> plains(10);
+        for (size_t i = 0; i < plains.size(); i++)
+        {
+            vector<complex<double>> input(slot_size, static_cast<double>(i));
+            encoder.encode(input, (i & 1) ? second_parms_id : context->first_parms_id(),
+                delta, plains[i]);
+        }
+
+        vector<Ciphertext> encrypted;
+        encryptor.encrypt_many(plains, encrypted, 3);
+        vector<Ciphertext> encrypted_symmetric;
+        encryptor.encrypt_symmetric_many(plains, encrypted_symmetric, 3);
+        Plaintext plain;
+        vector<complex<double>> output(slot_size);
+        for (size_t i = 0; i < plains.size(); i++)
+        {
+            for (auto *ct : { &encrypted[i], &encrypted_symmetric[i] })
+            {
+                ASSERT_TRUE(ct->parms_id() == plains[i].parms_id());
+                decryptor.decrypt(*ct, plain);
+                encoder.decode(plain, output);
+                for (size_t j = 0; j < slot_size; j++)
+                {
+                    ASSERT_TRUE(abs(static_cast<double>(i) - output[j].real()) < 0.5);
+                }
+            }
+        }
+    }
 }
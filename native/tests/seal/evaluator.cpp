@@ -11,6 +11,7 @@
 #include "seal/ckks.h"
 #include "seal/intencoder.h"
 #include "seal/modulus.h"
+#include <numeric>
 #include <cstdint>
 #include <cstddef>
 #include <string>
@@ -3716,6 +3717,180 @@ namespace SEALTest
             6, 7, 8, 5
         }));
     }
+
+    TEST(EvaluatorTest, BFVEncryptRotatePlannedKeysDecrypt)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        SmallModulus plain_modulus(257);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(plain_modulus);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 40, 40 }));
+
+        auto context = SEALContext::Create(parms, false, sec_level_type::none);
+        KeyGenerator keygen(context);
+        vector<int> steps = keygen.plan_galois_steps({ { 0, 1 }, { 3, 4 }, { 5, 4 } }, 3);
+        ASSERT_TRUE((steps == vector<int>{ 0, 3, 5 }));
+        GaloisKeys glk = keygen.galois_keys(steps);
+        ASSERT_EQ(3ULL, glk.size());
+
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Decryptor decryptor(context, keygen.secret_key());
+        BatchEncoder batch_encoder(context);
+
+        vector<uint64_t> plain_vec(64);
+        iota(plain_vec.begin(), plain_vec.end(), 0);
+        Plaintext plain;
+        batch_encoder.encode(plain_vec, plain);
+        Ciphertext encrypted;
+        encryptor.encrypt(plain, encrypted);
+
+        // Rotations by 8 and -2 are composed from the keys for 3 and 5
+        int total = 0;
+        for (int step : { 3, 5, 8, -2, 31 })
+        {
+            evaluator.rotate_rows_inplace(encrypted, step, glk);
+            total += step;
+            decryptor.decrypt(encrypted, plain);
+            vector<uint64_t> result;
+            batch_encoder.decode(plain, result);
+            for (size_t i = 0; i < 64; i++)
+            {
+                size_t row = i & ~size_t(31);
+                size_t col = static_cast<size_t>((static_cast<int>(i & 31) + total) & 31);
+                ASSERT_EQ(plain_vec[row + col], result[i]);
+            }
+        }
+
+        GaloisKeys even_glk = keygen.galois_keys(vector<int>{ 2 });
+        ASSERT_THROW(evaluator.rotate_rows_inplace(encrypted, 1, even_glk), invalid_argument);
+    }
+
+    TEST(EvaluatorTest, HybridKeySwitching)
+    {
+        {
+            // Three data primes in digits of two, two special primes
+            EncryptionParameters parms(scheme_type::BFV);
+            SmallModulus plain_modulus(257);
+            parms.set_poly_modulus_degree(8);
+            parms.set_plain_modulus(plain_modulus);
+            parms.set_coeff_modulus(CoeffModulus::Create(8, { 40, 40, 40, 50, 50 }));
+            parms.set_special_prime_count(2);
+            parms.set_decomposition_count(2);
+
+            auto context = SEALContext::Create(parms, true, sec_level_type::none);
+            ASSERT_EQ(2ULL, context->keyswitching_digit_size());
+            ASSERT_EQ(3ULL, context->first_context_data()->parms().coeff_modulus().size());
+            ASSERT_TRUE(context->key_context_data()->next_context_data() ==
+                context->first_context_data());
+            KeyGenerator keygen(context);
+            GaloisKeys glk = keygen.galois_keys();
+            RelinKeys rlk = keygen.relin_keys();
+            ASSERT_EQ(2ULL, rlk.key(2).size());
+
+            Encryptor encryptor(context, keygen.public_key());
+            Evaluator evaluator(context);
+            Decryptor decryptor(context, keygen.secret_key());
+            BatchEncoder batch_encoder(context);
+
+            Plaintext plain;
+            vector<uint64_t> plain_vec{
+                1, 2, 3, 4,
+                5, 6, 7, 8
+            };
+            batch_encoder.encode(plain_vec, plain);
+            Ciphertext encrypted;
+            encryptor.encrypt(plain, encrypted);
+
+            evaluator.rotate_rows_inplace(encrypted, 1, glk);
+            evaluator.square_inplace(encrypted);
+            evaluator.relinearize_inplace(encrypted, rlk);
+            decryptor.decrypt(encrypted, plain);
+            batch_encoder.decode(plain, plain_vec);
+            ASSERT_TRUE((plain_vec == vector<uint64_t>{
+                4, 9, 16, 1,
+                36, 49, 64, 25
+            }));
+
+            // The last digit is partial at lower levels
+            evaluator.mod_switch_to_next_inplace(encrypted);
+            evaluator.rotate_columns_inplace(encrypted, glk);
+            decryptor.decrypt(encrypted, plain);
+            batch_encoder.decode(plain, plain_vec);
+            ASSERT_TRUE((plain_vec == vector<uint64_t>{
+                36, 49, 64, 25,
+                4, 9, 16, 1
+            }));
+            evaluator.mod_switch_to_next_inplace(encrypted);
+            evaluator.rotate_rows_inplace(encrypted, -1, glk);
+            decryptor.decrypt(encrypted, plain);
+            batch_encoder.decode(plain, plain_vec);
+            ASSERT_TRUE((plain_vec == vector<uint64_t>{
+                25, 36, 49, 64,
+                1, 4, 9, 16
+            }));
+        }
+        {
+            // A single digit with three special primes
+            EncryptionParameters parms(scheme_type::CKKS);
+            size_t slot_size = 4;
+            parms.set_poly_modulus_degree(slot_size * 2);
+            parms.set_coeff_modulus(CoeffModulus::Create(
+                slot_size * 2, { 50, 40, 40, 60, 60, 60 }));
+            parms.set_special_prime_count(3);
+            parms.set_decomposition_count(1);
+
+            auto context = SEALContext::Create(parms, true, sec_level_type::none);
+            ASSERT_EQ(3ULL, context->keyswitching_digit_size());
+            KeyGenerator keygen(context);
+            GaloisKeys glk = keygen.galois_keys();
+            RelinKeys rlk = keygen.relin_keys();
+
+            Encryptor encryptor(context, keygen.public_key());
+            Evaluator evaluator(context);
+            Decryptor decryptor(context, keygen.secret_key());
+            CKKSEncoder encoder(context);
+            const double delta = static_cast<double>(1ULL << 40);
+
+            vector<std::complex<double>> input{
+                std::complex<double>(1, 1),
+                std::complex<double>(2, 2),
+                std::complex<double>(3, 3),
+                std::complex<double>(4, 4)
+            };
+            vector<std::complex<double>> output(slot_size, 0);
+
+            Plaintext plain;
+            Ciphertext encrypted;
+            encoder.encode(input, context->first_parms_id(), delta, plain);
+            encryptor.encrypt(plain, encrypted);
+            evaluator.rotate_vector_inplace(encrypted, 1, glk);
+            evaluator.multiply_plain_inplace(encrypted, plain);
+            evaluator.rescale_to_next_inplace(encrypted);
+            evaluator.square_inplace(encrypted);
+            evaluator.relinearize_inplace(encrypted, rlk);
+            evaluator.rotate_vector_inplace(encrypted, 2, glk);
+            decryptor.decrypt(encrypted, plain);
+            encoder.decode(plain, output);
+            for (size_t i = 0; i < slot_size; i++)
+            {
+                auto value = input[(i + 3) % slot_size] * input[(i + 2) % slot_size];
+                value *= value;
+                ASSERT_EQ(value.real(), round(output[i].real()));
+                ASSERT_EQ(value.imag(), round(output[i].imag()));
+            }
+        }
+        {
+            // There must be a data prime besides the special primes
+            EncryptionParameters parms(scheme_type::CKKS);
+            parms.set_poly_modulus_degree(8);
+            parms.set_coeff_modulus(CoeffModulus::Create(8, { 40, 40 }));
+            parms.set_special_prime_count(2);
+            auto context = SEALContext::Create(parms, true, sec_level_type::none);
+            ASSERT_FALSE(context->parameters_set());
+        }
+    }
+
     TEST(EvaluatorTest, BFVEncryptModSwitchToNextDecrypt)
     {
         // the common parameters: the plaintext and the polynomial moduli
@@ -5,9 +5,16 @@
 #include "seal/galoiskeys.h"
 #include "seal/context.h"
 #include "seal/keygenerator.h"
+#include "seal/batchencoder.h"
+#include "seal/decryptor.h"
+#include "seal/encryptor.h"
+#include "seal/evaluator.h"
+#include "seal/mappedfile.h"
 #include "seal/util/uintcore.h"
 #include "seal/modulus.h"
 #include "seal/util/polyarithsmallmod.h"
+#include <cstdio>
+#include <fstream>
 #include <vector>
 
 using namespace seal;
@@ -200,6 +207,132 @@ namespace SEALTest
             test_keys.load(context, stream);
             GaloisKeys keys = keygen.galois_keys();
             compare_kswitchkeys(keys, test_keys, secret_key, context);
+
+            keygen.galois_keys_save(stream, compr_mode_type::bitpack);
+            test_keys.load(context, stream);
+            compare_kswitchkeys(keys, test_keys, secret_key, context);
+        }
+    }
+
+    TEST(GaloisKeysTest, GaloisKeysBitPackedSaveLoad)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(256);
+        parms.set_plain_modulus(65537);
+        parms.set_coeff_modulus(CoeffModulus::Create(256, { 60, 50 }));
+        auto context = SEALContext::Create(parms, false, sec_level_type::none);
+        KeyGenerator keygen(context);
+
+        stringstream stream;
+        GaloisKeys keys = keygen.galois_keys();
+        GaloisKeys test_keys;
+        auto full_size = keys.save(stream, compr_mode_type::none);
+        test_keys.load(context, stream);
+        auto packed_size = keys.save(stream, compr_mode_type::bitpack);
+        ASSERT_EQ(keys.save_size(compr_mode_type::bitpack), packed_size);
+        ASSERT_GT(full_size, packed_size * 9 / 8);
+        ASSERT_EQ(packed_size, test_keys.load(context, stream));
+        ASSERT_EQ(keys.data().size(), test_keys.data().size());
+        ASSERT_TRUE(keys.parms_id() == test_keys.parms_id());
+        for (size_t j = 0; j < test_keys.data().size(); j++)
+        {
+            ASSERT_EQ(keys.data()[j].size(), test_keys.data()[j].size());
+            for (size_t i = 0; i < test_keys.data()[j].size(); i++)
+            {
+                ASSERT_EQ(keys.data()[j][i].data().int_array().size(), test_keys.data()[j][i].data().int_array().size());
+                ASSERT_TRUE(is_equal_uint_uint(keys.data()[j][i].data().data(), test_keys.data()[j][i].data().data(), keys.data()[j][i].data().int_array().size()));
+            }
+        }
+#ifdef SEAL_USE_ZLIB
+        auto packed_deflate_size = keys.save(stream, compr_mode_type::bitpack_deflate);
+        ASSERT_GE(keys.save_size(compr_mode_type::bitpack_deflate), packed_deflate_size);
+        ASSERT_EQ(packed_deflate_size, test_keys.load(context, stream));
+        ASSERT_TRUE(is_equal_uint_uint(keys.data()[1][0].data().data(), test_keys.data()[1][0].data().data(), keys.data()[1][0].data().int_array().size()));
+#endif
+#ifdef SEAL_USE_ZSTD
+        auto zstd_size = keys.save(stream, compr_mode_type::zstd);
+        ASSERT_GE(keys.save_size(compr_mode_type::zstd), zstd_size);
+        ASSERT_GT(full_size, zstd_size);
+        ASSERT_EQ(zstd_size, test_keys.load(context, stream));
+        ASSERT_TRUE(is_equal_uint_uint(keys.data()[1][0].data().data(), test_keys.data()[1][0].data().data(), keys.data()[1][0].data().int_array().size()));
+#endif
+    }
+
+    TEST(GaloisKeysTest, GaloisKeysLoadViewMappedFile)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(64);
+        parms.set_plain_modulus(65537);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 60, 60 }));
+        auto context = SEALContext::Create(parms, false, sec_level_type::none);
+        KeyGenerator keygen(context);
+
+        const string path = "galoiskeys_load_view_test.bin";
+        GaloisKeys keys = keygen.galois_keys();
+        {
+            ofstream file(path, ios::binary);
+            ASSERT_EQ(keys.save_aligned_size(), keys.save_aligned(file));
+        }
+
+        {
+            MappedFile mapped(path);
+            ASSERT_EQ(static_cast<size_t>(keys.save_aligned_size()), mapped.size());
+            ASSERT_EQ(0ULL, reinterpret_cast<uintptr_t>(mapped.data()) % 64);
+
+            GaloisKeys test_keys;
+            test_keys.load_view(context, mapped.data(), mapped.size());
+            ASSERT_TRUE(keys.parms_id() == test_keys.parms_id());
+            ASSERT_EQ(keys.data().size(), test_keys.data().size());
+            for (size_t j = 0; j < test_keys.data().size(); j++)
+            {
+                ASSERT_EQ(keys.data()[j].size(), test_keys.data()[j].size());
+                for (size_t i = 0; i < test_keys.data()[j].size(); i++)
+                {
+                    auto &key = keys.data()[j][i].data();
+                    auto &test_key = test_keys.data()[j][i].data();
+                    ASSERT_EQ(key.int_array().size(), test_key.int_array().size());
+                    ASSERT_TRUE(is_equal_uint_uint(key.data(), test_key.data(), key.int_array().size()));
+                    ASSERT_TRUE(test_key.data() >= reinterpret_cast<uint64_t*>(mapped.data()));
+                }
+            }
+
+            // The keys work directly from the mapped file
+            BatchEncoder encoder(context);
+            Encryptor encryptor(context, keygen.public_key());
+            Decryptor decryptor(context, keygen.secret_key());
+            Evaluator evaluator(context);
+            vector<uint64_t> values(encoder.slot_count());
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                values[i] = i;
+            }
+            Plaintext plain;
+            encoder.encode(values, plain);
+            Ciphertext encrypted;
+            encryptor.encrypt(plain, encrypted);
+            evaluator.rotate_rows_inplace(encrypted, 1, test_keys);
+            decryptor.decrypt(encrypted, plain);
+            vector<uint64_t> result;
+            encoder.decode(plain, result);
+            size_t row_size = values.size() / 2;
+            for (size_t i = 0; i < row_size; i++)
+            {
+                ASSERT_EQ(values[(i + 1) % row_size], result[i]);
+                ASSERT_EQ(values[row_size + (i + 1) % row_size], result[row_size + i]);
+            }
+
+            // Data in the view layout is not accepted by load and vice versa
+            ASSERT_THROW(test_keys.unsafe_load(context, mapped.data(), mapped.size()), logic_error);
+            stringstream stream;
+            keys.save(stream, compr_mode_type::none);
+            string str = stream.str();
+            vector<uint64_t> buffer((str.size() + 7) / 8);
+            auto buffer_bytes = reinterpret_cast<SEAL_BYTE*>(buffer.data());
+            copy_n(reinterpret_cast<const SEAL_BYTE*>(str.data()), str.size(), buffer_bytes);
+            ASSERT_THROW(test_keys.load_view(context, buffer_bytes, str.size()), logic_error);
         }
+        remove(path.c_str());
+
+        ASSERT_THROW(MappedFile("galoiskeys_load_view_test_missing.bin"), runtime_error);
     }
 }
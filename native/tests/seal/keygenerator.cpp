@@ -9,6 +9,8 @@
 #include "seal/decryptor.h"
 #include "seal/evaluator.h"
 #include "seal/valcheck.h"
+#include "seal/batchencoder.h"
+#include <sstream>
 
 using namespace seal;
 using namespace seal::util;
@@ -369,4 +371,87 @@ namespace SEALTest
         decryptor.decrypt(ct, ptres);
         ASSERT_EQ("1x^4 + 4x^2 + 4", ptres.to_string());
     }
+
+    TEST(KeyGeneratorTest, ParallelAndStreamingGaloisKeys)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(128);
+        parms.set_plain_modulus(PlainModulus::Batching(128, 20));
+        parms.set_coeff_modulus(CoeffModulus::Create(128, { 40, 40, 40 }));
+        auto context = SEALContext::Create(parms, false, sec_level_type::none);
+        Evaluator evaluator(context);
+        BatchEncoder encoder(context);
+
+        KeyGenerator keygen(context);
+        ASSERT_EQ(1ULL, keygen.thread_count());
+        Encryptor encryptor(context, keygen.public_key());
+        Decryptor decryptor(context, keygen.secret_key());
+
+        vector<uint64_t> values(encoder.slot_count());
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            values[i] = i;
+        }
+        Plaintext plain;
+        encoder.encode(values, plain);
+        Ciphertext encrypted;
+        encryptor.encrypt(plain, encrypted);
+
+        auto check_rotation = [&](const GaloisKeys &galk) {
+            Ciphertext rotated;
+            evaluator.rotate_rows(encrypted, 3, galk, rotated);
+            evaluator.rotate_columns_inplace(rotated, galk);
+            Plaintext plain_rotated;
+            decryptor.decrypt(rotated, plain_rotated);
+            vector<uint64_t> result;
+            encoder.decode(plain_rotated, result);
+            size_t row_size = values.size() / 2;
+            for (size_t i = 0; i < row_size; i++)
+            {
+                ASSERT_EQ(values[row_size + (i + 3) % row_size], result[i]);
+                ASSERT_EQ(values[(i + 3) % row_size], result[row_size + i]);
+            }
+        };
+
+        for (size_t thread_count : { size_t(0), size_t(3) })
+        {
+            keygen.set_thread_count(thread_count);
+            ASSERT_EQ(thread_count, keygen.thread_count());
+
+            RelinKeys rlk = keygen.relin_keys();
+            ASSERT_TRUE(is_valid_for(rlk, context));
+
+            GaloisKeys galk = keygen.galois_keys();
+            ASSERT_TRUE(is_valid_for(galk, context));
+            check_rotation(galk);
+
+            // Streaming save must produce exactly what GaloisKeys::load expects
+            stringstream stream;
+            auto out_size = keygen.galois_keys_save(stream, compr_mode_type::none);
+            ASSERT_EQ(out_size, static_cast<streamoff>(stream.str().size()));
+            GaloisKeys loaded;
+            ASSERT_EQ(out_size, loaded.load(context, stream));
+            ASSERT_EQ(galk.size(), loaded.size());
+            check_rotation(loaded);
+
+            // Duplicate and unordered elements, and a buffer destination
+            vector<uint64_t> elts{ 255, 3, 255, 9 };
+            vector<SEAL_BYTE> buffer(1 << 20);
+            out_size = keygen.galois_keys_save(elts, buffer.data(), buffer.size(),
+                compr_mode_type::none);
+            ASSERT_EQ(out_size, loaded.load(context, buffer.data(), buffer.size()));
+            ASSERT_EQ(3ULL, loaded.size());
+            ASSERT_TRUE(loaded.has_key(3));
+            ASSERT_TRUE(loaded.has_key(9));
+            ASSERT_TRUE(loaded.has_key(255));
+            ASSERT_TRUE(is_valid_for(loaded, context));
+
+            stream.str("");
+            keygen.galois_keys_save(vector<uint64_t>{}, stream);
+            loaded.load(context, stream);
+            ASSERT_EQ(0ULL, loaded.size());
+
+            ASSERT_THROW(keygen.galois_keys_save(vector<uint64_t>{ 2 }, stream), invalid_argument);
+        }
+    }
 }
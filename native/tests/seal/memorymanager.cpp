@@ -6,6 +6,13 @@
 #include "seal/memorymanager.h"
 #include "seal/intarray.h"
 #include "seal/util/uintcore.h"
+#include "seal/context.h"
+#include "seal/keygenerator.h"
+#include "seal/encryptor.h"
+#include "seal/evaluator.h"
+#include "seal/ckks.h"
+#include <chrono>
+#include <thread>
 
 using namespace seal;
 using namespace seal::util;
@@ -67,4 +74,211 @@ namespace SEALTest
         }
         ASSERT_EQ(1L, pool.use_count());
     }
-}
\ No newline at end of file
+
+    TEST(MemoryPoolHandleTest, TrimAndInUse)
+    {
+        MemoryPoolHandle pool;
+        ASSERT_EQ(0ULL, pool.in_use_byte_count());
+        ASSERT_EQ(0ULL, pool.trim());
+
+        pool = MemoryPoolHandle::New();
+        {
+            auto ptr = allocate_uint(100, pool);
+            ASSERT_EQ(800ULL, pool.in_use_byte_count());
+            ASSERT_EQ(0ULL, pool.trim());
+        }
+        ASSERT_EQ(0ULL, pool.in_use_byte_count());
+        ASSERT_EQ(800ULL, pool.alloc_byte_count());
+        ASSERT_EQ(0ULL, pool.trim(800));
+        ASSERT_EQ(800ULL, pool.trim());
+        ASSERT_EQ(0ULL, pool.alloc_byte_count());
+    }
+
+    TEST(MemoryPoolHandleTest, MemoryPoolTrimmer)
+    {
+        ASSERT_THROW(MemoryPoolTrimmer(MemoryPoolHandle(), chrono::milliseconds(10)),
+            invalid_argument);
+        ASSERT_THROW(MemoryPoolTrimmer(MemoryPoolHandle::New(), chrono::milliseconds(0)),
+            invalid_argument);
+        ASSERT_THROW(MemoryPoolTrimmer(MemoryPoolHandle(make_shared<MemoryPoolST>()),
+            chrono::milliseconds(10)), invalid_argument);
+
+        MemoryPoolHandle pool = MemoryPoolHandle::New();
+        auto in_use = allocate_uint(10, pool);
+        {
+            auto big = allocate_uint(1000, pool);
+        }
+        ASSERT_EQ(8080ULL, pool.alloc_byte_count());
+
+        MemoryPoolTrimmer trimmer(pool, chrono::milliseconds(20));
+        for (int i = 0; i < 500 && pool.alloc_byte_count() > 80; i++)
+        {
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+
+        // Only the unused memory is released
+        ASSERT_EQ(80ULL, pool.alloc_byte_count());
+        ASSERT_EQ(8000ULL, trimmer.released_byte_count());
+        ASSERT_EQ(80ULL, pool.in_use_byte_count());
+    }
+
+    TEST(MemoryPoolHandleTest, SizeClasses)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(1024);
+        parms.set_coeff_modulus(CoeffModulus::Create(1024, { 50, 30, 30, 30, 30, 50 }));
+        auto context = SEALContext::Create(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+        auto relin_keys = keygen.relin_keys();
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        CKKSEncoder encoder(context);
+
+        // Square and rescale down the modulus switching chain, allocating
+        // everything from the given pool
+        auto workload = [&](MemoryPoolHandle pool) {
+            Plaintext plain(pool);
+            encoder.encode(1.0, std::pow(2.0, 30), plain, pool);
+            Ciphertext encrypted(pool);
+            encryptor.encrypt(plain, encrypted, pool);
+            while (encrypted.coeff_mod_count() > 1)
+            {
+                evaluator.square_inplace(encrypted, pool);
+                evaluator.relinearize_inplace(encrypted, relin_keys, pool);
+                evaluator.rescale_to_next_inplace(encrypted, pool);
+            }
+            return pool.alloc_byte_count();
+        };
+
+        auto exact_pool = MemoryPoolHandle::New();
+        auto classes_pool = MemoryPoolHandle::New(false, true);
+        size_t exact_byte_count = workload(exact_pool);
+        size_t classes_byte_count = workload(classes_pool);
+        ASSERT_TRUE(classes_pool.pool_count() < exact_pool.pool_count());
+        ASSERT_TRUE(classes_byte_count < exact_byte_count);
+
+        // Also through the memory manager
+        auto pool = MemoryManager::GetPool(mm_prof_opt::FORCE_NEW, false, true);
+        ASSERT_EQ(classes_byte_count, workload(pool));
+    }
+
+    TEST(MemoryPoolHandleTest, MMProfArena)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(1024);
+        parms.set_coeff_modulus(CoeffModulus::Create(1024, { 50, 30, 30, 50 }));
+        auto context = SEALContext::Create(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+        auto relin_keys = keygen.relin_keys();
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        CKKSEncoder encoder(context);
+
+        // Results live in the global pool; temporaries come from the arena
+        auto global_pool = MemoryPoolHandle::Global();
+        Plaintext plain(global_pool);
+        encoder.encode(1.0, std::pow(2.0, 30), plain, global_pool);
+        Ciphertext encrypted(global_pool);
+        encryptor.encrypt(plain, encrypted, global_pool);
+
+        auto arena = MemoryPoolHandle::Arena(size_t(1) << 20);
+        for (int request = 0; request < 2; request++)
+        {
+            Ciphertext result(encrypted, global_pool);
+            {
+                MMProfGuard guard(make_unique<MMProfArena>(arena));
+                ASSERT_TRUE(MemoryManager::GetPool() == arena);
+                evaluator.square_inplace(result);
+                evaluator.relinearize_inplace(result, relin_keys);
+                evaluator.rescale_to_next_inplace(result);
+                ASSERT_EQ(0ULL, arena.in_use_byte_count());
+            }
+
+            // The arena was reset at the end of the scope
+            auto stats = dynamic_cast<MemoryPoolArena &>(
+                static_cast<MemoryPool &>(arena)).stats();
+            ASSERT_EQ(static_cast<size_t>(request + 1), stats.reset_count);
+            ASSERT_EQ(0ULL, stats.used_byte_count);
+            ASSERT_TRUE(stats.peak_used_byte_count > 0);
+            ASSERT_EQ(0ULL, stats.overflow_count);
+            ASSERT_EQ(size_t(1) << 20, arena.alloc_byte_count());
+        }
+
+        // Memory still in use prevents a reset
+        MMProfArena prof(4096, false);
+        MemoryPool &prof_pool = prof.get_pool(mm_prof_opt::DEFAULT);
+        {
+            Pointer<SEAL_BYTE> ptr = prof_pool.get_for_byte_count(100);
+            ASSERT_THROW(prof.reset(), logic_error);
+
+            // Without overflow, allocations beyond the capacity fail
+            ASSERT_THROW((void)prof_pool.get_for_byte_count(4096), bad_alloc);
+            ASSERT_EQ(1ULL, prof.statistics().overflow_count);
+        }
+        prof.reset();
+        ASSERT_EQ(0ULL, prof.statistics().used_byte_count);
+
+        ASSERT_THROW(MMProfArena(MemoryPoolHandle::New()), invalid_argument);
+        ASSERT_THROW(MMProfArena(0), invalid_argument);
+    }
+
+    TEST(MemoryPoolHandleTest, SizeStats)
+    {
+        MemoryPoolHandle pool;
+        ASSERT_TRUE(pool.size_stats().empty());
+
+        pool = MemoryPoolHandle::New();
+        {
+            IntArray<uint64_t> array(10, pool);
+        }
+        auto stats = pool.size_stats();
+        ASSERT_EQ(1ULL, stats.size());
+        ASSERT_EQ(80ULL, stats[0].item_byte_count);
+        ASSERT_EQ(1ULL, stats[0].miss_count);
+        ASSERT_EQ(0ULL, stats[0].in_use_count);
+    }
+#ifdef SEAL_USE_ALLOCATION_TRACING
+    TEST(MemoryPoolHandleTest, AllocationTracing)
+    {
+        EncryptionParameters parms(scheme_type::BFV);
+        parms.set_poly_modulus_degree(1024);
+        parms.set_coeff_modulus(CoeffModulus::BFVDefault(1024));
+        parms.set_plain_modulus(65537);
+        auto context = SEALContext::Create(parms, false, sec_level_type::none);
+        KeyGenerator keygen(context);
+        Encryptor encryptor(context, keygen.public_key());
+        Evaluator evaluator(context);
+        Ciphertext encrypted;
+        encryptor.encrypt_zero(encrypted);
+
+        // Attribute new memory to the innermost and outermost sites
+        size_t multiply_byte_count = 0;
+        size_t untraced_count = 0;
+        set_allocation_trace_hook([&](const allocation_event &event) {
+            if (!event.site)
+            {
+                untraced_count++;
+                return;
+            }
+            const AllocationSite *outer = event.site;
+            while (outer->parent())
+            {
+                outer = outer->parent();
+            }
+            if (string(outer->name()) == "Evaluator::multiply_inplace")
+            {
+                multiply_byte_count += event.item_byte_count;
+            }
+        });
+        {
+            SEAL_ALLOCATION_SITE("test");
+            ASSERT_STREQ("test", AllocationSite::Current()->name());
+        }
+        ASSERT_TRUE(AllocationSite::Current() == nullptr);
+
+        evaluator.multiply_inplace(encrypted, encrypted, MemoryPoolHandle::New());
+        set_allocation_trace_hook(nullptr);
+        ASSERT_TRUE(multiply_byte_count > 0);
+    }
+#endif
+}
@@ -161,4 +161,41 @@ namespace SEALTest
             ASSERT_TRUE(plain2.is_ntt_form());
         }
     }
+
+    TEST(PlaintextTest, SaveAlignedLoadView)
+    {
+        EncryptionParameters parms(scheme_type::CKKS);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 30, 30 }));
+
+        auto context = SEALContext::Create(parms, false, sec_level_type::none);
+        CKKSEncoder encoder(context);
+
+        Plaintext plain;
+        encoder.encode(vector<double>{ 0.1, 2.3, 34.4 }, pow(2.0, 20), plain);
+        stringstream stream;
+        auto out_size = plain.save_aligned(stream);
+        ASSERT_EQ(plain.save_aligned_size(), out_size);
+
+        string str = stream.str();
+        vector<uint64_t> buffer((str.size() + 7) / 8);
+        auto buffer_bytes = reinterpret_cast<SEAL_BYTE*>(buffer.data());
+        copy_n(reinterpret_cast<const SEAL_BYTE*>(str.data()), str.size(), buffer_bytes);
+
+        Plaintext plain2;
+        ASSERT_EQ(out_size, plain2.load_view(context, buffer_bytes, str.size()));
+        ASSERT_TRUE(plain2.is_ntt_form());
+        ASSERT_TRUE(plain2.parms_id() == plain.parms_id());
+        ASSERT_EQ(plain.scale(), plain2.scale());
+        ASSERT_EQ(plain.coeff_count(), plain2.coeff_count());
+        ASSERT_TRUE(plain2.data() >= buffer.data() &&
+            plain2.data() < buffer.data() + buffer.size());
+        for (size_t i = 0; i < plain.coeff_count(); i++)
+        {
+            ASSERT_EQ(plain[i], plain2[i]);
+        }
+
+        // Data in the view layout is not accepted by load
+        ASSERT_THROW(plain2.load(context, stream), logic_error);
+    }
 }
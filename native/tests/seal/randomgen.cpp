@@ -211,4 +211,64 @@ namespace SEALTest
             ASSERT_TRUE(find(results.begin(), results.end(), value) != results.end());
         }
     }
+
+    TEST(RandomGenerator, BufferSize)
+    {
+        ASSERT_THROW(BlakePRNG({}, 0), invalid_argument);
+        ASSERT_THROW(BlakePRNG({}, 100), invalid_argument);
+        ASSERT_THROW(AESPRNG({}, UniformRandomGenerator::buffer_size_max + 64),
+            invalid_argument);
+
+        BlakePRNGFactory factory;
+        ASSERT_EQ(UniformRandomGenerator::buffer_size_default, factory.buffer_size());
+        ASSERT_THROW(factory.set_buffer_size(0), invalid_argument);
+        ASSERT_THROW(factory.set_buffer_size(4000), invalid_argument);
+        factory.set_buffer_size(1 << 16);
+        ASSERT_EQ(size_t(1) << 16, factory.buffer_size());
+        ASSERT_EQ(size_t(1) << 16, factory.create()->buffer_size());
+    }
+
+    TEST(RandomGenerator, AESPRNG)
+    {
+        AESPRNGFactory factory1({ 1, 2, 3, 4, 5, 6, 7, 8 });
+        AESPRNGFactory factory2({ 1, 2, 3, 4, 5, 6, 7, 8 });
+        factory2.set_buffer_size(64);
+        auto generator1 = factory1.create();
+        auto generator2 = factory2.create();
+        auto generator3 = AESPRNGFactory({ 1, 2, 3, 4, 5, 6, 7, 9 }).create();
+
+        // The counter-mode stream does not depend on the buffer size
+        array<uint64_t, 1000> values1, values2, values3;
+        generator1->generate(sizeof(values1), reinterpret_cast<SEAL_BYTE*>(values1.data()));
+        generator2->generate(sizeof(values2), reinterpret_cast<SEAL_BYTE*>(values2.data()));
+        generator3->generate(sizeof(values3), reinterpret_cast<SEAL_BYTE*>(values3.data()));
+        ASSERT_TRUE(values1 == values2);
+        for (size_t i = 0; i < values1.size(); i++)
+        {
+            ASSERT_NE(values1[i], values3[i]);
+        }
+        ASSERT_EQ(values1.size(), set<uint64_t>(values1.cbegin(), values1.cend()).size());
+    }
+
+    TEST(RandomGenerator, Shake128PRNG)
+    {
+        // The first output bytes are SHAKE-128 of the little-endian seed words
+        auto generator1 = Shake128PRNGFactory({ 1, 2, 3, 4, 5, 6, 7, 8 }).create();
+        array<uint8_t, 16> expected{
+            0x17, 0xC9, 0x4E, 0xE9, 0xC4, 0x2B, 0x12, 0x10,
+            0x2F, 0xCF, 0xA2, 0x58, 0x9B, 0xF1, 0x20, 0x40 };
+        array<uint8_t, 16> output;
+        generator1->generate(output.size(), reinterpret_cast<SEAL_BYTE*>(output.data()));
+        ASSERT_TRUE(expected == output);
+
+        Shake128PRNGFactory factory2({ 1, 2, 3, 4, 5, 6, 7, 8 });
+        factory2.set_buffer_size(128);
+        auto generator2 = factory2.create();
+        auto generator3 = Shake128PRNGFactory({ 1, 2, 3, 4, 5, 6, 7, 8 }).create();
+        array<uint64_t, 1000> values2, values3;
+        generator2->generate(sizeof(values2), reinterpret_cast<SEAL_BYTE*>(values2.data()));
+        generator3->generate(sizeof(values3), reinterpret_cast<SEAL_BYTE*>(values3.data()));
+        ASSERT_TRUE(values2 == values3);
+        ASSERT_EQ(values2.size(), set<uint64_t>(values2.cbegin(), values2.cend()).size());
+    }
 }
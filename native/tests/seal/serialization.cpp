@@ -1,10 +1,16 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT license.
 
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
 #include <sstream>
 #include <fstream>
 #include <string>
 #include <functional>
+#include <vector>
 #include "gtest/gtest.h"
 #include "seal/util/defines.h"
 #include "seal/serialization.h"
@@ -12,6 +18,49 @@
 using namespace seal;
 using namespace std;
 
+namespace
+{
+    // The global allocation functions are replaced to track the number of
+    // bytes allocated, so that tests can check the peak memory use of an
+    // operation; each allocation is prefixed by its size
+    constexpr size_t allocation_prefix_size = alignof(max_align_t);
+
+    atomic<size_t> allocated_byte_count(0);
+
+    atomic<size_t> peak_allocated_byte_count(0);
+}
+
+void *operator new(size_t size)
+{
+    auto ptr = static_cast<char*>(malloc(size + allocation_prefix_size));
+    if (!ptr)
+    {
+        throw bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(ptr) = size;
+    size_t count = allocated_byte_count += size;
+    size_t peak = peak_allocated_byte_count;
+    while (count > peak && !peak_allocated_byte_count.compare_exchange_weak(peak, count))
+    {
+    }
+    return ptr + allocation_prefix_size;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr)
+    {
+        auto base = static_cast<char*>(ptr) - allocation_prefix_size;
+        allocated_byte_count -= *reinterpret_cast<size_t*>(base);
+        free(base);
+    }
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
 namespace SEALTest
 {
     struct test_struct
@@ -73,9 +122,146 @@ namespace SEALTest
         ASSERT_EQ(st.a, st3.a);
         ASSERT_EQ(st.b, st3.b);
         ASSERT_EQ(st.c, st3.c);
+#endif
+        // Objects without coefficient data are saved unchanged when bit-packing
+        test_struct st4;
+        ASSERT_TRUE(Serialization::IsSupportedComprMode(compr_mode_type::bitpack));
+        out_size = Serialization::Save(
+            bind(&test_struct::save_members, &st, _1),
+            st.save_size(compr_mode_type::none),
+            stream, compr_mode_type::bitpack);
+        ASSERT_EQ(st.save_size(compr_mode_type::bitpack), out_size);
+        in_size = Serialization::Load(
+            bind(&test_struct::load_members, &st4, _1),
+            stream);
+        ASSERT_EQ(out_size, in_size);
+        ASSERT_EQ(st.a, st4.a);
+        ASSERT_EQ(st.b, st4.b);
+        ASSERT_EQ(st.c, st4.c);
+#ifdef SEAL_USE_ZSTD
+        test_struct st5;
+        out_size = Serialization::Save(
+            bind(&test_struct::save_members, &st, _1),
+            st.save_size(compr_mode_type::none),
+            stream, compr_mode_type::zstd);
+        ASSERT_TRUE(st.save_size(compr_mode_type::zstd) >= out_size);
+        in_size = Serialization::Load(
+            bind(&test_struct::load_members, &st5, _1),
+            stream);
+        ASSERT_EQ(out_size, in_size);
+        ASSERT_EQ(st.a, st5.a);
+        ASSERT_EQ(st.b, st5.b);
+        ASSERT_EQ(st.c, st5.c);
 #endif
     }
 
+    TEST(SerializationTest, SaveToAppendStream)
+    {
+        test_struct st{ 3, ~0, 3.14159 };
+        using namespace std::placeholders;
+        auto save = [&](ostream &stream, compr_mode_type compr_mode) {
+            return Serialization::Save(
+                bind(&test_struct::save_members, &st, _1),
+                st.save_size(compr_mode_type::none),
+                stream, compr_mode);
+        };
+
+        // Modes that complete the header after the data must not seek back in a
+        // file stream, which writes at the end of the file in append mode
+        const string path = "serialization_append_test.bin";
+        vector<compr_mode_type> compr_modes{ compr_mode_type::none, compr_mode_type::bitpack };
+#ifdef SEAL_USE_ZLIB
+        compr_modes.push_back(compr_mode_type::deflate);
+#endif
+        vector<streamoff> out_sizes;
+        {
+            ofstream file(path, ios::binary);
+            out_sizes.push_back(save(file, compr_modes[0]));
+        }
+        for (size_t i = 1; i < compr_modes.size(); i++)
+        {
+            ofstream file(path, ios::binary | ios::app);
+            out_sizes.push_back(save(file, compr_modes[i]));
+        }
+
+        ifstream file(path, ios::binary);
+        for (auto out_size : out_sizes)
+        {
+            test_struct st2{ 0, 0, 0 };
+            ASSERT_EQ(out_size, Serialization::Load(
+                bind(&test_struct::load_members, &st2, _1), file));
+            ASSERT_EQ(st.a, st2.a);
+            ASSERT_EQ(st.b, st2.b);
+            ASSERT_EQ(st.c, st2.c);
+        }
+        ASSERT_EQ(char_traits<char>::eof(), file.peek());
+        file.close();
+        remove(path.c_str());
+    }
+
+    TEST(SerializationTest, SaveToFileMemoryUse)
+    {
+        // Writes 8 MB of 40-bit values, compressible roughly as coefficients are
+        const streamoff data_size = streamoff(1) << 23;
+        const size_t block_uint64_count = 512;
+        auto next_block = [&](vector<uint64_t> &block, uint64_t &state) {
+            for (auto &value : block)
+            {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                value = state >> 24;
+            }
+        };
+        auto save_members = [&](ostream &stream) {
+            vector<uint64_t> block(block_uint64_count);
+            uint64_t state = 1;
+            for (streamoff i = 0; i < data_size; i += sizeof(uint64_t) * block_uint64_count)
+            {
+                next_block(block, state);
+                stream.write(reinterpret_cast<const char*>(block.data()),
+                    static_cast<streamsize>(sizeof(uint64_t) * block_uint64_count));
+            }
+        };
+        auto load_members = [&](istream &stream) {
+            vector<uint64_t> block(block_uint64_count), expected(block_uint64_count);
+            uint64_t state = 1;
+            for (streamoff i = 0; i < data_size; i += sizeof(uint64_t) * block_uint64_count)
+            {
+                next_block(expected, state);
+                stream.read(reinterpret_cast<char*>(block.data()),
+                    static_cast<streamsize>(sizeof(uint64_t) * block_uint64_count));
+                ASSERT_TRUE(block == expected);
+            }
+        };
+        auto raw_size = static_cast<streamoff>(sizeof(Serialization::SEALHeader)) + data_size;
+
+        // Neither the uncompressed nor the compressed data is held in memory
+        // when saving to a file stream; only the state of the compressor and
+        // its fixed-size chunks are
+        const string path = "serialization_memory_test.bin";
+        vector<compr_mode_type> compr_modes{ compr_mode_type::bitpack };
+#ifdef SEAL_USE_ZLIB
+        compr_modes.push_back(compr_mode_type::deflate);
+#endif
+        for (auto compr_mode : compr_modes)
+        {
+            streamoff out_size = 0;
+            size_t peak_byte_count = 0;
+            {
+                ofstream file(path, ios::binary);
+                size_t base_byte_count = allocated_byte_count;
+                peak_allocated_byte_count = base_byte_count;
+                out_size = Serialization::Save(save_members, raw_size, file, compr_mode);
+                peak_byte_count = peak_allocated_byte_count - base_byte_count;
+            }
+            ASSERT_TRUE(peak_byte_count < static_cast<size_t>(data_size / 8));
+
+            ifstream file(path, ios::binary);
+            ASSERT_EQ(out_size, Serialization::Load(load_members, file));
+            ASSERT_EQ(char_traits<char>::eof(), file.peek());
+        }
+        remove(path.c_str());
+    }
+
     TEST(SerializationTest, SaveLoadToBuffer)
     {
         test_struct st{ 3, ~0, 3.14159 }, st2;
@@ -135,4 +321,147 @@ namespace SEALTest
         ASSERT_EQ(st.c, st3.c);
 #endif
     }
+#ifdef SEAL_USE_ZLIB
+    namespace
+    {
+        // An output buffer without support for seeking
+        class AppendOnlyBuffer : public streambuf
+        {
+        public:
+            string data;
+
+        private:
+            int_type overflow(int_type ch) override
+            {
+                if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                {
+                    data.push_back(traits_type::to_char_type(ch));
+                }
+                return traits_type::not_eof(ch);
+            }
+
+            streamsize xsputn(const char *s, streamsize count) override
+            {
+                data.append(s, static_cast<size_t>(count));
+                return count;
+            }
+        };
+    }
+
+    TEST(SerializationTest, DeflateChunkedSaveLoad)
+    {
+        // Spans many compression chunks
+        vector<uint64_t> data(100000);
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = (i * 0x9E3779B97F4A7C15ULL) >> 40;
+        }
+        auto data_size = static_cast<streamoff>(data.size() * sizeof(uint64_t));
+        auto save_members = [&](ostream &stream) {
+            stream.write(reinterpret_cast<const char*>(data.data()), data_size);
+        };
+        auto raw_size = static_cast<streamoff>(sizeof(Serialization::SEALHeader)) + data_size;
+        vector<uint64_t> data2(data.size());
+        auto load_members = [&](istream &stream) {
+            stream.read(reinterpret_cast<char*>(data2.data()), data_size);
+        };
+
+        // Two objects back to back in a seekable stream
+        stringstream stream;
+        auto out_size = Serialization::Save(save_members, raw_size, stream, compr_mode_type::deflate);
+        ASSERT_TRUE(out_size < raw_size);
+        ASSERT_EQ(out_size, static_cast<streamoff>(stream.tellp()));
+        auto out_size2 = Serialization::Save(save_members, raw_size, stream, compr_mode_type::deflate);
+        ASSERT_EQ(out_size, out_size2);
+        ASSERT_EQ(out_size, Serialization::Load(load_members, stream));
+        ASSERT_TRUE(data == data2);
+        ASSERT_EQ(out_size, static_cast<streamoff>(stream.tellg()));
+        data2.assign(data2.size(), 0);
+        ASSERT_EQ(out_size, Serialization::Load(load_members, stream));
+        ASSERT_TRUE(data == data2);
+
+        // A stream that cannot seek back to the header gives the same output
+        AppendOnlyBuffer append_only_buffer;
+        ostream append_only_stream(&append_only_buffer);
+        Serialization::Save(save_members, raw_size, append_only_stream, compr_mode_type::deflate);
+        ASSERT_EQ(stream.str().substr(0, static_cast<size_t>(out_size)), append_only_buffer.data);
+
+        // Truncated or corrupted data is rejected
+        string saved = append_only_buffer.data;
+        stringstream truncated_stream(saved.substr(0, saved.size() - 4));
+        ASSERT_THROW(Serialization::Load(load_members, truncated_stream), runtime_error);
+        saved[saved.size() / 2] ^= 0x5A;
+        stringstream corrupted_stream(saved);
+        ASSERT_ANY_THROW(Serialization::Load(load_members, corrupted_stream));
+    }
+#endif
+#ifdef SEAL_USE_ZSTD
+    TEST(SerializationTest, ZstdChunkedSaveLoad)
+    {
+        using namespace std::placeholders;
+
+        // Large enough to be split into several chunks
+        vector<uint64_t> data(3 * (size_t(1) << 20) / sizeof(uint64_t) + 123);
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = (i * 0x9E3779B97F4A7C15ULL) >> 34;
+        }
+        auto data_size = static_cast<streamoff>(data.size() * sizeof(uint64_t));
+        auto save_members = [&](ostream &stream) {
+            stream.write(reinterpret_cast<const char*>(data.data()), data_size);
+        };
+        auto raw_size = static_cast<streamoff>(sizeof(Serialization::SEALHeader)) + data_size;
+        auto size_bound = static_cast<streamoff>(sizeof(Serialization::SEALHeader)) +
+            static_cast<streamoff>(Serialization::ComprSizeEstimate(
+                static_cast<size_t>(data_size), compr_mode_type::zstd));
+
+        stringstream invalid_stream;
+        ASSERT_THROW(Serialization::Save(save_members, raw_size, invalid_stream,
+            CompressionParameters(compr_mode_type::zstd, 1000)), invalid_argument);
+
+        for (size_t thread_count : { size_t(1), size_t(4) })
+        {
+            for (int level : { 1, 3, 9 })
+            {
+                stringstream stream;
+                auto out_size = Serialization::Save(save_members, raw_size, stream,
+                    CompressionParameters(compr_mode_type::zstd, level, thread_count));
+                ASSERT_TRUE(out_size < raw_size);
+                ASSERT_TRUE(out_size <= size_bound);
+
+                vector<uint64_t> data2(data.size());
+                auto in_size = Serialization::Load([&](istream &stream) {
+                    stream.read(reinterpret_cast<char*>(data2.data()), data_size);
+                }, stream);
+                ASSERT_EQ(out_size, in_size);
+                ASSERT_TRUE(data == data2);
+
+                // Truncated data is rejected
+                string truncated = stream.str().substr(0, static_cast<size_t>(out_size) - 8);
+                stringstream truncated_stream(truncated);
+                ASSERT_THROW(Serialization::Load([&](istream &stream) {
+                    stream.read(reinterpret_cast<char*>(data2.data()), data_size);
+                }, truncated_stream), runtime_error);
+            }
+        }
+
+        // A frame that decompresses to more or less than the content size in its
+        // frame header is rejected
+        stringstream stream;
+        Serialization::Save(save_members, raw_size, stream, compr_mode_type::zstd);
+        string saved = stream.str();
+        size_t frame_start = sizeof(Serialization::SEALHeader);
+        uint8_t descriptor = static_cast<uint8_t>(saved[frame_start + 4]);
+        bool single_segment = (descriptor >> 5) & 1;
+        size_t content_size_offset = frame_start + 5 + (single_segment ? 0 : 1) +
+            vector<size_t>{ 0, 1, 2, 4 }[descriptor & 3];
+        ASSERT_TRUE(single_segment || (descriptor >> 6));
+        saved[content_size_offset] ^= 1;
+        stringstream corrupted_stream(saved);
+        vector<uint64_t> data2(data.size());
+        ASSERT_THROW(Serialization::Load([&](istream &stream) {
+            stream.read(reinterpret_cast<char*>(data2.data()), data_size);
+        }, corrupted_stream), logic_error);
+    }
+#endif
 }
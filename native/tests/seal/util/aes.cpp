@@ -0,0 +1,83 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/util/aes.h"
+#include <array>
+#include <cstdint>
+
+using namespace seal::util;
+using namespace seal;
+using namespace std;
+
+namespace SEALTest
+{
+    namespace util
+    {
+        TEST(AESTest, EncryptBlock)
+        {
+            auto encrypt = [](const AES128CTR &aes, const array<uint8_t, 16> &input) {
+                array<uint8_t, 16> output;
+                aes.encrypt_block(reinterpret_cast<const SEAL_BYTE*>(input.data()),
+                    reinterpret_cast<SEAL_BYTE*>(output.data()));
+                return output;
+            };
+
+            // Both the AES-NI and the portable implementation must pass
+            for (bool allow_aes_ni : { true, false })
+            {
+                // Test vector from FIPS-197, Appendix C.1
+                AES128CTR aes({ 0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL }, 0,
+                    allow_aes_ni);
+                array<uint8_t, 16> expected{
+                    0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30,
+                    0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A };
+                ASSERT_TRUE(expected == encrypt(aes, {
+                    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                    0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }));
+
+                // Test vector from FIPS-197, Appendix B
+                AES128CTR aes2({ 0xA6D2AE2816157E2BULL, 0x3C4FCF098815F7ABULL }, 0,
+                    allow_aes_ni);
+                expected = {
+                    0x39, 0x25, 0x84, 0x1D, 0x02, 0xDC, 0x09, 0xFB,
+                    0xDC, 0x11, 0x85, 0x97, 0x19, 0x6A, 0x0B, 0x32 };
+                ASSERT_TRUE(expected == encrypt(aes2, {
+                    0x32, 0x43, 0xF6, 0xA8, 0x88, 0x5A, 0x30, 0x8D,
+                    0x31, 0x31, 0x98, 0xA2, 0xE0, 0x37, 0x07, 0x34 }));
+            }
+        }
+
+        TEST(AESTest, Keystream)
+        {
+            uint64_t nonce = 0x0123456789ABCDEFULL;
+            AES128CTR::key_type key{ 0x1122334455667788ULL, 0x99AABBCCDDEEFF00ULL };
+            array<uint8_t, 16 * 6> portable_stream;
+            AES128CTR(key, nonce, false).keystream(
+                5, 6, reinterpret_cast<SEAL_BYTE*>(portable_stream.data()));
+
+            for (bool allow_aes_ni : { true, false })
+            {
+                AES128CTR aes(key, nonce, allow_aes_ni);
+                array<uint8_t, 16 * 6> stream;
+                aes.keystream(5, 6, reinterpret_cast<SEAL_BYTE*>(stream.data()));
+                ASSERT_TRUE(portable_stream == stream);
+
+                for (uint64_t i = 0; i < 6; i++)
+                {
+                    array<uint8_t, 16> counter_block;
+                    for (size_t k = 0; k < 8; k++)
+                    {
+                        counter_block[k] = static_cast<uint8_t>(nonce >> (8 * k));
+                        counter_block[k + 8] = static_cast<uint8_t>((5 + i) >> (8 * k));
+                    }
+                    array<uint8_t, 16> expected;
+                    aes.encrypt_block(reinterpret_cast<const SEAL_BYTE*>(counter_block.data()),
+                        reinterpret_cast<SEAL_BYTE*>(expected.data()));
+                    ASSERT_TRUE(equal(expected.cbegin(), expected.cend(),
+                        stream.cbegin() + static_cast<ptrdiff_t>(16 * i)));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,146 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/util/galois.h"
+#include "seal/util/polyarithsmallmod.h"
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+using namespace seal;
+using namespace seal::util;
+using namespace std;
+
+namespace SEALTest
+{
+    namespace util
+    {
+        TEST(GaloisTest, DecomposeRotation)
+        {
+            auto sum_mod = [](const vector<int> &steps, int row_size) {
+                int sum = accumulate(steps.begin(), steps.end(), 0) % row_size;
+                return sum < 0 ? sum + row_size : sum;
+            };
+
+            vector<int> result = decompose_rotation(5, { 1, 4 }, 64);
+            ASSERT_EQ(2ULL, result.size());
+            ASSERT_EQ(5, sum_mod(result, 32));
+
+            result = decompose_rotation(7, { 1, -1, 8 }, 64);
+            ASSERT_EQ(2ULL, result.size());
+            ASSERT_EQ(7, sum_mod(result, 32));
+
+            result = decompose_rotation(-3, { 1, 4 }, 64);
+            ASSERT_EQ(8ULL, result.size());
+            ASSERT_EQ(29, sum_mod(result, 32));
+
+            result = decompose_rotation(-3, { 1, -4 }, 64);
+            ASSERT_EQ(2ULL, result.size());
+            ASSERT_EQ(29, sum_mod(result, 32));
+
+            result = decompose_rotation(4, { 4 }, 64);
+            ASSERT_EQ(1ULL, result.size());
+            ASSERT_EQ(4, result[0]);
+
+            result = decompose_rotation(31, { 1 }, 64);
+            ASSERT_EQ(31ULL, result.size());
+
+            // Odd rotations cannot be composed from even steps
+            ASSERT_TRUE(decompose_rotation(3, { 2 }, 64).empty());
+            ASSERT_TRUE(decompose_rotation(3, {}, 64).empty());
+
+            ASSERT_THROW((void)decompose_rotation(0, { 1 }, 64), invalid_argument);
+            ASSERT_THROW((void)decompose_rotation(32, { 1 }, 64), invalid_argument);
+            ASSERT_THROW((void)decompose_rotation(1, { 32 }, 64), invalid_argument);
+            ASSERT_THROW((void)decompose_rotation(1, { 1 }, 63), invalid_argument);
+        }
+
+        TEST(GaloisTest, PlanRotationSteps)
+        {
+            vector<int> result = plan_rotation_steps({ { 3, 10 }, { 5, 10 } }, 64, 2);
+            ASSERT_EQ((vector<int>{ 3, 5 }), result);
+
+            // No keys beyond those that save key switches
+            result = plan_rotation_steps({ { 3, 10 }, { 5, 10 } }, 64, 10);
+            ASSERT_EQ((vector<int>{ 3, 5 }), result);
+
+            // Every requested rotation must be reachable before counts matter
+            result = plan_rotation_steps({ { 2, 100000 }, { 3, 1 } }, 64, 1);
+            ASSERT_EQ(1ULL, result.size());
+            ASSERT_FALSE(decompose_rotation(2, result, 64).empty());
+            ASSERT_FALSE(decompose_rotation(3, result, 64).empty());
+
+            result = plan_rotation_steps({ { 3, 100 }, { 6, 1 } }, 64, 1);
+            ASSERT_EQ((vector<int>{ 3 }), result);
+
+            // Steps that are the same rotation share a key
+            result = plan_rotation_steps({ { 30, 1 }, { -2, 1 } }, 64, 2);
+            ASSERT_EQ((vector<int>{ -2 }), result);
+
+            // Every plan reaches all rotations; with enough keys each takes one
+            // key switch
+            map<int, size_t> step_counts{ { 1, 50 }, { 2, 40 }, { 3, 30 },
+                { 7, 20 }, { -5, 10 }, { 13, 5 }, { -11, 1 } };
+            for (size_t max_key_count = 1; max_key_count < 10; max_key_count++)
+            {
+                result = plan_rotation_steps(step_counts, 64, max_key_count);
+                ASSERT_TRUE(result.size() <= max_key_count);
+                size_t key_switch_count = 0;
+                for (auto &step_count : step_counts)
+                {
+                    size_t length = decompose_rotation(
+                        step_count.first, result, 64).size();
+                    ASSERT_NE(0ULL, length);
+                    key_switch_count += length * step_count.second;
+                }
+                if (max_key_count >= step_counts.size())
+                {
+                    ASSERT_EQ(156ULL, key_switch_count);
+                }
+            }
+
+            // A zero step needs a key of its own
+            result = plan_rotation_steps({ { 0, 1 }, { 1, 1 } }, 64, 2);
+            ASSERT_EQ((vector<int>{ 0, 1 }), result);
+            result = plan_rotation_steps({ { 0, 1 }, { 1, 0 } }, 64, 1);
+            ASSERT_EQ((vector<int>{ 0 }), result);
+            ASSERT_THROW((void)plan_rotation_steps({ { 0, 1 }, { 1, 1 } }, 64, 1),
+                invalid_argument);
+
+            ASSERT_TRUE(plan_rotation_steps({}, 64, 1).empty());
+            ASSERT_THROW((void)plan_rotation_steps({ { 1, 1 } }, 64, 0), invalid_argument);
+            ASSERT_THROW((void)plan_rotation_steps({ { 32, 1 } }, 64, 4), invalid_argument);
+        }
+
+        TEST(GaloisTest, GaloisTool)
+        {
+            GaloisTool galois_tool(3);
+            SmallModulus mod(17);
+            vector<uint64_t> operand{ 0, 1, 2, 3, 4, 5, 6, 7 };
+            vector<uint64_t> expected(8), result(8);
+            for (uint64_t galois_elt : { 1, 3, 5, 9, 15 })
+            {
+                apply_galois(operand.data(), 3, galois_elt, mod, expected.data());
+                apply_permutation(operand.data(), galois_tool.permutation(galois_elt),
+                    8, mod, result.data());
+                ASSERT_TRUE(expected == result);
+
+                apply_galois_ntt(operand.data(), 3, galois_elt, expected.data());
+                apply_permutation_ntt(operand.data(), galois_tool.ntt_permutation(galois_elt),
+                    8, result.data());
+                ASSERT_TRUE(expected == result);
+            }
+
+            // Tables are computed once
+            ASSERT_EQ(galois_tool.permutation(3), galois_tool.permutation(3));
+            ASSERT_EQ(galois_tool.ntt_permutation(3), galois_tool.ntt_permutation(3));
+            ASSERT_NE(galois_tool.permutation(3), galois_tool.ntt_permutation(3));
+
+            ASSERT_THROW((void)galois_tool.permutation(2), invalid_argument);
+            ASSERT_THROW((void)galois_tool.ntt_permutation(17), invalid_argument);
+            ASSERT_THROW(GaloisTool(0), invalid_argument);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/util/keccak.h"
+#include <array>
+#include <cstdint>
+#include <string>
+
+using namespace seal::util;
+using namespace seal;
+using namespace std;
+
+namespace SEALTest
+{
+    namespace util
+    {
+        TEST(KeccakTest, Shake128Empty)
+        {
+            Shake128 shake;
+            array<uint8_t, 32> output;
+            shake.squeeze(reinterpret_cast<SEAL_BYTE*>(output.data()), output.size());
+
+            array<uint8_t, 32> expected{
+                0x7F, 0x9C, 0x2B, 0xA4, 0xE8, 0x8F, 0x82, 0x7D, 0x61, 0x60, 0x45, 0x50,
+                0x76, 0x05, 0x85, 0x3E, 0xD7, 0x3B, 0x80, 0x93, 0xF6, 0xEF, 0xBC, 0x88,
+                0xEB, 0x1A, 0x6E, 0xAC, 0xFA, 0x66, 0xEF, 0x26 };
+            ASSERT_TRUE(expected == output);
+        }
+
+        TEST(KeccakTest, Shake128MultiBlock)
+        {
+            // Input and output both span several 168-byte blocks
+            string input;
+            for (int i = 0; i < 100; i++)
+            {
+                input += "abc";
+            }
+            Shake128 shake;
+            shake.absorb(reinterpret_cast<const SEAL_BYTE*>(input.data()), 100);
+            shake.absorb(reinterpret_cast<const SEAL_BYTE*>(input.data() + 100), 200);
+
+            array<uint8_t, 400> output;
+            shake.squeeze(reinterpret_cast<SEAL_BYTE*>(output.data()), 7);
+            shake.squeeze(reinterpret_cast<SEAL_BYTE*>(output.data() + 7), 393);
+
+            array<uint8_t, 16> expected{
+                0xDB, 0x64, 0x5E, 0x80, 0xB5, 0xDD, 0x20, 0x63, 0x43, 0xC2, 0x33, 0x56,
+                0x5C, 0x7D, 0x36, 0xF0 };
+            ASSERT_TRUE(equal(expected.cbegin(), expected.cend(), output.cbegin() + 384));
+
+            ASSERT_THROW(shake.absorb(
+                reinterpret_cast<const SEAL_BYTE*>(input.data()), 1), logic_error);
+            shake.reset();
+            shake.absorb(reinterpret_cast<const SEAL_BYTE*>(input.data()), 1);
+        }
+    }
+}
@@ -6,6 +6,9 @@
 #include "seal/util/pointer.h"
 #include "seal/util/common.h"
 #include <memory>
+#include <thread>
+#include <vector>
+#include <atomic>
 
 using namespace seal;
 using namespace seal::util;
@@ -343,6 +346,396 @@ namespace SEALTest
             }
         }
 
+        TEST(MemoryPoolTests, ConcurrentMT)
+        {
+            MemoryPoolMT pool;
+            const size_t thread_count = 8;
+            const size_t sizes[] = { 1, 3, 8, 64, 1000 };
+            atomic<bool> corrupted{ false };
+            vector<thread> threads;
+            for (size_t t = 0; t < thread_count; t++)
+            {
+                threads.emplace_back([&, t]() {
+                    // Each thread writes a unique pattern and checks it is not
+                    // overwritten while it owns the allocation; freed items are
+                    // returned to free lists that other threads also use
+                    for (uint64_t round = 0; round < 500; round++)
+                    {
+                        vector<Pointer<uint64_t>> ptrs;
+                        for (size_t size : sizes)
+                        {
+                            auto ptr = Pointer<uint64_t>(
+                                pool.get_for_byte_count(size * bytes_per_uint64));
+                            uint64_t tag = (t << 32) ^ (round << 8) ^ size;
+                            fill_n(ptr.get(), size, tag);
+                            ptrs.emplace_back(move(ptr));
+                        }
+                        for (size_t i = 0; i < ptrs.size(); i++)
+                        {
+                            uint64_t tag = (t << 32) ^ (round << 8) ^ sizes[i];
+                            for (size_t j = 0; j < sizes[i]; j++)
+                            {
+                                if (ptrs[i][j] != tag)
+                                {
+                                    corrupted = true;
+                                }
+                            }
+                        }
+                    }
+                });
+            }
+            for (auto &th : threads)
+            {
+                th.join();
+            }
+            ASSERT_FALSE(corrupted);
+            ASSERT_EQ(5ULL, pool.pool_count());
+
+            // Each thread holds at most one item of each size at a time
+            size_t max_byte_count = 0;
+            for (size_t size : sizes)
+            {
+                max_byte_count += 2 * thread_count * size * bytes_per_uint64;
+            }
+            ASSERT_TRUE(pool.alloc_byte_count() <= max_byte_count);
+
+            // A new pool at the same address must not hit stale cache entries
+            MemoryPoolMT pool2;
+            Pointer<uint64_t> ptr = pool2.get_for_byte_count(3 * bytes_per_uint64);
+            ASSERT_EQ(1ULL, pool2.pool_count());
+        }
+
+        template<typename PoolType>
+        void test_trim()
+        {
+            PoolType pool;
+            ASSERT_EQ(0ULL, pool.in_use_byte_count());
+            ASSERT_EQ(0ULL, pool.trim(0));
+
+            vector<Pointer<SEAL_BYTE>> ptrs;
+            for (int i = 0; i < 20; i++)
+            {
+                ptrs.emplace_back(pool.get_for_byte_count(1000));
+            }
+            ptrs.emplace_back(pool.get_for_byte_count(8));
+            ASSERT_EQ(20008ULL, pool.in_use_byte_count());
+            size_t alloc_byte_count = pool.alloc_byte_count();
+            ASSERT_TRUE(alloc_byte_count >= 20008ULL);
+
+            // Nothing can be released while everything is in use
+            ASSERT_EQ(0ULL, pool.trim(0));
+
+            // Keep the very first item; its batch cannot be released
+            for (size_t i = 1; i < ptrs.size(); i++)
+            {
+                ptrs[i].release();
+            }
+            ASSERT_EQ(1000ULL, pool.in_use_byte_count());
+
+            // Trimming with a large retention releases nothing
+            ASSERT_EQ(0ULL, pool.trim(alloc_byte_count));
+            ASSERT_EQ(alloc_byte_count, pool.alloc_byte_count());
+
+            size_t released = pool.trim(0);
+            ASSERT_EQ(alloc_byte_count - 1000ULL, released);
+            ASSERT_EQ(1000ULL, pool.alloc_byte_count());
+            ASSERT_EQ(1000ULL, pool.in_use_byte_count());
+            ASSERT_EQ(2ULL, pool.pool_count());
+
+            // The pool keeps working after all batches of a size are gone
+            Pointer<SEAL_BYTE> ptr = pool.get_for_byte_count(8);
+            fill_n(ptr.get(), 8, SEAL_BYTE(1));
+            ptr.release();
+            ptrs[0].release();
+            ASSERT_EQ(0ULL, pool.in_use_byte_count());
+            ASSERT_EQ(1008ULL, pool.trim(0));
+            ASSERT_EQ(0ULL, pool.alloc_byte_count());
+            for (int i = 0; i < 3; i++)
+            {
+                ptrs[i] = pool.get_for_byte_count(1000);
+                fill_n(ptrs[i].get(), 1000, SEAL_BYTE(2));
+            }
+            ASSERT_EQ(3000ULL, pool.in_use_byte_count());
+        }
+
+        TEST(MemoryPoolTests, TrimMT)
+        {
+            test_trim<MemoryPoolMT>();
+            test_trim<MemoryPoolST>();
+
+            // Items can be returned concurrently with trimming
+            MemoryPoolMT pool(true);
+            atomic<bool> done{ false };
+            thread trimmer([&]() {
+                while (!done)
+                {
+                    pool.trim(0);
+                }
+            });
+            vector<thread> threads;
+            for (size_t t = 0; t < 4; t++)
+            {
+                threads.emplace_back([&, t]() {
+                    for (int round = 0; round < 200; round++)
+                    {
+                        vector<Pointer<uint64_t>> ptrs;
+                        for (size_t i = 0; i < 8; i++)
+                        {
+                            ptrs.emplace_back(pool.get_for_byte_count((i + 1) * bytes_per_uint64));
+                            fill_n(ptrs.back().get(), i + 1, t);
+                        }
+                        for (size_t i = 0; i < 8; i++)
+                        {
+                            ASSERT_EQ(t, ptrs[i][i]);
+                        }
+                    }
+                });
+            }
+            for (auto &th : threads)
+            {
+                th.join();
+            }
+            done = true;
+            trimmer.join();
+            ASSERT_EQ(0ULL, pool.in_use_byte_count());
+            pool.trim(0);
+            ASSERT_EQ(0ULL, pool.alloc_byte_count());
+        }
+
+        TEST(MemoryPoolTests, SizeClasses)
+        {
+            ASSERT_EQ(0ULL, MemoryPool::size_class_byte_count(0));
+            ASSERT_EQ(64ULL, MemoryPool::size_class_byte_count(1));
+            ASSERT_EQ(64ULL, MemoryPool::size_class_byte_count(64));
+            ASSERT_EQ(128ULL, MemoryPool::size_class_byte_count(65));
+            ASSERT_EQ(192ULL, MemoryPool::size_class_byte_count(129));
+            ASSERT_EQ(256ULL, MemoryPool::size_class_byte_count(193));
+            ASSERT_EQ(3072ULL, MemoryPool::size_class_byte_count(2049));
+            ASSERT_EQ(4096ULL, MemoryPool::size_class_byte_count(3073));
+            ASSERT_EQ(6144ULL, MemoryPool::size_class_byte_count(4097));
+            ASSERT_EQ(8192ULL, MemoryPool::size_class_byte_count(6145));
+            ASSERT_EQ(12288ULL, MemoryPool::size_class_byte_count(8193));
+            for (size_t byte_count = 1; byte_count < (size_t(1) << 20); byte_count = byte_count * 5 / 4 + 1)
+            {
+                size_t class_byte_count = MemoryPool::size_class_byte_count(byte_count);
+                ASSERT_TRUE(class_byte_count >= byte_count);
+                ASSERT_EQ(class_byte_count, MemoryPool::size_class_byte_count(class_byte_count));
+                ASSERT_TRUE(class_byte_count <= 2 * byte_count || class_byte_count == 64);
+                if (byte_count > 128)
+                {
+                    ASSERT_TRUE(3 * (class_byte_count - byte_count) <= class_byte_count);
+                }
+            }
+
+            // Polynomials with 1 to 8 RNS components, as with ciphertexts at
+            // different levels, allocated one after another
+            auto level_workload = [](MemoryPool &pool) {
+                const size_t poly_byte_count = 4096 * bytes_per_uint64;
+                for (size_t k = 8; k >= 1; k--)
+                {
+                    Pointer<uint64_t> ptr = pool.get_for_byte_count(k * poly_byte_count);
+                    fill_n(ptr.get(), k * 4096, k);
+                }
+                return pool.alloc_byte_count();
+            };
+            MemoryPoolMT exact_mt, classes_mt(false, true);
+            MemoryPoolST exact_st, classes_st(false, true);
+            size_t exact_byte_count = level_workload(exact_mt);
+            ASSERT_EQ(36ULL * 4096 * bytes_per_uint64, exact_byte_count);
+            ASSERT_EQ(8ULL, exact_mt.pool_count());
+            ASSERT_EQ(24ULL * 4096 * bytes_per_uint64, level_workload(classes_mt));
+            ASSERT_EQ(6ULL, classes_mt.pool_count());
+            ASSERT_EQ(exact_byte_count, level_workload(exact_st));
+            ASSERT_EQ(24ULL * 4096 * bytes_per_uint64, level_workload(classes_st));
+
+            // The rounded size is what is in use
+            Pointer<SEAL_BYTE> ptr = classes_mt.get_for_byte_count(100);
+            ASSERT_EQ(128ULL, classes_mt.in_use_byte_count());
+        }
+
+        TEST(MemoryPoolTests, AlignmentAndHugePages)
+        {
+            ASSERT_EQ(8ULL, MemoryPool::item_stride(8));
+            ASSERT_EQ(64ULL, MemoryPool::item_stride(64));
+            ASSERT_EQ(128ULL, MemoryPool::item_stride(65));
+            ASSERT_EQ(832ULL, MemoryPool::item_stride(800));
+
+            auto is_aligned = [](const void *ptr) {
+                return reinterpret_cast<uintptr_t>(ptr) % MemoryPool::alloc_alignment == 0;
+            };
+            auto check_alignment = [&](MemoryPool &pool) {
+                for (size_t byte_count : { 64, 100, 800, 1000, 4096 * 8 })
+                {
+                    // Several items per size so that items later in a batch are checked
+                    vector<Pointer<SEAL_BYTE>> ptrs;
+                    for (int i = 0; i < 5; i++)
+                    {
+                        ptrs.emplace_back(pool.get_for_byte_count(byte_count));
+                        ASSERT_TRUE(is_aligned(ptrs.back().get()));
+                    }
+                }
+            };
+            MemoryPoolMT pool_mt;
+            check_alignment(pool_mt);
+            MemoryPoolST pool_st;
+            check_alignment(pool_st);
+
+            // Huge pages fall back to regular allocations if unavailable
+            auto check_huge_pages = [&](MemoryPool &pool) {
+                size_t byte_count = size_t(4) << 20;
+                {
+                    Pointer<SEAL_BYTE> ptr = pool.get_for_byte_count(byte_count);
+                    ASSERT_TRUE(is_aligned(ptr.get()));
+                    fill_n(ptr.get(), byte_count, static_cast<SEAL_BYTE>(1));
+                    ASSERT_TRUE(static_cast<SEAL_BYTE>(1) == ptr[byte_count - 1]);
+                    Pointer<SEAL_BYTE> small = pool.get_for_byte_count(100);
+                    ASSERT_TRUE(is_aligned(small.get()));
+                }
+                ASSERT_EQ(0ULL, pool.in_use_byte_count());
+                ASSERT_EQ(byte_count + 100, pool.trim(0));
+            };
+            MemoryPoolMT huge_mt(true, false, true);
+            check_huge_pages(huge_mt);
+            MemoryPoolST huge_st(true, false, true);
+            check_huge_pages(huge_st);
+        }
+
+        TEST(MemoryPoolTests, SizeStats)
+        {
+            auto test_stats = [](MemoryPool &pool, size_t hit_count) {
+                {
+                    Pointer<SEAL_BYTE> a = pool.get_for_byte_count(100);
+                    Pointer<SEAL_BYTE> b = pool.get_for_byte_count(100);
+                    Pointer<SEAL_BYTE> c = pool.get_for_byte_count(200);
+                }
+                {
+                    Pointer<SEAL_BYTE> a = pool.get_for_byte_count(100);
+                }
+                auto stats = pool.size_stats();
+                ASSERT_EQ(2ULL, stats.size());
+                ASSERT_EQ(200ULL, stats[0].item_byte_count);
+                ASSERT_EQ(100ULL, stats[1].item_byte_count);
+                ASSERT_EQ(0ULL, stats[0].in_use_count);
+                ASSERT_EQ(1ULL, stats[0].peak_in_use_count);
+                ASSERT_EQ(2ULL, stats[1].peak_in_use_count);
+                ASSERT_EQ(1ULL, stats[0].miss_count);
+                ASSERT_EQ(3 - hit_count, stats[1].miss_count);
+                ASSERT_EQ(hit_count, stats[1].hit_count);
+            };
+            MemoryPoolMT pool_mt;
+            test_stats(pool_mt, 1);
+            MemoryPoolST pool_st;
+            test_stats(pool_st, 1);
+
+            // Arenas never reuse memory
+            MemoryPoolArena pool_arena(4096);
+            test_stats(pool_arena, 0);
+        }
+
+        TEST(MemoryPoolTests, SizeStatsConcurrentMT)
+        {
+            MemoryPoolMT pool;
+            auto worker = [&pool]() {
+                for (int i = 0; i < 1000; i++)
+                {
+                    Pointer<SEAL_BYTE> ptr = pool.get_for_byte_count(64 * (i % 3 + 1));
+                }
+            };
+            vector<thread> threads;
+            for (int i = 0; i < 4; i++)
+            {
+                threads.emplace_back(worker);
+            }
+            for (auto &t : threads)
+            {
+                t.join();
+            }
+            auto stats = pool.size_stats();
+            ASSERT_EQ(3ULL, stats.size());
+            for (auto &size_stats : stats)
+            {
+                ASSERT_EQ(0ULL, size_stats.in_use_count);
+                ASSERT_TRUE(size_stats.peak_in_use_count <= 4);
+                ASSERT_TRUE(size_stats.miss_count >= 1);
+                ASSERT_TRUE(size_stats.miss_count <= size_stats.item_count);
+                ASSERT_EQ(size_stats.item_byte_count == 64 ? 1336ULL : 1332ULL,
+                    size_stats.hit_count + size_stats.miss_count);
+                ASSERT_TRUE(size_stats.lock_wait_time.count() >= 0);
+            }
+        }
+
+        TEST(MemoryPoolTests, Arena)
+        {
+            MemoryPoolArena arena(1000);
+            ASSERT_EQ(1024ULL, arena.alloc_byte_count());
+            {
+                Pointer<uint64_t> a = arena.get_for_byte_count(800);
+                Pointer<SEAL_BYTE> b = arena.get_for_byte_count(100);
+                ASSERT_EQ(0ULL, reinterpret_cast<uintptr_t>(b.get()) % MemoryPool::alloc_alignment);
+                fill_n(a.get(), 100, uint64_t(1));
+                fill_n(b.get(), 100, static_cast<SEAL_BYTE>(2));
+                ASSERT_EQ(1ULL, a[99]);
+                ASSERT_EQ(900ULL, arena.in_use_byte_count());
+                ASSERT_EQ(2ULL, arena.pool_count());
+                ASSERT_EQ(0ULL, arena.stats().overflow_count);
+
+                // Does not fit; served from overflow memory
+                Pointer<SEAL_BYTE> c = arena.get_for_byte_count(800);
+                auto stats = arena.stats();
+                ASSERT_EQ(1ULL, stats.overflow_count);
+                ASSERT_TRUE(stats.overflow_byte_count >= 800);
+                ASSERT_TRUE(arena.alloc_byte_count() > 1024);
+
+                // Returning memory does not make it available again
+                a.release();
+                ASSERT_EQ(stats.used_byte_count, arena.stats().used_byte_count);
+                ASSERT_FALSE(arena.reset());
+            }
+            ASSERT_EQ(0ULL, arena.in_use_byte_count());
+            ASSERT_TRUE(arena.reset());
+            ASSERT_EQ(1024ULL, arena.alloc_byte_count());
+            auto stats = arena.stats();
+            ASSERT_EQ(0ULL, stats.used_byte_count);
+            ASSERT_EQ(1ULL, stats.reset_count);
+            ASSERT_TRUE(stats.peak_used_byte_count > 1024);
+
+            // The same memory is handed out again after a reset
+            Pointer<SEAL_BYTE> first = arena.get_for_byte_count(64);
+            SEAL_BYTE *first_ptr = first.get();
+            first.release();
+            ASSERT_TRUE(arena.reset());
+            Pointer<SEAL_BYTE> again = arena.get_for_byte_count(64);
+            ASSERT_EQ(first_ptr, again.get());
+            again.release();
+
+            // Trimming keeps overflow memory up to max_retained_bytes, and kept
+            // overflow memory is used before allocating more
+            {
+                Pointer<SEAL_BYTE> a = arena.get_for_byte_count(1000);
+                Pointer<SEAL_BYTE> b = arena.get_for_byte_count(1000);
+                Pointer<SEAL_BYTE> c = arena.get_for_byte_count(1000);
+                ASSERT_EQ(0ULL, arena.trim(0));
+            }
+            size_t alloc_byte_count = arena.alloc_byte_count();
+            ASSERT_TRUE(alloc_byte_count > 3 * 1024);
+            ASSERT_EQ(0ULL, arena.trim(alloc_byte_count));
+            size_t released = arena.trim(alloc_byte_count - 1);
+            ASSERT_TRUE(released > 0);
+            ASSERT_EQ(alloc_byte_count - released, arena.alloc_byte_count());
+            ASSERT_TRUE(arena.alloc_byte_count() > 1024);
+            {
+                Pointer<SEAL_BYTE> a = arena.get_for_byte_count(1000);
+                Pointer<SEAL_BYTE> b = arena.get_for_byte_count(1000);
+                ASSERT_EQ(alloc_byte_count - released, arena.alloc_byte_count());
+            }
+            arena.trim(0);
+            ASSERT_EQ(1024ULL, arena.alloc_byte_count());
+
+            MemoryPoolArena fixed(256, false);
+            ASSERT_THROW((void)fixed.get_for_byte_count(512), bad_alloc);
+            ASSERT_THROW(MemoryPoolArena(0), invalid_argument);
+        }
+
         TEST(MemoryPoolTests, TestMemoryPoolST)
         {
             {
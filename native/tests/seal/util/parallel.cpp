@@ -0,0 +1,58 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/util/parallel.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace seal::util;
+using namespace std;
+
+namespace SEALTest
+{
+    namespace util
+    {
+        TEST(ParallelTest, ParallelFor)
+        {
+            for (size_t thread_count : { 0, 1, 3, 8 })
+            {
+                vector<atomic<size_t>> calls(100);
+                atomic<bool> bad_thread_index(false);
+                parallel_for(thread_count, calls.size(), [&](size_t thread_index, size_t i) {
+                    if (thread_count && thread_index >= thread_count)
+                    {
+                        bad_thread_index = true;
+                    }
+                    calls[i]++;
+                });
+                ASSERT_FALSE(bad_thread_index);
+                for (auto &c : calls)
+                {
+                    ASSERT_EQ(1ULL, c.load());
+                }
+            }
+
+            // No tasks
+            parallel_for(4, 0, [](size_t, size_t) { throw logic_error("unexpected"); });
+
+            // Exceptions reach the caller and stop further tasks
+            for (size_t thread_count : { 1, 4 })
+            {
+                atomic<size_t> call_count(0);
+                ASSERT_THROW(parallel_for(thread_count, 1000, [&](size_t, size_t i) {
+                    call_count++;
+                    if (i == 10)
+                    {
+                        throw invalid_argument("task failed");
+                    }
+                }), invalid_argument);
+                if (thread_count == 1)
+                {
+                    ASSERT_EQ(11ULL, call_count.load());
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/randomgen.h"
+#include "seal/encryptionparams.h"
+#include "seal/util/rlwe.h"
+#include "seal/util/polycore.h"
+#include <memory>
+#include <cmath>
+#include <cstdint>
+
+using namespace seal::util;
+using namespace seal;
+using namespace std;
+
+namespace SEALTest
+{
+    namespace util
+    {
+        namespace
+        {
+            // Maps an RNS value back to a signed small value and checks that all
+            // RNS components agree.
+            int64_t get_small_value(const uint64_t *poly, size_t index,
+                const EncryptionParameters &parms)
+            {
+                size_t coeff_count = parms.poly_modulus_degree();
+                auto &coeff_modulus = parms.coeff_modulus();
+                uint64_t value = poly[index];
+                int64_t result = (value > coeff_modulus[0].value() / 2) ?
+                    -static_cast<int64_t>(coeff_modulus[0].value() - value) :
+                    static_cast<int64_t>(value);
+                for (size_t j = 1; j < coeff_modulus.size(); j++)
+                {
+                    uint64_t expected = (result < 0) ?
+                        coeff_modulus[j].value() - static_cast<uint64_t>(-result) :
+                        static_cast<uint64_t>(result);
+                    EXPECT_EQ(expected, poly[index + j * coeff_count]);
+                }
+                return result;
+            }
+        }
+
+        TEST(RLWETest, SamplePolyTernary)
+        {
+            EncryptionParameters parms(scheme_type::BFV);
+            parms.set_poly_modulus_degree(1000);
+            parms.set_coeff_modulus({ 0x7FFFFFFFFFFF7, 0xFFFFFFFFFC001, 97 });
+
+            auto rng = BlakePRNGFactory({ 1, 2, 3, 4, 5, 6, 7, 8 }).create();
+            auto poly(allocate_zero_poly(1000, 3, MemoryManager::GetPool()));
+            sample_poly_ternary(rng, parms, poly.get());
+
+            int counts[3]{ 0, 0, 0 };
+            for (size_t i = 0; i < 1000; i++)
+            {
+                int64_t value = get_small_value(poly.get(), i, parms);
+                ASSERT_TRUE(value >= -1 && value <= 1);
+                counts[value + 1]++;
+            }
+            for (int i = 0; i < 3; i++)
+            {
+                ASSERT_TRUE(counts[i] > 250 && counts[i] < 420);
+            }
+        }
+
+        TEST(RLWETest, SamplePolyCBD)
+        {
+            EncryptionParameters parms(scheme_type::BFV);
+            parms.set_poly_modulus_degree(4000);
+            parms.set_coeff_modulus({ 0x7FFFFFFFFFFF7, 0xFFFFFFFFFC001, 97 });
+
+            auto rng = BlakePRNGFactory({ 1, 2, 3, 4, 5, 6, 7, 8 }).create();
+            auto poly(allocate_zero_poly(4000, 3, MemoryManager::GetPool()));
+            sample_poly_cbd(rng, parms, poly.get());
+
+            double average = 0;
+            double stddev = 0;
+            for (size_t i = 0; i < 4000; i++)
+            {
+                int64_t value = get_small_value(poly.get(), i, parms);
+                ASSERT_TRUE(value >= -21 && value <= 21);
+                average += static_cast<double>(value);
+                stddev += static_cast<double>(value * value);
+            }
+            average /= 4000;
+            stddev = sqrt(stddev / 4000);
+            ASSERT_TRUE(average > -0.5 && average < 0.5);
+            ASSERT_TRUE(stddev > 2.8 && stddev < 3.6);
+        }
+
+        TEST(RLWETest, SamplePolyNormal)
+        {
+            EncryptionParameters parms(scheme_type::BFV);
+            parms.set_poly_modulus_degree(4000);
+            parms.set_coeff_modulus({ 0x7FFFFFFFFFFF7, 0xFFFFFFFFFC001, 97 });
+
+            auto rng = BlakePRNGFactory({ 1, 2, 3, 4, 5, 6, 7, 8 }).create();
+            auto poly(allocate_zero_poly(4000, 3, MemoryManager::GetPool()));
+            sample_poly_normal(rng, parms, poly.get());
+
+            double stddev = 0;
+            for (size_t i = 0; i < 4000; i++)
+            {
+                int64_t value = get_small_value(poly.get(), i, parms);
+                ASSERT_TRUE(value >= -20 && value <= 20);
+                stddev += static_cast<double>(value * value);
+            }
+            stddev = sqrt(stddev / 4000);
+            ASSERT_TRUE(stddev > 2.4 && stddev < 3.6);
+        }
+    }
+}
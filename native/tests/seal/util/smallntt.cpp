@@ -123,5 +123,53 @@ namespace SEALTest
                 ASSERT_EQ(temp[i], poly[i]);
             }
         }
+
+        TEST(SmallNTTTablesTest, SmallNTTTablesCacheTest)
+        {
+            MemoryPoolHandle pool = MemoryPoolHandle::Global();
+            int coeff_count_power = 4;
+            SmallModulus modulus(get_prime(uint64_t(1) << coeff_count_power, 50));
+            SmallNTTTables generated;
+            ASSERT_TRUE(generated.generate(coeff_count_power, modulus));
+
+            SmallNTTTables tables1, tables2;
+            {
+                SmallNTTTablesCache cache(coeff_count_power, pool);
+                ASSERT_TRUE(cache.get(modulus, tables1));
+                ASSERT_TRUE(cache.get(modulus, tables2));
+                ASSERT_EQ(1ULL, cache.size());
+                ASSERT_EQ(modulus.value(), tables2.modulus().value());
+                ASSERT_EQ(coeff_count_power, tables2.coeff_count_power());
+                ASSERT_EQ(generated.get_root(), tables2.get_root());
+                ASSERT_EQ(*generated.get_inv_degree_modulo(), *tables2.get_inv_degree_modulo());
+                for (size_t i = 0; i < generated.coeff_count(); i++)
+                {
+                    ASSERT_EQ(generated.get_from_root_powers(i), tables1.get_from_root_powers(i));
+                    ASSERT_EQ(generated.get_from_scaled_inv_root_powers_div_two(i),
+                        tables2.get_from_scaled_inv_root_powers_div_two(i));
+                }
+
+                auto poly(allocate_zero_poly(16, 1, pool));
+                for (size_t i = 0; i < 16; i++)
+                {
+                    poly[i] = i;
+                }
+                ntt_negacyclic_harvey(poly.get(), tables1);
+                inverse_ntt_negacyclic_harvey(poly.get(), tables2);
+                for (size_t i = 0; i < 16; i++)
+                {
+                    ASSERT_EQ(i, poly[i]);
+                }
+
+                // Failures are cached too
+                SmallModulus not_prime(uint64_t(1) << 40);
+                ASSERT_FALSE(cache.get(not_prime, tables2));
+                ASSERT_FALSE(tables2.is_generated());
+                ASSERT_FALSE(cache.get(not_prime, tables2));
+                ASSERT_EQ(2ULL, cache.size());
+
+                tables1.reset();
+            }
+        }
     }
 }
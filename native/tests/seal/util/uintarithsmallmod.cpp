@@ -183,6 +183,50 @@ namespace SEALTest
             ASSERT_EQ(1010101010101ULL, barrett_reduce_128(input, mod));
         }
 
+        TEST(UIntArithSmallMod, MontgomeryReduce128)
+        {
+            uint64_t input[2];
+
+            SmallModulus mod(3);
+            uint64_t neg_inv = montgomery_neg_inv(mod);
+            ASSERT_EQ(0xFFFFFFFFFFFFFFFFULL, neg_inv * mod.value());
+            input[0] = 0;
+            input[1] = 0;
+            ASSERT_EQ(0ULL, montgomery_reduce_128(input, mod, neg_inv));
+            input[0] = 0;
+            input[1] = 2;
+            ASSERT_EQ(2ULL, montgomery_reduce_128(input, mod, neg_inv));
+            // 2^(-64) = 1 mod 3
+            input[0] = 1;
+            input[1] = 0;
+            ASSERT_EQ(1ULL, montgomery_reduce_128(input, mod, neg_inv));
+
+            mod = 13131313131313ULL;
+            neg_inv = montgomery_neg_inv(mod);
+            ASSERT_EQ(0xFFFFFFFFFFFFFFFFULL, neg_inv * mod.value());
+            input[0] = 0;
+            input[1] = 123456789ULL;
+            ASSERT_EQ(123456789ULL, montgomery_reduce_128(input, mod, neg_inv));
+
+            mod = 0xFFFFFFFFFFFC001ULL;
+            neg_inv = montgomery_neg_inv(mod);
+            ASSERT_EQ(0xFFFFFFFFFFFFFFFFULL, neg_inv * mod.value());
+            input[0] = 0;
+            input[1] = 0xFFFFFFFFFFFC000ULL;
+            ASSERT_EQ(0xFFFFFFFFFFFC000ULL, montgomery_reduce_128(input, mod, neg_inv));
+
+            // Reducing x * y and multiplying back by 2^64 gives x * y mod q
+            input[0] = 0;
+            input[1] = 1;
+            uint64_t r = barrett_reduce_128(input, mod);
+            uint64_t x = 0x123456789ABCDEFULL;
+            uint64_t y = 0xFEDCBA987654321ULL;
+            unsigned long long z[2];
+            multiply_uint64(x, y, z);
+            ASSERT_EQ(multiply_uint_uint_mod(x, y, mod), multiply_uint_uint_mod(
+                montgomery_reduce_128(z, mod, neg_inv), r, mod));
+        }
+
         TEST(UIntArithSmallMod, MultiplyUIntUIntSmallMod)
         {
             SmallModulus mod(2);
@@ -0,0 +1,96 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "gtest/gtest.h"
+#include "seal/util/zeroencryptionpool.h"
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+using namespace seal::util;
+using namespace seal;
+using namespace std;
+
+namespace SEALTest
+{
+    namespace util
+    {
+        TEST(ZeroEncryptionPoolTest, TakeAndRefill)
+        {
+            // Each generated "ciphertext" is tagged with a unique counter value
+            atomic<uint64_t> counter{ 0 };
+            auto generator = [&counter](const parms_id_type &parms_id,
+                shared_ptr<UniformRandomGenerator> rng, Ciphertext &destination) {
+                ASSERT_TRUE(rng != nullptr);
+                destination.parms_id() = parms_id;
+                destination.scale() = static_cast<double>(++counter);
+            };
+            auto factory = UniformRandomGeneratorFactory::DefaultFactory();
+
+            ASSERT_THROW(ZeroEncryptionPool(nullptr, factory, 1, 1), invalid_argument);
+            ASSERT_THROW(ZeroEncryptionPool(generator, nullptr, 1, 1), invalid_argument);
+            ASSERT_THROW(ZeroEncryptionPool(generator, factory, 0, 1), invalid_argument);
+            ASSERT_THROW(ZeroEncryptionPool(generator, factory, 1, 0), invalid_argument);
+
+            ZeroEncryptionPool pool(generator, factory, 3, 2);
+            ASSERT_EQ(3ULL, pool.depth());
+            ASSERT_EQ(2ULL, pool.thread_count());
+
+            parms_id_type parms_id{ 1, 2, 3, 4 };
+            Ciphertext ct;
+            ASSERT_EQ(0ULL, pool.size(parms_id));
+            ASSERT_FALSE(pool.try_take(parms_id, ct));
+
+            auto wait_full = [&]() {
+                for (int i = 0; i < 1000 && pool.size(parms_id) < 3; i++)
+                {
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                }
+                return pool.size(parms_id);
+            };
+            ASSERT_EQ(3ULL, wait_full());
+
+            // Every ciphertext is handed out exactly once
+            set<double> seen;
+            for (int round = 0; round < 4; round++)
+            {
+                ASSERT_EQ(3ULL, wait_full());
+                for (int i = 0; i < 3; i++)
+                {
+                    ASSERT_TRUE(pool.try_take(parms_id, ct));
+                    ASSERT_TRUE(ct.parms_id() == parms_id);
+                    ASSERT_TRUE(seen.insert(ct.scale()).second);
+                }
+            }
+
+            // Other parms_ids are filled after reserve
+            parms_id_type other{ 5, 6, 7, 8 };
+            pool.reserve(other);
+            for (int i = 0; i < 1000 && pool.size(other) < 3; i++)
+            {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+            ASSERT_EQ(3ULL, pool.size(other));
+        }
+
+        TEST(ZeroEncryptionPoolTest, GeneratorFailure)
+        {
+            auto generator = [](const parms_id_type &,
+                shared_ptr<UniformRandomGenerator>, Ciphertext &) {
+                throw logic_error("failed");
+            };
+            ZeroEncryptionPool pool(generator,
+                UniformRandomGeneratorFactory::DefaultFactory(), 2, 1);
+            parms_id_type parms_id{ 1, 2, 3, 4 };
+            pool.reserve(parms_id);
+            this_thread::sleep_for(chrono::milliseconds(10));
+
+            // A failing level stays empty and requests keep falling back
+            Ciphertext ct;
+            ASSERT_FALSE(pool.try_take(parms_id, ct));
+            ASSERT_EQ(0ULL, pool.size(parms_id));
+        }
+    }
+}